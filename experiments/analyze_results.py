@@ -11,6 +11,7 @@ import numpy as np
 import matplotlib.pyplot as plt
 from datetime import datetime
 import pandas as pd
+import cbs_statlog
 
 class CBSResultsAnalyzer:
     def __init__(self, results_dir, timestamp):
@@ -23,26 +24,20 @@ class CBSResultsAnalyzer:
         }
         
     def parse_log_file(self, scenario):
-        """Parse statistics log file for a scenario"""
-        log_file = os.path.join(self.results_dir, f'scenario{scenario}_stats_{self.timestamp}.log')
+        """Load the binary statistics log of a scenario (written by cbs_collect)"""
+        log_file = os.path.join(self.results_dir, f'scenario{scenario}_stats_{self.timestamp}.cbsstat')
         
         if not os.path.exists(log_file):
             print(f"Warning: Log file not found: {log_file}")
             return None
-            
-        stats = {
-            'timestamps': [],
-            'rx_packets': {0: [], 1: [], 2: [], 3: []},
-            'tx_packets': {0: [], 1: [], 2: [], 3: []},
-            'rx_dropped': {0: [], 1: [], 2: [], 3: []},
-            'tx_dropped': {0: [], 1: [], 2: [], 3: []}
-        }
         
-        with open(log_file, 'r') as f:
-            lines = f.readlines()
-            
-        # Parse the log data (simplified for this example)
-        # In real implementation, parse actual format
+        log = cbs_statlog.load(log_file)
+        ports = range(len(log.ports))
+        
+        # Per-port arrays are strided views onto the mapped file
+        stats = {'timestamps': log.seconds()}
+        for counter in log.counters():
+            stats[counter] = {port: log.port_view(counter, port) for port in ports}
         
         return stats
     
@@ -58,19 +53,19 @@ class CBSResultsAnalyzer:
             'jitter': {}
         }
         
-        # Calculate throughput for each port
-        for port in range(4):
-            if len(stats['tx_packets'][port]) > 1:
-                packets = np.array(stats['tx_packets'][port])
-                time_diff = 1  # 1 second intervals
-                throughput = np.diff(packets) * 1500 * 8 / (time_diff * 1e6)  # Mbps
-                metrics['throughput'][port] = throughput.mean()
+        # Calculate throughput for each port from the byte counters and poll timestamps
+        t = stats['timestamps']
+        for port in stats['tx_bytes']:
+            if len(t) > 1 and t[-1] > t[0]:
+                octets = stats['tx_bytes'][port]
+                throughput = float(octets[-1] - octets[0]) * 8 / ((t[-1] - t[0]) * 1e6)  # Mbps
+                metrics['throughput'][port] = throughput
         
         # Calculate frame loss rate
-        for port in range(4):
-            if stats['tx_packets'][port] and stats['rx_dropped'][port]:
-                total = stats['tx_packets'][port][-1]
-                dropped = stats['rx_dropped'][port][-1]
+        for port in stats['tx_packets']:
+            if len(stats['tx_packets'][port]) and len(stats['rx_dropped'][port]):
+                total = int(stats['tx_packets'][port][-1])
+                dropped = int(stats['rx_dropped'][port][-1])
                 if total > 0:
                     metrics['frame_loss_rate'][port] = (dropped / total) * 100
                     
@@ -288,6 +283,15 @@ class CBSResultsAnalyzer:
         
     def generate_report(self):
         """Generate complete test report"""
+        # Measured throughput / loss from the collector logs
+        for scenario in (1, 2, 3):
+            metrics = self.calculate_metrics(self.parse_log_file(scenario))
+            if metrics:
+                self.data[f'scenario{scenario}']['measured'] = {
+                    name: {str(port): value for port, value in values.items()}
+                    for name, values in metrics.items()
+                }
+        
         print("Generating performance charts...")
         
         # Create all charts
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+Reader for cbs_statlog columnar statistics logs (written by cbs_collect)
+Every column is a numpy view straight onto the mapped file, nothing is parsed or copied
+"""
+
+import mmap
+import sys
+import numpy as np
+
+MAGIC = b'CBSSTAT1'
+HEADER_SIZE = 4096
+MAX_PORTS = 16
+MAX_COLUMNS = 32
+
+COLUMN_DTYPE = np.dtype([
+    ('name', 'S24'),
+    ('elem_size', '<u4'),
+    ('reserved', '<u4'),
+    ('offset', '<u8'),
+])
+
+HEADER_DTYPE = np.dtype([
+    ('magic', 'S8'),
+    ('version', '<u4'),
+    ('n_columns', '<u4'),
+    ('capacity', '<u8'),
+    ('count', '<u8'),
+    ('interval_ns', '<u8'),
+    ('start_mono_ns', '<u8'),
+    ('start_real_ns', '<u8'),
+    ('n_ports', '<u4'),
+    ('reserved', '<u4'),
+    ('ports', 'S16', (MAX_PORTS,)),
+    ('columns', COLUMN_DTYPE, (MAX_COLUMNS,)),
+])
+
+ELEM_DTYPES = {4: np.dtype('<u4'), 8: np.dtype('<u8')}
+
+
+class StatLog:
+    """Memory-mapped statistics log; columns are zero-copy numpy arrays"""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        hdr = np.frombuffer(self._map, dtype=HEADER_DTYPE, count=1)[0]
+        if hdr['magic'] != MAGIC:
+            raise ValueError(f'{path}: not a cbs_statlog file')
+
+        self.interval_ns = int(hdr['interval_ns'])
+        self.start_real_ns = int(hdr['start_real_ns'])
+        self.start_mono_ns = int(hdr['start_mono_ns'])
+        self.ports = [p.decode() for p in hdr['ports'][:hdr['n_ports']]]
+
+        # Only whole polls: the collector commits once every port is appended
+        n_ports = len(self.ports)
+        self.count = int(hdr['count']) // n_ports * n_ports
+
+        self.columns = {}
+        for col in hdr['columns'][:hdr['n_columns']]:
+            self.columns[col['name'].decode()] = np.frombuffer(
+                self._map, dtype=ELEM_DTYPES[int(col['elem_size'])],
+                count=self.count, offset=int(col['offset']))
+
+    def counters(self):
+        """Names of the counter columns"""
+        return [name for name in self.columns if name not in ('t_ns', 'port')]
+
+    def port_view(self, name, port):
+        """Strided view of one column for one port (records interleave by port)"""
+        n_ports = len(self.ports)
+        return self.columns[name].reshape(-1, n_ports)[:, port]
+
+    def seconds(self):
+        """Poll timestamps in seconds since the log was created"""
+        t = self.port_view('t_ns', 0)
+        return (t - self.start_mono_ns) / 1e9
+
+
+def load(path):
+    return StatLog(path)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print('Usage: python cbs_statlog.py <log>')
+        sys.exit(1)
+
+    log = load(sys.argv[1])
+    t = log.seconds()
+    print(f'{sys.argv[1]}: {log.count // len(log.ports)} polls x {len(log.ports)} ports, '
+          f'{t[-1] - t[0] if len(t) else 0:.1f} s, interval {log.interval_ns / 1e3:.0f} us')
+    for p, name in enumerate(log.ports):
+        last = {c: int(log.port_view(c, p)[-1]) for c in log.counters()} if len(t) else {}
+        print(f'  {name}: {last}')
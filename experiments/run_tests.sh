@@ -35,41 +35,30 @@ run_scenario() {
     sudo ../implementation/lan9692_cbs_test $scenario &
     CBS_PID=$!
     
-    # Start video streams on Port 1
-    echo "Starting video streams..."
-    ffmpeg -re -i /dev/video0 -c:v h264 -b:v 15M -f mpegts udp://192.168.1.2:5000?pkt_size=1316 &
-    STREAM1_PID=$!
+    # Video streams (TC7, TC6) and the 800 Mbps BE flood from one paced generator;
+    # every datagram carries a sequence number and transmit timestamp
+    echo "Starting video streams and BE traffic..."
+    ../implementation/cbs_trafgen -d $duration \
+        -s 192.168.1.2:5000:15:7 -s 192.168.1.3:5001:15:6 \
+        -b 192.168.1.2:5201:800 > "$RESULTS_DIR/scenario${scenario}_trafgen_${TIMESTAMP}.txt" &
+    TRAFGEN_PID=$!
     
-    ffmpeg -re -i /dev/video1 -c:v h264 -b:v 15M -f mpegts udp://192.168.1.3:5001?pkt_size=1316 &
-    STREAM2_PID=$!
-    
-    # Start BE traffic generator on Port 4
-    echo "Starting BE traffic generator..."
-    iperf3 -c 192.168.1.2 -u -b 800M -t $duration -p 5201 &
-    BE_PID=$!
-    
-    # Monitor and collect statistics
+    # Monitor and collect statistics: 1 ms binary log of all port counters
     echo "Collecting statistics..."
+    ../implementation/cbs_collect -o "$RESULTS_DIR/scenario${scenario}_stats_${TIMESTAMP}.cbsstat" \
+        -i 1000 -d $duration eth0 eth1 eth2 eth3 &
+    COLLECT_PID=$!
+    
     for ((i=0; i<$duration; i++)); do
-        # Capture switch statistics
         echo "Time: $i seconds"
-        
-        # Get port statistics
-        for port in 0 1 2 3; do
-            echo "Port $port stats:" >> "$RESULTS_DIR/scenario${scenario}_stats_${TIMESTAMP}.log"
-            cat /sys/class/net/eth${port}/statistics/rx_packets >> "$RESULTS_DIR/scenario${scenario}_stats_${TIMESTAMP}.log"
-            cat /sys/class/net/eth${port}/statistics/tx_packets >> "$RESULTS_DIR/scenario${scenario}_stats_${TIMESTAMP}.log"
-            cat /sys/class/net/eth${port}/statistics/rx_dropped >> "$RESULTS_DIR/scenario${scenario}_stats_${TIMESTAMP}.log"
-            cat /sys/class/net/eth${port}/statistics/tx_dropped >> "$RESULTS_DIR/scenario${scenario}_stats_${TIMESTAMP}.log"
-        done
-        
         sleep 1
     done
+    wait $COLLECT_PID
     
     # Stop all processes
     echo "Stopping test processes..."
-    kill $CBS_PID $STREAM1_PID $STREAM2_PID $BE_PID 2>/dev/null
-    wait $CBS_PID $STREAM1_PID $STREAM2_PID $BE_PID 2>/dev/null
+    kill $CBS_PID $TRAFGEN_PID 2>/dev/null
+    wait $CBS_PID $TRAFGEN_PID 2>/dev/null
     
     echo -e "${GREEN}Scenario $scenario completed${NC}"
     echo ""
@@ -90,7 +79,8 @@ main() {
     fi
     
     # Build the CBS test application if needed
-    if [ ! -f "../implementation/lan9692_cbs_test" ]; then
+    if [ ! -f "../implementation/lan9692_cbs_test" ] || [ ! -f "../implementation/cbs_collect" ] || \
+       [ ! -f "../implementation/cbs_trafgen" ]; then
         echo "Building CBS test application..."
         cd ../implementation
         make clean && make
@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# 단일 호스트 veth/netns 실험 환경
+# 스위치 없이 cbs_trafgen 송신 -> 수신 경로를 구성한다.
+#   송신: 기본 네임스페이스, veth0.100 (10.0.100.1)
+#   수신: 네임스페이스 cbs_rx, veth1.100 (10.0.100.2, 10.0.100.3)
+# VLAN egress-qos-map 으로 소켓 priority(=TC)가 그대로 PCP 가 된다.
+# 커널에 8021q 가 없으면 VLAN_ID=0 으로 VLAN 없이 구성한다.
+#
+# 사용법: sudo ./veth_lab.sh up|down
+
+set -euo pipefail
+
+# 네트워크 설정
+NETNS=${NETNS:-cbs_rx}
+DEV_SND=${DEV_SND:-veth0}
+DEV_RCV=${DEV_RCV:-veth1}
+VLAN_ID=${VLAN_ID:-100}
+SRC_IP="10.0.100.1"
+DST_IP_PC1="10.0.100.2"
+DST_IP_PC2="10.0.100.3"
+
+up() {
+    # veth 쌍 생성, 수신측은 별도 네임스페이스로 이동
+    ip link add "$DEV_SND" type veth peer name "$DEV_RCV"
+    ip netns add "$NETNS"
+    ip link set "$DEV_RCV" netns "$NETNS"
+
+    ip link set "$DEV_SND" up
+    ip netns exec "$NETNS" ip link set lo up
+    ip netns exec "$NETNS" ip link set "$DEV_RCV" up
+    if [ "$VLAN_ID" -eq 0 ]; then
+        SND_IF="$DEV_SND"
+        RCV_IF="$DEV_RCV"
+    else
+        SND_IF="$DEV_SND.$VLAN_ID"
+        RCV_IF="$DEV_RCV.$VLAN_ID"
+
+        # 송신측 VLAN (priority 0..7 -> PCP 0..7)
+        ip link add link "$DEV_SND" name "$SND_IF" type vlan id $VLAN_ID \
+            egress-qos-map 0:0 1:1 2:2 3:3 4:4 5:5 6:6 7:7
+        ip link set "$SND_IF" up
+        ip netns exec "$NETNS" ip link add link "$DEV_RCV" name "$RCV_IF" type vlan id $VLAN_ID
+        ip netns exec "$NETNS" ip link set "$RCV_IF" up
+    fi
+
+    # 두 개의 수신 PC 주소를 한 인터페이스에
+    ip addr add "$SRC_IP/24" dev "$SND_IF"
+    ip netns exec "$NETNS" ip addr add "$DST_IP_PC1/24" dev "$RCV_IF"
+    ip netns exec "$NETNS" ip addr add "$DST_IP_PC2/24" dev "$RCV_IF"
+
+    echo "송신: $SND_IF ($SRC_IP)"
+    echo "수신: ip netns exec $NETNS ... $RCV_IF ($DST_IP_PC1, $DST_IP_PC2)"
+}
+
+down() {
+    # 네임스페이스 삭제 시 안쪽 veth 도 함께 삭제된다
+    ip netns del "$NETNS" 2>/dev/null || true
+    ip link del "$DEV_SND" 2>/dev/null || true
+}
+
+case "${1:-}" in
+    up)   up ;;
+    down) down ;;
+    *)    echo "사용법: $0 up|down"; exit 1 ;;
+esac
@@ -117,6 +117,11 @@ cvlc udp://@:5006 \
 # 패킷 캡처 (PCP 확인용)
 sudo tcpdump -i r100 -e -vv vlan -w capture_pc1.pcap &
 
+# cbs_trafgen 스트림 분석 (손실/중복/순서/지연/지터, 1초마다 CSV 기록)
+# -o 는 이어쓰기라 실행마다 새 파일로 시작, 종료 시 요약은 analyze_pc1.txt 끝에 기록
+sudo rm -f analyze_pc1.csv
+sudo ${CBS_ANALYZE:-./cbs_analyze} -o analyze_pc1.csv r100 > analyze_pc1.txt &
+
 echo "PC1 receiver ready. Press Ctrl+C to stop."
 wait
 EOF
@@ -147,6 +152,10 @@ cvlc udp://@:5007 \
 # 패킷 캡처
 sudo tcpdump -i r100 -e -vv vlan -w capture_pc2.pcap &
 
+# cbs_trafgen 스트림 분석
+sudo rm -f analyze_pc2.csv
+sudo ${CBS_ANALYZE:-./cbs_analyze} -o analyze_pc2.csv r100 > analyze_pc2.txt &
+
 echo "PC2 receiver ready. Press Ctrl+C to stop."
 wait
 EOF
@@ -166,9 +175,9 @@ configure_board_cbs() {
     cd implementation
     
     if [[ "$mode" == "enable" ]]; then
-        sudo ./evb_lan9692_cbs enable
+        sudo EVB_TTY="$BOARD_TTY" ./evb_lan9692_cbs enable
     else
-        sudo ./evb_lan9692_cbs disable
+        sudo EVB_TTY="$BOARD_TTY" ./evb_lan9692_cbs disable
     fi
     
     cd ..
@@ -251,7 +260,7 @@ monitor_performance() {
             sudo tc -s filter show dev r100 egress >> "$RESULT_DIR/network_stats.txt"
             
             # 보드 통계
-            sudo dr mup1cc -d "$BOARD_TTY" -m get -i implementation/fetch_stats.yaml \
+            sudo EVB_TTY="$BOARD_TTY" ./implementation/evb_lan9692_cbs stats \
                 >> "$RESULT_DIR/board_stats.txt" 2>&1
             
             sleep 5
@@ -326,6 +335,24 @@ analyze_results() {
     # VLC 로그에서 드롭 프레임 확인
     echo "=== Frame Drop Analysis ===" > "$RESULT_DIR/analysis.txt"
     grep -i "drop\|lost" "$RESULT_DIR"/vlc_*.log >> "$RESULT_DIR/analysis.txt" || true
+
+    # 수신측 cbs_analyze 결과 (수신 PC에서 복사해 온 경우): 스트림별 손실
+    # 종료 요약은 끝까지 채워지지 않은 순번 구간도 손실로 셈, 없으면 구간 CSV 합계 사용
+    for pc in pc1 pc2; do
+        txt="$RESULT_DIR/analyze_$pc.txt"
+        csv="$RESULT_DIR/analyze_$pc.csv"
+        if [ -f "$txt" ] && grep -q "^=== Summary ===" "$txt"; then
+            echo "=== Stream Loss: analyze_$pc (summary) ===" >> "$RESULT_DIR/analysis.txt"
+            sed -n '/^=== Summary ===/,$p' "$txt" | tail -n +2 >> "$RESULT_DIR/analysis.txt"
+        elif [ -f "$csv" ]; then
+            echo "=== Stream Loss: analyze_$pc.csv (intervals, open gaps not counted) ===" \
+                >> "$RESULT_DIR/analysis.txt"
+            awk -F, 'NR > 1 { f[$2] += $6; l[$2] += $8; d[$2] += $9; r[$2] += $10; if ($14 > m[$2]) m[$2] = $14 }
+                     END { for (s in f) printf "%s frames %d lost %d dup %d reord %d max latency %.1f us\n",
+                                               s, f[s], l[s], d[s], r[s], m[s] / 1000 }' \
+                "$csv" >> "$RESULT_DIR/analysis.txt"
+        fi
+    done
     
     # iperf3 결과 분석
     if [ -f "$RESULT_DIR/iperf_800M.json" ]; then
@@ -358,7 +385,7 @@ main() {
     if [ ! -f "implementation/evb_lan9692_cbs" ]; then
         echo "Building CBS tool..."
         cd implementation
-        gcc -o evb_lan9692_cbs evb_lan9692_cbs.c
+        make evb_lan9692_cbs
         cd ..
     fi
     
@@ -0,0 +1,451 @@
+/**
+ * Receive-side stream analyzer
+ * Replaces grepping the VLC logs for "drop|lost" and reading rx_dropped:
+ * reads an interface through TPACKET_V3 rings, picks out the test frames
+ * of cbs_trafgen and cbs_sender (cbs_pkt payload header), demultiplexes
+ * them by VLAN, PCP, source and destination address, destination port
+ * and stream id, and keeps loss,
+ * duplicates, reordering, one-way latency and RFC 3550 jitter per
+ * stream in fixed memory (cbs_rxstat). Every interval the change since
+ * the previous one is printed, and optionally appended to a CSV file.
+ *
+ * With -t N, N rings join one PACKET_FANOUT group. Flow hashing keeps
+ * a stream on one ring, so each worker owns its streams outright; the
+ * publisher only takes a worker's lock, which the worker holds per batch.
+ *
+ * One-way latency needs sender and receiver clocks in sync (PTP, or the
+ * veth/netns lab of veth_lab.sh on one host).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <arpa/inet.h>
+#include "cbs_rx.h"
+#include "cbs_rxstat.h"
+#include "cbs_pkt.h"
+
+#define NS_PER_SEC                  1000000000ULL
+#define MAX_WORKERS                 16
+#define STREAM_SLOTS                1024            /* per worker, power of two */
+#define MAX_STREAMS                 (STREAM_SLOTS * 3 / 4)
+#define BATCH                       256             /* frames per lock hold */
+#define POLL_MS                     100
+#define DEFAULT_INTERVAL_MS         1000
+
+/* One Stream: key 0 marks a free slot */
+typedef struct {
+    uint64_t key;               /* VLAN, PCP, port and stream id; addresses in addr */
+    cbs_pkt_info_t addr;        /* first frame, for the report and the lookup */
+    cbs_rxstat_t st;
+    cbs_rxstat_counts_t prev;   /* at the previous publish */
+} stream_t;
+
+/* One Ring and the Streams It Owns */
+typedef struct {
+    int cpu;
+    cbs_rx_t *rx;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    stream_t *streams;          /* STREAM_SLOTS, open addressing */
+    stream_t *last;             /* bursts: most frames hit the previous stream */
+    uint32_t n_streams;
+    uint64_t other;             /* not test frames */
+    uint64_t overflow;          /* test frames of streams beyond MAX_STREAMS */
+    uint64_t aggregates;        /* GSO/GRO frames split back into datagrams */
+    int error;
+} worker_t;
+
+/* One Line of a Report */
+typedef struct {
+    const stream_t *s;
+    cbs_rxstat_counts_t delta;
+    cbs_hist_summary_t latency;
+    uint64_t jitter_ns;
+} row_t;
+
+static worker_t workers[MAX_WORKERS];
+static int n_workers = 1;
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+/* ===== Stream Table ===== */
+
+/* Bit 63 keeps every key non-zero */
+static inline uint64_t stream_key(const cbs_pkt_info_t *info) {
+    return 1ULL << 63 | (uint64_t)info->vid << 35 | (uint64_t)info->pcp << 32 |
+           (uint64_t)info->dst_port << 16 | info->stream;
+}
+
+/* Two senders may use the same stream ids and ports: the addresses decide */
+static inline int stream_match(const stream_t *s, uint64_t key, const cbs_pkt_info_t *info) {
+    return s->key == key && s->addr.dst_ip == info->dst_ip && s->addr.src_ip == info->src_ip;
+}
+
+static stream_t *stream_lookup(worker_t *w, const cbs_pkt_info_t *info) {
+    uint64_t key = stream_key(info);
+    uint64_t hash = key ^ ((uint64_t)info->src_ip << 32 | info->dst_ip);
+    uint32_t i;
+
+    if (w->last && stream_match(w->last, key, info)) {
+        return w->last;
+    }
+    for (i = (uint32_t)((hash * 0x9E3779B97F4A7C15ULL) >> 54) & (STREAM_SLOTS - 1);
+         w->streams[i].key != 0; i = (i + 1) & (STREAM_SLOTS - 1)) {
+        if (stream_match(&w->streams[i], key, info)) {
+            return w->last = &w->streams[i];
+        }
+    }
+    if (w->n_streams == MAX_STREAMS) {
+        return NULL;
+    }
+    w->streams[i].key = key;
+    w->streams[i].addr = *info;
+    cbs_rxstat_init(&w->streams[i].st);
+    w->n_streams++;
+    return w->last = &w->streams[i];
+}
+
+static inline void handle_frame(worker_t *w, const cbs_rx_frame_t *f) {
+    cbs_pkt_info_t info;
+    stream_t *s;
+
+    if (cbs_pkt_parse(f->data, f->len, f->vlan_tci, &info) < 0) {
+        w->other++;
+        return;
+    }
+    s = stream_lookup(w, &info);
+    if (s == NULL) {
+        w->overflow++;
+        return;
+    }
+    if (f->gso_size && info.payload_len > f->gso_size) {
+        /* Unsegmented aggregate (veth, receive GRO): the datagrams of one cbs_trafgen
+           message carry consecutive sequence numbers and the same transmit time */
+        uint32_t headers = f->wire_len - info.payload_len;
+
+        for (uint32_t off = 0; off < info.payload_len; off += f->gso_size) {
+            uint32_t seg = info.payload_len - off < f->gso_size ? info.payload_len - off : f->gso_size;
+            cbs_rxstat_update(&s->st, info.seq++, info.tx_ns, f->ts_ns, headers + seg);
+        }
+        w->aggregates++;
+        return;
+    }
+    cbs_rxstat_update(&s->st, info.seq, info.tx_ns, f->ts_ns, f->wire_len);
+}
+
+static void *worker_thread(void *arg) {
+    worker_t *w = arg;
+    cbs_rx_frame_t f;
+    cpu_set_t cpus;
+    int ret;
+
+    CPU_ZERO(&cpus);
+    CPU_SET(w->cpu, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    while (running) {
+        /* Sleep unlocked, then drain a batch under the lock */
+        ret = cbs_rx_next(w->rx, &f, POLL_MS);
+        if (ret <= 0) {
+            if (ret < 0) {
+                w->error = ret;
+                break;
+            }
+            continue;
+        }
+        pthread_mutex_lock(&w->lock);
+        for (int n = 0; ret > 0 && n < BATCH; n++) {
+            handle_frame(w, &f);
+            ret = (n + 1 < BATCH) ? cbs_rx_next(w->rx, &f, 0) : 0;
+        }
+        pthread_mutex_unlock(&w->lock);
+        if (ret < 0) {
+            w->error = ret;
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* ===== Reports ===== */
+
+static int row_compare(const void *a, const void *b) {
+    const stream_t *x = ((const row_t *)a)->s, *y = ((const row_t *)b)->s;
+
+    if (x->addr.dst_ip != y->addr.dst_ip) {
+        return ntohl(x->addr.dst_ip) < ntohl(y->addr.dst_ip) ? -1 : 1;
+    }
+    if (x->addr.src_ip != y->addr.src_ip) {
+        return ntohl(x->addr.src_ip) < ntohl(y->addr.src_ip) ? -1 : 1;
+    }
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+/* source>destination:port/stream */
+static void stream_name(const stream_t *s, char *buf, size_t size) {
+    struct in_addr src = { .s_addr = s->addr.src_ip }, dst = { .s_addr = s->addr.dst_ip };
+    char from[INET_ADDRSTRLEN], to[INET_ADDRSTRLEN];
+
+    inet_ntop(AF_INET, &src, from, sizeof(from));
+    inet_ntop(AF_INET, &dst, to, sizeof(to));
+    snprintf(buf, size, "%s>%s:%u/%u", from, to, s->addr.dst_port, s->addr.stream);
+}
+
+static void counts_delta(const cbs_rxstat_counts_t *now, const cbs_rxstat_counts_t *prev,
+                         cbs_rxstat_counts_t *delta) {
+    delta->frames = now->frames - prev->frames;
+    delta->bytes = now->bytes - prev->bytes;
+    delta->lost = now->lost - prev->lost;
+    delta->duplicates = now->duplicates - prev->duplicates;
+    delta->reordered = now->reordered - prev->reordered;
+    delta->late = now->late - prev->late;
+    delta->restarts = now->restarts - prev->restarts;
+}
+
+/* Interval report: changes since the previous one, latency of the interval */
+static void publish(double t, double interval_s, FILE *csv) {
+    static row_t rows[MAX_WORKERS * MAX_STREAMS];
+    uint64_t other = 0, overflow = 0, drops = 0;
+    size_t n = 0;
+
+    for (int i = 0; i < n_workers; i++) {
+        worker_t *w = &workers[i];
+
+        pthread_mutex_lock(&w->lock);
+        for (uint32_t j = 0; j < STREAM_SLOTS; j++) {
+            stream_t *s = &w->streams[j];
+
+            if (s->key == 0) {
+                continue;
+            }
+            rows[n].s = s;
+            counts_delta(&s->st.counts, &s->prev, &rows[n].delta);
+            cbs_rxstat_interval(&s->st, &rows[n].latency);
+            rows[n].jitter_ns = cbs_rxstat_jitter_ns(&s->st);
+            s->prev = s->st.counts;
+            n++;
+        }
+        cbs_rx_update_stats(w->rx);
+        other += w->other;
+        overflow += w->overflow;
+        drops += w->rx->stats.drops;
+        pthread_mutex_unlock(&w->lock);
+    }
+    qsort(rows, n, sizeof(rows[0]), row_compare);
+
+    printf("\n[%8.3f s] %-32s %4s %3s %2s %9s %9s %6s %5s %5s %5s %9s %9s %9s %8s\n", t, "stream", "vid",
+           "pcp", "tc", "frames", "Mbps", "lost", "dup", "reord", "late", "lat p50", "lat p99",
+           "lat max", "jitter");
+    for (size_t i = 0; i < n; i++) {
+        const row_t *r = &rows[i];
+        char name[48], vid[8];
+
+        stream_name(r->s, name, sizeof(name));
+        if (r->s->addr.vid == CBS_PKT_UNTAGGED) {
+            snprintf(vid, sizeof(vid), "-");
+        } else {
+            snprintf(vid, sizeof(vid), "%u", r->s->addr.vid);
+        }
+        printf("%12s %-32s %4s %3u %2u %9llu %9.3f %6llu %5llu %5llu %5llu %7.1fus %7.1fus %7.1fus %6.1fus\n",
+               "", name, vid, r->s->addr.pcp, r->s->addr.tc, (unsigned long long)r->delta.frames,
+               r->delta.bytes * 8 / interval_s / 1e6, (unsigned long long)r->delta.lost,
+               (unsigned long long)r->delta.duplicates, (unsigned long long)r->delta.reordered,
+               (unsigned long long)r->delta.late, r->latency.p50 / 1e3, r->latency.p99 / 1e3,
+               r->latency.max / 1e3, r->jitter_ns / 1e3);
+        if (csv) {
+            fprintf(csv, "%.3f,%s,%s,%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%u,%u,%u,%llu\n", t, name, vid,
+                    r->s->addr.pcp, r->s->addr.tc, (unsigned long long)r->delta.frames,
+                    (unsigned long long)r->delta.bytes, (unsigned long long)r->delta.lost,
+                    (unsigned long long)r->delta.duplicates, (unsigned long long)r->delta.reordered,
+                    (unsigned long long)r->delta.late, r->latency.p50, r->latency.p99,
+                    r->latency.max, (unsigned long long)r->jitter_ns);
+        }
+    }
+    printf("%12s other frames %llu, ring drops %llu, streams over the table limit %llu\n", "",
+           (unsigned long long)other, (unsigned long long)drops, (unsigned long long)overflow);
+    if (csv) {
+        fflush(csv);
+    }
+}
+
+/* Totals since start; gaps still in the window count as lost */
+static void summary(void) {
+    static row_t rows[MAX_WORKERS * MAX_STREAMS];
+    size_t n = 0;
+
+    for (int i = 0; i < n_workers; i++) {
+        for (uint32_t j = 0; j < STREAM_SLOTS; j++) {
+            if (workers[i].streams[j].key != 0) {
+                rows[n++].s = &workers[i].streams[j];
+            }
+        }
+    }
+    qsort(rows, n, sizeof(rows[0]), row_compare);
+
+    printf("\n=== Summary ===\n%-32s %10s %8s %8s %5s %5s %5s %9s %9s %9s %8s\n", "stream", "frames",
+           "lost", "loss %", "dup", "reord", "late", "lat min", "lat mean", "lat max", "jitter");
+    for (size_t i = 0; i < n; i++) {
+        const stream_t *s = rows[i].s;
+        const cbs_rxstat_counts_t *c = &s->st.counts;
+        uint64_t lost = c->lost + cbs_rxstat_pending(&s->st);
+        char name[48];
+
+        stream_name(s, name, sizeof(name));
+        printf("%-32s %10llu %8llu %8.4f %5llu %5llu %5llu %7.1fus %7.1fus %7.1fus %6.1fus\n", name,
+               (unsigned long long)c->frames, (unsigned long long)lost,
+               100.0 * lost / (c->frames - c->duplicates + lost), (unsigned long long)c->duplicates,
+               (unsigned long long)c->reordered, (unsigned long long)c->late,
+               s->st.latency_min / 1e3, (double)s->st.latency_sum / c->frames / 1e3,
+               s->st.latency_max / 1e3, cbs_rxstat_jitter_ns(&s->st) / 1e3);
+        if (s->st.negative) {
+            printf("%-32s %llu frames arrived before they were sent: clocks are not in sync\n", "",
+                   (unsigned long long)s->st.negative);
+        }
+        if (c->restarts) {
+            printf("%-32s sender restarted %llu times\n", "", (unsigned long long)c->restarts);
+        }
+    }
+    for (int i = 0; i < n_workers; i++) {
+        printf("Worker %d (CPU %d): %llu other frames, %llu aggregates split. ", i, workers[i].cpu,
+               (unsigned long long)workers[i].other, (unsigned long long)workers[i].aggregates);
+        cbs_rx_dump_stats(workers[i].rx, stdout);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t interval_ms = DEFAULT_INTERVAL_MS, start, next, prev, now;
+    double duration_s = 0;
+    uint32_t blocks = 0;
+    int first_cpu = 0, ncpu, opt, ret = 0;
+    const char *ifname, *out = NULL;
+    FILE *csv = NULL;
+
+    while ((opt = getopt(argc, argv, "i:d:t:c:b:o:h")) != -1) {
+        switch (opt) {
+        case 'i': interval_ms = strtoull(optarg, NULL, 0); break;
+        case 'd': duration_s = atof(optarg); break;
+        case 't': n_workers = atoi(optarg); break;
+        case 'c': first_cpu = atoi(optarg); break;
+        case 'b': blocks = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'o': out = optarg; break;
+        default:
+            printf("Usage: %s [-i interval_ms] [-d seconds] [-t threads] [-c cpu] [-b blocks] [-o csv] iface\n",
+                   argv[0]);
+            printf("  -i  Report interval in milliseconds (default %d)\n", DEFAULT_INTERVAL_MS);
+            printf("  -d  Run time in seconds, 0 = until SIGINT/SIGTERM (default)\n");
+            printf("  -t  Receive threads, one ring each in a fanout group (default 1, max %d)\n",
+                   MAX_WORKERS);
+            printf("  -c  CPU of the first thread, the others follow (default 0)\n");
+            printf("  -b  Ring blocks of %u KB per thread (default %d)\n", CBS_RX_BLOCK_SIZE >> 10,
+                   CBS_RX_DEFAULT_BLOCKS);
+            printf("  -o  Append every interval report to a CSV file\n");
+            printf("Latency is one-way: sender and receiver clocks must be in sync.\n");
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1 || interval_ms == 0 || n_workers < 1 || n_workers > MAX_WORKERS ||
+        first_cpu < 0 || duration_s < 0) {
+        fprintf(stderr, "Need one interface, a non-zero interval and 1-%d threads\n", MAX_WORKERS);
+        return 1;
+    }
+    ifname = argv[optind];
+
+    if (out) {
+        csv = fopen(out, "a");
+        if (csv == NULL) {
+            perror(out);
+            return 1;
+        }
+        if (ftell(csv) == 0) {
+            fprintf(csv, "time_s,stream,vid,pcp,tc,frames,bytes,lost,duplicates,reordered,late,"
+                         "lat_p50_ns,lat_p99_ns,lat_max_ns,jitter_ns\n");
+        }
+    }
+
+    ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1) {
+        ncpu = 1;
+    }
+    for (int i = 0; i < n_workers; i++) {
+        worker_t *w = &workers[i];
+
+        w->cpu = (first_cpu + i) % ncpu;
+        w->streams = calloc(STREAM_SLOTS, sizeof(stream_t));
+        w->rx = cbs_rx_open(ifname, blocks, n_workers > 1 ? (uint16_t)(getpid() & 0xFFFF) : 0);
+        if (w->streams == NULL || w->rx == NULL) {
+            fprintf(stderr, "Cannot open a receive ring on %s: %s\n", ifname, strerror(errno));
+            return 1;
+        }
+        pthread_mutex_init(&w->lock, NULL);
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    for (int i = 0; i < n_workers; i++) {
+        if ((ret = pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i])) != 0) {
+            fprintf(stderr, "Cannot start worker %d: %s\n", i, strerror(ret));
+            running = 0;
+            n_workers = i;
+            break;
+        }
+    }
+    printf("Analyzing %s with %d ring%s, reporting every %llu ms\n", ifname, n_workers,
+           n_workers == 1 ? "" : "s", (unsigned long long)interval_ms);
+
+    start = next = prev = clock_ns(CLOCK_MONOTONIC);
+    while (running) {
+        struct timespec ts;
+
+        next += interval_ms * 1000000ULL;
+        if (duration_s > 0 && next >= start + (uint64_t)(duration_s * NS_PER_SEC)) {
+            next = start + (uint64_t)(duration_s * NS_PER_SEC);
+            running = 0;
+        }
+        ts.tv_sec = next / NS_PER_SEC;
+        ts.tv_nsec = next % NS_PER_SEC;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && running) {
+        }
+        now = clock_ns(CLOCK_MONOTONIC);
+        publish((now - start) / 1e9, (now - prev) / 1e9, csv);
+        prev = now;
+    }
+    running = 0;
+
+    ret = 0;
+    for (int i = 0; i < n_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (workers[i].error) {
+            fprintf(stderr, "Worker %d: %s\n", i, strerror(-workers[i].error));
+            ret = 1;
+        }
+    }
+    summary();
+
+    for (int i = 0; i < n_workers; i++) {
+        cbs_rx_close(workers[i].rx);
+        free(workers[i].streams);
+    }
+    if (csv) {
+        fclose(csv);
+    }
+    return ret;
+}
@@ -0,0 +1,1410 @@
+/**
+ * CBS configuration path benchmarks
+ * Runs the driver against simulated register backends, no hardware needed
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include "lan9692_cbs.h"
+#include "cbs_regio.h"
+#include "cbs_regcache.h"
+#include "cbs_sampler.h"
+#include "cbs_counters.h"
+#include "cbs_hist.h"
+#include "cbs_statlog.h"
+#include "cbs_shm.h"
+#include "cbs_trace.h"
+#include "cbs_sim.h"
+#include "cbs_nc.h"
+#include "cbs_credit.h"
+#include "cbs_pkt.h"
+#include "cbs_rxstat.h"
+#include "cbs_tx.h"
+#include "cbs_rx.h"
+#include "cbs_calc.h"
+#include "lan9662_regs.h"
+#include "mup1.h"
+#include "evb_changeset.h"
+#include "coreconf.h"
+
+static int saved_stdout = -1;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Silence driver progress output while timing */
+static void quiet_begin(void) {
+    int devnull = open("/dev/null", O_WRONLY);
+
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+}
+
+static void quiet_end(void) {
+    fflush(stdout);
+    if (saved_stdout >= 0) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        saved_stdout = -1;
+    }
+}
+
+/* Video streaming configuration from main.c, scenario 2 */
+static void build_video_config(switch_config_t *config, const char *backend) {
+    memset(config, 0, sizeof(*config));
+    config->vlan_enabled = true;
+    config->reg_backend = backend;
+
+    for (int port = 0; port < NUM_PORTS; port++) {
+        config->ports[port].port_id = port;
+        config->ports[port].port_speed = PORT_SPEED_1GBPS;
+    }
+
+    for (int port = 1; port <= 2; port++) {
+        uint8_t tc = (port == 1) ? TC_VIDEO_STREAM_1 : TC_VIDEO_STREAM_2;
+        cbs_config_t *cfg = &config->ports[port].tc_config[tc];
+
+        lan9692_cbs_calculate(20, PORT_SPEED_1GBPS, CBS_MAX_FRAME_SIZE, cfg, NULL);
+    }
+}
+
+/* Per-access cost of each register backend */
+static int bench_regio(int iterations) {
+    const char *specs[] = { "sim", "trace:sim", "trace@100:sim" };
+
+    printf("%-16s %12s %12s\n", "backend", "read ns", "write ns");
+    for (size_t i = 0; i < sizeof(specs)/sizeof(specs[0]); i++) {
+        cbs_regio_t *io = cbs_regio_open_spec(specs[i], 0, LAN9692_REG_SIZE);
+        uint32_t sink = 0;
+        uint64_t t0, t1, t2;
+
+        if (io == NULL) return -1;
+
+        t0 = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            cbs_regio_write(io, (n & 0x3FFF) << 2, n);
+        }
+        t1 = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            sink += cbs_regio_read(io, (n & 0x3FFF) << 2);
+        }
+        t2 = now_ns();
+
+        printf("%-16s %12.1f %12.1f\n", specs[i],
+               (double)(t2 - t1) / iterations, (double)(t1 - t0) / iterations);
+        cbs_regio_close(io);
+        (void)sink;
+    }
+    return 0;
+}
+
+/* Full lan9692_cbs_init against the simulated register file */
+static int bench_init(int iterations) {
+    switch_config_t config;
+    uint64_t start, total = 0;
+
+    build_video_config(&config, "trace:sim");
+
+    for (int n = 0; n < iterations; n++) {
+        quiet_begin();
+        start = now_ns();
+        int ret = lan9692_cbs_init(&config);
+        total += now_ns() - start;
+        if (n + 1 < iterations) {
+            lan9692_cbs_shutdown();
+        }
+        quiet_end();
+        if (ret < 0) return ret;
+    }
+
+    printf("lan9692_cbs_init: %.1f us avg over %d runs\n",
+           (double)total / iterations / 1000.0, iterations);
+    lan9692_cbs_shutdown();
+    return 0;
+}
+
+/* Program all 4096 VLANs: per-VLAN calls vs one range / table update */
+static int bench_vlan(int iterations) {
+    const char *specs[] = { "sim", "trace@500:sim" };
+    static uint8_t tc_map[LAN9692_NUM_VLANS];
+    switch_config_t config;
+
+    for (size_t i = 0; i < sizeof(specs)/sizeof(specs[0]); i++) {
+        uint64_t per_vlan = 0, range = 0, delta = 0;
+        int changed = 0;
+
+        build_video_config(&config, specs[i]);
+        for (int n = 0; n < iterations; n++) {
+            uint64_t start;
+            uint8_t tc = (n & 1) ? TC_VIDEO_STREAM_2 : TC_VIDEO_STREAM_1;
+
+            quiet_begin();
+            lan9692_cbs_init(&config);
+            start = now_ns();
+            for (int vid = 0; vid < LAN9692_NUM_VLANS; vid++) {
+                lan9692_set_vlan_tc_mapping(vid, tc);
+            }
+            per_vlan += now_ns() - start;
+
+            lan9692_cbs_init(&config);
+            start = now_ns();
+            lan9692_set_vlan_tc_range(0, LAN9692_NUM_VLANS, tc);
+            range += now_ns() - start;
+
+            /* Re-map 16 VLANs on top of the programmed table */
+            memset(tc_map, tc, sizeof(tc_map));
+            memset(tc_map + 1000, TC_BEST_EFFORT, 16);
+            start = now_ns();
+            changed = lan9692_set_vlan_tc_table(tc_map, NULL);
+            delta += now_ns() - start;
+            lan9692_cbs_shutdown();
+            quiet_end();
+        }
+
+        printf("backend %s:\n", specs[i]);
+        printf("  4096 x lan9692_set_vlan_tc_mapping: %10.1f us\n", (double)per_vlan / iterations / 1000.0);
+        printf("  lan9692_set_vlan_tc_range(0, 4096): %10.1f us\n", (double)range / iterations / 1000.0);
+        printf("  lan9692_set_vlan_tc_table, %2d diff: %10.1f us\n", changed, (double)delta / iterations / 1000.0);
+    }
+    return 0;
+}
+
+/* Program every LAN9662 QSYS_CBS_* register once */
+static void program_lan9662_cbs(cbs_regio_t *io, cbs_regcache_t *cache, uint32_t seed) {
+    for (int port = 0; port < LAN9662_NUM_PORTS; port++) {
+        for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
+            uint32_t regs[4] = { QSYS_CBS_CIR(port, q), QSYS_CBS_EIR(port, q),
+                                 QSYS_CBS_CBS(port, q), QSYS_CBS_EBS(port, q) };
+            for (int r = 0; r < 4; r++) {
+                if (cache) {
+                    cbs_regcache_write(cache, regs[r], seed + r);
+                } else {
+                    /* Previous lan9662_write: store + settle per register */
+                    cbs_regio_write(io, regs[r], seed + r);
+                    usleep(1);
+                }
+            }
+        }
+    }
+}
+
+/* Full LAN9662 CBS provisioning, per-store settle vs shadow cache */
+static int bench_cache(int iterations) {
+    cbs_regio_t *io = cbs_regio_open_spec("trace:sim", LAN9662_BASE_ADDR, LAN9662_REG_SIZE);
+    cbs_regcache_t cache;
+    uint64_t start, uncached = 0, cached = 0;
+
+    if (io == NULL || cbs_regcache_init(&cache, io, LAN9662_NUM_PORTS * LAN9662_NUM_QUEUES * 4) < 0) {
+        cbs_regio_close(io);
+        return -1;
+    }
+
+    for (int n = 0; n < iterations; n++) {
+        start = now_ns();
+        program_lan9662_cbs(io, NULL, n);
+        uncached += now_ns() - start;
+
+        start = now_ns();
+        cbs_regcache_begin(&cache);
+        program_lan9662_cbs(io, &cache, n + 1);
+        cbs_regcache_end(&cache);
+        cached += now_ns() - start;
+    }
+
+    printf("%d registers per provisioning pass\n", LAN9662_NUM_PORTS * LAN9662_NUM_QUEUES * 4);
+    printf("  uncached + usleep(1): %10.1f us\n", (double)uncached / iterations / 1000.0);
+    printf("  shadow cache + flush: %10.1f us\n", (double)cached / iterations / 1000.0);
+    cbs_regcache_dump_stats(&cache, stdout);
+
+    cbs_regcache_destroy(&cache);
+    cbs_regio_close(io);
+    return 0;
+}
+
+/* Sampler sweep rate, timing jitter and drain cost over the 64 LAN9662 monitor queues */
+static int bench_sampler(int iterations) {
+    const char *specs[] = { "sim", "trace@200:sim" };
+    const uint32_t rates[] = { 1000, 5000, 10000 };
+    static cbs_sample_t batch[CBS_SAMPLER_RING_SIZE];
+    static cbs_sampler_t sampler;
+
+    printf("%-14s %6s %10s %11s %10s %9s %8s %9s\n", "backend", "Hz", "sweeps/s",
+           "samples/s", "jitter us", "overruns", "dropped", "drain ns");
+    for (size_t b = 0; b < sizeof(specs)/sizeof(specs[0]); b++) {
+        for (size_t r = 0; r < sizeof(rates)/sizeof(rates[0]); r++) {
+            cbs_regio_t *io = cbs_regio_open_spec(specs[b], LAN9662_BASE_ADDR, LAN9662_REG_SIZE);
+            cbs_sampler_stats_t stats;
+            uint64_t start, elapsed, drain_ns = 0, drained = 0, prev = 0, jitter = 0;
+            uint64_t period = 1000000000ULL / rates[r];
+
+            if (io == NULL || cbs_sampler_init(&sampler, io, rates[r]) < 0) {
+                cbs_regio_close(io);
+                return -1;
+            }
+            for (int port = 0; port < 8; port++) {
+                for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
+                    cbs_sampler_add(&sampler, QSYS_QUEUE_DEPTH(port, q), port, q);
+                }
+            }
+
+            start = now_ns();
+            cbs_sampler_start(&sampler);
+            for (int n = 0; n <= iterations; n++) {
+                if (n < iterations) {
+                    usleep(100000);
+                } else {
+                    cbs_sampler_stop(&sampler);
+                }
+
+                uint64_t t0 = now_ns();
+                size_t got = cbs_sampler_drain(&sampler, batch, CBS_SAMPLER_RING_SIZE);
+                drain_ns += now_ns() - t0;
+                drained += got;
+
+                /* Worst deviation of the sweep-to-sweep interval from the period */
+                for (size_t i = 0; i < got; i++) {
+                    if (batch[i].channel != 0) continue;
+                    if (prev != 0) {
+                        uint64_t dt = batch[i].t_ns - prev;
+                        uint64_t dev = dt > period ? dt - period : period - dt;
+                        if (dev > jitter) jitter = dev;
+                    }
+                    prev = batch[i].t_ns;
+                }
+            }
+            elapsed = now_ns() - start;
+            cbs_sampler_get_stats(&sampler, &stats);
+
+            printf("%-14s %6u %10.0f %11.0f %10.1f %9llu %8llu %9.1f\n", specs[b], rates[r],
+                   stats.sweeps * 1e9 / elapsed, stats.samples * 1e9 / elapsed,
+                   jitter / 1000.0, (unsigned long long)stats.overruns,
+                   (unsigned long long)stats.dropped,
+                   drained ? (double)drain_ns / drained : 0.0);
+
+            cbs_sampler_destroy(&sampler);
+            cbs_regio_close(io);
+        }
+    }
+    return 0;
+}
+
+/* All 64 LAN9662 ports: 5 MAC counters + 8 queues x 3 queue counters */
+static int add_lan9662_counters(cbs_counters_t *c) {
+    uint32_t octets = cbs_counters_octets_per_sec(LAN9662_PORT_SPEED_1G);
+    uint32_t frames = cbs_counters_frames_per_sec(LAN9662_PORT_SPEED_1G);
+
+    for (int port = 0; port < LAN9662_NUM_PORTS; port++) {
+        cbs_counters_add(c, DEV_STAT_TX_OCTETS(port), octets);
+        cbs_counters_add(c, DEV_STAT_RX_OCTETS(port), octets);
+        cbs_counters_add(c, DEV_STAT_TX_FRAMES(port), frames);
+        cbs_counters_add(c, DEV_STAT_RX_FRAMES(port), frames);
+        cbs_counters_add(c, DEV_STAT_DROPS(port), frames);
+        for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
+            cbs_counters_add(c, QSYS_QSTAT_TX_FRAMES(port, q), frames);
+            cbs_counters_add(c, QSYS_QSTAT_TX_OCTETS(port, q), octets);
+            cbs_counters_add(c, QSYS_QSTAT_DROPS(port, q), frames);
+        }
+    }
+    return c->count;
+}
+
+/* Poll cost of the 64-bit counter engine over every LAN9662 port, plus a wrap check */
+static int bench_counters(int iterations) {
+    const char *specs[] = { "sim", "trace@100:sim", "trace@500:sim" };
+    uint32_t n = LAN9662_NUM_PORTS * (5 + LAN9662_NUM_QUEUES * 3);
+
+    printf("%-14s %9s %12s %12s %14s\n", "backend", "counters", "poll us", "ns/counter", "wrap window s");
+    for (size_t i = 0; i < sizeof(specs)/sizeof(specs[0]); i++) {
+        cbs_regio_t *io = cbs_regio_open_spec(specs[i], LAN9662_BASE_ADDR, LAN9662_REG_SIZE);
+        cbs_counters_t c;
+        uint64_t start, elapsed;
+
+        if (io == NULL || cbs_counters_init(&c, io, n, 0) < 0) {
+            cbs_regio_close(io);
+            return -1;
+        }
+        add_lan9662_counters(&c);
+
+        start = now_ns();
+        for (int it = 0; it < iterations; it++) {
+            cbs_counters_poll(&c);
+        }
+        elapsed = now_ns() - start;
+
+        printf("%-14s %9u %12.1f %12.1f %14.1f\n", specs[i], c.count,
+               (double)elapsed / iterations / 1000.0, (double)elapsed / iterations / c.count,
+               c.wrap_ns / 1e9);
+
+        /* A TX octet counter crossing 2^32 between two polls must still add up */
+        if (i == 0) {
+            cbs_regio_write(io, DEV_STAT_TX_OCTETS(0), 0xFFFFFF00u);
+            cbs_counters_poll(&c);
+            uint64_t before = c.counters[0].total;
+            cbs_regio_write(io, DEV_STAT_TX_OCTETS(0), 0x00000100u);
+            cbs_counters_poll(&c);
+            printf("  wrap 0xFFFFFF00 -> 0x00000100: delta %llu (%s)\n",
+                   (unsigned long long)(c.counters[0].total - before),
+                   c.counters[0].total - before == 0x200 ? "ok" : "WRONG");
+        }
+
+        cbs_counters_destroy(&c);
+        cbs_regio_close(io);
+    }
+    return 0;
+}
+
+/* Collector write path: iterations seconds of 1 ms polls of 4 ports x 6 counters */
+static int bench_statlog(int iterations) {
+    const char *ports[] = { "eth0", "eth1", "eth2", "eth3" };
+    const char *counters[] = { "rx_packets", "tx_packets", "rx_bytes", "tx_bytes",
+                               "rx_dropped", "tx_dropped" };
+    char path[] = "/tmp/cbs_statlog_XXXXXX";
+    uint64_t polls = (uint64_t)iterations * 1000, values[6] = { 0 };
+    uint64_t start, elapsed;
+    cbs_statlog_t log;
+    int fd = mkstemp(path);
+
+    if (fd < 0) {
+        return -1;
+    }
+    close(fd);
+
+    start = now_ns();
+    if (cbs_statlog_create(&log, path, polls * 4, 1000000, ports, 4, counters, 6) < 0) {
+        unlink(path);
+        return -1;
+    }
+    uint64_t created = now_ns() - start;
+
+    start = now_ns();
+    for (uint64_t n = 0; n < polls; n++) {
+        for (uint32_t p = 0; p < 4; p++) {
+            for (int c = 0; c < 6; c++) {
+                values[c] += 1000 + p + c;
+            }
+            cbs_statlog_append(&log, n * 1000000, p, values);
+        }
+        cbs_statlog_commit(&log);
+    }
+    elapsed = now_ns() - start;
+
+    start = now_ns();
+    cbs_statlog_close(&log);
+    uint64_t closed = now_ns() - start;
+
+    printf("%llu polls x 4 ports (%d s at 1 ms), %.1f MB, %.1f MB per hour\n",
+           (unsigned long long)polls, iterations, log.size / 1e6, log.size / 1e6 * 3600 / iterations);
+    printf("  create + preallocate: %10.1f ms\n", created / 1e6);
+    printf("  append + commit:      %10.1f ns per poll (%.3f%% of 1 ms)\n",
+           (double)elapsed / polls, (double)elapsed / polls / 1e4);
+    printf("  close (msync):        %10.1f ms\n", closed / 1e6);
+
+    unlink(path);
+    return 0;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Depth histograms: iterations seconds of 64 queues at 10 kHz, then summary and merge */
+static int bench_hist(int iterations) {
+    static cbs_hist_t hist[64], total;
+    uint64_t n = (uint64_t)iterations * 10000, start, recorded, summarized, merged;
+    uint32_t *exact = malloc(n * sizeof(uint32_t));
+    uint32_t seed = 1;
+    cbs_hist_summary_t sum;
+    double err = 0;
+
+    if (exact == NULL) {
+        return -1;
+    }
+    for (int q = 0; q < 64; q++) {
+        cbs_hist_reset(&hist[q]);
+    }
+    cbs_hist_reset(&total);
+
+    /* Mostly shallow queues with rare deep bursts, the shape that matters for tails */
+    start = now_ns();
+    for (uint64_t i = 0; i < n; i++) {
+        for (int q = 0; q < 64; q++) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            uint32_t depth = seed % 1522;
+            if ((seed >> 16) % 500 == 0) depth *= 64;
+            cbs_hist_record(&hist[q], depth);
+            if (q == 0) exact[i] = depth;
+        }
+    }
+    recorded = now_ns() - start;
+
+    start = now_ns();
+    cbs_hist_summarize(&hist[0], &sum, 0);
+    summarized = now_ns() - start;
+
+    start = now_ns();
+    for (int q = 0; q < 64; q++) {
+        cbs_hist_merge(&total, &hist[q]);
+    }
+    merged = now_ns() - start;
+
+    /* Bucket bounds against the exact order statistics of queue 0 */
+    qsort(exact, n, sizeof(uint32_t), cmp_u32);
+    const double fractions[] = { 0.50, 0.99, 0.999 };
+    const uint32_t reported[] = { sum.p50, sum.p99, sum.p999 };
+    for (int i = 0; i < 3; i++) {
+        uint32_t want = exact[(uint64_t)(fractions[i] * n + 0.999999) - 1];
+        double e = want ? ((double)reported[i] - want) / want : 0;
+        if (e > err) err = e;
+    }
+
+    printf("%llu samples x 64 queues, %zu KB per histogram\n",
+           (unsigned long long)n, sizeof(cbs_hist_t) / 1024);
+    printf("  record:               %10.1f ns per sample\n", (double)recorded / (n * 64));
+    printf("  summarize (p50-max):  %10.1f us\n", summarized / 1e3);
+    printf("  merge 64 queues:      %10.1f us\n", merged / 1e3);
+    printf("  queue 0 p50/p99/p99.9/max: %u/%u/%u/%u B, worst error %.2f%% (bound %.2f%%)\n",
+           sum.p50, sum.p99, sum.p999, sum.max, err * 100, 100.0 / CBS_HIST_SUB_HALF);
+    printf("  p99.9 delay at 1 Gbps: %.1f us\n",
+           cbs_hist_delay_ns(cbs_hist_percentile(&total, 0.999), 1000000000ULL) / 1e3);
+
+    free(exact);
+    return 0;
+}
+
+/* Shared-memory segment: one writer, N readers spinning on snapshots */
+typedef struct {
+    cbs_shm_t shm;
+    uint64_t period_ns;         /* writer publish period */
+    volatile int stop;
+    uint64_t publishes;
+    uint64_t write_ns;
+} shm_writer_t;
+
+typedef struct {
+    const char *name;
+    volatile int *stop;
+    int per_port;
+    uint64_t reads, retries, torn, failed, ns;
+} shm_reader_t;
+
+static void *shm_writer_thread(void *arg) {
+    shm_writer_t *w = arg;
+    uint64_t next = now_ns();
+
+    while (!w->stop) {
+        uint64_t t0 = now_ns();
+        cbs_shm_data_t *data = cbs_shm_begin(&w->shm);
+
+        /* Every field of every port carries the publish number, so a torn copy shows */
+        for (uint32_t p = 0; p < data->n_ports; p++) {
+            cbs_shm_port_t *port = &data->ports[p];
+            port->tx_frames = port->rx_frames = w->publishes;
+            port->tx_octets = port->rx_octets = w->publishes * 1000;
+            for (int q = 0; q < CBS_SHM_NUM_TCS; q++) {
+                port->tc[q].tx_frames = w->publishes;
+                port->tc[q].tx_bps = (double)w->publishes;
+            }
+        }
+        cbs_shm_end(&w->shm, t0);
+        w->write_ns += now_ns() - t0;
+        w->publishes++;
+
+        next += w->period_ns;
+        while (now_ns() < next && !w->stop) {
+            usleep(20);
+        }
+    }
+    return NULL;
+}
+
+static void *shm_reader_thread(void *arg) {
+    shm_reader_t *r = arg;
+    static __thread cbs_shm_data_t snap;
+    cbs_shm_t shm;
+    uint64_t start;
+
+    if (cbs_shm_open(&shm, r->name) < 0) {
+        r->failed++;
+        return NULL;
+    }
+
+    start = now_ns();
+    while (!*r->stop) {
+        int ret;
+        if (r->per_port) {
+            uint32_t p = r->reads % CBS_SHM_MAX_PORTS;
+            ret = cbs_shm_read_port(&shm, p, &snap.ports[p], NULL);
+            if (ret >= 0 && snap.ports[p].tc[7].tx_frames != snap.ports[p].tx_frames) r->torn++;
+        } else {
+            ret = cbs_shm_snapshot(&shm, &snap);
+            if (ret >= 0 && snap.ports[CBS_SHM_MAX_PORTS - 1].tc[7].tx_frames != snap.ports[0].tx_frames) {
+                r->torn++;
+            }
+        }
+        if (ret < 0) {
+            r->failed++;
+        } else {
+            r->retries += ret;
+        }
+        r->reads++;
+    }
+    r->ns = now_ns() - start;
+    cbs_shm_close(&shm);
+    return NULL;
+}
+
+static int bench_shm(int iterations) {
+    const int readers[] = { 1, 2, 4, 8 };
+    const uint64_t periods[] = { 1000000, 100000 };
+    char name[32];
+
+    snprintf(name, sizeof(name), "/cbs_bench_%d", (int)getpid());
+    printf("%zu KB segment, %d ms per run\n", sizeof(cbs_shm_segment_t) / 1024, iterations);
+    printf("%-7s %7s %5s %12s %10s %9s %8s %6s %7s %9s\n", "writer", "readers", "mode",
+           "reads/s", "ns/read", "retry %", "publish", "torn", "failed", "write ns");
+
+    for (size_t w = 0; w < sizeof(periods)/sizeof(periods[0]); w++) {
+        for (int per_port = 0; per_port <= 1; per_port++) {
+            for (size_t n = 0; n < sizeof(readers)/sizeof(readers[0]); n++) {
+                static shm_writer_t writer;
+                shm_reader_t r[8];
+                pthread_t wt, rt[8];
+                uint64_t reads = 0, retries = 0, torn = 0, failed = 0, ns = 0;
+
+                memset(&writer, 0, sizeof(writer));
+                if (cbs_shm_create(&writer.shm, name, CBS_SHM_MAX_PORTS) < 0) {
+                    return -1;
+                }
+                writer.period_ns = periods[w];
+
+                pthread_create(&wt, NULL, shm_writer_thread, &writer);
+                for (int i = 0; i < readers[n]; i++) {
+                    r[i] = (shm_reader_t){ .name = name, .stop = &writer.stop, .per_port = per_port };
+                    pthread_create(&rt[i], NULL, shm_reader_thread, &r[i]);
+                }
+                usleep(iterations * 1000);
+                writer.stop = 1;
+                pthread_join(wt, NULL);
+                for (int i = 0; i < readers[n]; i++) {
+                    pthread_join(rt[i], NULL);
+                    reads += r[i].reads;
+                    retries += r[i].retries;
+                    torn += r[i].torn;
+                    failed += r[i].failed;
+                    ns += r[i].ns;
+                }
+                cbs_shm_close(&writer.shm);
+
+                /* reads/s is the aggregate over all readers, ns/read is per reader */
+                printf("%-7s %7d %5s %12.0f %10.1f %9.3f %8llu %6llu %7llu %9.0f\n",
+                       periods[w] == 1000000 ? "1 kHz" : "10 kHz", readers[n], per_port ? "port" : "full",
+                       reads * 1e9 / (ns / readers[n] + 1), (double)ns / (reads + 1),
+                       100.0 * retries / (reads + 1), (unsigned long long)writer.publishes,
+                       (unsigned long long)torn, (unsigned long long)failed,
+                       writer.publishes ? (double)writer.write_ns / writer.publishes : 0.0);
+                if (torn) {
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/* lan9692_cbs_init plus a hitless reconfiguration on the sim backend, average us */
+static double traced_init_us(int runs) {
+    switch_config_t config, bigger;
+    uint64_t start, total = 0;
+
+    build_video_config(&config, "sim");
+    bigger = config;
+    lan9692_cbs_calculate(30, PORT_SPEED_1GBPS, CBS_MAX_FRAME_SIZE,
+                          &bigger.ports[1].tc_config[TC_VIDEO_STREAM_1], NULL);
+
+    quiet_begin();
+    for (int n = 0; n < runs; n++) {
+        start = now_ns();
+        lan9692_cbs_init(&config);
+        lan9692_cbs_apply(&config, &bigger);
+        total += now_ns() - start;
+        lan9692_cbs_shutdown();
+    }
+    quiet_end();
+    return total / 1e3 / runs;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Off/on init rounds alternate so drift hits both; each side reports its median */
+#define TRACE_ROUNDS        15
+#define TRACE_ROUND_RUNS    20
+
+/* Tracer cost: emit points off and on, driver paths, save and JSON export */
+static int bench_trace(int iterations) {
+    char bin[] = "/tmp/cbs_trace_XXXXXX";
+    uint64_t start, off_ns, on_ns, at_ns, save_ns, export_ns, head, first, split;
+    double init_off[TRACE_ROUNDS], init_on[TRACE_ROUNDS];
+    cbs_trace_event_t *events;
+    FILE *fp;
+    int fd = mkstemp(bin);
+
+    if (fd < 0) {
+        return -1;
+    }
+    close(fd);
+
+    /* Off: one branch per emit point (the barrier keeps the check in the loop) */
+    cbs_trace_stop();
+    start = now_ns();
+    for (int n = 0; n < iterations; n++) {
+        cbs_trace_emit(CBS_TRACE_REG_WRITE, 1, CBS_TRACE_NO_TC, n, n);
+        __asm__ volatile("" ::: "memory");
+    }
+    off_ns = now_ns() - start;
+
+    /* On: clock read + slot claim + store, wrapping a 64 K event ring */
+    if (cbs_trace_start(65536) < 0) {
+        return -1;
+    }
+    start = now_ns();
+    for (int n = 0; n < iterations; n++) {
+        cbs_trace_emit(CBS_TRACE_REG_WRITE, 1, CBS_TRACE_NO_TC, n, n);
+    }
+    on_ns = now_ns() - start;
+
+    /* Sampler path: the sample already carries its timestamp */
+    start = now_ns();
+    for (int n = 0; n < iterations; n++) {
+        cbs_trace_emit_at(n, CBS_TRACE_QUEUE_DEPTH, n & 7, n & 7, n, 0);
+    }
+    at_ns = now_ns() - start;
+    cbs_trace_stop();
+
+    for (int r = 0; r < TRACE_ROUNDS; r++) {
+        cbs_trace_stop();
+        init_off[r] = traced_init_us(TRACE_ROUND_RUNS);
+        if (cbs_trace_start(0) < 0) {
+            unlink(bin);
+            return -1;
+        }
+        init_on[r] = traced_init_us(TRACE_ROUND_RUNS);
+    }
+    qsort(init_off, TRACE_ROUNDS, sizeof(double), cmp_double);
+    qsort(init_on, TRACE_ROUNDS, sizeof(double), cmp_double);
+    head = cbs_trace.head;
+
+    /* Save the last round's ring, then export it */
+    start = now_ns();
+    int64_t saved = cbs_trace_save(bin, "cbs_bench");
+    save_ns = now_ns() - start;
+
+    /* Oldest event first, unrolled from the ring head as cbs_trace_save writes it */
+    events = malloc(sizeof(cbs_trace_event_t) * (saved > 0 ? saved : 1));
+    if (events == NULL) {
+        cbs_trace_stop();
+        unlink(bin);
+        return -1;
+    }
+    if (saved > 0) {
+        first = (head - saved) & cbs_trace.mask;
+        split = cbs_trace.mask + 1 - first;
+        if (split > (uint64_t)saved) {
+            split = saved;
+        }
+        memcpy(events, &cbs_trace.events[first], split * sizeof(cbs_trace_event_t));
+        memcpy(events + split, cbs_trace.events, (saved - split) * sizeof(cbs_trace_event_t));
+    }
+
+    fp = fopen("/dev/null", "w");
+    start = now_ns();
+    cbs_trace_export_json(events, saved > 0 ? saved : 0, "cbs_bench", fp);
+    export_ns = now_ns() - start;
+    fclose(fp);
+    free(events);
+    cbs_trace_stop();
+    unlink(bin);
+
+    printf("emit, tracing off:      %10.2f ns\n", (double)off_ns / iterations);
+    printf("emit, tracing on:       %10.2f ns (%zu bytes per event)\n",
+           (double)on_ns / iterations, sizeof(cbs_trace_event_t));
+    printf("emit_at (samples):      %10.2f ns\n", (double)at_ns / iterations);
+    printf("init + apply, off:      %10.1f us (median of %d x %d runs)\n",
+           init_off[TRACE_ROUNDS / 2], TRACE_ROUNDS, TRACE_ROUND_RUNS);
+    printf("init + apply, on:       %10.1f us (%+.1f%%, %.0f events per run)\n",
+           init_on[TRACE_ROUNDS / 2],
+           100.0 * (init_on[TRACE_ROUNDS / 2] - init_off[TRACE_ROUNDS / 2]) / init_off[TRACE_ROUNDS / 2],
+           (double)head / TRACE_ROUND_RUNS);
+    if (saved > 0) {
+        printf("save:                   %10.1f ns per event (%lld events)\n",
+               (double)save_ns / saved, (long long)saved);
+        printf("JSON export:            %10.1f ns per event\n", (double)export_ns / saved);
+    }
+    return 0;
+}
+
+/* CBS simulator throughput: scenario 2 with video, best-effort and small-frame load */
+static int bench_sim(int iterations) {
+    static cbs_sim_t sim;
+    const cbs_sim_source_t sources[] = {
+        { .port = 1, .tc = TC_VIDEO_STREAM_1, .stream = 0, .rate = 15000000,
+          .frame_bytes = CBS_MAX_FRAME_SIZE, .burst = 4 },
+        { .port = 2, .tc = TC_VIDEO_STREAM_2, .stream = 1, .rate = 15000000,
+          .frame_bytes = CBS_MAX_FRAME_SIZE, .burst = 4 },
+        { .port = 1, .tc = TC_BEST_EFFORT, .stream = 2, .rate = 900000000,
+          .frame_bytes = CBS_MAX_FRAME_SIZE, .burst = 1, .poisson = true },
+        { .port = 2, .tc = TC_BEST_EFFORT, .stream = 3, .rate = 900000000,
+          .frame_bytes = CBS_MAX_FRAME_SIZE, .burst = 1, .poisson = true },
+        { .port = 3, .tc = TC_BEST_EFFORT, .stream = 4, .rate = 600000000,
+          .frame_bytes = 64, .burst = 1, .poisson = true },
+    };
+    const uint32_t n_sources = sizeof(sources) / sizeof(sources[0]);
+    switch_config_t config;
+    cbs_hist_summary_t video;
+    uint64_t start, elapsed;
+    int64_t frames;
+
+    build_video_config(&config, NULL);
+    if (cbs_sim_init(&sim, &config, 0, CBS_SIM_WIRE_OVERHEAD) < 0) {
+        return -1;
+    }
+
+    /* iterations x 100 ms of simulated time */
+    start = now_ns();
+    frames = cbs_sim_run(&sim, sources, n_sources, iterations * CBS_SIM_PS_PER_SEC / 10, 1);
+    elapsed = now_ns() - start;
+    if (frames < 0) {
+        cbs_sim_destroy(&sim);
+        return -1;
+    }
+    cbs_hist_summarize(&sim.streams[0].delay_ns, &video, 0);
+
+    printf("%lld frames, %.1f s simulated in %.1f ms\n", (long long)frames,
+           sim.end_ps / 1e12, elapsed / 1e6);
+    printf("  throughput:           %10.2f M frames/s\n", frames * 1e3 / elapsed);
+    printf("  per frame:            %10.1f ns\n", (double)elapsed / frames);
+    printf("  video 1 delay p99/max: %.1f/%.1f us\n", video.p99 / 1e3, video.max / 1e3);
+
+    cbs_sim_destroy(&sim);
+    return 0;
+}
+
+/* Candidate shaper settings per second: 4 EVB switches in series, random idle slopes */
+static int bench_nc(int iterations) {
+    static const struct { uint8_t tc; uint8_t port; uint32_t rate; uint32_t burst; } profiles[] = {
+        { 7, 0, 25000000, 65536 }, { 6, 0, 8000000, 32768 },
+        { 6, 1, 8000000, 32768 },  { 5, 1, 4000000, 16384 },
+    };
+    enum { SWITCHES = 4, CANDIDATES = 1000 };
+    cbs_nc_port_t ports[SWITCHES * 2];
+    cbs_nc_stream_t streams[sizeof(profiles) / sizeof(profiles[0])];
+    cbs_nc_stream_result_t results[sizeof(profiles) / sizeof(profiles[0])];
+    cbs_nc_network_t net = { ports, SWITCHES * 2, streams, sizeof(profiles) / sizeof(profiles[0]) };
+    cbs_nc_workspace_t ws;
+    uint64_t seed = 1, start, elapsed, best = UINT64_MAX;
+    long bounded = 0;
+
+    if (cbs_nc_workspace_init(&ws, net.n_ports, net.n_streams) < 0) {
+        return -1;
+    }
+    memset(ports, 0, sizeof(ports));
+    memset(streams, 0, sizeof(streams));
+    for (uint32_t p = 0; p < net.n_ports; p++) {
+        ports[p].port_rate = 1000000000ULL;
+        ports[p].latency_ns = 2000;
+    }
+    for (uint32_t s = 0; s < net.n_streams; s++) {
+        streams[s].rate = profiles[s].rate;
+        streams[s].burst = profiles[s].burst;
+        streams[s].max_frame = CBS_MAX_FRAME_SIZE;
+        streams[s].tc = profiles[s].tc;
+        streams[s].n_hops = SWITCHES;
+        for (int h = 0; h < SWITCHES; h++) {
+            streams[s].hops[h] = h * 2 + profiles[s].port;
+        }
+    }
+
+    start = now_ns();
+    for (long i = 0; i < (long)iterations * CANDIDATES; i++) {
+        uint64_t worst = 0;
+        int ret;
+
+        for (uint32_t p = 0; p < net.n_ports; p++) {
+            for (int tc = 5; tc <= 7; tc++) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                ports[p].idle_slope[tc] = (5 + (seed >> 33) % 96) * 1000000ULL;  /* 5-100 Mbps */
+            }
+        }
+        ret = cbs_nc_analyze(&net, &ws, results);
+        if (ret < 0) {
+            cbs_nc_workspace_free(&ws);
+            return -1;
+        }
+        if (ret > 0) continue;
+        bounded++;
+        for (uint32_t s = 0; s < net.n_streams; s++) {
+            if (results[s].delay_ns > worst) worst = results[s].delay_ns;
+        }
+        if (worst < best) best = worst;
+    }
+    elapsed = now_ns() - start;
+
+    printf("%ld candidates, %ld fully bounded, in %.1f ms\n", (long)iterations * CANDIDATES,
+           bounded, elapsed / 1e6);
+    printf("  throughput:           %10.0f configs/s\n", (double)iterations * CANDIDATES * 1e9 / elapsed);
+    printf("  per config:           %10.1f ns\n", (double)elapsed / ((double)iterations * CANDIDATES));
+    if (bounded) {
+        printf("  best worst-case e2e:  %10.1f us\n", best / 1e3);
+    }
+    cbs_nc_workspace_free(&ws);
+    return 0;
+}
+
+/* All 64 x 8 LAN9662 queues on 1G ports; TC7/6/5 shaped with per-port idle slopes */
+static int credit_setup(cbs_credit_t *k, uint64_t dt_ps) {
+    static const uint32_t base_kbps[] = { 30000, 10000, 5000 };
+
+    if (cbs_credit_init(k, LAN9662_NUM_PORTS * LAN9662_NUM_QUEUES, dt_ps) < 0) {
+        return -1;
+    }
+    for (int port = 0; port < LAN9662_NUM_PORTS; port++) {
+        uint64_t higher = 0;
+
+        for (int tc = LAN9662_NUM_QUEUES - 1; tc >= 5; tc--) {
+            cbs_calc_class_t cls = {
+                .port_rate = 1000000000ULL,
+                .idle_slope = (uint64_t)base_kbps[7 - tc] * 1000 * (1 + port % 8),
+                .max_frame = CBS_MAX_FRAME_SIZE,
+                .max_interference = CBS_MAX_FRAME_SIZE,
+                .higher_idle_slope = higher,
+                .higher_max_frame = higher ? CBS_MAX_FRAME_SIZE : 0,
+            };
+            cbs_calc_result_t r;
+
+            if (cbs_calc(&cls, &r) < 0 ||
+                cbs_credit_set(k, port * LAN9662_NUM_QUEUES + tc, r.idle_slope, r.send_slope,
+                               r.hi_credit, r.lo_credit) < 0) {
+                cbs_credit_destroy(k);
+                return -1;
+            }
+            higher += cls.idle_slope;
+        }
+    }
+    return 0;
+}
+
+/* Random backlog, at most one transmitting queue per port, among the backlogged ones */
+static void credit_masks(uint64_t *seed, uint64_t *tx, uint64_t *queued, int words) {
+    for (int w = 0; w < words; w++) {
+        tx[w] = 0;
+        *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        queued[w] = *seed ^ (*seed >> 29);
+        for (int port = 0; port < 8; port++) {
+            uint64_t bits = (queued[w] >> (port * 8)) & 0xFF;
+            *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            if (bits && (*seed >> 63)) {
+                tx[w] |= (1ULL << (port * 8)) << (31 - __builtin_clz((uint32_t)bits));
+            }
+        }
+    }
+}
+
+/* Credit kernel throughput, scalar vs the dispatched ISA, and a bit-for-bit comparison */
+static int bench_credit(int iterations) {
+    enum { WORDS = LAN9662_NUM_PORTS * LAN9662_NUM_QUEUES / CBS_CREDIT_QUEUES_PER_WORD, PATTERNS = 64 };
+    static uint64_t tx[PATTERNS][WORDS], queued[PATTERNS][WORDS];
+    const uint32_t step_counts[] = { 1, 12 };      /* 1 us steps; 12 = one 1522 B frame at 1G */
+    cbs_credit_t ref, fast;
+    uint64_t seed = 1, mismatches = 0;
+
+    if (credit_setup(&ref, 1000000) < 0) {
+        return -1;
+    }
+    if (credit_setup(&fast, 1000000) < 0) {
+        cbs_credit_destroy(&ref);
+        return -1;
+    }
+    for (int p = 0; p < PATTERNS; p++) {
+        credit_masks(&seed, tx[p], queued[p], WORDS);
+    }
+
+    printf("%u queues, kernel %s\n", ref.n_queues, cbs_credit_isa());
+    printf("%-8s %16s %16s %8s\n", "steps", "scalar upd/s", "dispatch upd/s", "speedup");
+    for (size_t s = 0; s < sizeof(step_counts) / sizeof(step_counts[0]); s++) {
+        uint32_t steps = step_counts[s];
+        long calls = (long)iterations * 1000 / steps;
+        uint64_t eligible[WORDS], start, scalar_ns, fast_ns;
+
+        start = now_ns();
+        for (long n = 0; n < calls; n++) {
+            cbs_credit_step_scalar(&ref, tx[n % PATTERNS], queued[n % PATTERNS], eligible, steps);
+        }
+        scalar_ns = now_ns() - start;
+
+        start = now_ns();
+        for (long n = 0; n < calls; n++) {
+            cbs_credit_step(&fast, tx[n % PATTERNS], queued[n % PATTERNS], eligible, steps);
+        }
+        fast_ns = now_ns() - start;
+
+        printf("%-8u %16.3e %16.3e %7.2fx\n", steps,
+               (double)calls * steps * ref.n_queues * 1e9 / scalar_ns,
+               (double)calls * steps * ref.n_queues * 1e9 / fast_ns, (double)scalar_ns / fast_ns);
+    }
+    mismatches += memcmp(ref.credit, fast.credit, ref.n_queues * sizeof(int64_t)) != 0;
+
+    /* Closed loop: each port sends a frame from its highest eligible queue */
+    for (long n = 0; n < (long)iterations * 100; n++) {
+        static uint64_t ref_eligible[WORDS], fast_eligible[WORDS];
+        uint64_t t[WORDS], q[WORDS];
+
+        credit_masks(&seed, t, q, WORDS);
+        for (int w = 0; w < WORDS; w++) {
+            t[w] = 0;
+            for (int port = 0; port < 8; port++) {
+                uint32_t bits = (ref_eligible[w] >> (port * 8)) & 0xFF;
+                if (bits) {
+                    t[w] |= (1ULL << (port * 8)) << (31 - __builtin_clz(bits));
+                }
+            }
+            q[w] |= t[w];
+        }
+        cbs_credit_step_scalar(&ref, t, q, ref_eligible, 12);
+        cbs_credit_step(&fast, t, q, fast_eligible, 12);
+        mismatches += memcmp(ref_eligible, fast_eligible, sizeof(ref_eligible)) != 0 ||
+                      memcmp(ref.credit, fast.credit, ref.n_queues * sizeof(int64_t)) != 0;
+    }
+    printf("  bit-identical:        %10s (%ld closed-loop frame times)\n", mismatches ? "NO" : "yes",
+           (long)iterations * 100);
+
+    cbs_credit_destroy(&ref);
+    cbs_credit_destroy(&fast);
+    return mismatches ? -1 : 0;
+}
+
+/* Paths of the former fetch_stats.yaml in evb_lan9692_cbs.c */
+static void build_stats_fetch(evb_changeset_t *cs) {
+    static const unsigned ports[] = { 8, 10, 11 };
+    const char *fdb = "/ieee802-dot1q-bridge:bridges/bridge[name='b0']/component[name='c0']"
+                      "/filtering-database/vlan-registration-entry[database-id='0']";
+
+    evb_cs_init(cs);
+    for (int i = 0; i < 3; i++) {
+        evb_cs_fetch(cs, "/ietf-interfaces:interfaces/interface[name='%u']"
+                     "/ieee802-dot1q-bridge:bridge-port/port-type", ports[i]);
+    }
+    for (int vid = 100; vid <= 120; vid += 10) {
+        evb_cs_fetch(cs, "%s[vids='%d']", fdb, vid);
+    }
+    evb_cs_fetch(cs, "/ietf-interfaces:interfaces/interface[name='8']"
+                 "/ieee802-dot1q-bridge:bridge-port/pcp-decoding-table/pcp-decoding-map");
+    for (int i = 1; i < 3; i++) {
+        evb_cs_fetch(cs, "/ietf-interfaces:interfaces/interface[name='%u']"
+                     "/ieee802-dot1q-bridge:bridge-port/pcp-encoding-table/pcp-encoding-map", ports[i]);
+    }
+    for (int i = 1; i < 3; i++) {
+        evb_cs_fetch(cs, "/ietf-interfaces:interfaces/interface[name='%u']"
+                     "/mchp-velocitysp-port:eth-qos/config/traffic-class-shapers", ports[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        evb_cs_fetch(cs, "/ietf-interfaces:interfaces/interface[name='%u']"
+                     "/mchp-velocitysp-port:eth-port/statistics/traffic-class", ports[i]);
+    }
+}
+
+/* Start mup1_sim on a pty and return the slave path it prints */
+static pid_t start_mup1_sim(const char *baud, char *pty, size_t size) {
+    const char *sim = getenv("MUP1_SIM") ? getenv("MUP1_SIM") : "./mup1_sim";
+    int fds[2];
+    pid_t pid;
+
+    if (access(sim, X_OK) < 0 || pipe(fds) < 0) {
+        return -1;
+    }
+    pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(sim, sim, "-b", baud, (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    FILE *fp = fdopen(fds[0], "r");
+    if (pid < 0 || fp == NULL || fgets(pty, size, fp) == NULL) {
+        if (pid > 0) kill(pid, SIGTERM);
+        return -1;
+    }
+    pty[strcspn(pty, "\n")] = '\0';
+    fclose(fp);
+    return pid;
+}
+
+/* Stats fetch over MUP1 at 115200 baud: YAML text vs CORECONF CBOR */
+static int bench_mup1(int iterations) {
+    static evb_changeset_t fetch;
+    static uint8_t body[MUP1_MAX_FRAME];
+    char pty[64];
+    pid_t sim = start_mup1_sim("115200", pty, sizeof(pty));
+
+    if (sim < 0) {
+        printf("mup1_sim not found (set MUP1_SIM), skipped\n");
+        return 0;
+    }
+
+    mup1_session_t *session = mup1_open(pty);
+    if (session == NULL) {
+        kill(sim, SIGTERM);
+        waitpid(sim, NULL, 0);
+        return -1;
+    }
+
+    build_stats_fetch(&fetch);
+    printf("%d-path stats fetch, %d runs each, 115200 baud stand-in\n", fetch.n_entries, iterations);
+    printf("%-6s %10s %10s %12s %10s\n", "format", "req bytes", "resp bytes", "wire bytes", "RTT ms");
+
+    for (int cbor = 0; cbor <= 1; cbor++) {
+        uint64_t tx = mup1_get_stats(session)->tx_bytes, rx = mup1_get_stats(session)->rx_bytes;
+        uint64_t start, total = 0;
+        size_t resp_len = 0;
+        int len;
+
+        if (cbor) {
+            len = coreconf_encode_fetch(&fetch, body, sizeof(body));
+        } else {
+            len = evb_cs_render_fetch_yaml(&fetch, (char *)body, sizeof(body));
+        }
+        if (len < 0) break;
+
+        for (int n = 0; n < iterations; n++) {
+            mup1_response_t resp;
+
+            start = now_ns();
+            if (mup1_request(session, COAP_FETCH, cbor ? COAP_CF_YANG_IDS_CBOR : COAP_CF_YAML,
+                             cbor ? COAP_CF_YANG_INST_CBOR : COAP_CF_YAML, body, len, &resp) < 0) {
+                len = -1;
+                break;
+            }
+            total += now_ns() - start;
+            resp_len = resp.payload_len;
+            mup1_response_free(&resp);
+        }
+        if (len < 0) break;
+
+        uint64_t wire = mup1_get_stats(session)->tx_bytes - tx + mup1_get_stats(session)->rx_bytes - rx;
+        printf("%-6s %10d %10zu %12llu %10.1f\n", cbor ? "CBOR" : "YAML", len, resp_len,
+               (unsigned long long)(wire / iterations), (double)total / iterations / 1e6);
+    }
+
+    mup1_close(session);
+    kill(sim, SIGTERM);
+    waitpid(sim, NULL, 0);
+    return 0;
+}
+
+/* Receive analysis: parse a captured test frame and account it, as cbs_analyze does per frame */
+#define RX_STREAMS                  8
+#define RX_SNAP                     128
+#define RX_BURST                    8
+
+static int bench_rx(int iterations) {
+    static cbs_rxstat_t streams[RX_STREAMS];
+    uint64_t n = (uint64_t)iterations * 10000, seq[RX_STREAMS] = { 0 }, injected = 0, swaps = 0;
+    uint64_t start, elapsed, lost = 0, reordered = 0, frames = 0, last_swap = 0;
+    uint8_t *ring = malloc(n * RX_SNAP), tmpl[RX_STREAMS][1400];
+    cbs_pkt_flow_t flow = {
+        .dst_mac = { 0x02, 0, 0, 0, 0, 2 }, .src_mac = { 0x02, 0, 0, 0, 0, 1 },
+        .vid = 100, .src_ip = htobe32(0x0A006401), .dst_ip = htobe32(0x0A006402), .src_port = 40000,
+    };
+    uint32_t seed = 1, off;
+    cbs_pkt_info_t info;
+
+    if (ring == NULL) {
+        return -1;
+    }
+    for (int s = 0; s < RX_STREAMS; s++) {
+        flow.pcp = (uint8_t)s;
+        flow.dst_port = (uint16_t)(5005 + s);
+        if (cbs_pkt_build(tmpl[s], sizeof(tmpl[s]), &flow, (uint16_t)s, (uint8_t)s, 1370) < 0) {
+            free(ring);
+            return -1;
+        }
+        cbs_rxstat_init(&streams[s]);
+    }
+    off = cbs_pkt_hdr_offset(&flow);
+
+    /* Bursts of 8 frames per stream, 1% of sequence numbers lost, 0.5% of neighbours swapped
+       (never two swaps in a row: that moves one frame two places, a single reorder) */
+    for (uint64_t i = 0; i < n; i++) {
+        int s = (int)(i / RX_BURST % RX_STREAMS);
+        uint8_t *frame = ring + i * RX_SNAP;
+
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        if (seed % 100 == 0) {
+            seq[s]++;
+            injected++;
+        }
+        memcpy(frame, tmpl[s], RX_SNAP);
+        cbs_pkt_stamp(frame + off, seq[s]++, 1000000 + i * 1000);
+        if (i % RX_BURST != 0 && i != last_swap + 1 && (seed >> 8) % 200 == 0) {
+            uint8_t tmp[RX_SNAP];
+
+            memcpy(tmp, frame, RX_SNAP);
+            memcpy(frame, frame - RX_SNAP, RX_SNAP);
+            memcpy(frame - RX_SNAP, tmp, RX_SNAP);
+            last_swap = i;
+            swaps++;
+        }
+    }
+
+    start = now_ns();
+    for (uint64_t i = 0; i < n; i++) {
+        if (cbs_pkt_parse(ring + i * RX_SNAP, RX_SNAP, -1, &info) == 0) {
+            cbs_rxstat_update(&streams[info.stream], info.seq, info.tx_ns, 1050000 + i * 1000, 1370);
+        }
+    }
+    elapsed = now_ns() - start;
+
+    for (int s = 0; s < RX_STREAMS; s++) {
+        frames += streams[s].counts.frames;
+        lost += streams[s].counts.lost + cbs_rxstat_pending(&streams[s]);
+        reordered += streams[s].counts.reordered;
+    }
+    printf("%llu frames over %d streams, %zu B of state per stream\n", (unsigned long long)n, RX_STREAMS,
+           sizeof(cbs_rxstat_t));
+    printf("  parse + account:      %10.1f ns per frame (%.2f Mpps per core)\n",
+           (double)elapsed / n, n * 1e3 / elapsed);
+    printf("  frames %llu, lost %llu (injected %llu), reordered %llu (swapped %llu)\n",
+           (unsigned long long)frames, (unsigned long long)lost, (unsigned long long)injected,
+           (unsigned long long)reordered, (unsigned long long)swaps);
+
+    free(ring);
+    return (frames == n && lost == injected && reordered == swaps) ? 0 : -1;
+}
+
+/* ===== Test frames: build/parse round trip, TX ring to RX ring over loopback ===== */
+
+#define TX_STREAMS                  4
+#define TX_BATCH                    64
+
+/* One's complement sum over the IPv4 header: 0xFFFF when the checksum is right */
+static int ipv4_csum_ok(const uint8_t *ip) {
+    uint32_t sum = 0;
+
+    for (int i = 0; i < CBS_PKT_IP_LEN; i += 2) {
+        sum += (uint32_t)ip[i] << 8 | ip[i + 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return sum == 0xFFFF;
+}
+
+static int pkt_roundtrip(const cbs_pkt_flow_t *flow, uint32_t frame_bytes, uint8_t *buf, size_t size) {
+    uint32_t off = cbs_pkt_hdr_offset(flow);
+    int tagged = flow->vid != CBS_PKT_UNTAGGED;
+    int len = cbs_pkt_build(buf, size, flow, 3, flow->pcp, frame_bytes);
+    cbs_pkt_info_t info;
+
+    if (len != (int)(frame_bytes - CBS_PKT_FCS_LEN)) {
+        return -1;
+    }
+    cbs_pkt_stamp(buf + off, frame_bytes * 1000ULL, 0x0123456789ABCDEFULL);
+    if (cbs_pkt_parse(buf, (uint32_t)len, -1, &info) < 0 ||
+        !ipv4_csum_ok(buf + CBS_PKT_ETH_LEN + (tagged ? CBS_PKT_VLAN_LEN : 0)) ||
+        info.vid != flow->vid || (tagged && info.pcp != flow->pcp) || info.tc != flow->pcp ||
+        info.stream != 3 || info.src_ip != flow->src_ip || info.dst_ip != flow->dst_ip ||
+        info.dst_port != flow->dst_port ||
+        info.payload_len != (uint32_t)len - off ||
+        info.seq != frame_bytes * 1000ULL || info.tx_ns != 0x0123456789ABCDEFULL) {
+        return -1;
+    }
+    /* A tag the kernel took off must parse like an inline one */
+    if (tagged) {
+        cbs_pkt_info_t stripped;
+
+        memmove(buf + 12, buf + 12 + CBS_PKT_VLAN_LEN, (size_t)len - 12 - CBS_PKT_VLAN_LEN);
+        if (cbs_pkt_parse(buf, (uint32_t)len - CBS_PKT_VLAN_LEN, flow->pcp << 13 | flow->vid, &stripped) < 0 ||
+            stripped.vid != info.vid || stripped.pcp != info.pcp || stripped.stream != info.stream ||
+            stripped.payload_len != info.payload_len || stripped.seq != info.seq) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int bench_tx(int iterations) {
+    static uint8_t buf[CBS_TX_FRAME_SIZE];
+    static cbs_rxstat_t streams[TX_STREAMS];
+    cbs_pkt_flow_t flow = {
+        .dst_mac = { 0x02, 0, 0, 0, 0, 2 }, .src_mac = { 0x02, 0, 0, 0, 0, 1 },
+        .src_ip = htobe32(0x0A006401), .dst_ip = htobe32(0x0A006402), .src_port = 40000, .dst_port = 5005,
+    };
+    uint64_t n = (uint64_t)iterations * 1000, checked = 0, bad = 0, start, elapsed, sent = 0;
+    uint64_t frames = 0, lost = 0, reordered = 0, seq[TX_STREAMS] = { 0 };
+    uint8_t tmpl[TX_STREAMS][1400];
+    uint32_t off, len = 0;
+    cbs_rx_frame_t rf;
+    cbs_pkt_info_t info;
+    cbs_tx_t *tx;
+    cbs_rx_t *rx;
+    int ret = 0;
+
+    /* Every frame size, tagged and untagged */
+    start = now_ns();
+    for (int tagged = 0; tagged < 2; tagged++) {
+        flow.vid = tagged ? 100 : CBS_PKT_UNTAGGED;
+        for (uint32_t bytes = cbs_pkt_min_frame(tagged); bytes <= CBS_MAX_FRAME_SIZE; bytes++) {
+            flow.pcp = (uint8_t)(bytes & 7);
+            bad += pkt_roundtrip(&flow, bytes, buf, sizeof(buf)) < 0;
+            checked++;
+        }
+        /* Too small for the header, too large for the buffer */
+        bad += cbs_pkt_build(buf, sizeof(buf), &flow, 0, 0, cbs_pkt_min_frame(tagged) - 1) != -EINVAL;
+        bad += cbs_pkt_build(buf, 1500, &flow, 0, 0, 1600) != -EINVAL;
+        checked += 2;
+    }
+    elapsed = now_ns() - start;
+    printf("build/parse round trip: %llu frame sizes, %llu wrong, %.1f ns per frame\n",
+           (unsigned long long)checked, (unsigned long long)bad, (double)elapsed / checked);
+    if (bad) {
+        return -1;
+    }
+
+    /* TX ring to RX ring over loopback: every frame back, in order */
+    tx = cbs_tx_open_packet("lo", CBS_TX_DEFAULT_FRAMES);
+    if (tx == NULL) {
+        printf("loopback TX/RX skipped: %s (needs CAP_NET_RAW)\n", strerror(errno));
+        return 0;
+    }
+    rx = cbs_rx_open("lo", 0, 0);
+    if (rx == NULL) {
+        printf("loopback TX/RX skipped: %s (needs CAP_NET_RAW)\n", strerror(errno));
+        cbs_tx_close(tx);
+        return 0;
+    }
+    flow.vid = CBS_PKT_UNTAGGED;
+    for (int s = 0; s < TX_STREAMS; s++) {
+        flow.dst_port = (uint16_t)(5005 + s);
+        len = (uint32_t)cbs_pkt_build(tmpl[s], sizeof(tmpl[s]), &flow, (uint16_t)s, (uint8_t)s, 1370);
+        cbs_rxstat_init(&streams[s]);
+    }
+    off = cbs_pkt_hdr_offset(&flow);
+
+    start = now_ns();
+    while (sent < n && ret >= 0) {
+        uint8_t *frame = cbs_tx_frame(tx);
+
+        if (frame == NULL) {
+            ret = cbs_tx_kick(tx);
+            continue;
+        }
+        int s = (int)(sent % TX_STREAMS);
+        memcpy(frame, tmpl[s], len);
+        cbs_pkt_stamp(frame + off, seq[s]++, now_ns());
+        cbs_tx_commit(tx, len);
+        if (++sent % TX_BATCH == 0) {
+            ret = cbs_tx_kick(tx);
+        }
+    }
+    if (ret >= 0) {
+        ret = cbs_tx_kick(tx);
+    }
+    elapsed = now_ns() - start;
+
+    /* Blocks are handed over when full or after CBS_RX_BLOCK_TIMEOUT_MS */
+    while (frames < sent && cbs_rx_next(rx, &rf, 5 * CBS_RX_BLOCK_TIMEOUT_MS) > 0) {
+        if (cbs_pkt_parse(rf.data, rf.len, rf.vlan_tci, &info) == 0 && info.dst_ip == flow.dst_ip &&
+            info.stream < TX_STREAMS) {
+            cbs_rxstat_update(&streams[info.stream], info.seq, info.tx_ns, rf.ts_ns, rf.wire_len);
+            frames++;
+        }
+    }
+    cbs_rx_update_stats(rx);
+    for (int s = 0; s < TX_STREAMS; s++) {
+        lost += streams[s].counts.lost + cbs_rxstat_pending(&streams[s]) +
+                (seq[s] - (streams[s].started ? streams[s].max_seq + 1 : 0));
+        reordered += streams[s].counts.reordered + streams[s].counts.duplicates;
+    }
+    printf("loopback TX ring: %llu frames in %.1f ms, %.2f Mpps, %.1f frames per kick\n",
+           (unsigned long long)sent, elapsed / 1e6, sent * 1e3 / elapsed,
+           tx->stats.kicks ? (double)tx->stats.frames / tx->stats.kicks : 0.0);
+    printf("  received %llu, lost %llu, reordered %llu, ring drops %llu\n", (unsigned long long)frames,
+           (unsigned long long)lost, (unsigned long long)reordered, (unsigned long long)rx->stats.drops);
+
+    cbs_rx_close(rx);
+    cbs_tx_close(tx);
+    return (ret >= 0 && frames == sent && lost == 0 && reordered == 0) ? 0 : -1;
+}
+
+static const struct {
+    const char *name;
+    int (*run)(int iterations);
+    int default_iterations;
+    const char *help;
+} benches[] = {
+    { "regio", bench_regio, 1000000, "per-access cost of register backends" },
+    { "init",  bench_init,  20,      "full LAN9692 init on the sim backend" },
+    { "cache", bench_cache, 5,       "LAN9662 64-port provisioning with the shadow cache" },
+    { "vlan",  bench_vlan,  5,       "programming all 4096 LAN9692 VLAN->TC entries" },
+    { "mup1",  bench_mup1,  5,       "EVB stats fetch bytes and round trip, YAML vs CBOR" },
+    { "sampler", bench_sampler, 10,  "64-queue depth sampler at 1-10 kHz, 100 ms drains" },
+    { "counters", bench_counters, 200, "64-bit counter poll over all 64 LAN9662 ports" },
+    { "statlog", bench_statlog, 60,  "columnar stats log writes, 1 ms polls of 4 ports" },
+    { "hist",  bench_hist,  10,      "64-queue depth histograms: record, percentiles, merge" },
+    { "shm",   bench_shm,   500,     "shared-memory stats segment, 1 writer and 1-8 seqlock readers" },
+    { "trace", bench_trace, 10000000, "event tracer overhead, on and off, and export cost" },
+    { "sim",   bench_sim,   20,      "802.1Qav simulator throughput, scenario 2 plus 64 B load" },
+    { "nc",    bench_nc,    100,     "end-to-end bound analysis over 4 EVB switches, random idle slopes" },
+    { "credit", bench_credit, 100,   "SoA credit kernel over 64 x 8 LAN9662 queues, scalar vs SIMD" },
+    { "rx",    bench_rx,    100,     "receive analyzer: test frame parse and per-stream loss/latency accounting" },
+    { "tx",    bench_tx,    20,      "test frame build/parse round trip, TX ring to RX ring over loopback" },
+};
+
+int main(int argc, char *argv[]) {
+    const char *which = (argc > 1) ? argv[1] : "all";
+    int iterations = (argc > 2) ? atoi(argv[2]) : 0;
+    int ran = 0;
+
+    for (size_t i = 0; i < sizeof(benches)/sizeof(benches[0]); i++) {
+        if (strcmp(which, "all") != 0 && strcmp(which, benches[i].name) != 0) {
+            continue;
+        }
+        printf("=== %s: %s ===\n", benches[i].name, benches[i].help);
+        if (benches[i].run(iterations > 0 ? iterations : benches[i].default_iterations) < 0) {
+            fprintf(stderr, "Benchmark %s failed\n", benches[i].name);
+            return EXIT_FAILURE;
+        }
+        printf("\n");
+        ran++;
+    }
+
+    if (ran == 0) {
+        printf("Usage: %s [all", argv[0]);
+        for (size_t i = 0; i < sizeof(benches)/sizeof(benches[0]); i++) {
+            printf("|%s", benches[i].name);
+        }
+        printf("] [iterations]\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
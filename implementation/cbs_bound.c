@@ -0,0 +1,304 @@
+/**
+ * End-to-end latency bound calculator
+ * Runs the network-calculus analysis (cbs_nc) over a topology file, or
+ * over the EVB-LAN9692 lab setup (ingress port 8, shaped egress ports
+ * 10/11) repeated over several switches in series, and prints per-stream
+ * worst-case delay and backlog with the per-hop class bounds
+ *
+ * Topology file, one item per line ('#' starts a comment):
+ *   port <name> <rate_mbps> [tc<N>=<idle_kbps>]... [unshaped=<bytes>] [latency=<ns>]
+ *   stream <name> tc=<N> rate=<kbps> burst=<bytes> [frame=<bytes>] path=<port>[,<port>]...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "cbs_nc.h"
+#include "cbs_profiles.h"
+#include "evb_lab.h"
+
+#define MAX_PORTS                   256
+#define MAX_STREAMS                 1024
+#define NAME_LEN                    32
+
+static cbs_nc_port_t ports[MAX_PORTS];
+static cbs_nc_stream_t streams[MAX_STREAMS];
+static cbs_nc_stream_result_t results[MAX_STREAMS];
+static char port_names[MAX_PORTS][NAME_LEN];
+static char stream_names[MAX_STREAMS][NAME_LEN];
+static uint32_t n_ports, n_streams;
+
+static const streaming_profile_t *profile_of_tc(uint8_t tc) {
+    for (size_t i = 0; i < cbs_num_profiles; i++) {
+        if (cbs_profiles[i].tc == tc) {
+            return &cbs_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Switches in series, each with the EVB lab egress shapers (evb_lab.c);
+ * every lab stream, at its cbs_profiles rate and burst, leaves each
+ * switch on its egress port
+ */
+static int build_evb_chain(int switches, uint32_t latency_ns) {
+    for (int sw = 0; sw < switches; sw++) {
+        for (int e = 0; e < 2; e++) {
+            cbs_nc_port_t *p = &ports[n_ports];
+
+            memset(p, 0, sizeof(*p));
+            p->port_rate = 1000000000ULL;
+            p->latency_ns = latency_ns;
+            for (size_t i = 0; i < evb_num_shapers; i++) {
+                if (evb_shapers[i].port == 10 + e) {
+                    p->idle_slope[evb_shapers[i].tc] = evb_shapers[i].idle_slope * 1000ULL;
+                }
+            }
+            snprintf(port_names[n_ports], NAME_LEN, "sw%d.p%d", sw + 1, 10 + e);
+            n_ports++;
+        }
+    }
+
+    for (size_t i = 0; i < evb_num_routes; i++) {
+        const streaming_profile_t *profile = profile_of_tc(evb_routes[i].tc);
+        cbs_nc_stream_t *st = &streams[n_streams];
+
+        if (profile == NULL) {
+            fprintf(stderr, "No streaming profile for lab TC%u\n", evb_routes[i].tc);
+            return -EINVAL;
+        }
+        memset(st, 0, sizeof(*st));
+        st->rate = profile->bitrate;
+        st->burst = profile->burst_size;
+        st->max_frame = CBS_CALC_DEFAULT_FRAME;
+        st->tc = evb_routes[i].tc;
+        st->n_hops = switches;
+        for (int sw = 0; sw < switches; sw++) {
+            st->hops[sw] = sw * 2 + (evb_routes[i].egress - 10);
+        }
+        snprintf(stream_names[n_streams], NAME_LEN, "%s -> %u", profile->name,
+                 evb_routes[i].egress);
+        n_streams++;
+    }
+    return 0;
+}
+
+static int find_port(const char *name) {
+    for (uint32_t p = 0; p < n_ports; p++) {
+        if (strcmp(port_names[p], name) == 0) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+static int parse_port(char *args, int line) {
+    cbs_nc_port_t *p = &ports[n_ports];
+    char *name = strtok(args, " \t\n");
+    char *rate = strtok(NULL, " \t\n");
+    char *tok;
+
+    if (name == NULL || rate == NULL || n_ports >= MAX_PORTS || find_port(name) >= 0) {
+        fprintf(stderr, "line %d: bad or duplicate port\n", line);
+        return -EINVAL;
+    }
+    memset(p, 0, sizeof(*p));
+    p->port_rate = strtoull(rate, NULL, 0) * 1000000ULL;
+    while ((tok = strtok(NULL, " \t\n")) != NULL) {
+        unsigned tc;
+        unsigned long long v;
+
+        if (sscanf(tok, "tc%u=%llu", &tc, &v) == 2 && tc < CBS_NC_NUM_TCS) {
+            p->idle_slope[tc] = v * 1000;
+        } else if (sscanf(tok, "unshaped=%llu", &v) == 1) {
+            p->max_unshaped_frame = (uint32_t)v;
+        } else if (sscanf(tok, "latency=%llu", &v) == 1) {
+            p->latency_ns = (uint32_t)v;
+        } else {
+            fprintf(stderr, "line %d: unknown port option '%s'\n", line, tok);
+            return -EINVAL;
+        }
+    }
+    snprintf(port_names[n_ports], NAME_LEN, "%s", name);
+    n_ports++;
+    return 0;
+}
+
+static int parse_stream(char *args, int line) {
+    cbs_nc_stream_t *st = &streams[n_streams];
+    char *name = strtok(args, " \t\n");
+    char *tok, *path = NULL;
+
+    if (name == NULL || n_streams >= MAX_STREAMS) {
+        fprintf(stderr, "line %d: bad stream\n", line);
+        return -EINVAL;
+    }
+    memset(st, 0, sizeof(*st));
+    st->max_frame = CBS_CALC_DEFAULT_FRAME;
+    while ((tok = strtok(NULL, " \t\n")) != NULL) {
+        unsigned long long v;
+
+        if (sscanf(tok, "tc=%llu", &v) == 1) {
+            st->tc = (uint8_t)v;
+        } else if (sscanf(tok, "rate=%llu", &v) == 1) {
+            st->rate = v * 1000;
+        } else if (sscanf(tok, "burst=%llu", &v) == 1) {
+            st->burst = (uint32_t)v;
+        } else if (sscanf(tok, "frame=%llu", &v) == 1) {
+            st->max_frame = (uint32_t)v;
+        } else if (strncmp(tok, "path=", 5) == 0) {
+            path = tok + 5;
+        } else {
+            fprintf(stderr, "line %d: unknown stream option '%s'\n", line, tok);
+            return -EINVAL;
+        }
+    }
+    /* Path last: strtok is not reentrant */
+    for (char *hop = path ? strtok(path, ",") : NULL; hop; hop = strtok(NULL, ",")) {
+        int p = find_port(hop);
+        if (p < 0 || st->n_hops >= CBS_NC_MAX_HOPS) {
+            fprintf(stderr, "line %d: unknown port '%s' or path too long\n", line, hop);
+            return -EINVAL;
+        }
+        st->hops[st->n_hops++] = p;
+    }
+    if (st->n_hops == 0) {
+        fprintf(stderr, "line %d: stream without a path\n", line);
+        return -EINVAL;
+    }
+    snprintf(stream_names[n_streams], NAME_LEN, "%s", name);
+    n_streams++;
+    return 0;
+}
+
+static int load_topology(const char *path) {
+    FILE *fp = fopen(path, "r");
+    char buf[1024];
+    int line = 0, ret = 0;
+
+    if (fp == NULL) {
+        return -errno;
+    }
+    while (ret == 0 && fgets(buf, sizeof(buf), fp)) {
+        char *hash = strchr(buf, '#');
+        char *kw;
+
+        line++;
+        if (hash) *hash = '\0';
+        kw = buf + strspn(buf, " \t");
+        if (strncmp(kw, "port", 4) == 0 && (kw[4] == ' ' || kw[4] == '\t')) {
+            ret = parse_port(kw + 4, line);
+        } else if (strncmp(kw, "stream", 6) == 0 && (kw[6] == ' ' || kw[6] == '\t')) {
+            ret = parse_stream(kw + 6, line);
+        } else if (kw[strspn(kw, " \t\r\n")] != '\0') {
+            fprintf(stderr, "line %d: expected 'port' or 'stream'\n", line);
+            ret = -EINVAL;
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+static void print_results(const cbs_nc_workspace_t *ws, uint64_t deadline_ns) {
+    printf("%-10s %2s %7s %9s %7s %7s %7s %9s %10s %9s\n", "port", "tc", "streams", "rate kbps",
+           "idle", "hi B", "lo B", "T us", "delay us", "backlog B");
+    for (uint32_t p = 0; p < n_ports; p++) {
+        for (int tc = CBS_NC_NUM_TCS - 1; tc >= 0; tc--) {
+            const cbs_nc_class_result_t *c = &ws->classes[p * CBS_NC_NUM_TCS + tc];
+
+            if (c->streams == 0) continue;
+            printf("%-10s %2d %7u %9llu %7llu ", port_names[p], tc, c->streams,
+                   (unsigned long long)(c->rate / 1000),
+                   (unsigned long long)(ports[p].idle_slope[tc] / 1000));
+            if (c->status != 0) {
+                printf("%s\n", c->status == -ERANGE ? "overloaded" : "not shaped / invalid");
+                continue;
+            }
+            printf("%7u %7u %9.1f %10.1f %9u\n", c->hi_credit, c->lo_credit,
+                   c->latency_ns / 1e3, c->delay_ns / 1e3, c->backlog);
+        }
+    }
+
+    printf("\n%-22s %2s %4s %9s %8s %12s %12s %10s %10s\n", "stream", "tc", "hops", "rate kbps",
+           "burst B", "e2e us", "sum hops us", "backlog B", "out burst");
+    for (uint32_t s = 0; s < n_streams; s++) {
+        const cbs_nc_stream_result_t *r = &results[s];
+
+        printf("%-22s %2u %4u %9llu %8u ", stream_names[s], streams[s].tc, streams[s].n_hops,
+               (unsigned long long)(streams[s].rate / 1000), streams[s].burst);
+        if (r->status != 0) {
+            printf("%12s\n", "unbounded");
+            continue;
+        }
+        printf("%12.1f %12.1f %10u %10u%s\n", r->delay_ns / 1e3, r->delay_tfa_ns / 1e3,
+               r->backlog, r->out_burst,
+               deadline_ns && r->delay_ns > deadline_ns ? "  MISSED" : "");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    cbs_nc_workspace_t ws;
+    cbs_nc_network_t net;
+    const char *topology = NULL;
+    int switches = 1, opt, ret, missed = 0;
+    uint32_t latency_ns = 0;
+    uint64_t deadline_ns = 0;
+
+    while ((opt = getopt(argc, argv, "f:n:l:D:h")) != -1) {
+        switch (opt) {
+        case 'f': topology = optarg; break;
+        case 'n': switches = atoi(optarg); break;
+        case 'l': latency_ns = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'D': deadline_ns = (uint64_t)(atof(optarg) * 1000); break;
+        default:
+            printf("Usage: %s [-f topology] [-n switches] [-l latency_ns] [-D deadline_us]\n", argv[0]);
+            printf("  -f  Topology file (port/stream lines), default the EVB lab setup\n");
+            printf("  -n  EVB switches in series (default 1, max %d)\n", CBS_NC_MAX_HOPS);
+            printf("  -l  EVB forwarding + propagation delay per hop (default 0 ns)\n");
+            printf("  -D  Flag streams whose bound exceeds the deadline; exit status 2 if any\n");
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (topology) {
+        ret = load_topology(topology);
+        if (ret < 0) {
+            fprintf(stderr, "%s: %s\n", topology, strerror(-ret));
+            return 1;
+        }
+    } else {
+        if (switches < 1 || switches > CBS_NC_MAX_HOPS) {
+            fprintf(stderr, "Switches must be 1-%d\n", CBS_NC_MAX_HOPS);
+            return 1;
+        }
+        if (build_evb_chain(switches, latency_ns) < 0) {
+            return 1;
+        }
+    }
+
+    if (cbs_nc_workspace_init(&ws, n_ports, n_streams) < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    net = (cbs_nc_network_t){ ports, n_ports, streams, n_streams };
+    ret = cbs_nc_analyze(&net, &ws, results);
+    if (ret < 0) {
+        fprintf(stderr, "Analysis failed: %s\n", ret == -ELOOP ? "cyclic dependency does not converge"
+                                                               : strerror(-ret));
+        cbs_nc_workspace_free(&ws);
+        return 1;
+    }
+
+    printf("=== End-to-end bounds: %u ports, %u streams%s ===\n", n_ports, n_streams,
+           ret ? ", some unbounded" : "");
+    print_results(&ws, deadline_ns);
+
+    for (uint32_t s = 0; s < n_streams; s++) {
+        missed += results[s].status != 0 || (deadline_ns && results[s].delay_ns > deadline_ns);
+    }
+    cbs_nc_workspace_free(&ws);
+    return missed ? 2 : 0;
+}
@@ -0,0 +1,56 @@
+/**
+ * IEEE 802.1Qav credit-based shaper parameter calculator
+ * All quantities are kept in bits and bps; bytes only appear on output
+ */
+
+#include "cbs_calc.h"
+#include <errno.h>
+
+#define NS_PER_SEC                  1000000000ULL
+
+/* ceil(a * b / c); callers keep a * b below 2^64 through the CBS_CALC_MAX_* limits */
+static inline uint64_t mul_div_ceil(uint64_t a, uint64_t b, uint64_t c) {
+    uint64_t p = a * b;
+    return p / c + (p % c != 0);
+}
+
+static inline uint64_t bits_to_bytes(uint64_t bits) {
+    return (bits + 7) / 8;
+}
+
+int cbs_calc(const cbs_calc_class_t *cls, cbs_calc_result_t *result) {
+    uint64_t rate = cls->port_rate;
+    uint64_t idle = cls->idle_slope;
+    uint64_t frame = (uint64_t)cls->max_frame * 8;
+    uint64_t interference = (uint64_t)cls->max_interference * 8;
+    uint64_t burst = (uint64_t)(cls->burst ? cls->burst : cls->max_frame) * 8;
+    uint64_t hi, lo;
+
+    if (rate == 0 || rate > CBS_CALC_MAX_RATE || idle == 0 ||
+        idle + cls->higher_idle_slope >= rate ||
+        cls->max_frame == 0 || cls->max_frame > CBS_CALC_MAX_FRAME ||
+        cls->max_interference > CBS_CALC_MAX_FRAME ||
+        cls->higher_max_frame > CBS_CALC_MAX_FRAME ||
+        burst < frame || burst > (uint64_t)CBS_CALC_MAX_BURST * 8) {
+        return -EINVAL;
+    }
+
+    /* Credit gained while a lower frame, then the higher classes, hold the port */
+    if (cls->higher_idle_slope == 0) {
+        hi = mul_div_ceil(interference, idle, rate);
+    } else {
+        hi = mul_div_ceil(interference, idle, rate - cls->higher_idle_slope) +
+             mul_div_ceil((uint64_t)cls->higher_max_frame * 8, idle, rate);
+    }
+
+    /* Credit spent sending one maximum frame */
+    lo = mul_div_ceil(frame, rate - idle, rate);
+
+    result->idle_slope = idle;
+    result->send_slope = rate - idle;
+    result->hi_credit = (uint32_t)bits_to_bytes(hi);
+    result->lo_credit = (uint32_t)bits_to_bytes(lo);
+    result->max_delay_ns = mul_div_ceil(hi + lo + burst - frame, NS_PER_SEC, idle) +
+                           mul_div_ceil(frame, NS_PER_SEC, rate);
+    return 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * IEEE 802.1Qav credit-based shaper parameter calculator
+ * Exact 64-bit integer arithmetic for any port rate and frame size,
+ * with the per-class worst-case queuing delay the reservation implies
+ */
+
+#ifndef CBS_CALC_H
+#define CBS_CALC_H
+
+#include <stdint.h>
+
+/* Limits that keep every intermediate product below 2^64 */
+#define CBS_CALC_MAX_RATE           400000000000ULL     /* 400 Gbps */
+#define CBS_CALC_MAX_FRAME          65535               /* bytes */
+#define CBS_CALC_MAX_BURST          (16u << 20)         /* bytes */
+
+/* Default maximum frame: 1500 byte MTU + 14 header + 4 VLAN tag + 4 FCS */
+#define CBS_CALC_DEFAULT_FRAME      1522
+
+/* One Shaped Traffic Class on an Egress Port */
+typedef struct {
+    uint64_t port_rate;         /* portTransmitRate, bps */
+    uint64_t idle_slope;        /* reserved bandwidth, bps */
+    uint32_t max_frame;         /* largest frame of this class, bytes */
+    uint32_t max_interference;  /* largest frame of any lower class, bytes */
+    uint64_t higher_idle_slope; /* sum of idle slopes of higher shaped classes, 0 for class A */
+    uint32_t higher_max_frame;  /* largest frame of the higher shaped classes, bytes */
+    uint32_t burst;             /* bytes queued back to back, 0 = one max_frame */
+} cbs_calc_class_t;
+
+/* Derived Shaper Parameters */
+typedef struct {
+    uint64_t idle_slope;        /* bps */
+    uint64_t send_slope;        /* bps, magnitude of idleSlope - portTransmitRate */
+    uint32_t hi_credit;         /* bytes, rounded up */
+    uint32_t lo_credit;         /* bytes, magnitude, rounded up */
+    uint64_t max_delay_ns;      /* worst-case queuing delay of the last byte of burst */
+} cbs_calc_result_t;
+
+/**
+ * Derive idleSlope/sendSlope/hiCredit/loCredit (802.1Q Annex L) and the
+ * worst-case queuing delay of one shaped class.
+ *
+ *   hiCredit = maxInterference * idleSlope / portRate                  (class A)
+ *   hiCredit = idleSlope * (maxInterference / (portRate - idleSlope_A)
+ *                           + maxFrame_A / portRate)                   (lower)
+ *   loCredit = maxFrame * sendSlope / portRate
+ *   delay    = (hiCredit + loCredit + burst - maxFrame) / idleSlope
+ *              + maxFrame / portRate
+ *
+ * The delay covers the blocking interval, credit recovery after the
+ * previous frame and the rest of the burst queued ahead, then the frame
+ * itself at line rate. It is an upper bound for a single hop.
+ * @param cls: Traffic class description
+ * @param result: Derived parameters
+ * @return: 0 on success, -EINVAL on out of range input
+ */
+int cbs_calc(const cbs_calc_class_t *cls, cbs_calc_result_t *result);
+
+#endif /* CBS_CALC_H */
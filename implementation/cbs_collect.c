@@ -0,0 +1,183 @@
+/**
+ * Port statistics collector
+ * Polls the netdev counters of a set of interfaces at a fixed interval
+ * into a columnar binary log (cbs_statlog), without forking per sample
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include "cbs_statlog.h"
+
+#define NS_PER_SEC      1000000000ULL
+#define DEFAULT_RUN_S   3600            /* segment capacity when no duration is given */
+
+static const char *const counter_names[] = {
+    "rx_packets", "tx_packets", "rx_bytes", "tx_bytes", "rx_dropped", "tx_dropped",
+};
+#define N_COUNTERS      (sizeof(counter_names) / sizeof(counter_names[0]))
+
+static volatile sig_atomic_t running = 1;
+
+/* Counter files stay open; each poll is one pread per counter */
+static int fds[CBS_STATLOG_MAX_PORTS][N_COUNTERS];
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+/* Segment 0 is the file given with -o, later ones get .1, .2, ... appended */
+static int open_log(cbs_statlog_t *log, const char *out, uint32_t segment, uint64_t capacity,
+                    uint64_t period, const char *const *ports, uint32_t n_ports) {
+    char path[4096];
+    int ret;
+
+    if (segment == 0) {
+        snprintf(path, sizeof(path), "%s", out);
+    } else {
+        snprintf(path, sizeof(path), "%s.%u", out, segment);
+    }
+    ret = cbs_statlog_create(log, path, capacity, period, ports, n_ports, counter_names, N_COUNTERS);
+    if (ret < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(-ret));
+    }
+    return ret;
+}
+
+static uint64_t read_counter(int fd) {
+    char buf[32];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    uint64_t v = 0;
+
+    for (ssize_t i = 0; i < n && buf[i] >= '0' && buf[i] <= '9'; i++) {
+        v = v * 10 + (buf[i] - '0');
+    }
+    return v;
+}
+
+int main(int argc, char *argv[]) {
+    const char *out = NULL, *root = "/sys/class/net";
+    uint64_t interval_us = 1000, duration_s = 0;
+    uint64_t polls = 0, overruns = 0, busy_ns = 0, next, end, period, capacity;
+    const char *ports[CBS_STATLOG_MAX_PORTS];
+    uint32_t n_ports, segment = 0;
+    cbs_statlog_t log;
+    int opt, ret, failed = 0;
+
+    while ((opt = getopt(argc, argv, "o:i:d:s:h")) != -1) {
+        switch (opt) {
+        case 'o': out = optarg; break;
+        case 'i': interval_us = strtoull(optarg, NULL, 0); break;
+        case 'd': duration_s = strtoull(optarg, NULL, 0); break;
+        case 's': root = optarg; break;
+        default:
+            printf("Usage: %s -o file [-i interval_us] [-d seconds] [-s sysfs_root] iface...\n", argv[0]);
+            printf("  -o  Output log (cbs_statlog columnar format)\n");
+            printf("  -i  Poll interval in microseconds (default 1000)\n");
+            printf("  -d  Run time in seconds, 0 = until SIGINT/SIGTERM (default), the log then\n");
+            printf("      continues in file.1, file.2, ... after every %d s of samples\n", DEFAULT_RUN_S);
+            printf("  -s  Directory holding <iface>/statistics (default /sys/class/net)\n");
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    n_ports = argc - optind;
+    if (out == NULL || n_ports == 0 || n_ports > CBS_STATLOG_MAX_PORTS || interval_us == 0) {
+        fprintf(stderr, "Need -o, a non-zero interval and 1-%d interfaces\n", CBS_STATLOG_MAX_PORTS);
+        return 1;
+    }
+
+    for (uint32_t p = 0; p < n_ports; p++) {
+        ports[p] = argv[optind + p];
+        for (size_t c = 0; c < N_COUNTERS; c++) {
+            char path[256];
+            snprintf(path, sizeof(path), "%s/%s/statistics/%s", root, ports[p], counter_names[c]);
+            fds[p][c] = open(path, O_RDONLY);
+            if (fds[p][c] < 0) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                return 1;
+            }
+        }
+    }
+
+    period = interval_us * 1000;
+    capacity = ((duration_s ? duration_s : DEFAULT_RUN_S) * NS_PER_SEC / period + 1) * n_ports;
+    if (open_log(&log, out, segment, capacity, period, ports, n_ports) < 0) {
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    next = mono_ns();
+    end = duration_s ? next + duration_s * NS_PER_SEC : UINT64_MAX;
+    while (running && next < end) {
+        struct timespec deadline = { .tv_sec = next / NS_PER_SEC, .tv_nsec = next % NS_PER_SEC };
+        uint64_t t;
+
+        if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+            continue;
+        }
+
+        t = mono_ns();
+        for (uint32_t p = 0; p < n_ports; p++) {
+            uint64_t values[N_COUNTERS];
+            for (size_t c = 0; c < N_COUNTERS; c++) {
+                values[c] = read_counter(fds[p][c]);
+            }
+            ret = cbs_statlog_append(&log, t, p, values);
+            if (ret == -ENOSPC && duration_s == 0) {
+                /* Open-ended run: continue in the next segment */
+                ret = cbs_statlog_close(&log);
+                if (ret == 0) {
+                    ret = open_log(&log, out, ++segment, capacity, period, ports, n_ports);
+                }
+                if (ret == 0) {
+                    ret = cbs_statlog_append(&log, t, p, values);
+                }
+            }
+            if (ret < 0) {
+                fprintf(stderr, "%s: %s, collection stopped after %llu polls\n",
+                        out, strerror(-ret), (unsigned long long)polls);
+                failed = 1;
+                running = 0;
+                break;
+            }
+        }
+        cbs_statlog_commit(&log);
+        busy_ns += mono_ns() - t;
+        polls++;
+
+        /* Stay on the interval grid; count the ticks that were missed */
+        next += period;
+        t = mono_ns();
+        if (t > next) {
+            overruns += (t - next) / period + 1;
+            next += ((t - next) / period + 1) * period;
+        }
+    }
+
+    printf("%s: %llu polls x %u ports in %u file(s), %llu overruns, %.1f us per poll (%.2f%% busy)\n",
+           out, (unsigned long long)polls, n_ports, segment + 1, (unsigned long long)overruns,
+           polls ? busy_ns / 1000.0 / polls : 0.0,
+           polls ? 100.0 * busy_ns / (polls * period) : 0.0);
+
+    for (uint32_t p = 0; p < n_ports; p++) {
+        for (size_t c = 0; c < N_COUNTERS; c++) {
+            close(fds[p][c]);
+        }
+    }
+    return (cbs_statlog_close(&log) < 0 || failed) ? 1 : 0;
+}
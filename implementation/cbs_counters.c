@@ -0,0 +1,101 @@
+/**
+ * Wrap-safe statistics counters for the CBS drivers
+ * Unsigned 32-bit differences absorb one wrap per interval; the poll
+ * interval is checked against the fastest counter's wrap time
+ */
+
+#include "cbs_counters.h"
+#include "cbs_prof.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define NS_PER_SEC                  1000000000ULL
+
+static inline uint64_t counters_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+int cbs_counters_init(cbs_counters_t *c, cbs_regio_t *io, uint32_t capacity, uint32_t tau_ms) {
+    if (c == NULL || io == NULL || capacity == 0) {
+        return -EINVAL;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->offsets = calloc(capacity, sizeof(*c->offsets));
+    c->counters = calloc(capacity, sizeof(*c->counters));
+    if (c->offsets == NULL || c->counters == NULL) {
+        cbs_counters_destroy(c);
+        return -ENOMEM;
+    }
+
+    c->io = io;
+    c->capacity = capacity;
+    c->tau_ns = (uint64_t)(tau_ms ? tau_ms : CBS_COUNTERS_TAU_MS) * 1000000ULL;
+    c->wrap_ns = UINT64_MAX;
+    return 0;
+}
+
+void cbs_counters_destroy(cbs_counters_t *c) {
+    free(c->offsets);
+    free(c->counters);
+    c->offsets = NULL;
+    c->counters = NULL;
+    c->count = c->capacity = 0;
+}
+
+int cbs_counters_add(cbs_counters_t *c, uint32_t offset, uint32_t max_per_sec) {
+    if (c->count >= c->capacity) {
+        return -ENOSPC;
+    }
+
+    if (max_per_sec) {
+        uint64_t wrap_ns = (1ULL << 32) * NS_PER_SEC / max_per_sec;
+        if (wrap_ns < c->wrap_ns) {
+            c->wrap_ns = wrap_ns;
+        }
+    }
+
+    c->offsets[c->count] = offset;
+    memset(&c->counters[c->count], 0, sizeof(cbs_counter_t));
+    return c->count++;
+}
+
+void cbs_counters_poll(cbs_counters_t *c) {
+    CBS_PROF_FUNC();
+    uint64_t now = counters_now_ns();
+    bool first = (c->stats.polls == 0);
+    uint64_t dt = first ? 0 : now - c->last_poll_ns;
+    /* First-order EWMA weight for an irregular interval: dt / (tau + dt),
+     * the first interval seeds the average */
+    double alpha = (c->stats.polls == 1) ? 1.0 : (double)dt / (double)(c->tau_ns + dt);
+
+    for (uint32_t i = 0; i < c->count; i++) {
+        cbs_counter_t *ctr = &c->counters[i];
+        uint32_t raw = cbs_regio_read(c->io, c->offsets[i]);
+
+        if (first) {
+            ctr->raw = raw;
+            continue;
+        }
+
+        /* Modulo 2^32 difference stays correct across a single wrap */
+        ctr->delta = (uint32_t)(raw - ctr->raw);
+        ctr->raw = raw;
+        ctr->total += ctr->delta;
+
+        if (dt > 0) {
+            double inst = (double)ctr->delta * NS_PER_SEC / dt;
+            ctr->rate += alpha * (inst - ctr->rate);
+        }
+    }
+
+    c->stats.late_polls += (!first && dt >= c->wrap_ns);
+    c->stats.last_interval_ns = dt;
+    c->stats.reads += c->count;
+    c->stats.polls++;
+    c->last_poll_ns = now;
+}
@@ -0,0 +1,99 @@
+/**
+ * Wrap-safe statistics counters for the CBS drivers
+ * Extends 32-bit hardware counters to 64 bits and keeps per-interval
+ * deltas and EWMA rates for every counter
+ */
+
+#ifndef CBS_COUNTERS_H
+#define CBS_COUNTERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cbs_regio.h"
+
+/* Default EWMA time constant */
+#define CBS_COUNTERS_TAU_MS         1000
+
+/* One Extended Counter */
+typedef struct {
+    uint64_t total;             /* 64-bit value since the first poll */
+    uint64_t delta;             /* increase over the last poll interval */
+    double rate;                /* EWMA of delta per second */
+    uint32_t raw;               /* last hardware value */
+} cbs_counter_t;
+
+/* Counter Set Statistics */
+typedef struct {
+    uint64_t polls;
+    uint64_t reads;
+    uint64_t late_polls;        /* intervals long enough to hide a wrap */
+    uint64_t last_interval_ns;
+} cbs_counters_stats_t;
+
+/* Counter Set */
+typedef struct {
+    cbs_regio_t *io;
+    uint32_t *offsets;          /* register per counter */
+    cbs_counter_t *counters;
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t tau_ns;            /* EWMA time constant */
+    uint64_t wrap_ns;           /* shortest time any counter needs to wrap */
+    uint64_t last_poll_ns;
+    cbs_counters_stats_t stats;
+} cbs_counters_t;
+
+/**
+ * Initialize an empty counter set
+ * @param c: Counter set
+ * @param io: Register backend, read directly (not through a cache)
+ * @param capacity: Number of counters to reserve
+ * @param tau_ms: EWMA time constant, 0 for CBS_COUNTERS_TAU_MS
+ * @return: 0 on success, negative on error
+ */
+int cbs_counters_init(cbs_counters_t *c, cbs_regio_t *io, uint32_t capacity, uint32_t tau_ms);
+
+/**
+ * Free counter set memory
+ * @param c: Counter set
+ */
+void cbs_counters_destroy(cbs_counters_t *c);
+
+/**
+ * Add a 32-bit counter register
+ * @param c: Counter set
+ * @param offset: Register offset
+ * @param max_per_sec: Fastest increase per second (line rate in octets or
+ *                     frames), used to flag polls too late to catch a wrap;
+ *                     0 if unknown
+ * @return: Counter index, negative when the set is full
+ */
+int cbs_counters_add(cbs_counters_t *c, uint32_t offset, uint32_t max_per_sec);
+
+/**
+ * Read every counter once and update totals, deltas and rates.
+ * Must run more often than the fastest counter can wrap; see
+ * cbs_counters_max_interval_ms.
+ * @param c: Counter set
+ */
+void cbs_counters_poll(cbs_counters_t *c);
+
+/**
+ * Longest poll interval that cannot miss a wrap of a 32-bit counter
+ * @param max_per_sec: Fastest increase per second
+ * @return: Interval in milliseconds
+ */
+static inline uint64_t cbs_counters_max_interval_ms(uint32_t max_per_sec) {
+    return max_per_sec ? (1ULL << 32) * 1000 / max_per_sec : UINT64_MAX;
+}
+
+/* Octets and minimum-size frames per second at a port speed (bps) */
+static inline uint32_t cbs_counters_octets_per_sec(uint64_t port_speed) {
+    return (uint32_t)(port_speed / 8);
+}
+
+static inline uint32_t cbs_counters_frames_per_sec(uint64_t port_speed) {
+    return (uint32_t)(port_speed / (84 * 8));   /* 64 byte frame + preamble + IFG */
+}
+
+#endif /* CBS_COUNTERS_H */
@@ -0,0 +1,200 @@
+/**
+ * Structure-of-arrays credit kernel for time-stepped CBS simulation
+ * The AVX2 path is compiled with a target attribute and picked at run
+ * time, so the build needs no -mavx2 and runs on any x86-64 or ARM host
+ */
+
+#include "cbs_credit.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CBS_CREDIT_AVX2             1
+#endif
+
+#define PS_PER_SEC                  1000000000000ULL
+#define PICOBITS_PER_BYTE           (8 * PS_PER_SEC)
+#define MAX_CREDIT_BYTES            1000000     /* hi/loCredit clamp, as CBS_SIM_MAX_CREDIT */
+#define MAX_STEP_PICOBITS           (INT64_MAX - (int64_t)MAX_CREDIT_BYTES * (int64_t)PICOBITS_PER_BYTE)
+#define NUM_ARRAYS                  5
+
+typedef void (*step_fn_t)(cbs_credit_t *, const uint64_t *, const uint64_t *, uint64_t *, uint32_t);
+
+static step_fn_t step_impl;
+
+int cbs_credit_init(cbs_credit_t *k, uint32_t n_queues, uint64_t dt_ps) {
+    size_t bytes;
+
+    if (n_queues == 0 || n_queues > CBS_CREDIT_MAX_QUEUES || dt_ps == 0) {
+        return -EINVAL;
+    }
+    n_queues = (n_queues + CBS_CREDIT_QUEUES_PER_WORD - 1) & ~(CBS_CREDIT_QUEUES_PER_WORD - 1);
+    bytes = (size_t)n_queues * sizeof(int64_t);
+
+    memset(k, 0, sizeof(*k));
+    k->mem = aligned_alloc(64, bytes * NUM_ARRAYS);
+    if (k->mem == NULL) {
+        return -ENOMEM;
+    }
+    memset(k->mem, 0, bytes * NUM_ARRAYS);
+    k->credit = k->mem;
+    k->idle_inc = k->credit + n_queues;
+    k->send_dec = k->idle_inc + n_queues;
+    k->hi_credit = k->send_dec + n_queues;
+    k->lo_credit = k->hi_credit + n_queues;
+    k->n_queues = n_queues;
+    k->dt_ps = dt_ps;
+    return 0;
+}
+
+void cbs_credit_destroy(cbs_credit_t *k) {
+    free(k->mem);
+    memset(k, 0, sizeof(*k));
+}
+
+int cbs_credit_set(cbs_credit_t *k, uint32_t queue, uint64_t idle_slope, uint64_t send_slope,
+                   uint32_t hi_credit, uint32_t lo_credit) {
+    uint64_t inc, dec;
+
+    if (queue >= k->n_queues) {
+        return -EINVAL;
+    }
+    k->credit[queue] = 0;
+    if (idle_slope == 0) {
+        k->idle_inc[queue] = k->send_dec[queue] = 0;
+        k->hi_credit[queue] = k->lo_credit[queue] = 0;
+        return 0;
+    }
+    /* c + inc and c - dec must stay within int64 for any credit in [-loCredit, hiCredit] */
+    if (__builtin_mul_overflow(idle_slope, k->dt_ps, &inc) || inc > (uint64_t)MAX_STEP_PICOBITS ||
+        __builtin_mul_overflow(send_slope, k->dt_ps, &dec) || dec > (uint64_t)MAX_STEP_PICOBITS) {
+        return -ERANGE;
+    }
+    k->idle_inc[queue] = (int64_t)inc;
+    k->send_dec[queue] = (int64_t)dec;
+    k->hi_credit[queue] = (int64_t)(hi_credit < MAX_CREDIT_BYTES ? hi_credit : MAX_CREDIT_BYTES) *
+                          (int64_t)PICOBITS_PER_BYTE;
+    k->lo_credit[queue] = -(int64_t)(lo_credit < MAX_CREDIT_BYTES ? lo_credit : MAX_CREDIT_BYTES) *
+                          (int64_t)PICOBITS_PER_BYTE;
+    return 0;
+}
+
+void cbs_credit_step_scalar(cbs_credit_t *k, const uint64_t *transmitting, const uint64_t *backlogged,
+                            uint64_t *eligible, uint32_t steps) {
+    for (uint32_t w = 0; w < k->n_queues / CBS_CREDIT_QUEUES_PER_WORD; w++) {
+        uint64_t out = 0;
+
+        for (uint32_t b = 0; b < CBS_CREDIT_QUEUES_PER_WORD; b++) {
+            uint32_t i = w * CBS_CREDIT_QUEUES_PER_WORD + b;
+            int tx = (transmitting[w] >> b) & 1;
+            int queued = (backlogged[w] >> b) & 1;
+            int64_t c = k->credit[i];
+
+            for (uint32_t s = 0; s < steps; s++) {
+                if (tx) {
+                    c -= k->send_dec[i];
+                    if (c < k->lo_credit[i]) c = k->lo_credit[i];
+                } else if (queued) {
+                    c += k->idle_inc[i];
+                    if (c > k->hi_credit[i]) c = k->hi_credit[i];
+                } else {
+                    /* Empty: positive credit is dropped, negative recovers toward zero */
+                    c = (c > 0) ? 0 : c + k->idle_inc[i];
+                    if (c > 0) c = 0;
+                }
+            }
+            k->credit[i] = c;
+            out |= (uint64_t)(queued && c >= 0) << b;
+        }
+        if (eligible) {
+            eligible[w] = out;
+        }
+    }
+}
+
+#ifdef CBS_CREDIT_AVX2
+/* Lane masks of four consecutive mask bits */
+static const int64_t lane_mask[16][4] __attribute__((aligned(32))) = {
+#define L(b)    (((b) & 1) ? -1 : 0), (((b) & 2) ? -1 : 0), (((b) & 4) ? -1 : 0), (((b) & 8) ? -1 : 0)
+    { L(0) },  { L(1) },  { L(2) },  { L(3) },  { L(4) },  { L(5) },  { L(6) },  { L(7) },
+    { L(8) },  { L(9) },  { L(10) }, { L(11) }, { L(12) }, { L(13) }, { L(14) }, { L(15) },
+#undef L
+};
+
+/*
+ * Same rules as the scalar loop, branch-free: with idle_inc >= 0 the
+ * empty-queue rule is min(c + idle_inc, 0) whatever the sign of c.
+ * Steps run over all sixteen vectors of a mask word in turn so the
+ * independent vectors hide the compare/blend latency of each other
+ */
+__attribute__((target("avx2")))
+static void step_avx2(cbs_credit_t *k, const uint64_t *transmitting, const uint64_t *backlogged,
+                      uint64_t *eligible, uint32_t steps) {
+    enum { VECTORS = CBS_CREDIT_QUEUES_PER_WORD / 4 };
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minus_one = _mm256_set1_epi64x(-1);
+
+    for (uint32_t w = 0; w < k->n_queues / CBS_CREDIT_QUEUES_PER_WORD; w++) {
+        __m256i *credit = (__m256i *)&k->credit[w * CBS_CREDIT_QUEUES_PER_WORD];
+        const __m256i *inc = (const __m256i *)&k->idle_inc[w * CBS_CREDIT_QUEUES_PER_WORD];
+        const __m256i *dec = (const __m256i *)&k->send_dec[w * CBS_CREDIT_QUEUES_PER_WORD];
+        const __m256i *hi = (const __m256i *)&k->hi_credit[w * CBS_CREDIT_QUEUES_PER_WORD];
+        const __m256i *lo = (const __m256i *)&k->lo_credit[w * CBS_CREDIT_QUEUES_PER_WORD];
+        uint64_t out = 0;
+
+        for (uint32_t s = 0; s < steps; s++) {
+            for (int v = 0; v < VECTORS; v++) {
+                __m256i tx = _mm256_load_si256((const __m256i *)lane_mask[(transmitting[w] >> (v * 4)) & 15]);
+                __m256i queued = _mm256_load_si256((const __m256i *)lane_mask[(backlogged[w] >> (v * 4)) & 15]);
+                __m256i c = _mm256_load_si256(&credit[v]);
+                __m256i up = _mm256_add_epi64(c, _mm256_load_si256(&inc[v]));
+                __m256i down = _mm256_sub_epi64(c, _mm256_load_si256(&dec[v]));
+                __m256i h = _mm256_load_si256(&hi[v]);
+                __m256i l = _mm256_load_si256(&lo[v]);
+                __m256i waiting = _mm256_blendv_epi8(up, h, _mm256_cmpgt_epi64(up, h));
+                __m256i empty = _mm256_and_si256(up, _mm256_cmpgt_epi64(zero, up));
+
+                down = _mm256_blendv_epi8(down, l, _mm256_cmpgt_epi64(l, down));
+                _mm256_store_si256(&credit[v], _mm256_blendv_epi8(_mm256_blendv_epi8(empty, waiting, queued),
+                                                                  down, tx));
+            }
+        }
+        for (int v = 0; v < VECTORS; v++) {
+            __m256i queued = _mm256_load_si256((const __m256i *)lane_mask[(backlogged[w] >> (v * 4)) & 15]);
+            __m256i ok = _mm256_and_si256(queued, _mm256_cmpgt_epi64(_mm256_load_si256(&credit[v]), minus_one));
+
+            out |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(ok)) << (v * 4);
+        }
+        if (eligible) {
+            eligible[w] = out;
+        }
+    }
+}
+#endif
+
+static step_fn_t select_impl(void) {
+#ifdef CBS_CREDIT_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return step_avx2;
+    }
+#endif
+    return cbs_credit_step_scalar;
+}
+
+void cbs_credit_step(cbs_credit_t *k, const uint64_t *transmitting, const uint64_t *backlogged,
+                     uint64_t *eligible, uint32_t steps) {
+    if (step_impl == NULL) {
+        step_impl = select_impl();
+    }
+    step_impl(k, transmitting, backlogged, eligible, steps);
+}
+
+const char *cbs_credit_isa(void) {
+    if (step_impl == NULL) {
+        step_impl = select_impl();
+    }
+    return step_impl == cbs_credit_step_scalar ? "scalar" : "avx2";
+}
@@ -0,0 +1,90 @@
+/**
+ * Structure-of-arrays credit kernel for time-stepped CBS simulation
+ * Advances the credit of every shaped queue of a switch (e.g. the
+ * 64 x 8 LAN9662 egress queues) by a fixed time step at once. Queue
+ * state is kept as parallel int64 arrays so four queues fit one AVX2
+ * register; the per-step inputs (which queues transmit, which hold
+ * frames) and the output (which queues may start a frame) are bitmasks,
+ * one bit per queue, queue index = port * 8 + tc.
+ *
+ * Credit rules and units are those of cbs_sim (picobits): while a queue
+ * transmits, credit falls at sendSlope down to -loCredit; while frames
+ * wait it rises at idleSlope up to hiCredit; an empty queue drops
+ * positive credit and recovers toward zero. All arithmetic is integer,
+ * so the AVX2 path is bit-identical to cbs_credit_step_scalar(), which
+ * is also the portable fallback.
+ */
+
+#ifndef CBS_CREDIT_H
+#define CBS_CREDIT_H
+
+#include <stdint.h>
+
+#define CBS_CREDIT_QUEUES_PER_WORD  64          /* queues per mask word */
+#define CBS_CREDIT_MAX_QUEUES       4096
+
+/* Queue State, one array element per queue */
+typedef struct {
+    int64_t *credit;            /* picobits */
+    int64_t *idle_inc;          /* idleSlope x dt, picobits; 0 = unshaped */
+    int64_t *send_dec;          /* sendSlope x dt, picobits */
+    int64_t *hi_credit;         /* picobits */
+    int64_t *lo_credit;         /* picobits, stored negative */
+    uint32_t n_queues;          /* multiple of CBS_CREDIT_QUEUES_PER_WORD */
+    uint64_t dt_ps;             /* time step */
+    void *mem;
+} cbs_credit_t;
+
+/**
+ * Allocate the kernel; every queue starts unshaped with zero credit
+ * @param k: Kernel
+ * @param n_queues: Number of queues, rounded up to a multiple of 64
+ * @param dt_ps: Time step in picoseconds
+ * @return: 0 on success, -EINVAL, -ENOMEM
+ */
+int cbs_credit_init(cbs_credit_t *k, uint32_t n_queues, uint64_t dt_ps);
+
+/**
+ * Release the kernel's arrays
+ * @param k: Kernel
+ */
+void cbs_credit_destroy(cbs_credit_t *k);
+
+/**
+ * Program one queue's shaper and reset its credit
+ * @param k: Kernel
+ * @param queue: Queue index (port * 8 + tc)
+ * @param idle_slope: bps, 0 = unshaped (always eligible when backlogged)
+ * @param send_slope: bps, magnitude
+ * @param hi_credit: bytes
+ * @param lo_credit: bytes, magnitude
+ * @return: 0 on success, -EINVAL, -ERANGE if a step of the slopes could overflow
+ */
+int cbs_credit_set(cbs_credit_t *k, uint32_t queue, uint64_t idle_slope, uint64_t send_slope,
+                   uint32_t hi_credit, uint32_t lo_credit);
+
+/**
+ * Advance every queue by steps time steps with constant inputs
+ * @param k: Kernel
+ * @param transmitting: n_queues / 64 mask words, bit set = queue's frame is on the wire
+ * @param backlogged: n_queues / 64 mask words, bit set = queue holds frames
+ * @param eligible: n_queues / 64 mask words written with backlogged && credit >= 0
+ *                  after the last step (may be NULL)
+ * @param steps: Number of time steps
+ */
+void cbs_credit_step(cbs_credit_t *k, const uint64_t *transmitting, const uint64_t *backlogged,
+                     uint64_t *eligible, uint32_t steps);
+
+/**
+ * Reference implementation of cbs_credit_step(), one queue at a time
+ */
+void cbs_credit_step_scalar(cbs_credit_t *k, const uint64_t *transmitting, const uint64_t *backlogged,
+                            uint64_t *eligible, uint32_t steps);
+
+/**
+ * Instruction set cbs_credit_step() runs on this CPU
+ * @return: "avx2" or "scalar"
+ */
+const char *cbs_credit_isa(void);
+
+#endif /* CBS_CREDIT_H */
@@ -0,0 +1,70 @@
+/**
+ * Fixed-memory log-linear histograms (HDR style) for queue depth and delay
+ */
+
+#include "cbs_hist.h"
+#include <string.h>
+
+void cbs_hist_reset(cbs_hist_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT32_MAX;
+}
+
+void cbs_hist_merge(cbs_hist_t *dst, const cbs_hist_t *src) {
+    if (src->count == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < CBS_HIST_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+uint32_t cbs_hist_bucket_max(uint32_t idx) {
+    uint32_t shift, mant;
+
+    if (idx < (1u << CBS_HIST_SUB_BITS)) {
+        return idx;
+    }
+    shift = idx / CBS_HIST_SUB_HALF - 1;
+    mant = idx - shift * CBS_HIST_SUB_HALF;
+    return (uint32_t)((((uint64_t)mant + 1) << shift) - 1);
+}
+
+uint32_t cbs_hist_percentile(const cbs_hist_t *h, double fraction) {
+    uint64_t target, seen = 0;
+
+    if (h->count == 0) {
+        return 0;
+    }
+
+    /* Rank of the value, at least the first one */
+    target = (uint64_t)(fraction * h->count + 0.999999);
+    if (target == 0) target = 1;
+    if (target > h->count) target = h->count;
+
+    for (uint32_t i = 0; i < CBS_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) {
+            uint32_t v = cbs_hist_bucket_max(i);
+            return v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+void cbs_hist_summarize(cbs_hist_t *h, cbs_hist_summary_t *summary, int reset) {
+    summary->count = h->count;
+    summary->mean = h->count ? (double)h->sum / h->count : 0.0;
+    summary->p50 = cbs_hist_percentile(h, 0.50);
+    summary->p99 = cbs_hist_percentile(h, 0.99);
+    summary->p999 = cbs_hist_percentile(h, 0.999);
+    summary->max = h->count ? h->max : 0;
+
+    if (reset) {
+        cbs_hist_reset(h);
+    }
+}
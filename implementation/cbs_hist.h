@@ -0,0 +1,106 @@
+/**
+ * Fixed-memory log-linear histograms (HDR style) for queue depth and delay
+ * Values 0..2^32-1 with 2^(CBS_HIST_SUB_BITS-1) linear buckets per power
+ * of two, i.e. a relative bucket width of at most 1/32
+ */
+
+#ifndef CBS_HIST_H
+#define CBS_HIST_H
+
+#include <stdint.h>
+
+#define CBS_HIST_SUB_BITS           6
+#define CBS_HIST_SUB_HALF           (1u << (CBS_HIST_SUB_BITS - 1))
+#define CBS_HIST_BUCKETS            ((32 - CBS_HIST_SUB_BITS) * CBS_HIST_SUB_HALF + (1u << CBS_HIST_SUB_BITS))
+
+/* Histogram */
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint32_t min;
+    uint32_t max;
+    uint64_t buckets[CBS_HIST_BUCKETS];
+} cbs_hist_t;
+
+/* Percentile Summary (bucket upper bounds, max is exact) */
+typedef struct {
+    uint64_t count;
+    double mean;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t p999;
+    uint32_t max;
+} cbs_hist_summary_t;
+
+/* Bucket index of a value: linear below 2^SUB_BITS, then SUB_HALF buckets per octave */
+static inline uint32_t cbs_hist_index(uint32_t v) {
+    uint32_t msb, shift;
+
+    if (v < (1u << CBS_HIST_SUB_BITS)) {
+        return v;
+    }
+    msb = 31 - __builtin_clz(v);
+    shift = msb - CBS_HIST_SUB_BITS + 1;
+    return shift * CBS_HIST_SUB_HALF + (v >> shift);
+}
+
+/**
+ * Record one value
+ * @param h: Histogram
+ * @param v: Value
+ */
+static inline void cbs_hist_record(cbs_hist_t *h, uint32_t v) {
+    h->buckets[cbs_hist_index(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+}
+
+/**
+ * Clear a histogram
+ * @param h: Histogram
+ */
+void cbs_hist_reset(cbs_hist_t *h);
+
+/**
+ * Add all values of src into dst
+ * @param dst: Destination histogram
+ * @param src: Source histogram
+ */
+void cbs_hist_merge(cbs_hist_t *dst, const cbs_hist_t *src);
+
+/**
+ * Largest value that falls in a bucket
+ * @param idx: Bucket index
+ * @return: Upper bound of the bucket
+ */
+uint32_t cbs_hist_bucket_max(uint32_t idx);
+
+/**
+ * Value at or below which a fraction of the recorded values lie
+ * @param h: Histogram
+ * @param fraction: 0.0 - 1.0
+ * @return: Bucket upper bound (clamped to the exact max), 0 if empty
+ */
+uint32_t cbs_hist_percentile(const cbs_hist_t *h, double fraction);
+
+/**
+ * Summarize a histogram and optionally reset it (reset-on-read)
+ * @param h: Histogram
+ * @param summary: Output
+ * @param reset: Clear h after reading
+ */
+void cbs_hist_summarize(cbs_hist_t *h, cbs_hist_summary_t *summary, int reset);
+
+/**
+ * Queuing delay of a backlog drained at a given rate
+ * @param depth_bytes: Queue depth in bytes
+ * @param rate_bps: Drain rate (port rate, or idle slope for a shaped queue)
+ * @return: Delay in nanoseconds
+ */
+static inline uint64_t cbs_hist_delay_ns(uint32_t depth_bytes, uint64_t rate_bps) {
+    return rate_bps ? (uint64_t)depth_bytes * 8000000000ULL / rate_bps : 0;
+}
+
+#endif /* CBS_HIST_H */
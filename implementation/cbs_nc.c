@@ -0,0 +1,254 @@
+/**
+ * Network-calculus end-to-end bounds for streams crossing several CBS hops
+ * Quantities are bytes, bps and ns; all roundings are upward so every
+ * bound stays conservative
+ */
+
+#include "cbs_nc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define NS_PER_SEC                  1000000000ULL
+#define UNBOUNDED                   UINT32_MAX  /* burst behind an overloaded hop */
+
+/* ceil(a * b / c), falling back to floating point beyond 2^64 */
+static inline uint64_t mul_div_ceil(uint64_t a, uint64_t b, uint64_t c) {
+    uint64_t p;
+
+    if (__builtin_mul_overflow(a, b, &p)) {
+        return (uint64_t)((double)a * b / c) + 1;
+    }
+    return p / c + (p % c != 0);
+}
+
+static inline uint32_t add_bytes(uint32_t a, uint64_t b) {
+    return (a == UNBOUNDED || b >= UNBOUNDED - a) ? UNBOUNDED : a + (uint32_t)b;
+}
+
+int cbs_nc_workspace_init(cbs_nc_workspace_t *ws, uint32_t max_ports, uint32_t max_streams) {
+    memset(ws, 0, sizeof(*ws));
+    ws->burst_in = calloc((size_t)(max_streams ? max_streams : 1) * CBS_NC_MAX_HOPS, sizeof(uint32_t));
+    ws->classes = calloc((size_t)(max_ports ? max_ports : 1) * CBS_NC_NUM_TCS,
+                         sizeof(cbs_nc_class_result_t));
+    if (ws->burst_in == NULL || ws->classes == NULL) {
+        cbs_nc_workspace_free(ws);
+        return -ENOMEM;
+    }
+    ws->max_ports = max_ports;
+    ws->max_streams = max_streams;
+    return 0;
+}
+
+void cbs_nc_workspace_free(cbs_nc_workspace_t *ws) {
+    free(ws->burst_in);
+    free(ws->classes);
+    ws->burst_in = NULL;
+    ws->classes = NULL;
+}
+
+/*
+ * Server of one shaped class: credit bounds from cbs_calc with the frames
+ * that actually cross the port, and the latency T of the rate-latency
+ * curve idleSlope * (t - T), so that delay = T + burst / idleSlope
+ */
+static void class_server(const cbs_nc_port_t *port, cbs_nc_class_result_t *classes, int tc) {
+    cbs_nc_class_result_t *c = &classes[tc];
+    cbs_calc_class_t cls = {
+        .port_rate = port->port_rate,
+        .idle_slope = port->idle_slope[tc],
+        .max_frame = c->max_frame,
+        .max_interference = port->max_unshaped_frame ? port->max_unshaped_frame : CBS_CALC_DEFAULT_FRAME,
+    };
+    cbs_calc_result_t result;
+    uint64_t frame_ns;
+
+    if (cls.idle_slope == 0) {
+        c->status = -EINVAL;    /* stream on an unshaped class */
+        return;
+    }
+    if (c->rate > cls.idle_slope) {
+        c->status = -ERANGE;
+        return;
+    }
+    for (int other = 0; other < CBS_NC_NUM_TCS; other++) {
+        if (other < tc && classes[other].max_frame > cls.max_interference) {
+            cls.max_interference = classes[other].max_frame;
+        } else if (other > tc && port->idle_slope[other]) {
+            cls.higher_idle_slope += port->idle_slope[other];
+            if (classes[other].max_frame > cls.higher_max_frame) {
+                cls.higher_max_frame = classes[other].max_frame;
+            }
+        }
+    }
+    if (cbs_calc(&cls, &result) < 0) {
+        c->status = -EINVAL;
+        return;
+    }
+
+    c->hi_credit = result.hi_credit;
+    c->lo_credit = result.lo_credit;
+    /* cbs_calc's delay for a one-frame burst, less that frame at idleSlope (about hiCredit / idleSlope) */
+    frame_ns = (uint64_t)cls.max_frame * 8 * NS_PER_SEC / cls.idle_slope;
+    c->latency_ns = result.max_delay_ns > frame_ns ? result.max_delay_ns - frame_ns : 0;
+}
+
+int cbs_nc_analyze(const cbs_nc_network_t *net, cbs_nc_workspace_t *ws,
+                   cbs_nc_stream_result_t *results) {
+    cbs_nc_class_result_t *classes = ws->classes;
+    int unbounded = 0, iteration;
+
+    if (net->n_ports > ws->max_ports || net->n_streams > ws->max_streams) {
+        return -EINVAL;
+    }
+    for (uint32_t p = 0; p < net->n_ports; p++) {
+        if (net->ports[p].port_rate == 0 || net->ports[p].port_rate > CBS_CALC_MAX_RATE) {
+            return -EINVAL;
+        }
+    }
+    memset(classes, 0, (size_t)net->n_ports * CBS_NC_NUM_TCS * sizeof(*classes));
+
+    /* Class membership: sustained rate and largest frame per port and TC */
+    for (uint32_t s = 0; s < net->n_streams; s++) {
+        const cbs_nc_stream_t *st = &net->streams[s];
+
+        if (st->tc >= CBS_NC_NUM_TCS || st->n_hops == 0 || st->n_hops > CBS_NC_MAX_HOPS ||
+            st->rate == 0 || st->max_frame == 0 || st->max_frame > CBS_CALC_MAX_FRAME) {
+            return -EINVAL;
+        }
+        for (int h = 0; h < st->n_hops; h++) {
+            cbs_nc_class_result_t *c;
+
+            if (st->hops[h] >= net->n_ports) {
+                return -EINVAL;
+            }
+            c = &classes[st->hops[h] * CBS_NC_NUM_TCS + st->tc];
+            c->rate += st->rate;
+            c->streams++;
+            if (st->max_frame > c->max_frame) {
+                c->max_frame = st->max_frame;
+            }
+        }
+        /* Start every hop from the source burst; the iteration only grows them */
+        for (int h = 0; h < st->n_hops; h++) {
+            ws->burst_in[s * CBS_NC_MAX_HOPS + h] = st->burst > st->max_frame ? st->burst : st->max_frame;
+        }
+    }
+
+    for (uint32_t p = 0; p < net->n_ports; p++) {
+        for (int tc = 0; tc < CBS_NC_NUM_TCS; tc++) {
+            if (classes[p * CBS_NC_NUM_TCS + tc].streams) {
+                class_server(&net->ports[p], &classes[p * CBS_NC_NUM_TCS], tc);
+            }
+        }
+    }
+
+    /* Total flow analysis: hop delays from the aggregate bursts, bursts from upstream delays */
+    for (iteration = 0; iteration < CBS_NC_MAX_ITERATIONS; iteration++) {
+        int changed = 0;
+
+        for (uint32_t i = 0; i < net->n_ports * CBS_NC_NUM_TCS; i++) {
+            classes[i].burst = 0;
+        }
+        for (uint32_t s = 0; s < net->n_streams; s++) {
+            const cbs_nc_stream_t *st = &net->streams[s];
+            for (int h = 0; h < st->n_hops; h++) {
+                cbs_nc_class_result_t *c = &classes[st->hops[h] * CBS_NC_NUM_TCS + st->tc];
+                c->burst = add_bytes(c->burst, ws->burst_in[s * CBS_NC_MAX_HOPS + h]);
+            }
+        }
+        for (uint32_t i = 0; i < net->n_ports * CBS_NC_NUM_TCS; i++) {
+            cbs_nc_class_result_t *c = &classes[i];
+            if (c->streams == 0 || c->status != 0) continue;
+            if (c->burst == UNBOUNDED) {
+                c->delay_ns = UINT64_MAX;
+                continue;
+            }
+            c->delay_ns = c->latency_ns + mul_div_ceil((uint64_t)c->burst * 8, NS_PER_SEC,
+                                                       net->ports[i / CBS_NC_NUM_TCS].idle_slope[i % CBS_NC_NUM_TCS]);
+        }
+
+        for (uint32_t s = 0; s < net->n_streams; s++) {
+            const cbs_nc_stream_t *st = &net->streams[s];
+            uint32_t *burst = &ws->burst_in[s * CBS_NC_MAX_HOPS];
+
+            for (int h = 1; h < st->n_hops; h++) {
+                const cbs_nc_class_result_t *c = &classes[st->hops[h - 1] * CBS_NC_NUM_TCS + st->tc];
+                uint32_t next = (c->status != 0 || c->delay_ns == UINT64_MAX) ? UNBOUNDED :
+                                add_bytes(burst[h - 1], mul_div_ceil(st->rate, c->delay_ns, 8 * NS_PER_SEC));
+                if (next != burst[h]) {
+                    burst[h] = next;
+                    changed = 1;
+                }
+            }
+        }
+        if (!changed) {
+            break;
+        }
+    }
+    if (iteration == CBS_NC_MAX_ITERATIONS) {
+        return -ELOOP;
+    }
+
+    /* Class backlog: aggregate burst plus what arrives during the server latency */
+    for (uint32_t i = 0; i < net->n_ports * CBS_NC_NUM_TCS; i++) {
+        cbs_nc_class_result_t *c = &classes[i];
+        if (c->streams == 0) continue;
+        if (c->status == 0 && c->burst == UNBOUNDED) {
+            c->status = -ERANGE;
+        }
+        c->backlog = c->status ? UNBOUNDED :
+                     add_bytes(c->burst, mul_div_ceil(c->rate, c->latency_ns, 8 * NS_PER_SEC));
+    }
+
+    for (uint32_t s = 0; s < net->n_streams; s++) {
+        const cbs_nc_stream_t *st = &net->streams[s];
+        const uint32_t *burst = &ws->burst_in[s * CBS_NC_MAX_HOPS];
+        cbs_nc_stream_result_t *r = &results[s];
+        uint64_t latency_sum = 0, fixed = 0, min_rate = UINT64_MAX;
+        int alone = 1;
+
+        memset(r, 0, sizeof(*r));
+        for (int h = 0; h < st->n_hops; h++) {
+            const cbs_nc_port_t *port = &net->ports[st->hops[h]];
+            const cbs_nc_class_result_t *c = &classes[st->hops[h] * CBS_NC_NUM_TCS + st->tc];
+            uint32_t share;
+
+            if (c->status != 0) {
+                r->status = c->status;
+                break;
+            }
+            r->delay_tfa_ns += c->delay_ns + port->latency_ns;
+            latency_sum += c->latency_ns;
+            fixed += port->latency_ns;
+            if (port->idle_slope[st->tc] < min_rate) {
+                min_rate = port->idle_slope[st->tc];
+            }
+            alone &= c->streams == 1;
+
+            share = add_bytes(burst[h], mul_div_ceil(st->rate, c->latency_ns, 8 * NS_PER_SEC));
+            if (share > r->backlog) {
+                r->backlog = share;
+            }
+            if (h == st->n_hops - 1) {
+                r->out_burst = add_bytes(burst[h], mul_div_ceil(st->rate, c->delay_ns, 8 * NS_PER_SEC));
+            }
+        }
+        if (r->status != 0) {
+            r->delay_ns = r->delay_tfa_ns = UINT64_MAX;
+            r->backlog = r->out_burst = UNBOUNDED;
+            unbounded++;
+            continue;
+        }
+
+        /* Pay bursts only once through the concatenated servers */
+        r->delay_ns = r->delay_tfa_ns;
+        if (alone) {
+            uint64_t pboo = latency_sum + fixed + mul_div_ceil((uint64_t)burst[0] * 8, NS_PER_SEC, min_rate);
+            if (pboo < r->delay_ns) {
+                r->delay_ns = pboo;
+            }
+        }
+    }
+    return unbounded;
+}
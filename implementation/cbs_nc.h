@@ -0,0 +1,111 @@
+/**
+ * Network-calculus end-to-end bounds for streams crossing several CBS hops
+ * Every shaped class of an egress port is a rate-latency server
+ * (rate idleSlope, latency from the cbs_calc credit bounds); every stream
+ * is a token bucket (rate, burst). Per-hop class delays add up along the
+ * path while each stream's burst grows by rate x hop delay (total flow
+ * analysis, iterated to a fixed point). A stream that has its class to
+ * itself on every hop instead gets the pay-bursts-only-once bound of the
+ * concatenated servers, whichever is smaller.
+ *
+ * One analysis is a few cbs_calc calls per port and class plus a pass
+ * over the paths per iteration: no allocation in the steady state, so
+ * candidate configurations can be evaluated by the million.
+ */
+
+#ifndef CBS_NC_H
+#define CBS_NC_H
+
+#include <stdint.h>
+#include "cbs_calc.h"
+
+#define CBS_NC_MAX_HOPS             16
+#define CBS_NC_NUM_TCS              8
+#define CBS_NC_MAX_ITERATIONS       64          /* fixed point of cyclic dependencies */
+
+/* Egress Port (one hop) */
+typedef struct {
+    uint64_t port_rate;                     /* bps */
+    uint64_t idle_slope[CBS_NC_NUM_TCS];    /* bps, 0 = class not shaped */
+    uint32_t max_unshaped_frame;            /* largest frame of unshaped classes, 0 = CBS_CALC_DEFAULT_FRAME */
+    uint32_t latency_ns;                    /* fixed forwarding + propagation delay after the port */
+} cbs_nc_port_t;
+
+/* Stream: token bucket on a path of egress ports */
+typedef struct {
+    uint64_t rate;                          /* sustained bps */
+    uint32_t burst;                         /* bytes, at least max_frame */
+    uint32_t max_frame;                     /* bytes */
+    uint8_t tc;                             /* shaped class on every hop */
+    uint8_t n_hops;
+    uint16_t hops[CBS_NC_MAX_HOPS];         /* port indices in path order */
+} cbs_nc_stream_t;
+
+/* Network */
+typedef struct {
+    const cbs_nc_port_t *ports;
+    uint32_t n_ports;
+    const cbs_nc_stream_t *streams;
+    uint32_t n_streams;
+} cbs_nc_network_t;
+
+/* Per Port and Class Bounds */
+typedef struct {
+    uint64_t rate;                          /* sum of the stream rates, bps */
+    uint64_t latency_ns;                    /* rate-latency server T */
+    uint64_t delay_ns;                      /* worst-case delay through the port */
+    uint32_t backlog;                       /* worst-case queue, bytes */
+    uint32_t burst;                         /* aggregate arriving burst, bytes */
+    uint32_t max_frame;                     /* largest frame of the class's streams, bytes */
+    uint32_t hi_credit;                     /* bytes, from the streams' frames */
+    uint32_t lo_credit;                     /* bytes */
+    uint16_t streams;
+    int16_t status;                         /* 0, -ERANGE overloaded, -EINVAL bad class */
+} cbs_nc_class_result_t;
+
+/* Per Stream Bounds */
+typedef struct {
+    uint64_t delay_ns;                      /* end to end, fixed latencies included */
+    uint64_t delay_tfa_ns;                  /* sum of the per-hop bounds */
+    uint32_t backlog;                       /* largest share of any hop's queue, bytes */
+    uint32_t out_burst;                     /* burst leaving the last hop, bytes */
+    int status;                             /* 0, -ERANGE (overloaded hop), -EINVAL */
+} cbs_nc_stream_result_t;
+
+/* Scratch space reused between analyses */
+typedef struct {
+    uint32_t *burst_in;                     /* n_streams x CBS_NC_MAX_HOPS */
+    cbs_nc_class_result_t *classes;         /* n_ports x CBS_NC_NUM_TCS */
+    uint32_t max_streams;
+    uint32_t max_ports;
+} cbs_nc_workspace_t;
+
+/**
+ * Allocate scratch space for networks up to the given size
+ * @param ws: Workspace
+ * @param max_ports: Largest n_ports analyzed
+ * @param max_streams: Largest n_streams analyzed
+ * @return: 0 on success, -ENOMEM
+ */
+int cbs_nc_workspace_init(cbs_nc_workspace_t *ws, uint32_t max_ports, uint32_t max_streams);
+
+/**
+ * Release the workspace
+ * @param ws: Workspace
+ */
+void cbs_nc_workspace_free(cbs_nc_workspace_t *ws);
+
+/**
+ * Compute worst-case delay and backlog of every stream and class
+ * @param net: Network
+ * @param ws: Workspace large enough for net; ws->classes[port * CBS_NC_NUM_TCS + tc]
+ *            holds the class results afterwards
+ * @param results: n_streams stream results
+ * @return: Number of streams without a finite bound (0 = all bounded),
+ *          -EINVAL for a malformed network, -ELOOP if the dependencies
+ *          do not converge
+ */
+int cbs_nc_analyze(const cbs_nc_network_t *net, cbs_nc_workspace_t *ws,
+                   cbs_nc_stream_result_t *results);
+
+#endif /* CBS_NC_H */
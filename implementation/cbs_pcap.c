@@ -0,0 +1,245 @@
+/**
+ * Zero-copy pcap / pcapng reader
+ * Records are validated against the mapping size before any field is
+ * read, so a truncated capture ends with -EPROTO instead of a fault
+ */
+
+#include "cbs_pcap.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PCAP_MAGIC_US               0xA1B2C3D4
+#define PCAP_MAGIC_NS               0xA1B23C4D
+#define PCAP_HEADER_LEN             24
+#define PCAP_RECORD_LEN             16
+
+#define PCAPNG_SHB                  0x0A0D0D0A
+#define PCAPNG_IDB                  0x00000001
+#define PCAPNG_SPB                  0x00000003
+#define PCAPNG_EPB                  0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC     0x1A2B3C4D
+#define PCAPNG_OPT_END              0
+#define PCAPNG_OPT_IF_TSRESOL       9
+#define PCAPNG_DEFAULT_TSRESOL      6           /* microseconds */
+
+static inline uint16_t rd16(const cbs_pcap_t *pc, const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return pc->swapped ? __builtin_bswap16(v) : v;
+}
+
+static inline uint32_t rd32(const cbs_pcap_t *pc, const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return pc->swapped ? __builtin_bswap32(v) : v;
+}
+
+/* Timestamp in if_tsresol units (10^-n s, or 2^-n s with the high bit set) to ns */
+static uint64_t ts_to_ns(uint64_t ts, uint8_t resol) {
+    uint64_t scale = 1;
+
+    if (resol & 0x80) {
+        return (uint64_t)(((unsigned __int128)ts * 1000000000u) >> (resol & 0x7F));
+    }
+    if (resol <= 9) {
+        for (int i = resol; i < 9; i++) scale *= 10;
+        return ts * scale;
+    }
+    for (int i = 9; i < resol && i < 28; i++) scale *= 10;
+    return ts / scale;
+}
+
+int cbs_pcap_open(cbs_pcap_t *pc, const char *path) {
+    struct stat st;
+    uint32_t magic;
+    int fd;
+
+    memset(pc, 0, sizeof(*pc));
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    }
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        return -err;
+    }
+    if (st.st_size < PCAP_HEADER_LEN) {
+        close(fd);
+        return -EPROTO;
+    }
+    pc->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pc->map == MAP_FAILED) {
+        pc->map = NULL;
+        return -errno;
+    }
+    pc->size = st.st_size;
+    madvise((void *)pc->map, pc->size, MADV_SEQUENTIAL);
+
+    memcpy(&magic, pc->map, sizeof(magic));
+    if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS ||
+        __builtin_bswap32(magic) == PCAP_MAGIC_US || __builtin_bswap32(magic) == PCAP_MAGIC_NS) {
+        pc->swapped = (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS);
+        pc->ts_scale = (rd32(pc, pc->map) == PCAP_MAGIC_US) ? 1000 : 1;
+        pc->linktype = (uint16_t)rd32(pc, pc->map + 20);     /* upper bits: FCS length */
+        pc->pos = PCAP_HEADER_LEN;
+        return 0;
+    }
+    if (magic == PCAPNG_SHB) {
+        pc->pcapng = 1;         /* the Section Header Block is parsed by cbs_pcap_next() */
+        return 0;
+    }
+    cbs_pcap_close(pc);
+    return -EPROTO;
+}
+
+void cbs_pcap_close(cbs_pcap_t *pc) {
+    if (pc->map) {
+        munmap((void *)pc->map, pc->size);
+    }
+    pc->map = NULL;
+    pc->size = 0;
+}
+
+static int pcap_next(cbs_pcap_t *pc, cbs_pcap_frame_t *frame) {
+    const uint8_t *rec = pc->map + pc->pos;
+    uint32_t caplen;
+
+    if (pc->pos == pc->size) {
+        return 0;
+    }
+    if (pc->size - pc->pos < PCAP_RECORD_LEN) {
+        return -EPROTO;
+    }
+    caplen = rd32(pc, rec + 8);
+    if (pc->size - pc->pos - PCAP_RECORD_LEN < caplen) {
+        return -EPROTO;
+    }
+    frame->t_ns = (uint64_t)rd32(pc, rec) * 1000000000ULL + (uint64_t)rd32(pc, rec + 4) * pc->ts_scale;
+    frame->caplen = caplen;
+    frame->len = rd32(pc, rec + 12);
+    frame->data = rec + PCAP_RECORD_LEN;
+    frame->linktype = pc->linktype;
+    frame->interface = 0;
+    pc->pos += PCAP_RECORD_LEN + caplen;
+    return 1;
+}
+
+/* Interface Description Block: link type and timestamp resolution */
+static void pcapng_interface(cbs_pcap_t *pc, const uint8_t *body, uint32_t body_len) {
+    uint32_t id = pc->n_interfaces++;
+    uint32_t off = 8;
+
+    if (id >= CBS_PCAP_MAX_INTERFACES || body_len < 8) {
+        return;
+    }
+    pc->if_linktype[id] = rd16(pc, body);
+    pc->if_tsresol[id] = PCAPNG_DEFAULT_TSRESOL;
+    while (off + 4 <= body_len) {
+        uint16_t code = rd16(pc, body + off), len = rd16(pc, body + off + 2);
+
+        if (code == PCAPNG_OPT_END || off + 4 + len > body_len) {
+            break;
+        }
+        if (code == PCAPNG_OPT_IF_TSRESOL && len >= 1) {
+            pc->if_tsresol[id] = body[off + 4];
+        }
+        off += 4 + ((len + 3) & ~3u);
+    }
+}
+
+static int pcapng_next(cbs_pcap_t *pc, cbs_pcap_frame_t *frame) {
+    for (;;) {
+        const uint8_t *blk = pc->map + pc->pos;
+        const uint8_t *body = blk + 8;
+        uint32_t type, total, body_len;
+
+        if (pc->pos == pc->size) {
+            return 0;
+        }
+        if (pc->size - pc->pos < 12) {
+            return -EPROTO;
+        }
+        memcpy(&type, blk, sizeof(type));
+        if (type == PCAPNG_SHB) {
+            uint32_t bom;
+
+            /* New section: byte order and interfaces start over */
+            if (pc->size - pc->pos < 28) {
+                return -EPROTO;
+            }
+            memcpy(&bom, blk + 8, sizeof(bom));
+            if (bom != PCAPNG_BYTE_ORDER_MAGIC && __builtin_bswap32(bom) != PCAPNG_BYTE_ORDER_MAGIC) {
+                return -EPROTO;
+            }
+            pc->swapped = (bom != PCAPNG_BYTE_ORDER_MAGIC);
+            pc->n_interfaces = 0;
+        }
+        type = rd32(pc, blk);
+        total = rd32(pc, blk + 4);
+        if (total < 12 || (total & 3) || total > pc->size - pc->pos) {
+            return -EPROTO;
+        }
+        body_len = total - 12;
+        pc->pos += total;
+
+        switch (type) {
+        case PCAPNG_IDB:
+            pcapng_interface(pc, body, body_len);
+            break;
+        case PCAPNG_EPB: {
+            uint32_t id, caplen;
+
+            if (body_len < 20) {
+                return -EPROTO;
+            }
+            id = rd32(pc, body);
+            caplen = rd32(pc, body + 12);
+            if (caplen > body_len - 20 || id >= pc->n_interfaces || id >= CBS_PCAP_MAX_INTERFACES) {
+                return -EPROTO;
+            }
+            frame->t_ns = ts_to_ns((uint64_t)rd32(pc, body + 4) << 32 | rd32(pc, body + 8),
+                                   pc->if_tsresol[id]);
+            frame->caplen = caplen;
+            frame->len = rd32(pc, body + 16);
+            frame->data = body + 20;
+            frame->linktype = pc->if_linktype[id];
+            frame->interface = (uint16_t)id;
+            pc->last_t_ns = frame->t_ns;
+            return 1;
+        }
+        case PCAPNG_SPB: {
+            uint32_t len;
+
+            if (body_len < 4 || pc->n_interfaces == 0) {
+                return -EPROTO;
+            }
+            len = rd32(pc, body);
+            frame->caplen = len < body_len - 4 ? len : body_len - 4;
+            frame->len = len;
+            frame->data = body + 4;
+            frame->t_ns = pc->last_t_ns;
+            frame->linktype = pc->if_linktype[0];
+            frame->interface = 0;
+            return 1;
+        }
+        case PCAPNG_SHB:
+            break;
+        default:
+            pc->skipped++;      /* statistics, name resolution, custom blocks */
+            break;
+        }
+    }
+}
+
+int cbs_pcap_next(cbs_pcap_t *pc, cbs_pcap_frame_t *frame) {
+    if (pc->map == NULL) {
+        return 0;
+    }
+    return pc->pcapng ? pcapng_next(pc, frame) : pcap_next(pc, frame);
+}
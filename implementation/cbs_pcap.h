@@ -0,0 +1,102 @@
+/**
+ * Zero-copy pcap / pcapng reader
+ * Maps the capture read-only and walks its records in place: a frame is
+ * a pointer into the mapping plus its lengths and a nanosecond
+ * timestamp, so multi-GB Wireshark captures are read at memory speed.
+ * Handles classic pcap (micro- and nanosecond, either byte order) and
+ * pcapng (Enhanced/Simple Packet Blocks, any number of sections and
+ * interfaces, if_tsresol).
+ */
+
+#ifndef CBS_PCAP_H
+#define CBS_PCAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CBS_PCAP_LINKTYPE_ETHERNET  1
+#define CBS_PCAP_MAX_INTERFACES     64
+#define CBS_PCAP_ETH_P_8021Q        0x8100
+#define CBS_PCAP_ETH_P_8021AD       0x88A8
+
+/* One Captured Frame, valid until the capture is closed */
+typedef struct {
+    const uint8_t *data;        /* points into the mapping */
+    uint32_t caplen;            /* bytes present in data */
+    uint32_t len;               /* length on the wire, without FCS */
+    uint64_t t_ns;              /* capture timestamp, ns since the epoch */
+    uint16_t linktype;
+    uint16_t interface;         /* pcapng interface id, 0 for pcap */
+} cbs_pcap_frame_t;
+
+/* Open Capture */
+typedef struct {
+    const uint8_t *map;
+    size_t size;
+    size_t pos;                 /* next record */
+    int pcapng;
+    int swapped;                /* file byte order differs from the host */
+    /* pcap */
+    uint32_t ts_scale;          /* ns per timestamp fraction unit: 1000 (us) or 1 (ns) */
+    uint16_t linktype;
+    /* pcapng, per interface of the current section */
+    uint32_t n_interfaces;
+    uint16_t if_linktype[CBS_PCAP_MAX_INTERFACES];
+    uint8_t if_tsresol[CBS_PCAP_MAX_INTERFACES];
+    uint64_t last_t_ns;         /* Simple Packet Blocks carry no timestamp */
+    uint64_t skipped;           /* records that are not frames */
+} cbs_pcap_t;
+
+/**
+ * Map a capture file and read its header
+ * @param pc: Capture
+ * @param path: pcap or pcapng file
+ * @return: 0 on success, -errno, -EPROTO if not a capture
+ */
+int cbs_pcap_open(cbs_pcap_t *pc, const char *path);
+
+/**
+ * Unmap the capture; frame data pointers become invalid
+ * @param pc: Capture
+ */
+void cbs_pcap_close(cbs_pcap_t *pc);
+
+/**
+ * Next frame in file order
+ * @param pc: Capture
+ * @param frame: Filled with the frame
+ * @return: 1 with a frame, 0 at the end, -EPROTO on a truncated or malformed record
+ */
+int cbs_pcap_next(cbs_pcap_t *pc, cbs_pcap_frame_t *frame);
+
+/**
+ * 802.1Q priority and VLAN of an Ethernet frame (C-tag, or the tag
+ * inside an 802.1ad S-tag)
+ * @param frame: Ethernet frame
+ * @param pcp: Set to the priority code point
+ * @param vid: Set to the VLAN id
+ * @return: 1 if tagged, 0 if untagged or not Ethernet
+ */
+static inline int cbs_pcap_vlan(const cbs_pcap_frame_t *frame, uint8_t *pcp, uint16_t *vid) {
+    const uint8_t *p = frame->data + 12;
+    uint16_t type, tci;
+
+    if (frame->linktype != CBS_PCAP_LINKTYPE_ETHERNET || frame->caplen < 18) {
+        return 0;
+    }
+    type = (uint16_t)(p[0] << 8 | p[1]);
+    if (type == CBS_PCAP_ETH_P_8021AD && frame->caplen >= 22 &&
+        (uint16_t)(p[4] << 8 | p[5]) == CBS_PCAP_ETH_P_8021Q) {
+        p += 4;
+        type = CBS_PCAP_ETH_P_8021Q;
+    }
+    if (type != CBS_PCAP_ETH_P_8021Q && type != CBS_PCAP_ETH_P_8021AD) {
+        return 0;
+    }
+    tci = (uint16_t)(p[2] << 8 | p[3]);
+    *pcp = tci >> 13;
+    *vid = tci & 0x0FFF;
+    return 1;
+}
+
+#endif /* CBS_PCAP_H */
@@ -0,0 +1,122 @@
+/**
+ * Test frame layout shared by the traffic tools
+ */
+
+#include "cbs_pkt.h"
+#include <string.h>
+#include <errno.h>
+
+#define ETH_P_IPV4                  0x0800
+#define ETH_P_8021Q                 0x8100
+#define IP_PROTO_UDP                17
+#define IP_DF                       0x4000
+#define IP_OFFSET_MASK              0x1FFF
+#define IP_DEFAULT_TTL              64
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint16_t ip_checksum(const uint8_t *hdr, uint32_t len) {
+    uint32_t sum = 0;
+
+    for (uint32_t i = 0; i < len; i += 2) {
+        sum += (uint32_t)(hdr[i] << 8 | hdr[i + 1]);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+int cbs_pkt_build(uint8_t *buf, size_t size, const cbs_pkt_flow_t *flow, uint16_t stream,
+                  uint8_t tc, uint32_t frame_bytes) {
+    int tagged = (flow->vid != CBS_PKT_UNTAGGED);
+    uint32_t len = frame_bytes - CBS_PKT_FCS_LEN;
+    uint8_t *p = buf, *ip;
+
+    if (frame_bytes < cbs_pkt_min_frame(tagged) || len > size || len > 0xFFFF ||
+        (tagged && flow->vid > 4094) || flow->pcp > 7) {
+        return -EINVAL;
+    }
+    memset(buf, 0, len);
+
+    memcpy(p, flow->dst_mac, 6);
+    memcpy(p + 6, flow->src_mac, 6);
+    p += 12;
+    if (tagged) {
+        put16(p, ETH_P_8021Q);
+        put16(p + 2, (uint16_t)(flow->pcp << 13 | flow->vid));
+        p += 4;
+    }
+    put16(p, ETH_P_IPV4);
+    p += 2;
+
+    ip = p;
+    ip[0] = 0x45;
+    ip[1] = (uint8_t)(flow->pcp << 5);                 /* DSCP CS<pcp> */
+    put16(ip + 2, (uint16_t)(len - (ip - buf)));
+    put16(ip + 6, IP_DF);
+    ip[8] = IP_DEFAULT_TTL;
+    ip[9] = IP_PROTO_UDP;
+    memcpy(ip + 12, &flow->src_ip, 4);
+    memcpy(ip + 16, &flow->dst_ip, 4);
+    put16(ip + 10, ip_checksum(ip, CBS_PKT_IP_LEN));
+    p += CBS_PKT_IP_LEN;
+
+    put16(p, flow->src_port);
+    put16(p + 2, flow->dst_port);
+    put16(p + 4, (uint16_t)(len - (p - buf)));
+    p += CBS_PKT_UDP_LEN;
+
+    cbs_pkt_hdr_init(p, stream, tc);
+    return (int)len;
+}
+
+int cbs_pkt_parse(const uint8_t *frame, uint32_t len, int32_t vlan_tci, cbs_pkt_info_t *info) {
+    const uint8_t *p = frame + 12, *end = frame + len;
+    cbs_pkt_hdr_t hdr;
+    uint16_t type;
+    uint32_t ihl;
+
+    if (len < CBS_PKT_ETH_LEN + CBS_PKT_IP_LEN + CBS_PKT_UDP_LEN + sizeof(hdr)) {
+        return -EINVAL;
+    }
+    type = get16(p);
+    p += 2;
+    if (type == ETH_P_8021Q && vlan_tci < 0) {
+        vlan_tci = get16(p);
+        type = get16(p + 2);
+        p += CBS_PKT_VLAN_LEN;
+    }
+    if (type != ETH_P_IPV4 || (p[0] >> 4) != 4) {
+        return -EINVAL;
+    }
+    ihl = (p[0] & 0x0F) * 4u;
+    if (ihl < CBS_PKT_IP_LEN || p[9] != IP_PROTO_UDP || (get16(p + 6) & IP_OFFSET_MASK) != 0 ||
+        end - p < (ptrdiff_t)(ihl + CBS_PKT_UDP_LEN + sizeof(hdr))) {
+        return -EINVAL;
+    }
+    memcpy(&info->src_ip, p + 12, 4);
+    memcpy(&info->dst_ip, p + 16, 4);
+    p += ihl;
+    info->dst_port = get16(p + 2);
+    memcpy(&hdr, p + CBS_PKT_UDP_LEN, sizeof(hdr));
+    if (be32toh(hdr.magic) != CBS_PKT_MAGIC || get16(p + 4) < CBS_PKT_UDP_LEN + sizeof(hdr)) {
+        return -EINVAL;
+    }
+
+    info->vid = vlan_tci < 0 ? CBS_PKT_UNTAGGED : (uint16_t)(vlan_tci & 0x0FFF);
+    info->pcp = vlan_tci < 0 ? 0 : (uint8_t)((vlan_tci >> 13) & 0x7);
+    info->payload_len = get16(p + 4) - CBS_PKT_UDP_LEN;
+    info->tc = hdr.tc;
+    info->stream = be16toh(hdr.stream);
+    info->seq = be64toh(hdr.seq);
+    info->tx_ns = be64toh(hdr.tx_ns);
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Test frame layout shared by the traffic tools
+ * Ethernet + 802.1Q tag + IPv4 + UDP, followed by a fixed header that
+ * carries the stream id, a sequence number and the transmit time, so a
+ * receiver can compute loss, reordering and one-way latency per stream.
+ * Header fields are big-endian on the wire.
+ */
+
+#ifndef CBS_PKT_H
+#define CBS_PKT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <endian.h>
+
+#define CBS_PKT_MAGIC               0x43425354      /* "CBST" */
+#define CBS_PKT_ETH_LEN             14
+#define CBS_PKT_VLAN_LEN            4
+#define CBS_PKT_IP_LEN              20
+#define CBS_PKT_UDP_LEN             8
+#define CBS_PKT_FCS_LEN             4               /* added by the NIC, not in the buffer */
+#define CBS_PKT_UNTAGGED            0xFFFF          /* vid: no 802.1Q tag */
+
+/* Payload Header, first bytes of the UDP payload */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t stream;
+    uint8_t tc;
+    uint8_t flags;
+    uint64_t seq;               /* per stream, from 0 */
+    uint64_t tx_ns;             /* CLOCK_REALTIME when handed to the kernel */
+} cbs_pkt_hdr_t;
+
+/* Addressing of One Stream */
+typedef struct {
+    uint8_t dst_mac[6];
+    uint8_t src_mac[6];
+    uint16_t vid;               /* VLAN id, CBS_PKT_UNTAGGED for none */
+    uint8_t pcp;
+    uint32_t src_ip;            /* network byte order */
+    uint32_t dst_ip;            /* network byte order */
+    uint16_t src_port;
+    uint16_t dst_port;
+} cbs_pkt_flow_t;
+
+/* Fields of a Received Test Frame */
+typedef struct {
+    uint16_t vid;               /* VLAN id, CBS_PKT_UNTAGGED for none */
+    uint8_t pcp;
+    uint8_t tc;                 /* from the payload header */
+    uint32_t src_ip;            /* network byte order */
+    uint32_t dst_ip;            /* network byte order */
+    uint16_t dst_port;
+    uint16_t stream;
+    uint32_t payload_len;       /* UDP payload bytes, from the UDP header */
+    uint64_t seq;
+    uint64_t tx_ns;
+} cbs_pkt_info_t;
+
+/**
+ * Smallest frame (with FCS) that holds the payload header
+ * @param tagged: Frame carries an 802.1Q tag
+ * @return: Bytes
+ */
+static inline uint32_t cbs_pkt_min_frame(int tagged) {
+    uint32_t len = CBS_PKT_ETH_LEN + (tagged ? CBS_PKT_VLAN_LEN : 0) + CBS_PKT_IP_LEN +
+                   CBS_PKT_UDP_LEN + sizeof(cbs_pkt_hdr_t) + CBS_PKT_FCS_LEN;
+    return len < 64 ? 64 : len;
+}
+
+/**
+ * Build the frame template of a stream: headers with final lengths and
+ * IPv4 checksum (ID 0, DF, UDP checksum 0), payload header with seq and
+ * tx_ns zero, zero padding
+ * @param buf: Output buffer
+ * @param size: Buffer size
+ * @param flow: Addressing
+ * @param stream: Stream id written to the payload header
+ * @param tc: Traffic class written to the payload header
+ * @param frame_bytes: Frame size on the wire, with FCS
+ * @return: Bytes written (frame_bytes - FCS), -EINVAL if the size does not fit
+ */
+int cbs_pkt_build(uint8_t *buf, size_t size, const cbs_pkt_flow_t *flow, uint16_t stream,
+                  uint8_t tc, uint32_t frame_bytes);
+
+/**
+ * Parse a received frame: optional 802.1Q tag, IPv4 (any header length,
+ * first fragment only), UDP, payload header with the right magic
+ * @param frame: Frame from the destination MAC on
+ * @param len: Bytes available
+ * @param vlan_tci: Tag the kernel took off on receive, -1 if none
+ * @param info: Output
+ * @return: 0 on success, -EINVAL if it is not a test frame
+ */
+int cbs_pkt_parse(const uint8_t *frame, uint32_t len, int32_t vlan_tci, cbs_pkt_info_t *info);
+
+/**
+ * Offset of the payload header in a frame built by cbs_pkt_build()
+ * @param flow: Addressing the frame was built with
+ * @return: Bytes from the start of the frame
+ */
+static inline uint32_t cbs_pkt_hdr_offset(const cbs_pkt_flow_t *flow) {
+    return CBS_PKT_ETH_LEN + (flow->vid != CBS_PKT_UNTAGGED ? CBS_PKT_VLAN_LEN : 0) +
+           CBS_PKT_IP_LEN + CBS_PKT_UDP_LEN;
+}
+
+/**
+ * Write a payload header with seq and tx_ns zero
+ * @param hdr: Start of the UDP payload (any alignment)
+ * @param stream: Stream id
+ * @param tc: Traffic class
+ */
+static inline void cbs_pkt_hdr_init(uint8_t *hdr, uint16_t stream, uint8_t tc) {
+    cbs_pkt_hdr_t h = {
+        .magic = htobe32(CBS_PKT_MAGIC),
+        .stream = htobe16(stream),
+        .tc = tc,
+    };
+    __builtin_memcpy(hdr, &h, sizeof(h));
+}
+
+/**
+ * Fill in sequence number and transmit time
+ * @param hdr: Payload header inside a frame or UDP payload (any alignment)
+ * @param seq: Sequence number
+ * @param tx_ns: Transmit time, CLOCK_REALTIME ns
+ */
+static inline void cbs_pkt_stamp(uint8_t *hdr, uint64_t seq, uint64_t tx_ns) {
+    seq = htobe64(seq);
+    tx_ns = htobe64(tx_ns);
+    __builtin_memcpy(hdr + offsetof(cbs_pkt_hdr_t, seq), &seq, sizeof(seq));
+    __builtin_memcpy(hdr + offsetof(cbs_pkt_hdr_t, tx_ns), &tx_ns, sizeof(tx_ns));
+}
+
+#endif /* CBS_PKT_H */
@@ -0,0 +1,151 @@
+/**
+ * Work-stealing pool for independent, numbered tasks
+ * A range is packed as (first << 32) | end. Only the owner moves first
+ * forward and only thieves move end back, both through compare-and-swap
+ * of the whole word; a task index leaves a range exactly once, so a
+ * stale word can never match again (no ABA).
+ */
+
+#include "cbs_pool.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define RANGE(first, end)           (((uint64_t)(first) << 32) | (end))
+#define RANGE_FIRST(r)              ((uint32_t)((r) >> 32))
+#define RANGE_END(r)                ((uint32_t)(r))
+
+/* One cache line per worker: owners and thieves of different ranges do not share lines */
+typedef struct {
+    uint64_t range;
+    uint64_t steals;
+    uint32_t tasks;
+    char pad[64 - 2 * sizeof(uint64_t) - sizeof(uint32_t)];
+} __attribute__((aligned(64))) pool_slot_t;
+
+typedef struct {
+    pool_slot_t *slots;
+    unsigned workers;
+    cbs_pool_fn_t fn;
+    void *arg;
+} pool_t;
+
+typedef struct {
+    pool_t *pool;
+    unsigned id;
+} pool_worker_t;
+
+unsigned cbs_pool_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+}
+
+/* Next task of the worker's own range, or -1 once it is empty */
+static int64_t take(pool_slot_t *slot) {
+    uint64_t r = __atomic_load_n(&slot->range, __ATOMIC_ACQUIRE);
+
+    while (RANGE_FIRST(r) < RANGE_END(r)) {
+        if (__atomic_compare_exchange_n(&slot->range, &r, RANGE(RANGE_FIRST(r) + 1, RANGE_END(r)),
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return RANGE_FIRST(r);
+        }
+    }
+    return -1;
+}
+
+/* Move the back half of some other worker's range into our own; 0 if all are empty */
+static int steal(pool_t *pool, unsigned id) {
+    for (unsigned i = 1; i < pool->workers; i++) {
+        pool_slot_t *victim = &pool->slots[(id + i) % pool->workers];
+        uint64_t r = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+
+        while (RANGE_FIRST(r) < RANGE_END(r)) {
+            uint32_t mid = RANGE_END(r) - (RANGE_END(r) - RANGE_FIRST(r) + 1) / 2;
+
+            if (__atomic_compare_exchange_n(&victim->range, &r, RANGE(RANGE_FIRST(r), mid),
+                                            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&pool->slots[id].range, RANGE(mid, RANGE_END(r)), __ATOMIC_RELEASE);
+                pool->slots[id].steals++;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void *pool_worker(void *p) {
+    pool_worker_t *w = p;
+    pool_t *pool = w->pool;
+    pool_slot_t *slot = &pool->slots[w->id];
+
+    do {
+        int64_t task;
+
+        while ((task = take(slot)) >= 0) {
+            pool->fn(pool->arg, (uint32_t)task, w->id);
+            slot->tasks++;
+        }
+    } while (steal(pool, w->id));
+    return NULL;
+}
+
+int cbs_pool_run(unsigned workers, uint32_t n_tasks, cbs_pool_fn_t fn, void *arg,
+                 cbs_pool_stats_t *stats) {
+    pthread_t threads[CBS_POOL_MAX_WORKERS];
+    pool_worker_t ids[CBS_POOL_MAX_WORKERS];
+    pool_t pool = { .fn = fn, .arg = arg };
+    unsigned started = 1;
+    int ret = 0;
+
+    if (fn == NULL) {
+        return -EINVAL;
+    }
+    if (workers == 0) {
+        workers = cbs_pool_cpus();
+    }
+    if (workers > CBS_POOL_MAX_WORKERS) {
+        workers = CBS_POOL_MAX_WORKERS;
+    }
+    if (workers > n_tasks && n_tasks > 0) {
+        workers = n_tasks;
+    }
+
+    pool.slots = aligned_alloc(64, workers * sizeof(pool_slot_t));
+    if (pool.slots == NULL) {
+        return -ENOMEM;
+    }
+    memset(pool.slots, 0, workers * sizeof(pool_slot_t));
+    pool.workers = workers;
+    for (unsigned i = 0; i < workers; i++) {
+        pool.slots[i].range = RANGE((uint64_t)n_tasks * i / workers, (uint64_t)n_tasks * (i + 1) / workers);
+        ids[i] = (pool_worker_t){ &pool, i };
+    }
+
+    /* The caller is worker 0; a failed thread start leaves its range to be stolen */
+    for (; started < workers; started++) {
+        ret = -pthread_create(&threads[started], NULL, pool_worker, &ids[started]);
+        if (ret < 0) {
+            break;
+        }
+    }
+    pool_worker(&ids[0]);
+    for (unsigned i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        stats->workers = started;
+        stats->min_tasks = UINT32_MAX;
+        for (unsigned i = 0; i < started; i++) {
+            stats->steals += pool.slots[i].steals;
+            if (pool.slots[i].tasks < stats->min_tasks) stats->min_tasks = pool.slots[i].tasks;
+            if (pool.slots[i].tasks > stats->max_tasks) stats->max_tasks = pool.slots[i].tasks;
+        }
+    }
+    free(pool.slots);
+    return ret;
+}
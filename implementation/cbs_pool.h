@@ -0,0 +1,49 @@
+/**
+ * Work-stealing pool for independent, numbered tasks
+ * Task indices 0..n-1 are split into one contiguous range per worker.
+ * A worker takes tasks from the front of its own range; once that is
+ * empty it steals the back half of another worker's range, so uneven
+ * task costs (a 1 Gbps simulation point next to an idle one) still keep
+ * every core busy. Ranges live in one 64-bit word per worker, updated
+ * with compare-and-swap: no locks, no queues to allocate.
+ */
+
+#ifndef CBS_POOL_H
+#define CBS_POOL_H
+
+#include <stdint.h>
+
+#define CBS_POOL_MAX_WORKERS        256
+
+/* Task Callback: runs task on worker (0..workers-1), concurrently with other tasks */
+typedef void (*cbs_pool_fn_t)(void *arg, uint32_t task, unsigned worker);
+
+/* Run Statistics */
+typedef struct {
+    unsigned workers;
+    uint64_t steals;            /* successful steals */
+    uint32_t min_tasks;         /* fewest tasks run by one worker */
+    uint32_t max_tasks;         /* most tasks run by one worker */
+} cbs_pool_stats_t;
+
+/**
+ * Number of online CPUs
+ * @return: At least 1
+ */
+unsigned cbs_pool_cpus(void);
+
+/**
+ * Run tasks 0..n_tasks-1 on a pool of threads and wait for all of them
+ * @param workers: Threads, 0 = one per online CPU; the caller is worker 0
+ * @param n_tasks: Number of tasks
+ * @param fn: Task callback
+ * @param arg: Callback argument
+ * @param stats: Filled with run statistics, may be NULL
+ * @return: 0 on success, negative errno if not every thread could be
+ *          started; all tasks still ran, on the caller and the threads
+ *          that did start, which steal the ranges of the missing ones
+ */
+int cbs_pool_run(unsigned workers, uint32_t n_tasks, cbs_pool_fn_t fn, void *arg,
+                 cbs_pool_stats_t *stats);
+
+#endif /* CBS_POOL_H */
@@ -0,0 +1,191 @@
+/**
+ * Compile-time switchable profiling for the CBS drivers
+ * Sites register themselves on first call; register accesses go into a
+ * fixed open-addressing table. A helper thread waits for SIGUSR1 with
+ * sigwait, so the summary is never printed from a signal handler.
+ */
+
+#ifdef CBS_PROFILE
+
+#include "cbs_prof.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TOP_REGISTERS               32
+#define MAX_PROBES                  16          /* then the access counts as (other) */
+
+/* Register Access Statistics */
+typedef struct {
+    uint64_t key;               /* (offset << 1 | write) + 1, 0 = free */
+    cbs_hist_t hist;
+} prof_reg_t;
+
+static cbs_prof_site_t *sites;
+static prof_reg_t regs[CBS_PROF_MAX_REGS];
+static prof_reg_t other_regs = { .key = UINT64_MAX };   /* table overflow */
+static uint64_t start_ticks, start_ns;
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void record_ticks(cbs_hist_t *h, uint64_t ticks) {
+    cbs_hist_record(h, ticks > UINT32_MAX ? UINT32_MAX : (uint32_t)ticks);
+}
+
+void cbs_prof_site_record(cbs_prof_site_t *site, uint64_t ticks) {
+    if (!__atomic_load_n(&site->registered, __ATOMIC_ACQUIRE) &&
+        __atomic_exchange_n(&site->registered, 1, __ATOMIC_ACQ_REL) == 0) {
+        cbs_hist_reset(&site->hist);
+        site->next = __atomic_load_n(&sites, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&sites, &site->next, site, 1,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    record_ticks(&site->hist, ticks);
+}
+
+void cbs_prof_reg_record(uint32_t offset, int write, uint64_t ticks) {
+    uint64_t key = (((uint64_t)offset << 1) | (write ? CBS_PROF_REG_WRITE : 0)) + 1;
+    uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 40) % CBS_PROF_MAX_REGS;
+
+    for (uint32_t probe = 0; probe < MAX_PROBES; probe++) {
+        prof_reg_t *r = &regs[(slot + probe) % CBS_PROF_MAX_REGS];
+        uint64_t seen = __atomic_load_n(&r->key, __ATOMIC_ACQUIRE);
+
+        if (seen == 0) {
+            uint64_t expected = 0;
+            if (__atomic_compare_exchange_n(&r->key, &expected, key, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                cbs_hist_reset(&r->hist);
+                seen = key;
+            } else {
+                seen = expected;
+            }
+        }
+        if (seen == key) {
+            record_ticks(&r->hist, ticks);
+            return;
+        }
+    }
+    record_ticks(&other_regs.hist, ticks);
+}
+
+static int by_total_site(const void *a, const void *b) {
+    const cbs_prof_site_t *x = *(cbs_prof_site_t *const *)a, *y = *(cbs_prof_site_t *const *)b;
+    return (x->hist.sum < y->hist.sum) - (x->hist.sum > y->hist.sum);
+}
+
+static int by_total_reg(const void *a, const void *b) {
+    const prof_reg_t *x = *(const prof_reg_t *const *)a, *y = *(const prof_reg_t *const *)b;
+    return (x->hist.sum < y->hist.sum) - (x->hist.sum > y->hist.sum);
+}
+
+void cbs_prof_dump(void) {
+    static cbs_prof_site_t *site_list[4096];
+    static prof_reg_t *reg_list[CBS_PROF_MAX_REGS + 1];
+    const char *path = getenv("CBS_PROFILE_OUT");
+    FILE *fp = path ? fopen(path, "a") : NULL;
+    uint64_t elapsed_ticks = cbs_prof_ticks() - start_ticks;
+    double ns_per_tick = elapsed_ticks ? (double)(mono_ns() - start_ns) / elapsed_ticks : 1.0;
+    uint64_t reg_count = 0, reg_ticks = 0;
+    size_t n_sites = 0, n_regs = 0;
+
+    if (fp == NULL) {
+        fp = stderr;
+    }
+
+    for (cbs_prof_site_t *s = __atomic_load_n(&sites, __ATOMIC_ACQUIRE); s && n_sites < 4096; s = s->next) {
+        site_list[n_sites++] = s;
+    }
+    for (size_t i = 0; i < CBS_PROF_MAX_REGS; i++) {
+        if (regs[i].key != 0 && regs[i].hist.count > 0) {
+            reg_list[n_regs++] = &regs[i];
+            reg_count += regs[i].hist.count;
+            reg_ticks += regs[i].hist.sum;
+        }
+    }
+    if (other_regs.hist.count > 0) {
+        reg_list[n_regs++] = &other_regs;
+        reg_count += other_regs.hist.count;
+        reg_ticks += other_regs.hist.sum;
+    }
+    qsort(site_list, n_sites, sizeof(site_list[0]), by_total_site);
+    qsort(reg_list, n_regs, sizeof(reg_list[0]), by_total_reg);
+
+    fprintf(fp, "\n=== CBS profile (pid %d, %.3f ns per tick) ===\n", (int)getpid(), ns_per_tick);
+    fprintf(fp, "%-34s %9s %11s %10s %10s %10s %10s\n", "API", "calls", "total ms",
+            "mean us", "p50 us", "p99 us", "max us");
+    for (size_t i = 0; i < n_sites; i++) {
+        cbs_hist_summary_t sum;
+        cbs_hist_summarize(&site_list[i]->hist, &sum, 0);
+        fprintf(fp, "%-34s %9llu %11.3f %10.2f %10.2f %10.2f %10.2f\n", site_list[i]->name,
+                (unsigned long long)sum.count, site_list[i]->hist.sum * ns_per_tick / 1e6,
+                sum.mean * ns_per_tick / 1e3, sum.p50 * ns_per_tick / 1e3,
+                sum.p99 * ns_per_tick / 1e3, sum.max * ns_per_tick / 1e3);
+    }
+
+    fprintf(fp, "\nRegister accesses: %llu, %.3f ms (%zu registers, top %d by time)\n",
+            (unsigned long long)reg_count, reg_ticks * ns_per_tick / 1e6, n_regs, TOP_REGISTERS);
+    fprintf(fp, "%-12s %-5s %11s %11s %10s %10s %10s %10s\n", "offset", "dir", "count",
+            "total us", "mean ns", "p50 ns", "p99 ns", "max ns");
+    for (size_t i = 0; i < n_regs && i < TOP_REGISTERS; i++) {
+        const prof_reg_t *r = reg_list[i];
+        cbs_hist_summary_t sum;
+        char name[16];
+
+        cbs_hist_summarize((cbs_hist_t *)&r->hist, &sum, 0);
+        if (r == &other_regs) {
+            snprintf(name, sizeof(name), "(other)");
+        } else {
+            snprintf(name, sizeof(name), "0x%08X", (uint32_t)((r->key - 1) >> 1));
+        }
+        fprintf(fp, "%-12s %-5s %11llu %11.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+                r == &other_regs ? "-" : (((r->key - 1) & CBS_PROF_REG_WRITE) ? "write" : "read"),
+                (unsigned long long)sum.count, r->hist.sum * ns_per_tick / 1e3,
+                sum.mean * ns_per_tick, sum.p50 * ns_per_tick, sum.p99 * ns_per_tick,
+                sum.max * ns_per_tick);
+    }
+    fflush(fp);
+    if (fp != stderr) {
+        fclose(fp);
+    }
+}
+
+/* SIGUSR1 is blocked in every thread and taken here synchronously */
+static void *dump_thread(void *arg) {
+    sigset_t *set = arg;
+    int sig;
+
+    while (sigwait(set, &sig) == 0) {
+        cbs_prof_dump();
+    }
+    return NULL;
+}
+
+__attribute__((constructor))
+static void cbs_prof_init(void) {
+    static sigset_t set;
+    pthread_t thread;
+
+    start_ticks = cbs_prof_ticks();
+    start_ns = mono_ns();
+
+    /* Threads created later inherit the mask */
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    if (pthread_create(&thread, NULL, dump_thread, &set) == 0) {
+        pthread_detach(thread);
+    }
+    atexit(cbs_prof_dump);
+}
+
+#endif /* CBS_PROFILE */
@@ -0,0 +1,89 @@
+/**
+ * Compile-time switchable profiling for the CBS drivers
+ * Built with -DCBS_PROFILE (make profile), every API marked with
+ * CBS_PROF_FUNC() and every register access through cbs_regio records
+ * call counts and latency histograms (TSC cycles, reported in ns). A
+ * summary goes to stderr (or $CBS_PROFILE_OUT) at exit and on SIGUSR1.
+ * Without CBS_PROFILE the macros expand to nothing.
+ */
+
+#ifndef CBS_PROF_H
+#define CBS_PROF_H
+
+#include <stdint.h>
+
+#ifdef CBS_PROFILE
+
+#include "cbs_hist.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#define CBS_PROF_MAX_REGS           1024    /* distinct register/direction pairs tracked */
+#define CBS_PROF_REG_WRITE          1u      /* key bit: write access */
+
+/* Instrumented Call Site */
+typedef struct cbs_prof_site {
+    const char *name;
+    struct cbs_prof_site *next; /* registered sites */
+    int registered;
+    cbs_hist_t hist;            /* cycles per call */
+} cbs_prof_site_t;
+
+/* Timestamp counter: TSC on x86, CLOCK_MONOTONIC ns elsewhere */
+static inline uint64_t cbs_prof_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/**
+ * Record one call of a site (registers the site on first use)
+ * @param site: Call site
+ * @param ticks: Duration in cbs_prof_ticks units
+ */
+void cbs_prof_site_record(cbs_prof_site_t *site, uint64_t ticks);
+
+/**
+ * Record one register access
+ * @param offset: Register offset
+ * @param write: Non-zero for a write
+ * @param ticks: Duration in cbs_prof_ticks units
+ */
+void cbs_prof_reg_record(uint32_t offset, int write, uint64_t ticks);
+
+/**
+ * Print the summary now
+ */
+void cbs_prof_dump(void);
+
+/* Scope guard ended by the compiler on every return path */
+typedef struct {
+    cbs_prof_site_t *site;
+    uint64_t start;
+} cbs_prof_scope_t;
+
+static inline void cbs_prof_scope_end(cbs_prof_scope_t *scope) {
+    cbs_prof_site_record(scope->site, cbs_prof_ticks() - scope->start);
+}
+
+/* Time the enclosing function; place first in the body */
+#define CBS_PROF_FUNC() \
+    static cbs_prof_site_t cbs_prof_site_ = { .name = __func__ }; \
+    cbs_prof_scope_t cbs_prof_scope_ __attribute__((cleanup(cbs_prof_scope_end), unused)) = \
+        { &cbs_prof_site_, cbs_prof_ticks() }
+
+#else
+
+#define CBS_PROF_FUNC()             do { } while (0)
+
+#endif /* CBS_PROFILE */
+
+#endif /* CBS_PROF_H */
@@ -0,0 +1,15 @@
+/**
+ * VOD/Live streaming profiles of the LAN9662 lab
+ */
+
+#include "cbs_profiles.h"
+
+const streaming_profile_t cbs_profiles[] = {
+    {"4K HDR Live", 25000000, 65536, TC_LIVE_4K_VIDEO, 100, 4},      /* 25Mbps */
+    {"FHD Live", 8000000, 32768, TC_LIVE_FHD_VIDEO, 110, 8},         /* 8Mbps */
+    {"HD VOD", 4000000, 16384, TC_VOD_STREAMING, 120, 16},           /* 4Mbps */
+    {"Audio HQ", 320000, 4096, TC_AUDIO_STREAM, 130, 8},             /* 320kbps */
+    {"Control", 100000, 1522, TC_CONTROL_DATA, 140, 4}               /* 100kbps */
+};
+
+const size_t cbs_num_profiles = sizeof(cbs_profiles) / sizeof(cbs_profiles[0]);
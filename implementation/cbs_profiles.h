@@ -0,0 +1,39 @@
+/**
+ * VOD/Live streaming profiles of the LAN9662 lab
+ * One table for everything that needs the stream mix: the switch
+ * configuration reserves CBS bandwidth for it and the traffic generator
+ * reproduces it on the wire.
+ */
+
+#ifndef CBS_PROFILES_H
+#define CBS_PROFILES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* VOD/Live Streaming Traffic Classes */
+typedef enum {
+    TC_LIVE_4K_VIDEO = 7,      /* 실시간 4K 영상 */
+    TC_LIVE_FHD_VIDEO = 6,     /* 실시간 FHD 영상 */
+    TC_VOD_STREAMING = 5,      /* VOD 스트리밍 */
+    TC_AUDIO_STREAM = 4,       /* 오디오 스트림 */
+    TC_CONTROL_DATA = 3,       /* 제어 데이터 */
+    TC_DIAGNOSTIC = 2,         /* 진단 데이터 */
+    TC_BEST_EFFORT = 0        /* 일반 트래픽 */
+} traffic_class_t;
+
+/* Streaming Profile */
+typedef struct {
+    const char *name;
+    uint32_t bitrate;          /* bps */
+    uint32_t burst_size;       /* bytes */
+    traffic_class_t tc;
+    uint8_t vlan_id_start;
+    uint8_t vlan_count;
+} streaming_profile_t;
+
+/* 실제 스트리밍 프로파일 */
+extern const streaming_profile_t cbs_profiles[];
+extern const size_t cbs_num_profiles;
+
+#endif /* CBS_PROFILES_H */
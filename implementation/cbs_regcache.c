@@ -0,0 +1,220 @@
+/**
+ * Shadow register cache for the CBS drivers
+ * Open-addressed table of register shadows with an ordered dirty list
+ */
+
+#include "cbs_regcache.h"
+#include "cbs_prof.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define REGCACHE_VALID      (1 << 0)
+#define REGCACHE_DIRTY      (1 << 1)
+
+static inline uint32_t regcache_hash(uint32_t offset) {
+    /* Registers are word aligned; mix so strided blocks spread out */
+    return (offset >> 2) * 0x9E3779B1u;
+}
+
+static cbs_regcache_entry_t *regcache_slot(cbs_regcache_entry_t *entries,
+                                           uint32_t capacity, uint32_t offset) {
+    uint32_t mask = capacity - 1;
+    uint32_t i = regcache_hash(offset) & mask;
+
+    while ((entries[i].flags & REGCACHE_VALID) && entries[i].offset != offset) {
+        i = (i + 1) & mask;
+    }
+    return &entries[i];
+}
+
+static int regcache_grow(cbs_regcache_t *cache) {
+    uint32_t capacity = cache->capacity * 2;
+    cbs_regcache_entry_t *entries = calloc(capacity, sizeof(*entries));
+
+    if (entries == NULL) {
+        return -ENOMEM;
+    }
+
+    for (uint32_t i = 0; i < cache->capacity; i++) {
+        if (cache->entries[i].flags & REGCACHE_VALID) {
+            *regcache_slot(entries, capacity, cache->entries[i].offset) = cache->entries[i];
+        }
+    }
+
+    free(cache->entries);
+    cache->entries = entries;
+    cache->capacity = capacity;
+    return 0;
+}
+
+/* Find or insert the shadow entry for a register */
+static cbs_regcache_entry_t *regcache_lookup(cbs_regcache_t *cache, uint32_t offset,
+                                             bool *inserted) {
+    cbs_regcache_entry_t *e = regcache_slot(cache->entries, cache->capacity, offset);
+
+    *inserted = false;
+    if (e->flags & REGCACHE_VALID) {
+        return e;
+    }
+
+    /* Keep load factor at or below 1/2 */
+    if ((cache->count + 1) * 2 > cache->capacity) {
+        if (regcache_grow(cache) < 0) {
+            return NULL;
+        }
+        e = regcache_slot(cache->entries, cache->capacity, offset);
+    }
+
+    e->offset = offset;
+    e->value = 0;
+    e->flags = REGCACHE_VALID;
+    cache->count++;
+    *inserted = true;
+    return e;
+}
+
+static int regcache_mark_dirty(cbs_regcache_t *cache, cbs_regcache_entry_t *e) {
+    if (cache->n_dirty == cache->dirty_capacity) {
+        uint32_t capacity = cache->dirty_capacity ? cache->dirty_capacity * 2 : 64;
+        uint32_t *dirty = realloc(cache->dirty, capacity * sizeof(*dirty));
+
+        if (dirty == NULL) {
+            return -ENOMEM;
+        }
+        cache->dirty = dirty;
+        cache->dirty_capacity = capacity;
+    }
+
+    cache->dirty[cache->n_dirty++] = e->offset;
+    e->flags |= REGCACHE_DIRTY;
+    return 0;
+}
+
+int cbs_regcache_init(cbs_regcache_t *cache, cbs_regio_t *io, uint32_t capacity) {
+    uint32_t size = 16;
+
+    memset(cache, 0, sizeof(*cache));
+    while (size < capacity * 2) {
+        size <<= 1;
+    }
+
+    cache->entries = calloc(size, sizeof(*cache->entries));
+    if (cache->entries == NULL) {
+        return -ENOMEM;
+    }
+    cache->io = io;
+    cache->capacity = size;
+    return 0;
+}
+
+void cbs_regcache_destroy(cbs_regcache_t *cache) {
+    free(cache->entries);
+    free(cache->dirty);
+    memset(cache, 0, sizeof(*cache));
+}
+
+uint32_t cbs_regcache_read(cbs_regcache_t *cache, uint32_t offset) {
+    bool inserted;
+    cbs_regcache_entry_t *e = regcache_lookup(cache, offset, &inserted);
+
+    if (e == NULL) {
+        return cbs_regio_read(cache->io, offset);
+    }
+    if (inserted) {
+        e->value = cbs_regio_read(cache->io, offset);
+        cache->stats.misses++;
+    } else {
+        cache->stats.hits++;
+    }
+    return e->value;
+}
+
+void cbs_regcache_write(cbs_regcache_t *cache, uint32_t offset, uint32_t value) {
+    bool inserted;
+    cbs_regcache_entry_t *e = regcache_lookup(cache, offset, &inserted);
+
+    cache->stats.writes++;
+    if (e == NULL) {
+        /* Out of memory: fall back to a direct write */
+        cbs_regio_write(cache->io, offset, value);
+        return;
+    }
+
+    if (e->flags & REGCACHE_DIRTY) {
+        cache->stats.coalesced++;
+        e->value = value;
+        return;
+    }
+    if (!inserted && e->value == value) {
+        cache->stats.elided++;
+        return;
+    }
+
+    e->value = value;
+    if (regcache_mark_dirty(cache, e) < 0) {
+        cbs_regio_write(cache->io, offset, value);
+    }
+}
+
+void cbs_regcache_rmw(cbs_regcache_t *cache, uint32_t offset, uint32_t mask, uint32_t value) {
+    uint32_t old = cbs_regcache_read(cache, offset);
+
+    cbs_regcache_write(cache, offset, (old & ~mask) | (value & mask));
+}
+
+int cbs_regcache_flush(cbs_regcache_t *cache) {
+    CBS_PROF_FUNC();
+    uint32_t n = cache->n_dirty;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        bool inserted;
+        cbs_regcache_entry_t *e = regcache_lookup(cache, cache->dirty[i], &inserted);
+
+        cbs_regio_write(cache->io, e->offset, e->value);
+        e->flags &= ~REGCACHE_DIRTY;
+    }
+
+    /* One barrier and a readback of the last register to drain posted writes */
+    cbs_regio_barrier(cache->io);
+    (void)cbs_regio_read(cache->io, cache->dirty[n - 1]);
+
+    cache->n_dirty = 0;
+    cache->stats.flushes++;
+    cache->stats.flushed += n;
+    return (int)n;
+}
+
+void cbs_regcache_begin(cbs_regcache_t *cache) {
+    cache->depth++;
+}
+
+int cbs_regcache_end(cbs_regcache_t *cache) {
+    if (cache->depth > 0 && --cache->depth > 0) {
+        return 0;
+    }
+    return cbs_regcache_flush(cache);
+}
+
+void cbs_regcache_invalidate(cbs_regcache_t *cache) {
+    cbs_regcache_flush(cache);
+    memset(cache->entries, 0, cache->capacity * sizeof(*cache->entries));
+    cache->count = 0;
+}
+
+void cbs_regcache_dump_stats(const cbs_regcache_t *cache, FILE *fp) {
+    const cbs_regcache_stats_t *s = &cache->stats;
+
+    fprintf(fp, "Register cache: %u registers shadowed\n", cache->count);
+    fprintf(fp, "  Reads:     %llu hits, %llu misses\n",
+            (unsigned long long)s->hits, (unsigned long long)s->misses);
+    fprintf(fp, "  Writes:    %llu (%llu coalesced, %llu unchanged)\n",
+            (unsigned long long)s->writes, (unsigned long long)s->coalesced,
+            (unsigned long long)s->elided);
+    fprintf(fp, "  Flushed:   %llu registers in %llu passes\n",
+            (unsigned long long)s->flushed, (unsigned long long)s->flushes);
+}
@@ -0,0 +1,119 @@
+/**
+ * Shadow register cache for the CBS drivers
+ * Local read-modify-write, write coalescing and ordered batch flush
+ */
+
+#ifndef CBS_REGCACHE_H
+#define CBS_REGCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cbs_regio.h"
+
+/* Cache Entry */
+typedef struct {
+    uint32_t offset;
+    uint32_t value;
+    uint8_t flags;              /* REGCACHE_VALID | REGCACHE_DIRTY */
+} cbs_regcache_entry_t;
+
+/* Cache Statistics */
+typedef struct {
+    uint64_t hits;              /* reads served from the shadow */
+    uint64_t misses;            /* reads that went to the backend */
+    uint64_t writes;            /* writes issued by the driver */
+    uint64_t coalesced;         /* writes merged into a pending dirty entry */
+    uint64_t elided;            /* writes equal to the programmed value */
+    uint64_t flushes;           /* flush passes that wrote something */
+    uint64_t flushed;           /* registers written to the backend */
+} cbs_regcache_stats_t;
+
+/* Shadow Register Cache */
+typedef struct {
+    cbs_regio_t *io;
+    cbs_regcache_entry_t *entries;  /* open addressing, power-of-two size */
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t *dirty;            /* dirty offsets in first-write order */
+    uint32_t n_dirty;
+    uint32_t dirty_capacity;
+    int depth;                  /* batch nesting level */
+    cbs_regcache_stats_t stats;
+} cbs_regcache_t;
+
+/**
+ * Initialize a cache in front of a register backend
+ * @param cache: Cache to initialize
+ * @param io: Register backend (not owned)
+ * @param capacity: Expected number of cached registers (grows as needed)
+ * @return: 0 on success, negative on error
+ */
+int cbs_regcache_init(cbs_regcache_t *cache, cbs_regio_t *io, uint32_t capacity);
+
+/**
+ * Free cache memory; pending writes are discarded
+ * @param cache: Cache
+ */
+void cbs_regcache_destroy(cbs_regcache_t *cache);
+
+/**
+ * Read a register, filling the shadow from the backend on a miss
+ * @param cache: Cache
+ * @param offset: Register offset
+ * @return: Register value
+ */
+uint32_t cbs_regcache_read(cbs_regcache_t *cache, uint32_t offset);
+
+/**
+ * Write a register into the shadow; it reaches the backend on flush
+ * @param cache: Cache
+ * @param offset: Register offset
+ * @param value: New value
+ */
+void cbs_regcache_write(cbs_regcache_t *cache, uint32_t offset, uint32_t value);
+
+/**
+ * Read-modify-write a register field in the shadow
+ * @param cache: Cache
+ * @param offset: Register offset
+ * @param mask: Bits to replace
+ * @param value: New bits (only bits in mask are used)
+ */
+void cbs_regcache_rmw(cbs_regcache_t *cache, uint32_t offset, uint32_t mask, uint32_t value);
+
+/**
+ * Write all dirty registers in first-write order, then issue one barrier
+ * and one readback so posted writes have landed on return
+ * @param cache: Cache
+ * @return: Number of registers written
+ */
+int cbs_regcache_flush(cbs_regcache_t *cache);
+
+/**
+ * Open a batch; writes are held until the outermost batch ends
+ * @param cache: Cache
+ */
+void cbs_regcache_begin(cbs_regcache_t *cache);
+
+/**
+ * Close a batch, flushing when the outermost batch ends
+ * @param cache: Cache
+ * @return: Registers written by the flush, 0 if still nested
+ */
+int cbs_regcache_end(cbs_regcache_t *cache);
+
+/**
+ * Drop all shadow values so the next reads go to the backend
+ * Pending writes are flushed first
+ * @param cache: Cache
+ */
+void cbs_regcache_invalidate(cbs_regcache_t *cache);
+
+/**
+ * Print cache statistics
+ * @param cache: Cache
+ * @param fp: Output stream
+ */
+void cbs_regcache_dump_stats(const cbs_regcache_t *cache, FILE *fp);
+
+#endif /* CBS_REGCACHE_H */
@@ -0,0 +1,289 @@
+/**
+ * Register I/O backends for the CBS drivers
+ * /dev/mem mapping, simulated register file and tracing wrapper
+ */
+
+#include "cbs_regio.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+static inline uint64_t regio_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Memory-mapped backends (/dev/mem and simulated image) */
+static uint32_t mem_read(cbs_regio_t *io, uint32_t offset) {
+    if (io->base == NULL || (size_t)offset + 4 > io->size) return 0;
+    return *((volatile uint32_t*)((uint8_t*)io->base + offset));
+}
+
+static void mem_write(cbs_regio_t *io, uint32_t offset, uint32_t value) {
+    if (io->base == NULL || (size_t)offset + 4 > io->size) return;
+    *((volatile uint32_t*)((uint8_t*)io->base + offset)) = value;
+}
+
+static void mem_barrier(cbs_regio_t *io) {
+    (void)io;
+    __sync_synchronize();
+}
+
+static void mem_close(cbs_regio_t *io) {
+    if (io->base != NULL) {
+        munmap(io->base, io->size);
+    }
+    if (io->fd >= 0) {
+        close(io->fd);
+    }
+}
+
+static const cbs_regio_ops_t mmap_ops = {
+    .name = "mmap",
+    .read = mem_read,
+    .write = mem_write,
+    .barrier = mem_barrier,
+    .close = mem_close,
+};
+
+static const cbs_regio_ops_t sim_ops = {
+    .name = "sim",
+    .read = mem_read,
+    .write = mem_write,
+    .barrier = mem_barrier,
+    .close = mem_close,
+};
+
+static cbs_regio_t *regio_alloc(const cbs_regio_ops_t *ops, size_t size) {
+    cbs_regio_t *io = calloc(1, sizeof(*io));
+    if (io == NULL) {
+        return NULL;
+    }
+    io->ops = ops;
+    io->size = size;
+    io->fd = -1;
+    return io;
+}
+
+cbs_regio_t *cbs_regio_open_mmap(off_t phys_addr, size_t size) {
+    cbs_regio_t *io = regio_alloc(&mmap_ops, size);
+    if (io == NULL) {
+        return NULL;
+    }
+
+    io->fd = open("/dev/mem", O_RDWR | O_SYNC);
+    if (io->fd < 0) {
+        perror("Failed to open /dev/mem");
+        free(io);
+        return NULL;
+    }
+
+    io->base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, io->fd, phys_addr);
+    if (io->base == MAP_FAILED) {
+        perror("Failed to mmap registers");
+        close(io->fd);
+        free(io);
+        return NULL;
+    }
+
+    return io;
+}
+
+cbs_regio_t *cbs_regio_open_sim(const char *path, size_t size) {
+    cbs_regio_t *io = regio_alloc(&sim_ops, size);
+    if (io == NULL) {
+        return NULL;
+    }
+
+    if (path == NULL || path[0] == '\0') {
+        /* Anonymous image, pages only materialize when touched */
+        io->base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    } else {
+        struct stat st;
+
+        io->fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (io->fd < 0) {
+            perror("Failed to open register image");
+            free(io);
+            return NULL;
+        }
+        if (fstat(io->fd, &st) < 0 ||
+            ((size_t)st.st_size < size && ftruncate(io->fd, size) < 0)) {
+            perror("Failed to size register image");
+            close(io->fd);
+            free(io);
+            return NULL;
+        }
+        io->base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, io->fd, 0);
+    }
+
+    if (io->base == MAP_FAILED) {
+        perror("Failed to map register image");
+        if (io->fd >= 0) close(io->fd);
+        free(io);
+        return NULL;
+    }
+
+    return io;
+}
+
+/* Tracing wrapper */
+
+/* The sampler thread reads through the same handle as the configuration path */
+static inline void stat_add(uint64_t *counter, uint64_t n) {
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+static void trace_delay(cbs_regio_t *io) {
+    if (io->latency_ns == 0) return;
+
+    /* Busy-wait: sleeping cannot resolve bus-access latencies */
+    uint64_t until = regio_now_ns() + io->latency_ns;
+    while (regio_now_ns() < until) {
+    }
+}
+
+static uint32_t trace_read(cbs_regio_t *io, uint32_t offset) {
+    uint64_t start = regio_now_ns();
+    trace_delay(io);
+    /* Lower ops directly: a profiled build counts the access once, here */
+    uint32_t value = io->lower->ops->read(io->lower, offset);
+    stat_add(&io->stats.read_ns, regio_now_ns() - start);
+    stat_add(&io->stats.reads, 1);
+
+    if (io->log) {
+        fprintf(io->log, "R 0x%08X -> 0x%08X\n", offset, value);
+    }
+    return value;
+}
+
+static void trace_write(cbs_regio_t *io, uint32_t offset, uint32_t value) {
+    uint64_t start = regio_now_ns();
+    trace_delay(io);
+    io->lower->ops->write(io->lower, offset, value);
+    stat_add(&io->stats.write_ns, regio_now_ns() - start);
+    stat_add(&io->stats.writes, 1);
+
+    if (io->log) {
+        fprintf(io->log, "W 0x%08X <- 0x%08X\n", offset, value);
+    }
+}
+
+static void trace_barrier(cbs_regio_t *io) {
+    cbs_regio_barrier(io->lower);
+    stat_add(&io->stats.barriers, 1);
+
+    if (io->log) {
+        fprintf(io->log, "B\n");
+    }
+}
+
+static void trace_close(cbs_regio_t *io) {
+    cbs_regio_close(io->lower);
+}
+
+static const cbs_regio_ops_t trace_ops = {
+    .name = "trace",
+    .read = trace_read,
+    .write = trace_write,
+    .barrier = trace_barrier,
+    .close = trace_close,
+};
+
+cbs_regio_t *cbs_regio_open_trace(cbs_regio_t *lower, FILE *log, uint32_t latency_ns) {
+    if (lower == NULL) {
+        return NULL;
+    }
+
+    cbs_regio_t *io = regio_alloc(&trace_ops, lower->size);
+    if (io == NULL) {
+        cbs_regio_close(lower);
+        return NULL;
+    }
+    io->lower = lower;
+    io->log = log;
+    io->latency_ns = latency_ns;
+    return io;
+}
+
+cbs_regio_t *cbs_regio_open_spec(const char *spec, off_t phys_addr, size_t size) {
+    if (spec == NULL || spec[0] == '\0' || strcmp(spec, "mmap") == 0) {
+        return cbs_regio_open_mmap(phys_addr, size);
+    }
+
+    if (strcmp(spec, "sim") == 0) {
+        return cbs_regio_open_sim(NULL, size);
+    }
+    if (strncmp(spec, "sim:", 4) == 0) {
+        return cbs_regio_open_sim(spec + 4, size);
+    }
+
+    if (strncmp(spec, "trace", 5) == 0) {
+        const char *p = spec + 5;
+        const char *inner = strchr(p, ':');
+        FILE *log = NULL;
+        uint32_t latency_ns = 0;
+
+        if (inner == NULL) {
+            fprintf(stderr, "Invalid register backend: %s\n", spec);
+            return NULL;
+        }
+        while (p < inner) {
+            if (strncmp(p, "+log", 4) == 0) {
+                log = stderr;
+                p += 4;
+            } else if (*p == '@') {
+                latency_ns = (uint32_t)strtoul(p + 1, (char **)&p, 10);
+            } else {
+                fprintf(stderr, "Invalid register backend: %s\n", spec);
+                return NULL;
+            }
+        }
+        return cbs_regio_open_trace(cbs_regio_open_spec(inner + 1, phys_addr, size),
+                                    log, latency_ns);
+    }
+
+    fprintf(stderr, "Unknown register backend: %s\n", spec);
+    errno = EINVAL;
+    return NULL;
+}
+
+void cbs_regio_close(cbs_regio_t *io) {
+    if (io == NULL) return;
+
+    io->ops->close(io);
+    free(io);
+}
+
+void cbs_regio_dump_stats(cbs_regio_t *io, FILE *fp) {
+    cbs_regio_stats_t snap = {
+        .reads = __atomic_load_n(&io->stats.reads, __ATOMIC_RELAXED),
+        .writes = __atomic_load_n(&io->stats.writes, __ATOMIC_RELAXED),
+        .barriers = __atomic_load_n(&io->stats.barriers, __ATOMIC_RELAXED),
+        .read_ns = __atomic_load_n(&io->stats.read_ns, __ATOMIC_RELAXED),
+        .write_ns = __atomic_load_n(&io->stats.write_ns, __ATOMIC_RELAXED),
+    };
+    const cbs_regio_stats_t *s = &snap;
+
+    fprintf(fp, "Register backend: %s", io->ops->name);
+    if (io->lower) {
+        fprintf(fp, " -> %s", io->lower->ops->name);
+    }
+    fprintf(fp, "\n");
+    fprintf(fp, "  Reads:    %llu (%.1f ns avg)\n",
+            (unsigned long long)s->reads,
+            s->reads ? (double)s->read_ns / s->reads : 0.0);
+    fprintf(fp, "  Writes:   %llu (%.1f ns avg)\n",
+            (unsigned long long)s->writes,
+            s->writes ? (double)s->write_ns / s->writes : 0.0);
+    fprintf(fp, "  Barriers: %llu\n", (unsigned long long)s->barriers);
+}
@@ -0,0 +1,125 @@
+/**
+ * Register I/O backends for the CBS drivers
+ * Pluggable ops table shared by the LAN9692 and LAN9662 configuration code
+ */
+
+#ifndef CBS_REGIO_H
+#define CBS_REGIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include "cbs_prof.h"
+
+typedef struct cbs_regio cbs_regio_t;
+
+/* Backend Operations */
+typedef struct {
+    const char *name;
+    uint32_t (*read)(cbs_regio_t *io, uint32_t offset);
+    void (*write)(cbs_regio_t *io, uint32_t offset, uint32_t value);
+    void (*barrier)(cbs_regio_t *io);
+    void (*close)(cbs_regio_t *io);
+} cbs_regio_ops_t;
+
+/* Access Statistics (collected by the trace backend, updated atomically) */
+typedef struct {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t barriers;
+    uint64_t read_ns;           /* total time spent in lower reads */
+    uint64_t write_ns;          /* total time spent in lower writes */
+} cbs_regio_stats_t;
+
+/* Register I/O Handle */
+struct cbs_regio {
+    const cbs_regio_ops_t *ops;
+    void *base;                 /* mapped register window (mmap/sim) */
+    size_t size;                /* window size in bytes */
+    int fd;                     /* backing fd, -1 if anonymous */
+    cbs_regio_t *lower;         /* wrapped backend (trace) */
+    FILE *log;                  /* per-access log (trace), NULL = off */
+    uint32_t latency_ns;        /* injected per-access latency (trace) */
+    cbs_regio_stats_t stats;
+};
+
+/**
+ * Map a physical register window through /dev/mem (requires root)
+ * @param phys_addr: Physical base address
+ * @param size: Window size in bytes
+ * @return: Handle, NULL on error
+ */
+cbs_regio_t *cbs_regio_open_mmap(off_t phys_addr, size_t size);
+
+/**
+ * Open a simulated register file
+ * @param path: Backing image file (created/extended as needed), NULL for
+ *              an anonymous in-memory image
+ * @param size: Register window size in bytes
+ * @return: Handle, NULL on error
+ */
+cbs_regio_t *cbs_regio_open_sim(const char *path, size_t size);
+
+/**
+ * Wrap a backend with access counting, timing, logging and latency injection
+ * @param lower: Backend to wrap (owned by the returned handle)
+ * @param log: Stream for per-access log lines, NULL to disable
+ * @param latency_ns: Busy-wait added to every access, 0 to disable
+ * @return: Handle, NULL on error
+ */
+cbs_regio_t *cbs_regio_open_trace(cbs_regio_t *lower, FILE *log, uint32_t latency_ns);
+
+/**
+ * Open a backend from a spec string
+ *   "mmap"                     /dev/mem mapping (default for NULL or "")
+ *   "sim" | "sim:<file>"       simulated register file
+ *   "trace[+log][@<ns>]:<spec>" tracing wrapper around <spec>
+ * @param spec: Backend spec
+ * @param phys_addr: Physical base address used by the mmap backend
+ * @param size: Register window size in bytes
+ * @return: Handle, NULL on error
+ */
+cbs_regio_t *cbs_regio_open_spec(const char *spec, off_t phys_addr, size_t size);
+
+/**
+ * Close a backend and any backend it wraps
+ * @param io: Handle (NULL is ignored)
+ */
+void cbs_regio_close(cbs_regio_t *io);
+
+/**
+ * Print access statistics of a tracing backend
+ * @param io: Handle
+ * @param fp: Output stream
+ */
+void cbs_regio_dump_stats(cbs_regio_t *io, FILE *fp);
+
+#ifdef CBS_PROFILE
+static inline uint32_t cbs_regio_read(cbs_regio_t *io, uint32_t offset) {
+    uint64_t start = cbs_prof_ticks();
+    uint32_t value = io->ops->read(io, offset);
+    cbs_prof_reg_record(offset, 0, cbs_prof_ticks() - start);
+    return value;
+}
+
+static inline void cbs_regio_write(cbs_regio_t *io, uint32_t offset, uint32_t value) {
+    uint64_t start = cbs_prof_ticks();
+    io->ops->write(io, offset, value);
+    cbs_prof_reg_record(offset, 1, cbs_prof_ticks() - start);
+}
+#else
+static inline uint32_t cbs_regio_read(cbs_regio_t *io, uint32_t offset) {
+    return io->ops->read(io, offset);
+}
+
+static inline void cbs_regio_write(cbs_regio_t *io, uint32_t offset, uint32_t value) {
+    io->ops->write(io, offset, value);
+}
+#endif
+
+static inline void cbs_regio_barrier(cbs_regio_t *io) {
+    io->ops->barrier(io);
+}
+
+#endif /* CBS_REGIO_H */
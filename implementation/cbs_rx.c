@@ -0,0 +1,201 @@
+/**
+ * Raw frame receive ring
+ * Blocks are read in ring order: the kernel fills them in that order
+ * and does not move on while the next block still belongs to the reader
+ * (it drops frames and counts a freeze instead).
+ */
+
+#include "cbs_rx.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <linux/virtio_net.h>
+#include <endian.h>
+
+#define RING_FRAME_SIZE             2048            /* TPACKET_V3 packs frames, only checked by the kernel */
+
+static inline struct tpacket_block_desc *block_desc(cbs_rx_t *rx, uint32_t index) {
+    return (struct tpacket_block_desc *)(rx->ring + (size_t)index * CBS_RX_BLOCK_SIZE);
+}
+
+/* Received frames cut to CBS_RX_SNAPLEN, our own transmissions dropped */
+static int attach_filter(int fd) {
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_PKTTYPE),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, CBS_RX_SNAPLEN),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog prog = { .len = sizeof(code) / sizeof(code[0]), .filter = code };
+
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+}
+
+cbs_rx_t *cbs_rx_open(const char *ifname, uint32_t n_blocks, uint16_t fanout_group) {
+    struct tpacket_req3 req;
+    struct sockaddr_ll addr;
+    int version = TPACKET_V3, one = 1, err;
+    int ifindex = if_nametoindex(ifname);
+    cbs_rx_t *rx;
+
+    if (ifindex == 0) {
+        return NULL;
+    }
+    rx = calloc(1, sizeof(*rx));
+    if (rx == NULL) {
+        return NULL;
+    }
+    rx->ifindex = ifindex;
+    rx->n_blocks = n_blocks ? n_blocks : CBS_RX_DEFAULT_BLOCKS;
+
+    /* Protocol 0 until bind(): nothing is queued before the ring and filter are in place */
+    rx->fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (rx->fd < 0) {
+        goto fail;
+    }
+    if (setsockopt(rx->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0 ||
+        attach_filter(rx->fd) < 0) {
+        goto fail;
+    }
+    /* Optional: without it an aggregate looks like one large frame */
+    rx->vnet_hdr = setsockopt(rx->fd, SOL_PACKET, PACKET_VNET_HDR, &one, sizeof(one)) == 0;
+
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = CBS_RX_BLOCK_SIZE;
+    req.tp_block_nr = rx->n_blocks;
+    req.tp_frame_size = RING_FRAME_SIZE;
+    req.tp_frame_nr = CBS_RX_BLOCK_SIZE / RING_FRAME_SIZE * rx->n_blocks;
+    req.tp_retire_blk_tov = CBS_RX_BLOCK_TIMEOUT_MS;
+    if (setsockopt(rx->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        goto fail;
+    }
+    rx->ring_size = (size_t)req.tp_block_size * req.tp_block_nr;
+    rx->ring = mmap(NULL, rx->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, rx->fd, 0);
+    if (rx->ring == MAP_FAILED) {
+        rx->ring = NULL;
+        goto fail;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+    if (bind(rx->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        goto fail;
+    }
+    if (fanout_group) {
+        int fanout = fanout_group | (PACKET_FANOUT_HASH << 16);
+
+        if (setsockopt(rx->fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0) {
+            goto fail;
+        }
+    }
+    return rx;
+
+fail:
+    err = errno;
+    cbs_rx_close(rx);
+    errno = err;
+    return NULL;
+}
+
+int cbs_rx_next(cbs_rx_t *rx, cbs_rx_frame_t *frame, int timeout_ms) {
+    struct tpacket3_hdr *hdr;
+
+    while (rx->left == 0) {
+        struct tpacket_block_desc *bd = block_desc(rx, rx->block);
+
+        if (rx->next) {
+            /* Block read: back to the kernel */
+            __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+            rx->block = (rx->block + 1) % rx->n_blocks;
+            rx->next = NULL;
+            continue;
+        }
+        if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+            struct pollfd pfd = { .fd = rx->fd, .events = POLLIN | POLLERR };
+            int ret = poll(&pfd, 1, timeout_ms);
+
+            rx->stats.polls++;
+            if (ret < 0) {
+                return errno == EINTR ? 0 : -errno;
+            }
+            if (ret == 0 ||
+                !(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+                return 0;
+            }
+        }
+        rx->stats.blocks++;
+        rx->left = bd->hdr.bh1.num_pkts;
+        rx->next = (uint8_t *)bd + bd->hdr.bh1.offset_to_first_pkt;
+    }
+
+    hdr = (struct tpacket3_hdr *)rx->next;
+    frame->data = rx->next + hdr->tp_mac;
+    frame->len = hdr->tp_snaplen;
+    frame->wire_len = hdr->tp_len;
+    frame->ts_ns = (uint64_t)hdr->tp_sec * 1000000000ULL + hdr->tp_nsec;
+    /* Older kernels leave TP_STATUS_VLAN_VALID clear and only fill in a non-zero tag */
+    frame->vlan_tci = ((hdr->tp_status & TP_STATUS_VLAN_VALID) || hdr->hv1.tp_vlan_tci)
+                      ? (int32_t)hdr->hv1.tp_vlan_tci : -1;
+    frame->gso_size = 0;
+    if (rx->vnet_hdr) {
+        struct virtio_net_hdr vh;
+
+        /* Written right in front of the MAC header, little-endian */
+        memcpy(&vh, frame->data - sizeof(vh), sizeof(vh));
+        if (vh.gso_type != VIRTIO_NET_HDR_GSO_NONE) {
+            frame->gso_size = le16toh(vh.gso_size);
+        }
+    }
+    rx->next += hdr->tp_next_offset;
+    rx->left--;
+    rx->stats.frames++;
+    rx->stats.bytes += frame->wire_len;
+    return 1;
+}
+
+int cbs_rx_update_stats(cbs_rx_t *rx) {
+    struct tpacket_stats_v3 st;
+    socklen_t len = sizeof(st);
+
+    if (getsockopt(rx->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) < 0) {
+        return -errno;
+    }
+    rx->stats.drops += st.tp_drops;
+    rx->stats.freezes += st.tp_freeze_q_cnt;
+    return 0;
+}
+
+void cbs_rx_close(cbs_rx_t *rx) {
+    if (rx == NULL) {
+        return;
+    }
+    if (rx->ring) {
+        munmap(rx->ring, rx->ring_size);
+    }
+    if (rx->fd >= 0) {
+        close(rx->fd);
+    }
+    free(rx);
+}
+
+void cbs_rx_dump_stats(cbs_rx_t *rx, FILE *fp) {
+    const cbs_rx_stats_t *s = &rx->stats;
+
+    fprintf(fp, "RX ring (%u x %u KB blocks): %llu frames, %llu bytes, %llu blocks (%.1f frames/block), "
+            "%llu polls, %llu dropped, %llu freezes\n",
+            rx->n_blocks, CBS_RX_BLOCK_SIZE >> 10, (unsigned long long)s->frames,
+            (unsigned long long)s->bytes, (unsigned long long)s->blocks,
+            s->blocks ? (double)s->frames / s->blocks : 0.0, (unsigned long long)s->polls,
+            (unsigned long long)s->drops, (unsigned long long)s->freezes);
+}
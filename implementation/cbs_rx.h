@@ -0,0 +1,97 @@
+/**
+ * Raw frame receive ring
+ * AF_PACKET TPACKET_V3 (PACKET_MMAP): the kernel fills whole blocks of
+ * frames and hands a block over when it is full or its timeout expires,
+ * so the reader makes one poll() per block instead of a syscall per
+ * frame. A socket filter cuts every frame to its headers and drops our
+ * own transmissions. Several rings on one interface share the load with
+ * PACKET_FANOUT by flow hash, so a stream always lands on the same ring.
+ * The virtio-net header in front of every frame tells which frames are
+ * still unsegmented GSO/GRO aggregates (veth passes UDP GSO through).
+ */
+
+#ifndef CBS_RX_H
+#define CBS_RX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define CBS_RX_BLOCK_SIZE           (1u << 18)
+#define CBS_RX_DEFAULT_BLOCKS       64
+#define CBS_RX_BLOCK_TIMEOUT_MS     10
+#define CBS_RX_SNAPLEN              128             /* Eth + 802.1Q + IPv4 with options + UDP + test header */
+
+/* Received Frame, valid until the next cbs_rx_next() */
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;               /* bytes captured, at most CBS_RX_SNAPLEN */
+    uint32_t wire_len;          /* frame length without FCS */
+    uint64_t ts_ns;             /* kernel receive time, CLOCK_REALTIME */
+    int32_t vlan_tci;           /* 802.1Q tag taken off on receive, -1 if none */
+    uint16_t gso_size;          /* payload bytes per segment of an aggregate, 0 for a plain frame */
+} cbs_rx_frame_t;
+
+/* Receive Statistics */
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t blocks;
+    uint64_t polls;
+    uint64_t drops;             /* ring full, from PACKET_STATISTICS */
+    uint64_t freezes;           /* times the ring ran full */
+} cbs_rx_stats_t;
+
+/* Receive Ring Handle */
+typedef struct {
+    int fd;
+    int ifindex;
+    uint8_t *ring;
+    size_t ring_size;
+    uint32_t n_blocks;
+    uint32_t block;             /* block being read */
+    uint8_t *next;              /* next frame in it, NULL if the block is not ours yet */
+    uint32_t left;              /* frames left in it */
+    int vnet_hdr;               /* frames carry a virtio-net header (gso_size known) */
+    cbs_rx_stats_t stats;
+} cbs_rx_t;
+
+/**
+ * Open a receive ring on an interface
+ * @param ifname: Interface
+ * @param n_blocks: Ring blocks of CBS_RX_BLOCK_SIZE, 0 = default
+ * @param fanout_group: PACKET_FANOUT group shared by the rings of one reader, 0 = none
+ * @return: Handle, NULL on error (errno set)
+ */
+cbs_rx_t *cbs_rx_open(const char *ifname, uint32_t n_blocks, uint16_t fanout_group);
+
+/**
+ * Next frame; blocks are handed back to the kernel once read
+ * @param rx: Handle
+ * @param frame: Output
+ * @param timeout_ms: Longest wait for a block, -1 = forever
+ * @return: 1 with a frame, 0 on timeout or signal, negative errno on error
+ */
+int cbs_rx_next(cbs_rx_t *rx, cbs_rx_frame_t *frame, int timeout_ms);
+
+/**
+ * Add the kernel drop counters (reset by every read) to rx->stats
+ * @param rx: Handle
+ * @return: 0 on success, negative errno on error
+ */
+int cbs_rx_update_stats(cbs_rx_t *rx);
+
+/**
+ * Release the ring
+ * @param rx: Handle
+ */
+void cbs_rx_close(cbs_rx_t *rx);
+
+/**
+ * Print statistics
+ * @param rx: Handle
+ * @param fp: Output
+ */
+void cbs_rx_dump_stats(cbs_rx_t *rx, FILE *fp);
+
+#endif /* CBS_RX_H */
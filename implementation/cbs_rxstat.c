@@ -0,0 +1,108 @@
+/**
+ * Per-stream receive statistics
+ */
+
+#include "cbs_rxstat.h"
+#include <string.h>
+
+#define WINDOW_WORDS                (CBS_RXSTAT_WINDOW / 64)
+
+static inline uint64_t *window_word(cbs_rxstat_t *st, uint64_t seq) {
+    return &st->window[(seq % CBS_RXSTAT_WINDOW) / 64];
+}
+
+static inline uint64_t window_bit(uint64_t seq) {
+    return 1ULL << (seq % 64);
+}
+
+/* Sequence numbers before the first frame are not expected: mark them all seen */
+static void start(cbs_rxstat_t *st, uint64_t seq) {
+    st->started = 1;
+    st->max_seq = seq;
+    memset(st->window, 0xFF, sizeof(st->window));
+}
+
+/* New highest sequence number: slots of those that leave the window are reused */
+static void advance(cbs_rxstat_t *st, uint64_t seq) {
+    uint64_t d = seq - st->max_seq;
+
+    if (d >= CBS_RXSTAT_WINDOW) {
+        st->counts.lost += cbs_rxstat_pending(st) + (d - CBS_RXSTAT_WINDOW);
+        memset(st->window, 0, sizeof(st->window));
+    } else {
+        for (uint64_t s = st->max_seq + 1; s <= seq; s++) {
+            uint64_t *w = window_word(st, s);
+
+            if (!(*w & window_bit(s))) {
+                st->counts.lost++;              /* s - WINDOW never arrived */
+            }
+            *w &= ~window_bit(s);
+        }
+    }
+    *window_word(st, seq) |= window_bit(seq);
+    st->max_seq = seq;
+}
+
+void cbs_rxstat_init(cbs_rxstat_t *st) {
+    memset(st, 0, sizeof(*st));
+    st->latency_min = INT64_MAX;
+    st->latency_max = INT64_MIN;
+    cbs_hist_reset(&st->latency);
+}
+
+void cbs_rxstat_update(cbs_rxstat_t *st, uint64_t seq, uint64_t tx_ns, uint64_t rx_ns, uint32_t bytes) {
+    int64_t transit = (int64_t)(rx_ns - tx_ns);
+
+    if (!st->started) {
+        start(st, seq);
+    } else if (seq > st->max_seq) {
+        advance(st, seq);
+    } else if (st->max_seq - seq >= CBS_RXSTAT_WINDOW) {
+        if (seq == 0) {
+            st->counts.restarts++;
+            start(st, seq);
+        } else {
+            st->counts.late++;
+        }
+    } else if (*window_word(st, seq) & window_bit(seq)) {
+        st->counts.duplicates++;
+    } else {
+        *window_word(st, seq) |= window_bit(seq);
+        st->counts.reordered++;
+    }
+
+    /* RFC 3550 A.8: J += (|D| - J) / 16, kept scaled by 16 */
+    if (st->counts.frames > 0) {
+        int64_t d = transit - st->last_transit;
+
+        if (d < 0) {
+            d = -d;
+        }
+        st->jitter16 = (uint64_t)((int64_t)st->jitter16 + d - (int64_t)((st->jitter16 + 8) >> 4));
+    }
+    st->last_transit = transit;
+
+    if (transit < 0) {
+        st->negative++;
+    }
+    if (transit < st->latency_min) st->latency_min = transit;
+    if (transit > st->latency_max) st->latency_max = transit;
+    st->latency_sum += transit;
+    cbs_hist_record(&st->latency, transit < 0 ? 0 : transit > UINT32_MAX ? UINT32_MAX : (uint32_t)transit);
+
+    st->counts.frames++;
+    st->counts.bytes += bytes;
+}
+
+uint64_t cbs_rxstat_pending(const cbs_rxstat_t *st) {
+    uint64_t seen = 0;
+
+    for (int i = 0; i < WINDOW_WORDS; i++) {
+        seen += (uint64_t)__builtin_popcountll(st->window[i]);
+    }
+    return CBS_RXSTAT_WINDOW - seen;
+}
+
+void cbs_rxstat_interval(cbs_rxstat_t *st, cbs_hist_summary_t *sum) {
+    cbs_hist_summarize(&st->latency, sum, 1);
+}
@@ -0,0 +1,85 @@
+/**
+ * Per-stream receive statistics
+ * Loss, duplicates and reordering from the payload header sequence
+ * numbers, one-way latency from its transmit time, and interarrival
+ * jitter as in RFC 3550 6.4.1 (in ns instead of RTP timestamp units).
+ * Everything is updated per frame in fixed memory: a bitmap of the last
+ * CBS_RXSTAT_WINDOW sequence numbers tells a late frame from a duplicate,
+ * and a gap is counted lost once it falls out of the window.
+ */
+
+#ifndef CBS_RXSTAT_H
+#define CBS_RXSTAT_H
+
+#include <stdint.h>
+#include "cbs_hist.h"
+
+#define CBS_RXSTAT_WINDOW           1024            /* sequence numbers, multiple of 64 */
+
+/* Counters, monotonic */
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;             /* on the wire, without FCS */
+    uint64_t lost;              /* gaps that left the window */
+    uint64_t duplicates;
+    uint64_t reordered;         /* arrived after a higher sequence number, within the window */
+    uint64_t late;              /* arrived after leaving the window, already counted lost */
+    uint64_t restarts;          /* sequence 0 far behind: the sender started over */
+} cbs_rxstat_counts_t;
+
+/* State of One Stream */
+typedef struct {
+    cbs_rxstat_counts_t counts;
+    int started;
+    uint64_t max_seq;           /* highest sequence number seen */
+    uint64_t window[CBS_RXSTAT_WINDOW / 64];   /* bit seq % WINDOW: seen, for (max_seq - WINDOW, max_seq] */
+    int64_t last_transit;       /* ns, previous frame in arrival order */
+    uint64_t jitter16;          /* RFC 3550 J in ns, scaled by 16 */
+    int64_t latency_min;        /* ns, since start */
+    int64_t latency_max;
+    int64_t latency_sum;
+    uint64_t negative;          /* latency below zero: sender and receiver clocks disagree */
+    cbs_hist_t latency;         /* ns, since the last cbs_rxstat_interval() */
+} cbs_rxstat_t;
+
+/**
+ * Reset a stream
+ * @param st: Stream state
+ */
+void cbs_rxstat_init(cbs_rxstat_t *st);
+
+/**
+ * Account one received frame
+ * @param st: Stream state
+ * @param seq: Sequence number from the payload header
+ * @param tx_ns: Transmit time from the payload header
+ * @param rx_ns: Receive time, same clock as tx_ns
+ * @param bytes: Frame length
+ */
+void cbs_rxstat_update(cbs_rxstat_t *st, uint64_t seq, uint64_t tx_ns, uint64_t rx_ns, uint32_t bytes);
+
+/**
+ * Sequence numbers inside the window not seen yet; lost unless they
+ * still arrive, so add them to counts.lost for a final result
+ * @param st: Stream state
+ * @return: Missing sequence numbers
+ */
+uint64_t cbs_rxstat_pending(const cbs_rxstat_t *st);
+
+/**
+ * Latency percentiles since the previous call, then start a new interval
+ * @param st: Stream state
+ * @param sum: Output
+ */
+void cbs_rxstat_interval(cbs_rxstat_t *st, cbs_hist_summary_t *sum);
+
+/**
+ * Current interarrival jitter
+ * @param st: Stream state
+ * @return: ns
+ */
+static inline uint64_t cbs_rxstat_jitter_ns(const cbs_rxstat_t *st) {
+    return st->jitter16 >> 4;
+}
+
+#endif /* CBS_RXSTAT_H */
@@ -0,0 +1,124 @@
+/**
+ * High-frequency register sampler for the CBS drivers
+ * A dedicated thread reads a set of registers at 1-10 kHz and pushes
+ * timestamped samples into a single-producer/single-consumer lock-free ring
+ */
+
+#ifndef CBS_SAMPLER_H
+#define CBS_SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "cbs_regio.h"
+
+/* Sampler Limits */
+#define CBS_SAMPLER_MIN_HZ          1000
+#define CBS_SAMPLER_MAX_HZ          10000
+#define CBS_SAMPLER_MAX_CHANNELS    128
+#define CBS_SAMPLER_RING_SIZE       (1u << 18)  /* samples, power of two */
+#define CBS_SAMPLER_RT_PRIORITY     50          /* SCHED_FIFO, when permitted */
+
+/* One Register Reading */
+typedef struct {
+    uint64_t t_ns;              /* CLOCK_MONOTONIC_RAW at the read */
+    uint32_t value;
+    uint16_t channel;           /* index into the channel table */
+    uint16_t sweep;             /* sweep number, low 16 bits */
+} cbs_sample_t;
+
+/* Sampled Register */
+typedef struct {
+    uint32_t offset;
+    uint16_t port;
+    uint16_t queue;             /* traffic class / queue, 0 if per port */
+} cbs_sampler_channel_t;
+
+/* Sampler Statistics */
+typedef struct {
+    uint64_t sweeps;            /* completed passes over all channels */
+    uint64_t samples;           /* samples pushed into the ring */
+    uint64_t dropped;           /* samples lost because the ring was full */
+    uint64_t overruns;          /* periods skipped because a sweep ran late */
+    uint64_t max_lateness_ns;   /* worst wakeup delay past the deadline */
+} cbs_sampler_stats_t;
+
+/* Sampler */
+typedef struct {
+    cbs_regio_t *io;
+    cbs_sampler_channel_t channels[CBS_SAMPLER_MAX_CHANNELS];
+    uint32_t n_channels;
+    uint32_t rate_hz;
+    pthread_t thread;
+    atomic_bool running;
+    cbs_sample_t *ring;
+    /* producer and consumer indices on separate cache lines */
+    _Alignas(64) atomic_uint_fast64_t head;     /* written by the sampler */
+    _Alignas(64) atomic_uint_fast64_t tail;     /* written by the consumer */
+    _Alignas(64) cbs_sampler_stats_t stats;     /* written by the sampler */
+} cbs_sampler_t;
+
+/**
+ * Initialize a sampler over a register backend
+ * @param s: Sampler
+ * @param io: Register backend, read directly (not through a cache)
+ * @param rate_hz: Sweep rate, CBS_SAMPLER_MIN_HZ..CBS_SAMPLER_MAX_HZ
+ * @return: 0 on success, negative on error
+ */
+int cbs_sampler_init(cbs_sampler_t *s, cbs_regio_t *io, uint32_t rate_hz);
+
+/**
+ * Add a register to every sweep; only before cbs_sampler_start
+ * @param s: Sampler
+ * @param offset: Register offset
+ * @param port: Port the register belongs to
+ * @param queue: Queue / traffic class, 0 for port registers
+ * @return: Channel index, negative when the table is full
+ */
+int cbs_sampler_add(cbs_sampler_t *s, uint32_t offset, uint16_t port, uint16_t queue);
+
+/**
+ * Start the sampling thread, at SCHED_FIFO CBS_SAMPLER_RT_PRIORITY when permitted
+ * @param s: Sampler
+ * @return: 0 on success, negative on error
+ */
+int cbs_sampler_start(cbs_sampler_t *s);
+
+/**
+ * Stop the sampling thread; samples already in the ring stay drainable
+ * @param s: Sampler
+ */
+void cbs_sampler_stop(cbs_sampler_t *s);
+
+/**
+ * Stop the thread if needed and free the ring
+ * @param s: Sampler
+ */
+void cbs_sampler_destroy(cbs_sampler_t *s);
+
+/**
+ * Take up to max samples out of the ring without blocking the sampler.
+ * Only one thread may drain a given sampler.
+ * @param s: Sampler
+ * @param out: Output array
+ * @param max: Capacity of out
+ * @return: Number of samples copied
+ */
+size_t cbs_sampler_drain(cbs_sampler_t *s, cbs_sample_t *out, size_t max);
+
+/**
+ * Snapshot the sampler statistics (approximate while running)
+ * @param s: Sampler
+ * @param stats: Output
+ */
+void cbs_sampler_get_stats(const cbs_sampler_t *s, cbs_sampler_stats_t *stats);
+
+/**
+ * Current CLOCK_MONOTONIC_RAW time, the clock used for sample timestamps
+ * @return: Nanoseconds
+ */
+uint64_t cbs_sampler_now_ns(void);
+
+#endif /* CBS_SAMPLER_H */
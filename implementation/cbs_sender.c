@@ -0,0 +1,618 @@
+/**
+ * Credit-based shaped multi-stream sender
+ * Replaces the cvlc/ffmpeg streams and the tc u32 priority filters of
+ * vlc_cbs_test.sh with one process that shapes in user space: streams
+ * feed per-class queues, an 802.1Qav shaper per class (cbs_config_t
+ * parameters, computed with cbs_calc) and strict priority between
+ * classes decide the transmission schedule on a virtual port of the
+ * given rate, and every frame is written into a PACKET_MMAP or AF_XDP
+ * ring (cbs_tx) when its scheduled start time comes up on
+ * CLOCK_MONOTONIC. Frames are VLAN/PCP-tagged UDP with the cbs_pkt
+ * sequence/timestamp header.
+ *
+ * The schedule is computed exactly in picoseconds; the wall clock only
+ * decides when a frame is handed to the kernel. The difference between
+ * the two is the pacing error, reported per class. While the sender
+ * keeps up, every frame is kicked on its own at its start time; once
+ * it falls behind, frames already due are batched into one kick.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include "lan9692_cbs.h"
+#include "cbs_calc.h"
+#include "cbs_hist.h"
+#include "cbs_sim.h"
+#include "cbs_pkt.h"
+#include "cbs_tx.h"
+
+#define NS_PER_SEC                  1000000000ULL
+#define PICOBITS_PER_BYTE           (8 * CBS_SIM_PS_PER_SEC)
+#define NUM_CLASSES                 8
+#define MAX_STREAMS                 64
+#define CLASS_QUEUE                 1024            /* frames per class, tail drop */
+#define WIRE_OVERHEAD               20              /* preamble + SFD + inter-frame gap */
+#define DEFAULT_PORT_MBPS           1000
+#define DEFAULT_BATCH               64
+#define DEFAULT_VLAN                100
+#define START_LEAD_NS               2000000         /* schedule starts 2 ms after setup */
+#define SPIN_NS                     100000          /* busy-poll the last 100 us of a wait */
+#define BE_PORT                     5201            /* iperf3 */
+
+/* vlc_cbs_test.sh: 4K/FHD/VOD streams, EVB egress reservations */
+static const struct {
+    const char *name;
+    uint8_t tc;
+    uint32_t mbps;
+    uint32_t reserve_mbps;
+    uint16_t port;
+} lab_streams[] = {
+    { "4K",  7, 25, 30, 5005 },
+    { "FHD", 6,  8, 10, 5006 },
+    { "VOD", 5,  4,  5, 5007 },
+};
+
+/* mpegts pkt_size=1316 + UDP/IP/Ethernet/VLAN + FCS */
+#define LAB_FRAME_BYTES             1366
+
+typedef struct {
+    cbs_pkt_flow_t flow;
+    uint8_t tc;
+    uint64_t rate;              /* bps, 0 = always backlogged */
+    uint32_t frame_bytes;       /* with FCS */
+    /* Arrivals: exact period as gap_ps + gap_rem/rate */
+    uint64_t next_ps;
+    uint64_t gap_ps;
+    uint64_t gap_rem;
+    uint64_t acc;
+    uint32_t queued;
+    /* Frame */
+    uint8_t tmpl[CBS_TX_FRAME_SIZE];
+    uint32_t len;
+    uint32_t hdr_off;
+    uint64_t seq;
+    /* Statistics */
+    uint64_t frames;
+    uint64_t drops;
+} stream_t;
+
+typedef struct {
+    cbs_config_t cfg;
+    uint32_t streams;
+    /* Statistics */
+    uint64_t frames;
+    uint64_t bytes;
+    cbs_hist_t error_ns;        /* handed to the kernel minus scheduled start */
+} tclass_t;
+
+typedef struct {
+    cbs_sim_port_t sched;       /* shaper state, same credit rules as cbs_sim */
+    cbs_sim_entry_t ring[NUM_CLASSES][CLASS_QUEUE];
+    tclass_t tc[NUM_CLASSES];
+    stream_t streams[MAX_STREAMS];
+    uint32_t n_streams;
+} port_t;
+
+/* A frame handed to the ring but not kicked yet */
+typedef struct {
+    uint8_t tc;
+    uint64_t target_ns;
+} pending_t;
+
+static port_t port;
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* ===== Shaper (cbs_sim credit rules, one decision at a time) ===== */
+
+static void port_init(port_t *p, uint64_t rate) {
+    p->sched.rate = rate;
+    for (int tc = 0; tc < NUM_CLASSES; tc++) {
+        p->sched.tc[tc].ring = p->ring[tc];
+        p->sched.tc[tc].mask = CLASS_QUEUE - 1;
+        cbs_hist_reset(&p->tc[tc].error_ns);
+    }
+}
+
+static void enqueue(port_t *p, uint16_t id, uint64_t t_ps) {
+    stream_t *s = &p->streams[id];
+    cbs_sim_tc_t *q = &p->sched.tc[s->tc];
+
+    if (q->tail - q->head == CLASS_QUEUE) {
+        s->drops++;
+        return;
+    }
+    /* An empty class starts accruing credit from the arrival, not from its last update */
+    cbs_sim_credit_advance(q, t_ps);
+    q->ring[q->tail++ & q->mask] = (cbs_sim_entry_t){ .t_ps = t_ps, .bytes = s->frame_bytes, .stream = id };
+    q->queued_bytes += s->frame_bytes;
+    s->queued++;
+    p->sched.backlog |= 1u << s->tc;
+}
+
+/* Move every arrival up to t into the class queues; returns the next later arrival */
+static uint64_t admit(port_t *p, uint64_t t) {
+    uint64_t next = UINT64_MAX;
+
+    for (uint16_t i = 0; i < p->n_streams; i++) {
+        stream_t *s = &p->streams[i];
+
+        if (s->rate == 0) {
+            if (s->queued == 0) {
+                enqueue(p, i, t);
+            }
+            continue;
+        }
+        while (s->next_ps <= t) {
+            enqueue(p, i, s->next_ps);
+            s->next_ps += s->gap_ps;
+            s->acc += s->gap_rem;
+            if (s->acc >= s->rate) {
+                s->acc -= s->rate;
+                s->next_ps++;
+            }
+        }
+        if (s->next_ps < next) {
+            next = s->next_ps;
+        }
+    }
+    return next;
+}
+
+/*
+ * Next transmission of the port: the stream and its start time (ps from
+ * the schedule origin). The frame is taken off its queue and the
+ * shaper state moved past it.
+ */
+static int schedule_next(port_t *p, uint16_t *stream, uint64_t *start_ps) {
+    cbs_sim_port_t *sp = &p->sched;
+
+    for (;;) {
+        uint64_t wake, tx;
+        int sel;
+
+        if (sp->busy_until_ps > sp->now_ps) {
+            sp->now_ps = sp->busy_until_ps;
+        }
+        wake = admit(p, sp->now_ps);
+        sel = cbs_sim_select(sp, &wake);
+        if (sel >= 0) {
+            cbs_sim_entry_t e = cbs_sim_dequeue(sp, sel, WIRE_OVERHEAD, &tx);
+
+            p->streams[e.stream].queued--;
+            *stream = e.stream;
+            *start_ps = sp->now_ps;
+            return 0;
+        }
+        if (wake == UINT64_MAX) {
+            return -ENODATA;
+        }
+        sp->now_ps = wake;
+    }
+}
+
+/* ===== Setup ===== */
+
+static uint16_t default_port(uint8_t tc) {
+    for (size_t i = 0; i < sizeof(lab_streams) / sizeof(lab_streams[0]); i++) {
+        if (lab_streams[i].tc == tc) {
+            return lab_streams[i].port;
+        }
+    }
+    return BE_PORT;
+}
+
+static int add_stream(uint8_t tc, uint64_t rate, uint32_t frame_bytes, uint16_t vid, uint8_t pcp,
+                      uint16_t dport) {
+    stream_t *s;
+
+    if (port.n_streams == MAX_STREAMS || tc >= NUM_CLASSES || pcp > 7) {
+        return -EINVAL;
+    }
+    s = &port.streams[port.n_streams++];
+    memset(s, 0, sizeof(*s));
+    s->tc = tc;
+    s->rate = rate;
+    s->frame_bytes = frame_bytes;
+    s->flow.vid = vid;
+    s->flow.pcp = pcp;
+    s->flow.src_port = 40000 + port.n_streams - 1;
+    s->flow.dst_port = dport;
+    if (rate > 0) {
+        s->gap_ps = (uint64_t)frame_bytes * PICOBITS_PER_BYTE / rate;
+        s->gap_rem = (uint64_t)frame_bytes * PICOBITS_PER_BYTE % rate;
+    }
+    port.tc[tc].streams++;
+    return 0;
+}
+
+/* -s tc:mbps:bytes[:vid[:pcp[:dport]]] */
+static int parse_stream(const char *arg) {
+    unsigned tc, bytes = LAB_FRAME_BYTES, vid = DEFAULT_VLAN, pcp = 8, dport = 0;
+    double mbps;
+    int n = sscanf(arg, "%u:%lf:%u:%u:%u:%u", &tc, &mbps, &bytes, &vid, &pcp, &dport);
+
+    if (n < 2 || tc >= NUM_CLASSES || mbps < 0 || (vid > 4094 && vid != CBS_PKT_UNTAGGED)) {
+        return -EINVAL;
+    }
+    return add_stream(tc, (uint64_t)(mbps * 1e6), bytes, vid, pcp > 7 ? tc : pcp,
+                      dport ? dport : default_port(tc));
+}
+
+/* -c tc:idle_mbps */
+static int parse_class(const char *arg, uint32_t *reserve_kbps) {
+    unsigned tc;
+    double mbps;
+
+    if (sscanf(arg, "%u:%lf", &tc, &mbps) != 2 || tc >= NUM_CLASSES || mbps < 0 || mbps > 4000) {
+        return -EINVAL;
+    }
+    reserve_kbps[tc] = (uint32_t)(mbps * 1000);
+    return 0;
+}
+
+static int parse_mac(const char *arg, uint8_t *mac) {
+    unsigned b[6];
+
+    if (sscanf(arg, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return -EINVAL;
+    }
+    for (int i = 0; i < 6; i++) {
+        mac[i] = (uint8_t)b[i];
+    }
+    return 0;
+}
+
+static int interface_mac(const char *ifname, uint8_t *mac) {
+    struct ifreq ifr;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0), ret = 0;
+
+    if (fd < 0) {
+        return -errno;
+    }
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+        ret = -errno;
+    } else {
+        memcpy(mac, ifr.ifr_hwaddr.sa_data, 6);
+    }
+    close(fd);
+    return ret;
+}
+
+/* cbs_config_t of every reserved class; higher classes interfere as in cbs_calc */
+static int configure_classes(const uint32_t *reserve_kbps) {
+    uint32_t max_frame[NUM_CLASSES] = { 0 };
+    uint64_t higher_idle = 0;
+    uint32_t higher_frame = 0;
+
+    for (uint32_t i = 0; i < port.n_streams; i++) {
+        stream_t *s = &port.streams[i];
+        if (s->frame_bytes > max_frame[s->tc]) {
+            max_frame[s->tc] = s->frame_bytes;
+        }
+    }
+    for (int tc = NUM_CLASSES - 1; tc >= 0; tc--) {
+        tclass_t *q = &port.tc[tc];
+        cbs_sim_tc_t *shaper = &port.sched.tc[tc];
+        cbs_calc_class_t cls;
+        cbs_calc_result_t result;
+        uint32_t lower_frame = 0;
+
+        if (reserve_kbps[tc] == 0) {
+            continue;
+        }
+        for (int l = 0; l < tc; l++) {
+            if (max_frame[l] > lower_frame) {
+                lower_frame = max_frame[l];
+            }
+        }
+        cls = (cbs_calc_class_t){
+            .port_rate = port.sched.rate,
+            .idle_slope = (uint64_t)reserve_kbps[tc] * 1000,
+            .max_frame = max_frame[tc] ? max_frame[tc] : CBS_CALC_DEFAULT_FRAME,
+            .max_interference = lower_frame,
+            .higher_idle_slope = higher_idle,
+            .higher_max_frame = higher_frame,
+        };
+        if (cbs_calc(&cls, &result) < 0 || result.idle_slope >= port.sched.rate) {
+            fprintf(stderr, "TC%d: reservation of %u kbps does not fit the port\n", tc, reserve_kbps[tc]);
+            return -EINVAL;
+        }
+        q->cfg = (cbs_config_t){
+            .idle_slope = (uint32_t)result.idle_slope,
+            .send_slope = (uint32_t)result.send_slope,
+            .hi_credit = result.hi_credit,
+            .lo_credit = result.lo_credit,
+            .enabled = true,
+        };
+        shaper->shaped = true;
+        shaper->idle_slope = q->cfg.idle_slope;
+        shaper->send_slope = q->cfg.send_slope;
+        shaper->hi_credit = (int64_t)q->cfg.hi_credit * PICOBITS_PER_BYTE;
+        shaper->lo_credit = (int64_t)q->cfg.lo_credit * PICOBITS_PER_BYTE;
+        higher_idle += result.idle_slope;
+        if (cls.max_frame > higher_frame) {
+            higher_frame = cls.max_frame;
+        }
+    }
+    return 0;
+}
+
+/* ===== Transmission ===== */
+
+static int kick(cbs_tx_t *tx, pending_t *pend, uint32_t *n_pend) {
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+
+    for (uint32_t i = 0; i < *n_pend; i++) {
+        uint64_t err = now > pend[i].target_ns ? now - pend[i].target_ns : 0;
+        cbs_hist_record(&port.tc[pend[i].tc].error_ns, err > UINT32_MAX ? UINT32_MAX : (uint32_t)err);
+    }
+    *n_pend = 0;
+    return cbs_tx_kick(tx);
+}
+
+static void wait_until(uint64_t target) {
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+
+    if (target > now + SPIN_NS) {
+        struct timespec ts = {
+            .tv_sec = (target - SPIN_NS) / NS_PER_SEC,
+            .tv_nsec = (target - SPIN_NS) % NS_PER_SEC,
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    while (clock_ns(CLOCK_MONOTONIC) < target && running) {
+        cpu_relax();
+    }
+}
+
+static uint64_t run(cbs_tx_t *tx, uint64_t duration_ns, uint32_t batch) {
+    static pending_t pend[CBS_TX_DEFAULT_FRAMES];
+    uint64_t base = clock_ns(CLOCK_MONOTONIC) + START_LEAD_NS;
+    uint64_t rt_offset = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+    uint64_t end = base + duration_ns, now = 0;
+    uint32_t n_pend = 0;
+    uint16_t id;
+    uint64_t start_ps;
+    int ret = 0;
+
+    if (batch > CBS_TX_DEFAULT_FRAMES) {
+        batch = CBS_TX_DEFAULT_FRAMES;
+    }
+    while (running && schedule_next(&port, &id, &start_ps) == 0) {
+        stream_t *s = &port.streams[id];
+        uint64_t target = base + start_ps / 1000;
+        uint8_t *frame;
+
+        if (target >= end) {
+            break;
+        }
+        now = clock_ns(CLOCK_MONOTONIC);
+        if (target > now) {
+            if (n_pend && (ret = kick(tx, pend, &n_pend)) < 0) {
+                break;
+            }
+            wait_until(target);
+            now = clock_ns(CLOCK_MONOTONIC);
+        }
+        /* Ring full: the kernel is behind, keep kicking until a slot frees up */
+        while ((frame = cbs_tx_frame(tx)) == NULL) {
+            if ((ret = kick(tx, pend, &n_pend)) < 0 || !running || clock_ns(CLOCK_MONOTONIC) >= end) {
+                break;
+            }
+            cpu_relax();
+        }
+        if (frame == NULL) {
+            break;
+        }
+
+        memcpy(frame, s->tmpl, s->len);
+        cbs_pkt_stamp(frame + s->hdr_off, s->seq++, now + rt_offset);
+        cbs_tx_commit(tx, s->len);
+        pend[n_pend++] = (pending_t){ s->tc, target };
+        s->frames++;
+        port.tc[s->tc].frames++;
+        port.tc[s->tc].bytes += s->frame_bytes;
+        if (n_pend >= batch && (ret = kick(tx, pend, &n_pend)) < 0) {
+            break;
+        }
+    }
+    if (n_pend && ret == 0) {
+        ret = kick(tx, pend, &n_pend);
+    }
+    if (ret < 0) {
+        fprintf(stderr, "Transmission stopped: %s\n", strerror(-ret));
+    }
+    now = clock_ns(CLOCK_MONOTONIC);
+    return now > base ? now - base : 0;
+}
+
+static void report(cbs_tx_t *tx, uint64_t elapsed_ns) {
+    uint64_t frames = 0, bytes = 0;
+    double sec = elapsed_ns / 1e9;
+
+    printf("\n%-4s %10s %8s %8s %8s %10s %10s %9s %9s %9s\n", "TC", "idle Mbps", "hi B", "lo B",
+           "streams", "frames", "sent Mbps", "err p50", "err p99", "err max");
+    for (int tc = NUM_CLASSES - 1; tc >= 0; tc--) {
+        tclass_t *q = &port.tc[tc];
+        cbs_hist_summary_t sum;
+
+        if (q->streams == 0) {
+            continue;
+        }
+        cbs_hist_summarize(&q->error_ns, &sum, 0);
+        frames += q->frames;
+        bytes += q->bytes;
+        printf("TC%-2d ", tc);
+        if (port.sched.tc[tc].shaped) {
+            printf("%10.3f %8u %8u ", q->cfg.idle_slope / 1e6, q->cfg.hi_credit, q->cfg.lo_credit);
+        } else {
+            printf("%10s %8s %8s ", "-", "-", "-");
+        }
+        printf("%8u %10llu %10.3f %7.1fus %7.1fus %7.1fus\n", q->streams, (unsigned long long)q->frames,
+               q->bytes * 8 / sec / 1e6, sum.p50 / 1e3, sum.p99 / 1e3, sum.max / 1e3);
+    }
+
+    printf("\n%-6s %3s %3s %5s %6s %6s %10s %10s %10s %8s\n", "stream", "tc", "pcp", "vid", "dport",
+           "bytes", "offer Mbps", "sent Mbps", "frames", "drops");
+    for (uint32_t i = 0; i < port.n_streams; i++) {
+        stream_t *s = &port.streams[i];
+        char offer[16];
+
+        if (s->rate) {
+            snprintf(offer, sizeof(offer), "%.3f", s->rate / 1e6);
+        } else {
+            snprintf(offer, sizeof(offer), "line");
+        }
+        printf("%-6u %3u %3u %5u %6u %6u %10s %10.3f %10llu %8llu\n", i, s->tc, s->flow.pcp,
+               s->flow.vid == CBS_PKT_UNTAGGED ? 0 : s->flow.vid, s->flow.dst_port, s->frame_bytes, offer,
+               s->frames * s->frame_bytes * 8 / sec / 1e6, (unsigned long long)s->frames,
+               (unsigned long long)s->drops);
+    }
+
+    printf("\n%llu frames in %.3f s: %.1f kpps, %.1f Mbps (%.1f%% of the %.0f Mbps port with overhead)\n",
+           (unsigned long long)frames, sec, frames / sec / 1e3, bytes * 8 / sec / 1e6,
+           (bytes + frames * WIRE_OVERHEAD) * 8 / sec / port.sched.rate * 100, port.sched.rate / 1e6);
+    cbs_tx_dump_stats(tx, stdout);
+}
+
+int main(int argc, char *argv[]) {
+    const char *ifname = NULL, *backend = "auto";
+    uint8_t dst_mac[6] = { 0x02, 0x00, 0x0A, 0x00, 0x64, 0x02 };
+    uint32_t reserve_kbps[NUM_CLASSES] = { 0 }, batch = DEFAULT_BATCH, queue = 0, n_frames = 0;
+    double duration = 10.0, port_mbps = DEFAULT_PORT_MBPS, be_mbps = -1;
+    bool classes_given = false;
+    uint8_t src_mac[6];
+    uint64_t elapsed;
+    cbs_tx_t *tx;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "i:x:q:n:R:d:c:s:b:D:B:h")) != -1) {
+        switch (opt) {
+        case 'i': ifname = optarg; ret = 0; break;
+        case 'x': backend = optarg; ret = 0; break;
+        case 'q': queue = (uint32_t)atoi(optarg); ret = 0; break;
+        case 'n': n_frames = (uint32_t)atoi(optarg); ret = 0; break;
+        case 'R': port_mbps = atof(optarg); ret = port_mbps > 0 ? 0 : -EINVAL; break;
+        case 'd': duration = atof(optarg); ret = duration > 0 ? 0 : -EINVAL; break;
+        case 'c': ret = parse_class(optarg, reserve_kbps); classes_given = true; break;
+        case 's': ret = parse_stream(optarg); break;
+        case 'b': be_mbps = atof(optarg); ret = be_mbps >= 0 ? 0 : -EINVAL; break;
+        case 'D': ret = parse_mac(optarg, dst_mac); break;
+        case 'B': batch = (uint32_t)atoi(optarg); ret = batch > 0 ? 0 : -EINVAL; break;
+        default:
+            printf("Usage: %s -i ifname [-x auto|packet|xdp] [-q queue] [-n slots] [-R port_mbps]\n"
+                   "          [-d sec] [-c tc:idle_mbps]... [-s tc:mbps[:bytes[:vid[:pcp[:dport]]]]]...\n"
+                   "          [-b be_mbps] [-D dst_mac] [-B batch]\n", argv[0]);
+            printf("  -x  TX ring: AF_XDP, AF_PACKET PACKET_MMAP, or XDP falling back (default auto)\n");
+            printf("  -q  Queue for AF_XDP (default 0)\n");
+            printf("  -n  Ring slots (default %d)\n", CBS_TX_DEFAULT_FRAMES);
+            printf("  -R  Rate of the shaped port, wire overhead included (default %d)\n", DEFAULT_PORT_MBPS);
+            printf("  -d  Run time in seconds (default 10)\n");
+            printf("  -c  Reserve idle slope for a class; unreserved classes are strict priority only\n");
+            printf("  -s  Stream; mbps 0 = always backlogged (line rate); pcp defaults to tc,\n");
+            printf("      bytes to %d (with FCS), vid to %d (%d = untagged)\n",
+                   LAB_FRAME_BYTES, DEFAULT_VLAN, CBS_PKT_UNTAGGED);
+            printf("  -b  Best-effort load on TC0, 0 = line rate\n");
+            printf("  -D  Destination MAC (default 02:00:0a:00:64:02)\n");
+            printf("  -B  Frames per kick once the sender is behind schedule (default %d)\n", DEFAULT_BATCH);
+            printf("  Without -s: the 4K/FHD/VOD streams of vlc_cbs_test.sh with the EVB reservations\n");
+            return opt == 'h' ? 0 : 1;
+        }
+        if (ret < 0) {
+            fprintf(stderr, "Bad value for -%c: %s\n", opt, optarg);
+            return 1;
+        }
+    }
+    if (ifname == NULL) {
+        fprintf(stderr, "No interface given (-i)\n");
+        return 1;
+    }
+    port_init(&port, (uint64_t)(port_mbps * 1e6));
+
+    if (port.n_streams == 0) {
+        for (size_t i = 0; i < sizeof(lab_streams) / sizeof(lab_streams[0]); i++) {
+            add_stream(lab_streams[i].tc, lab_streams[i].mbps * 1000000ULL, LAB_FRAME_BYTES, DEFAULT_VLAN,
+                       lab_streams[i].tc, lab_streams[i].port);
+            if (!classes_given) {
+                reserve_kbps[lab_streams[i].tc] = lab_streams[i].reserve_mbps * 1000;
+            }
+        }
+    }
+    if (be_mbps >= 0 && add_stream(TC_BEST_EFFORT, (uint64_t)(be_mbps * 1e6), CBS_MAX_FRAME_SIZE,
+                                   DEFAULT_VLAN, TC_BEST_EFFORT, BE_PORT) < 0) {
+        fprintf(stderr, "Too many streams\n");
+        return 1;
+    }
+    if (configure_classes(reserve_kbps) < 0) {
+        return 1;
+    }
+
+    tx = cbs_tx_open(backend, ifname, queue, n_frames);
+    if (tx == NULL) {
+        fprintf(stderr, "%s: cannot open %s TX ring: %s\n", ifname, backend, strerror(errno));
+        return 1;
+    }
+    if (interface_mac(ifname, src_mac) < 0) {
+        memset(src_mac, 0, sizeof(src_mac));
+    }
+    for (uint32_t i = 0; i < port.n_streams; i++) {
+        stream_t *s = &port.streams[i];
+        int len;
+
+        memcpy(s->flow.dst_mac, dst_mac, 6);
+        memcpy(s->flow.src_mac, src_mac, 6);
+        s->flow.src_ip = inet_addr("10.0.100.1");
+        s->flow.dst_ip = inet_addr("10.0.100.2");
+        len = cbs_pkt_build(s->tmpl, tx->max_len, &s->flow, (uint16_t)i, s->tc, s->frame_bytes);
+        if (len < 0) {
+            fprintf(stderr, "Stream %u: frame size %u outside %u-%u bytes\n", i, s->frame_bytes,
+                    cbs_pkt_min_frame(s->flow.vid != CBS_PKT_UNTAGGED), tx->max_len + CBS_PKT_FCS_LEN);
+            cbs_tx_close(tx);
+            return 1;
+        }
+        s->len = (uint32_t)len;
+        s->hdr_off = cbs_pkt_hdr_offset(&s->flow);
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    prctl(PR_SET_TIMERSLACK, 1UL);
+
+    printf("Shaping %u streams on %s (%s ring, %.0f Mbps port) for %.1f s\n",
+           port.n_streams, ifname, tx->ops->name, port_mbps, duration);
+    elapsed = run(tx, (uint64_t)(duration * NS_PER_SEC), batch);
+    report(tx, elapsed);
+    cbs_tx_close(tx);
+    return 0;
+}
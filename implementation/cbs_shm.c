@@ -0,0 +1,160 @@
+/**
+ * Shared-memory statistics segment for the CBS tools
+ * The segment is created by the writer and mapped PROT_READ by readers,
+ * so a misbehaving reader can never disturb the published data
+ */
+
+#include "cbs_shm.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void set_name(cbs_shm_t *shm, const char *name) {
+    snprintf(shm->name, sizeof(shm->name), "%s", name ? name : CBS_SHM_NAME);
+}
+
+int cbs_shm_create(cbs_shm_t *shm, const char *name, uint32_t n_ports) {
+    cbs_shm_segment_t *seg;
+    int fd, ret;
+
+    if (n_ports == 0 || n_ports > CBS_SHM_MAX_PORTS) {
+        return -EINVAL;
+    }
+
+    memset(shm, 0, sizeof(*shm));
+    set_name(shm, name);
+
+    fd = shm_open(shm->name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return -errno;
+    }
+    if (ftruncate(fd, sizeof(cbs_shm_segment_t)) < 0) {
+        ret = -errno;
+        close(fd);
+        return ret;
+    }
+    seg = mmap(NULL, sizeof(*seg), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ret = (seg == MAP_FAILED) ? -errno : 0;
+    close(fd);
+    if (ret < 0) {
+        return ret;
+    }
+
+    /* Readers of a previous writer see an odd seq, then the new layout */
+    __atomic_store_n(&seg->seq, seg->seq | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(&seg->data, 0, sizeof(seg->data));
+    seg->data.n_ports = n_ports;
+    seg->magic = CBS_SHM_MAGIC;
+    seg->version = CBS_SHM_VERSION;
+    seg->size = sizeof(*seg);
+    seg->writer_pid = getpid();
+    __atomic_store_n(&seg->seq, seg->seq + 1, __ATOMIC_RELEASE);
+
+    shm->seg = seg;
+    shm->writer = 1;
+    return 0;
+}
+
+int cbs_shm_open(cbs_shm_t *shm, const char *name) {
+    cbs_shm_segment_t *seg;
+    struct stat st;
+    int fd, ret = 0;
+
+    memset(shm, 0, sizeof(*shm));
+    set_name(shm, name);
+
+    fd = shm_open(shm->name, O_RDONLY, 0);
+    if (fd < 0) {
+        return -errno;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(*seg)) {
+        close(fd);
+        return -EPROTO;
+    }
+    seg = mmap(NULL, sizeof(*seg), PROT_READ, MAP_SHARED, fd, 0);
+    if (seg == MAP_FAILED) {
+        ret = -errno;
+    }
+    close(fd);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (seg->magic != CBS_SHM_MAGIC || seg->version != CBS_SHM_VERSION ||
+        seg->size != sizeof(*seg)) {
+        munmap(seg, sizeof(*seg));
+        return -EPROTO;
+    }
+
+    shm->seg = seg;
+    return 0;
+}
+
+void cbs_shm_close(cbs_shm_t *shm) {
+    if (shm->seg == NULL) {
+        return;
+    }
+    munmap(shm->seg, sizeof(*shm->seg));
+    if (shm->writer) {
+        shm_unlink(shm->name);
+    }
+    shm->seg = NULL;
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* Seqlock read of [src, src + len) into dst, plus the publish time under the same sequence */
+static int shm_read(const cbs_shm_t *shm, void *dst, const void *src, size_t len, uint64_t *update_ns) {
+    const uint64_t *seq = &shm->seg->seq;
+
+    for (int retries = 0; retries < CBS_SHM_MAX_RETRIES; retries++) {
+        uint64_t before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            cpu_relax();
+            continue;
+        }
+        memcpy(dst, src, len);
+        if (update_ns) {
+            *update_ns = shm->seg->data.update_ns;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(seq, __ATOMIC_RELAXED) == before) {
+            return retries;
+        }
+    }
+    return -EAGAIN;
+}
+
+int cbs_shm_snapshot(const cbs_shm_t *shm, cbs_shm_data_t *out) {
+    const cbs_shm_data_t *data = &shm->seg->data;
+    uint32_t n_ports = __atomic_load_n(&data->n_ports, __ATOMIC_RELAXED);
+    int ret;
+
+    if (n_ports > CBS_SHM_MAX_PORTS) {
+        n_ports = CBS_SHM_MAX_PORTS;
+    }
+
+    /* Only the live ports; a new writer with more ports means one full copy */
+    ret = shm_read(shm, out, data, offsetof(cbs_shm_data_t, ports) +
+                   n_ports * sizeof(cbs_shm_port_t), NULL);
+    if (ret < 0 || out->n_ports <= n_ports) {
+        return ret;
+    }
+    return shm_read(shm, out, data, sizeof(*out), NULL);
+}
+
+int cbs_shm_read_port(const cbs_shm_t *shm, uint32_t port, cbs_shm_port_t *out, uint64_t *update_ns) {
+    if (port >= __atomic_load_n(&shm->seg->data.n_ports, __ATOMIC_RELAXED)) {
+        return -EINVAL;
+    }
+    return shm_read(shm, out, &shm->seg->data.ports[port], sizeof(*out), update_ns);
+}
@@ -0,0 +1,143 @@
+/**
+ * Shared-memory statistics segment for the CBS tools
+ * The monitoring process publishes the latest per-port/per-TC counters,
+ * rates and status words into a POSIX shared-memory object guarded by a
+ * seqlock; any number of local readers take consistent snapshots with
+ * plain loads, no syscalls and no extra device traffic
+ *
+ * Writer:  seq odd -> update data -> seq even (single writer)
+ * Reader:  read seq (retry while odd) -> copy -> re-read seq, retry if changed
+ */
+
+#ifndef CBS_SHM_H
+#define CBS_SHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CBS_SHM_NAME                "/cbs_stats"
+#define CBS_SHM_MAGIC               0x53534243  /* "CBSS" */
+#define CBS_SHM_VERSION             1
+#define CBS_SHM_MAX_PORTS           64
+#define CBS_SHM_NUM_TCS             8
+#define CBS_SHM_MAX_RETRIES         100000      /* reader gives up on a stalled writer */
+
+/* TC status flags */
+#define CBS_SHM_TC_SHAPED           (1u << 0)   /* CBS shaper enabled on the queue */
+
+/* Per Traffic Class Statistics */
+typedef struct {
+    uint64_t tx_frames;
+    uint64_t tx_octets;
+    uint64_t drops;
+    double tx_bps;              /* EWMA transmit rate */
+    uint32_t idle_slope_kbps;   /* configured idle slope, 0 if unshaped */
+    uint32_t depth_max;         /* deepest sampled queue in the current report interval */
+    uint32_t status;            /* CBS_SHM_TC_* */
+    uint32_t reserved;
+} cbs_shm_tc_t;
+
+/* Per Port Statistics */
+typedef struct {
+    uint64_t tx_octets;
+    uint64_t rx_octets;
+    uint64_t tx_frames;
+    uint64_t rx_frames;
+    uint64_t drops;
+    double tx_bps;
+    double rx_bps;
+    uint32_t status;            /* device port status word; LAN9662: bit q = TC q shaped */
+    uint32_t reserved;
+    cbs_shm_tc_t tc[CBS_SHM_NUM_TCS];
+} cbs_shm_port_t;
+
+/* Published Data (everything the seqlock protects) */
+typedef struct {
+    uint64_t update_ns;         /* CLOCK_MONOTONIC of the last publish */
+    uint64_t publishes;
+    uint32_t n_ports;
+    uint32_t reserved;
+    cbs_shm_port_t ports[CBS_SHM_MAX_PORTS];
+} cbs_shm_data_t;
+
+/* Segment Layout */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;              /* sizeof(cbs_shm_segment_t) of the writer */
+    uint32_t writer_pid;
+    _Alignas(64) uint64_t seq;  /* odd while the writer is updating */
+    _Alignas(64) cbs_shm_data_t data;
+} cbs_shm_segment_t;
+
+/* Mapped Segment (writer or reader side) */
+typedef struct {
+    cbs_shm_segment_t *seg;
+    char name[64];
+    int writer;
+} cbs_shm_t;
+
+/**
+ * Create (or take over) the segment as its single writer
+ * @param shm: Handle
+ * @param name: Shared-memory object name, NULL for CBS_SHM_NAME
+ * @param n_ports: Number of ports published (max CBS_SHM_MAX_PORTS)
+ * @return: 0 on success, negative on error
+ */
+int cbs_shm_create(cbs_shm_t *shm, const char *name, uint32_t n_ports);
+
+/**
+ * Map an existing segment read-only
+ * @param shm: Handle
+ * @param name: Shared-memory object name, NULL for CBS_SHM_NAME
+ * @return: 0 on success, -ENOENT if not published, -EPROTO on layout mismatch
+ */
+int cbs_shm_open(cbs_shm_t *shm, const char *name);
+
+/**
+ * Unmap the segment; the writer also removes the name
+ * @param shm: Handle
+ */
+void cbs_shm_close(cbs_shm_t *shm);
+
+/**
+ * Start an update; readers retry until cbs_shm_end
+ * @param shm: Writer handle
+ * @return: Data to update in place
+ */
+static inline cbs_shm_data_t *cbs_shm_begin(cbs_shm_t *shm) {
+    __atomic_store_n(&shm->seg->seq, shm->seg->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return &shm->seg->data;
+}
+
+/**
+ * Finish an update and publish it
+ * @param shm: Writer handle
+ * @param now_ns: CLOCK_MONOTONIC timestamp of the data
+ */
+static inline void cbs_shm_end(cbs_shm_t *shm, uint64_t now_ns) {
+    shm->seg->data.update_ns = now_ns;
+    shm->seg->data.publishes++;
+    __atomic_store_n(&shm->seg->seq, shm->seg->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Copy a consistent snapshot of the whole segment
+ * @param shm: Reader handle
+ * @param out: Snapshot
+ * @return: Number of retries (>= 0), -EAGAIN if the writer stalled mid-update
+ */
+int cbs_shm_snapshot(const cbs_shm_t *shm, cbs_shm_data_t *out);
+
+/**
+ * Copy a consistent snapshot of one port
+ * @param shm: Reader handle
+ * @param port: Port index
+ * @param out: Port statistics
+ * @param update_ns: Publish time of the copy (may be NULL)
+ * @return: Number of retries (>= 0), -EINVAL for a bad port, -EAGAIN on a stalled writer
+ */
+int cbs_shm_read_port(const cbs_shm_t *shm, uint32_t port, cbs_shm_port_t *out, uint64_t *update_ns);
+
+#endif /* CBS_SHM_H */
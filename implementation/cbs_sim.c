@@ -0,0 +1,268 @@
+/**
+ * Discrete-event IEEE 802.1Qav credit-based shaper simulator
+ * Ports are independent: each advances its own clock from one
+ * transmission decision to the next (link free, a blocked class reaching
+ * zero credit, or an arrival), so a frame costs O(traffic classes)
+ */
+
+#include "cbs_sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#define PICOBITS_PER_BYTE           (8 * CBS_SIM_PS_PER_SEC)
+
+/* Put the head frame of a class on the wire at the port's clock */
+static void transmit(cbs_sim_t *sim, cbs_sim_port_t *p, int tc) {
+    uint64_t tx;
+    cbs_sim_entry_t e = cbs_sim_dequeue(p, tc, sim->wire_overhead, &tx);
+    uint64_t end = p->busy_until_ps;
+    uint64_t delay_ns = (end - e.t_ps) / 1000;
+
+    p->tc[tc].frames++;
+    p->tc[tc].bytes += e.bytes;
+    cbs_hist_record(&sim->streams[e.stream].delay_ns,
+                    delay_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)delay_ns);
+    if (end > sim->end_ps) {
+        sim->end_ps = end;
+    }
+}
+
+/* Make every transmission decision of a port up to time t */
+static void port_run_until(cbs_sim_t *sim, cbs_sim_port_t *p, uint64_t t) {
+    for (;;) {
+        uint64_t wake = UINT64_MAX;
+        int sel;
+
+        if (p->busy_until_ps > p->now_ps) {
+            if (p->busy_until_ps > t) {
+                return;
+            }
+            p->now_ps = p->busy_until_ps;
+        }
+
+        /* Strict priority among classes that are not blocked by negative credit */
+        sel = cbs_sim_select(p, &wake);
+        if (sel >= 0) {
+            transmit(sim, p, sel);
+        } else if (wake != UINT64_MAX && wake <= t) {
+            p->now_ps = wake;
+        } else {
+            /* Idle until t; a frame arriving then cannot go out earlier */
+            if (t != UINT64_MAX && t > p->now_ps) {
+                p->now_ps = t;
+            }
+            return;
+        }
+    }
+}
+
+int cbs_sim_init(cbs_sim_t *sim, const switch_config_t *config, uint32_t queue_bytes,
+                 uint32_t wire_overhead) {
+    uint32_t capacity = 1;
+
+    if (sim == NULL || config == NULL) {
+        return -EINVAL;
+    }
+    if (queue_bytes == 0) {
+        queue_bytes = CBS_SIM_DEFAULT_QUEUE_BYTES;
+    }
+
+    memset(sim, 0, sizeof(*sim));
+    sim->queue_bytes = queue_bytes;
+    sim->wire_overhead = wire_overhead;
+    for (uint32_t s = 0; s < CBS_SIM_MAX_STREAMS; s++) {
+        cbs_hist_reset(&sim->streams[s].delay_ns);
+    }
+
+    /* Every queued frame takes at least CBS_SIM_MIN_FRAME bytes of the limit */
+    while (capacity < queue_bytes / CBS_SIM_MIN_FRAME + 1) {
+        capacity <<= 1;
+    }
+
+    for (int port = 0; port < NUM_PORTS; port++) {
+        const port_cbs_config_t *pc = &config->ports[port];
+        cbs_sim_port_t *p = &sim->ports[port];
+
+        if (pc->port_speed == 0) {
+            cbs_sim_destroy(sim);
+            return -EINVAL;
+        }
+        p->rate = pc->port_speed;
+
+        for (int tc = 0; tc < MAX_TRAFFIC_CLASSES; tc++) {
+            const cbs_config_t *cfg = &pc->tc_config[tc];
+            cbs_sim_tc_t *q = &p->tc[tc];
+
+            q->ring = malloc(capacity * sizeof(cbs_sim_entry_t));
+            if (q->ring == NULL) {
+                cbs_sim_destroy(sim);
+                return -ENOMEM;
+            }
+            q->mask = capacity - 1;
+
+            if (!cfg->enabled) {
+                continue;
+            }
+            if (cfg->idle_slope == 0 || cfg->idle_slope > p->rate) {
+                cbs_sim_destroy(sim);
+                return -EINVAL;
+            }
+            q->shaped = true;
+            q->idle_slope = cfg->idle_slope;
+            q->send_slope = cfg->send_slope ? cfg->send_slope : p->rate - cfg->idle_slope;
+            q->hi_credit = (int64_t)(cfg->hi_credit < CBS_SIM_MAX_CREDIT ?
+                                     cfg->hi_credit : CBS_SIM_MAX_CREDIT) * PICOBITS_PER_BYTE;
+            q->lo_credit = (int64_t)(cfg->lo_credit < CBS_SIM_MAX_CREDIT ?
+                                     cfg->lo_credit : CBS_SIM_MAX_CREDIT) * PICOBITS_PER_BYTE;
+        }
+    }
+    return 0;
+}
+
+void cbs_sim_destroy(cbs_sim_t *sim) {
+    for (int port = 0; port < NUM_PORTS; port++) {
+        for (int tc = 0; tc < MAX_TRAFFIC_CLASSES; tc++) {
+            free(sim->ports[port].tc[tc].ring);
+            sim->ports[port].tc[tc].ring = NULL;
+        }
+    }
+}
+
+int cbs_sim_frame(cbs_sim_t *sim, const cbs_sim_frame_t *frame) {
+    cbs_sim_port_t *p;
+    cbs_sim_tc_t *q;
+    cbs_sim_stream_t *s;
+    uint32_t bytes = frame->bytes < CBS_SIM_MIN_FRAME ? CBS_SIM_MIN_FRAME : frame->bytes;
+    uint64_t t = frame->t_ps;
+
+    if (frame->port >= NUM_PORTS || frame->tc >= MAX_TRAFFIC_CLASSES ||
+        frame->stream >= CBS_SIM_MAX_STREAMS) {
+        return -EINVAL;
+    }
+    p = &sim->ports[frame->port];
+    q = &p->tc[frame->tc];
+    s = &sim->streams[frame->stream];
+
+    if (t < p->now_ps) {
+        sim->late++;
+        t = p->now_ps;
+    }
+    port_run_until(sim, p, t);
+
+    /* Credit up to the arrival under the old (empty or not) queue state */
+    cbs_sim_credit_advance(q, t);
+
+    s->frames++;
+    s->bytes += bytes;
+    s->port = frame->port;
+    s->tc = frame->tc;
+    if (q->queued_bytes + bytes > sim->queue_bytes) {
+        s->drops++;
+        q->drops++;
+        return 0;
+    }
+
+    q->ring[q->tail++ & q->mask] = (cbs_sim_entry_t){ .t_ps = t, .bytes = bytes, .stream = frame->stream };
+    q->queued_bytes += bytes;
+    if (q->queued_bytes > q->max_queued_bytes) {
+        q->max_queued_bytes = q->queued_bytes;
+    }
+    p->backlog |= 1u << frame->tc;
+    return 1;
+}
+
+void cbs_sim_finish(cbs_sim_t *sim) {
+    for (int port = 0; port < NUM_PORTS; port++) {
+        port_run_until(sim, &sim->ports[port], UINT64_MAX);
+    }
+}
+
+/* xorshift64* */
+static inline uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+int64_t cbs_sim_run(cbs_sim_t *sim, const cbs_sim_source_t *sources, uint32_t n_sources,
+                    uint64_t duration_ps, uint64_t seed) {
+    uint64_t *next, *burst_start, *period, *spacing;
+    uint32_t *sent;
+    uint64_t rng = seed ? seed : 1;
+    int64_t offered = 0;
+
+    next = calloc(n_sources ? n_sources : 1, 4 * sizeof(uint64_t) + sizeof(uint32_t));
+    if (next == NULL) {
+        return -ENOMEM;
+    }
+    burst_start = next + n_sources;
+    period = burst_start + n_sources;
+    spacing = period + n_sources;
+    sent = (uint32_t *)(spacing + n_sources);
+
+    for (uint32_t i = 0; i < n_sources; i++) {
+        const cbs_sim_source_t *src = &sources[i];
+
+        if (src->port >= NUM_PORTS || src->tc >= MAX_TRAFFIC_CLASSES ||
+            src->stream >= CBS_SIM_MAX_STREAMS || src->rate == 0 ||
+            src->frame_bytes == 0 || src->burst == 0) {
+            free(next);
+            return -EINVAL;
+        }
+        /* Mean burst interval that yields the average rate */
+        period[i] = (uint64_t)((double)src->burst * src->frame_bytes * 8 * CBS_SIM_PS_PER_SEC / src->rate);
+        spacing[i] = cbs_sim_tx_ps(sim->ports[src->port].rate, src->frame_bytes + sim->wire_overhead);
+        next[i] = burst_start[i] = src->start_ps;
+    }
+
+    for (;;) {
+        const cbs_sim_source_t *src;
+        cbs_sim_frame_t frame;
+        uint32_t i = 0;
+
+        if (n_sources == 0) {
+            break;
+        }
+        for (uint32_t j = 1; j < n_sources; j++) {
+            if (next[j] < next[i]) {
+                i = j;
+            }
+        }
+        if (next[i] > duration_ps) {
+            break;
+        }
+        src = &sources[i];
+
+        frame.t_ps = next[i];
+        frame.bytes = src->frame_bytes;
+        frame.stream = src->stream;
+        frame.port = src->port;
+        frame.tc = src->tc;
+        cbs_sim_frame(sim, &frame);
+        offered++;
+
+        if (++sent[i] < src->burst) {
+            next[i] += spacing[i];
+            continue;
+        }
+        sent[i] = 0;
+        if (src->poisson) {
+            double u = ((next_random(&rng) >> 11) + 0.5) / 9007199254740992.0;
+            burst_start[i] += (uint64_t)(-log(u) * period[i]);
+        } else {
+            burst_start[i] += period[i];
+        }
+        /* A burst cannot start before the previous one has left the source */
+        next[i] = burst_start[i] > next[i] + spacing[i] ? burst_start[i] : next[i] + spacing[i];
+    }
+
+    free(next);
+    cbs_sim_finish(sim);
+    return offered;
+}
@@ -0,0 +1,283 @@
+/**
+ * Discrete-event IEEE 802.1Qav credit-based shaper simulator
+ * Models the egress queues of every port in a switch_config_t: eight
+ * FIFO traffic classes per port in strict priority (TC7 highest), with
+ * the programmed idleSlope/sendSlope/hiCredit/loCredit applied to each
+ * enabled class. Frames are fed in arrival order and the simulator
+ * reports per-stream delay distributions and tail drops, so a
+ * reservation can be checked before it is programmed into hardware.
+ *
+ * Time is kept in picoseconds and credit in picobits (1e-12 bit), so a
+ * rate in bps changes the credit by exactly rate picobits per ps and
+ * every standard port speed has an integer per-byte transmit time. No
+ * rounding accumulates over a run.
+ */
+
+#ifndef CBS_SIM_H
+#define CBS_SIM_H
+
+#include <stdint.h>
+#include "lan9692_cbs.h"
+#include "cbs_hist.h"
+
+#define CBS_SIM_MAX_STREAMS         256
+#define CBS_SIM_DEFAULT_QUEUE_BYTES (128u * 1024)   /* tail-drop limit per TC */
+#define CBS_SIM_WIRE_OVERHEAD       20          /* preamble + SFD + inter-frame gap */
+#define CBS_SIM_MIN_FRAME           64
+#define CBS_SIM_MAX_CREDIT          1000000     /* bytes; hi/loCredit are clamped to this */
+#define CBS_SIM_PS_PER_SEC          1000000000000ULL
+
+/* One Frame Arrival */
+typedef struct {
+    uint64_t t_ps;              /* arrival at the egress queue */
+    uint32_t bytes;             /* frame length without wire overhead */
+    uint16_t stream;            /* < CBS_SIM_MAX_STREAMS */
+    uint8_t port;
+    uint8_t tc;
+} cbs_sim_frame_t;
+
+/* Queued Frame */
+typedef struct {
+    uint64_t t_ps;
+    uint32_t bytes;
+    uint16_t stream;
+    uint16_t reserved;
+} cbs_sim_entry_t;
+
+/* Traffic Class State */
+typedef struct {
+    cbs_sim_entry_t *ring;      /* FIFO, capacity mask + 1 */
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t queued_bytes;
+    bool shaped;
+    uint64_t idle_slope;        /* bps */
+    uint64_t send_slope;        /* bps, magnitude */
+    int64_t hi_credit;          /* picobits */
+    int64_t lo_credit;          /* picobits, magnitude */
+    int64_t credit;             /* picobits */
+    uint64_t credit_ps;         /* time the credit is valid at */
+    /* Statistics */
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t drops;
+    uint32_t max_queued_bytes;
+    int64_t min_credit;
+    int64_t max_credit;
+} cbs_sim_tc_t;
+
+/* Egress Port State */
+typedef struct {
+    uint64_t rate;              /* bps */
+    uint64_t now_ps;            /* last decision point */
+    uint64_t busy_until_ps;     /* end of the frame on the wire */
+    uint64_t busy_ps;           /* total transmit time */
+    uint32_t backlog;           /* bit tc = queue not empty */
+    cbs_sim_tc_t tc[MAX_TRAFFIC_CLASSES];
+} cbs_sim_port_t;
+
+/* Per-Stream Results */
+typedef struct {
+    uint64_t frames;            /* offered */
+    uint64_t bytes;
+    uint64_t drops;
+    uint8_t port;               /* of the last frame offered */
+    uint8_t tc;
+    cbs_hist_t delay_ns;        /* arrival to last bit on the wire */
+} cbs_sim_stream_t;
+
+/* Simulator */
+typedef struct {
+    cbs_sim_port_t ports[NUM_PORTS];
+    cbs_sim_stream_t streams[CBS_SIM_MAX_STREAMS];
+    uint32_t queue_bytes;       /* tail-drop limit per TC */
+    uint32_t wire_overhead;     /* bytes added to every frame on the wire */
+    uint64_t late;              /* arrivals earlier than their port's clock */
+    uint64_t end_ps;            /* last departure */
+} cbs_sim_t;
+
+/* Synthetic Source: bursts of frames, periodic or Poisson */
+typedef struct {
+    uint8_t port;
+    uint8_t tc;
+    uint16_t stream;
+    uint64_t rate;              /* average bps, frame bytes only */
+    uint32_t frame_bytes;
+    uint32_t burst;             /* frames per burst, back to back at port rate */
+    bool poisson;               /* exponential gaps between bursts */
+    uint64_t start_ps;
+} cbs_sim_source_t;
+
+/**
+ * Prepare a simulation of the egress side of a switch configuration
+ * @param sim: Simulator
+ * @param config: Configuration the driver would program
+ * @param queue_bytes: Tail-drop limit per traffic class, 0 for the default
+ * @param wire_overhead: Bytes of preamble/IFG per frame (CBS_SIM_WIRE_OVERHEAD)
+ * @return: 0 on success, -EINVAL for a bad configuration, -ENOMEM
+ */
+int cbs_sim_init(cbs_sim_t *sim, const switch_config_t *config, uint32_t queue_bytes,
+                 uint32_t wire_overhead);
+
+/**
+ * Release the queues
+ * @param sim: Simulator
+ */
+void cbs_sim_destroy(cbs_sim_t *sim);
+
+/**
+ * Offer one frame; arrivals must be in time order per port (earlier
+ * frames are counted in late and enqueued at the port's clock)
+ * @param sim: Simulator
+ * @param frame: Arrival
+ * @return: 1 if queued, 0 if tail dropped, -EINVAL for a bad port/TC/stream
+ */
+int cbs_sim_frame(cbs_sim_t *sim, const cbs_sim_frame_t *frame);
+
+/**
+ * Transmit everything still queued
+ * @param sim: Simulator
+ */
+void cbs_sim_finish(cbs_sim_t *sim);
+
+/**
+ * Generate traffic from synthetic sources for a duration and finish
+ * @param sim: Simulator
+ * @param sources: Sources (start_ps, rate and frame size set)
+ * @param n_sources: Number of sources
+ * @param duration_ps: Last arrival time
+ * @param seed: Random seed for Poisson sources
+ * @return: Frames offered, negative on error
+ */
+int64_t cbs_sim_run(cbs_sim_t *sim, const cbs_sim_source_t *sources, uint32_t n_sources,
+                    uint64_t duration_ps, uint64_t seed);
+
+/**
+ * Wire time of a frame on a port
+ * @param rate: Port rate in bps
+ * @param bytes: Bytes on the wire
+ * @return: Picoseconds, rounded up
+ */
+static inline uint64_t cbs_sim_tx_ps(uint64_t rate, uint32_t bytes) {
+    return ((uint64_t)bytes * 8 * CBS_SIM_PS_PER_SEC + rate - 1) / rate;
+}
+
+/*
+ * Credit rules, shared with tools that schedule a port in real time
+ * (cbs_sender): they keep a cbs_sim_port_t, fill its class rings
+ * themselves and take one transmission decision at a time.
+ */
+
+/**
+ * credit + slope * dt, saturating at limit
+ * @param credit: Picobits, at most limit
+ * @param limit: Picobits
+ * @param slope: bps (picobits per ps)
+ * @param dt: ps
+ * @return: Picobits
+ */
+static inline int64_t cbs_sim_credit_add(int64_t credit, int64_t limit, uint64_t slope, uint64_t dt) {
+    uint64_t room;
+
+    if (credit >= limit) {
+        return limit;
+    }
+    room = (uint64_t)limit - (uint64_t)credit;
+    if (dt > room / slope) {
+        return limit;
+    }
+    return credit + (int64_t)(slope * dt);
+}
+
+/**
+ * Bring a class's credit up to now: it accrues at idleSlope while frames
+ * wait (up to hiCredit), recovers toward zero when the queue is empty,
+ * and positive credit is dropped once the queue has drained
+ * @param q: Traffic class
+ * @param now: ps; no effect before q->credit_ps (its frame is still on the wire)
+ */
+static inline void cbs_sim_credit_advance(cbs_sim_tc_t *q, uint64_t now) {
+    uint64_t dt;
+
+    if (!q->shaped || now < q->credit_ps) {
+        return;
+    }
+    dt = now - q->credit_ps;
+    q->credit_ps = now;
+
+    if (q->head == q->tail) {
+        if (q->credit > 0) {
+            q->credit = 0;
+        } else if (q->credit < 0) {
+            q->credit = cbs_sim_credit_add(q->credit, 0, q->idle_slope, dt);
+        }
+    } else {
+        q->credit = cbs_sim_credit_add(q->credit, q->hi_credit, q->idle_slope, dt);
+        if (q->credit > q->max_credit) {
+            q->max_credit = q->credit;
+        }
+    }
+}
+
+/**
+ * Strict priority among the backlogged classes not blocked by negative credit
+ * @param p: Port, at its decision point p->now_ps
+ * @param wake: In/out: lowered to the time the first blocked class reaches zero credit
+ * @return: Class to transmit at p->now_ps, -1 if every backlogged class is blocked
+ */
+static inline int cbs_sim_select(cbs_sim_port_t *p, uint64_t *wake) {
+    for (uint32_t pending = p->backlog; pending; ) {
+        int tc = 31 - __builtin_clz(pending);
+        cbs_sim_tc_t *q = &p->tc[tc];
+        uint64_t w;
+
+        cbs_sim_credit_advance(q, p->now_ps);
+        if (!q->shaped || q->credit >= 0) {
+            return tc;
+        }
+        w = q->credit_ps + ((uint64_t)-q->credit + q->idle_slope - 1) / q->idle_slope;
+        if (w < *wake) {
+            *wake = w;
+        }
+        pending &= ~(1u << tc);
+    }
+    return -1;
+}
+
+/**
+ * Put the head frame of a class on the wire at p->now_ps: sendSlope for
+ * its transmit time, bounded by loCredit, and the port busy until its end
+ * @param p: Port
+ * @param tc: Class returned by cbs_sim_select
+ * @param wire_overhead: Bytes added to the frame on the wire
+ * @param tx_ps: Output, transmit time
+ * @return: The frame
+ */
+static inline cbs_sim_entry_t cbs_sim_dequeue(cbs_sim_port_t *p, int tc, uint32_t wire_overhead,
+                                              uint64_t *tx_ps) {
+    cbs_sim_tc_t *q = &p->tc[tc];
+    cbs_sim_entry_t e = q->ring[q->head++ & q->mask];
+    uint64_t tx = cbs_sim_tx_ps(p->rate, e.bytes + wire_overhead);
+
+    q->queued_bytes -= e.bytes;
+    if (q->head == q->tail) {
+        p->backlog &= ~(1u << tc);
+    }
+    if (q->shaped) {
+        q->credit -= (int64_t)(q->send_slope * tx);
+        if (q->credit < -q->lo_credit) {
+            q->credit = -q->lo_credit;
+        }
+        if (q->credit < q->min_credit) {
+            q->min_credit = q->credit;
+        }
+        q->credit_ps = p->now_ps + tx;
+    }
+    p->busy_until_ps = p->now_ps + tx;
+    p->busy_ps += tx;
+    *tx_ps = tx;
+    return e;
+}
+
+#endif /* CBS_SIM_H */
@@ -0,0 +1,448 @@
+/**
+ * Offline CBS reservation check
+ * Builds the switch configuration of a main.c test scenario with the
+ * driver's own calculator, then runs synthetic or captured traffic
+ * through the 802.1Qav simulator (cbs_sim) and reports per-stream delay
+ * and loss next to the analytic worst-case bound. Wireshark captures
+ * are classified with the PCP/VLAN tables the driver programs for the
+ * scenario and replayed straight from the mapped file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include "lan9692_cbs.h"
+#include "cbs_calc.h"
+#include "cbs_sim.h"
+#include "cbs_pcap.h"
+
+#define DEFAULT_BE_MBPS             900     /* best-effort load on each sink port */
+#define VIDEO_STREAM_MBPS           15      /* main.c video streams */
+#define VIDEO_BURST_FRAMES          4       /* frames per video burst */
+#define MAX_SOURCES                 64
+#define ETH_FCS_LEN                 4       /* captures end before the FCS */
+
+static cbs_sim_t sim;
+static char labels[CBS_SIM_MAX_STREAMS][32];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Switch configuration of main.c scenario 1 (CBS off), 2 (20 Mbps) or 3 (30 Mbps) */
+static int build_scenario_config(int scenario, switch_config_t *config) {
+    uint32_t reservation = (scenario == 3) ? 30 : 20;
+
+    memset(config, 0, sizeof(*config));
+    config->vlan_enabled = true;
+    config->ptp_enabled = true;
+    for (int port = 0; port < NUM_PORTS; port++) {
+        config->ports[port].port_id = port;
+        config->ports[port].port_speed = PORT_SPEED_1GBPS;
+    }
+    if (scenario < 1 || scenario > 3) {
+        return -EINVAL;
+    }
+
+    lan9692_cbs_calculate(reservation, PORT_SPEED_1GBPS, CBS_MAX_FRAME_SIZE,
+                          &config->ports[1].tc_config[TC_VIDEO_STREAM_1], NULL);
+    lan9692_cbs_calculate(reservation, PORT_SPEED_1GBPS, CBS_MAX_FRAME_SIZE,
+                          &config->ports[2].tc_config[TC_VIDEO_STREAM_2], NULL);
+
+    /* Scenario 1 disables the shapers, leaving strict priority */
+    if (scenario == 1) {
+        config->ports[1].tc_config[TC_VIDEO_STREAM_1].enabled = false;
+        config->ports[2].tc_config[TC_VIDEO_STREAM_2].enabled = false;
+    }
+    return 0;
+}
+
+/* Video streams on the sink ports plus Poisson best-effort load */
+static uint32_t default_sources(cbs_sim_source_t *src, uint32_t be_mbps) {
+    uint32_t n = 0;
+
+    for (int port = 1; port <= 2; port++) {
+        src[n] = (cbs_sim_source_t){
+            .port = port, .tc = (port == 1) ? TC_VIDEO_STREAM_1 : TC_VIDEO_STREAM_2,
+            .stream = n, .rate = VIDEO_STREAM_MBPS * 1000000ULL,
+            .frame_bytes = CBS_MAX_FRAME_SIZE, .burst = VIDEO_BURST_FRAMES,
+        };
+        snprintf(labels[n], sizeof(labels[n]), "video %d", port);
+        n++;
+    }
+    if (be_mbps > 0) {
+        for (int port = 1; port <= 2; port++) {
+            src[n] = (cbs_sim_source_t){
+                .port = port, .tc = TC_BEST_EFFORT, .stream = n,
+                .rate = be_mbps * 1000000ULL, .frame_bytes = CBS_MAX_FRAME_SIZE,
+                .burst = 1, .poisson = true,
+            };
+            snprintf(labels[n], sizeof(labels[n]), "best effort %d", port);
+            n++;
+        }
+    }
+    return n;
+}
+
+/* port:tc:mbps:bytes[:burst[:p]] */
+static int parse_source(const char *arg, cbs_sim_source_t *src, uint16_t stream) {
+    unsigned port, tc, bytes, burst = 1;
+    double mbps;
+    char mode = 0;
+
+    if (sscanf(arg, "%u:%u:%lf:%u:%u:%c", &port, &tc, &mbps, &bytes, &burst, &mode) < 4 ||
+        port >= NUM_PORTS || tc >= MAX_TRAFFIC_CLASSES || mbps <= 0 ||
+        bytes < CBS_SIM_MIN_FRAME || bytes > CBS_CALC_MAX_FRAME || burst == 0) {
+        return -EINVAL;
+    }
+    *src = (cbs_sim_source_t){
+        .port = port, .tc = tc, .stream = stream, .rate = (uint64_t)(mbps * 1e6),
+        .frame_bytes = bytes, .burst = burst, .poisson = (mode == 'p'),
+    };
+    snprintf(labels[stream], sizeof(labels[stream]), "P%u TC%u %g%s", port, tc, mbps,
+             mode == 'p' ? "M poisson" : "M");
+    return 0;
+}
+
+/* Captured arrivals, one per line: t_ns,port,tc,bytes[,stream] */
+static int64_t replay_csv(const char *path) {
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    int64_t frames = 0;
+
+    if (fp == NULL) {
+        return -errno;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long long t_ns;
+        unsigned port, tc, bytes, stream = UINT32_MAX;
+        cbs_sim_frame_t frame;
+
+        if (sscanf(line, "%llu,%u,%u,%u,%u", &t_ns, &port, &tc, &bytes, &stream) < 4) {
+            continue;           /* header or comment */
+        }
+        if (port >= NUM_PORTS || tc >= MAX_TRAFFIC_CLASSES) {
+            fprintf(stderr, "%s: bad port/tc at %llu ns\n", path, t_ns);
+            fclose(fp);
+            return -EINVAL;
+        }
+        if (stream == UINT32_MAX) {
+            stream = port * MAX_TRAFFIC_CLASSES + tc;
+        }
+        frame = (cbs_sim_frame_t){
+            .t_ps = t_ns * 1000, .bytes = bytes, .stream = stream, .port = port, .tc = tc,
+        };
+        if (cbs_sim_frame(&sim, &frame) < 0) {
+            fprintf(stderr, "%s: bad frame at %llu ns\n", path, t_ns);
+            fclose(fp);
+            return -EINVAL;
+        }
+        if (labels[stream][0] == '\0') {
+            snprintf(labels[stream], sizeof(labels[stream]), "P%u TC%u #%u", port, tc, stream);
+        }
+        frames++;
+    }
+    fclose(fp);
+    cbs_sim_finish(&sim);
+    return frames;
+}
+
+/*
+ * Analytic worst case (cbs_calc) of the shaped class a stream uses, with
+ * the frame sizes and bursts actually offered; 0 if not applicable
+ */
+static uint64_t stream_bound_ns(const switch_config_t *config, const cbs_sim_source_t *src,
+                                uint32_t n_sources, const cbs_sim_source_t *s) {
+    const port_cbs_config_t *pc = &config->ports[s->port];
+    cbs_calc_class_t cls = {
+        .port_rate = pc->port_speed,
+        .idle_slope = pc->tc_config[s->tc].idle_slope,
+    };
+    cbs_calc_result_t result;
+    uint32_t higher_seen = 0;
+
+    if (!pc->tc_config[s->tc].enabled) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < n_sources; i++) {
+        uint32_t wire = src[i].frame_bytes + sim.wire_overhead;
+
+        if (src[i].port != s->port) continue;
+        if (src[i].tc == s->tc) {
+            if (wire > cls.max_frame) cls.max_frame = wire;
+            cls.burst += src[i].burst * wire;
+        } else if (src[i].tc < s->tc) {
+            if (wire > cls.max_interference) cls.max_interference = wire;
+        } else if (!pc->tc_config[src[i].tc].enabled) {
+            return 0;           /* unshaped higher class: no bound */
+        } else {
+            if (!(higher_seen & (1u << src[i].tc))) {
+                cls.higher_idle_slope += pc->tc_config[src[i].tc].idle_slope;
+                higher_seen |= 1u << src[i].tc;
+            }
+            if (wire > cls.higher_max_frame) cls.higher_max_frame = wire;
+        }
+    }
+    return cbs_calc(&cls, &result) == 0 ? result.max_delay_ns : 0;
+}
+
+static void print_report(const switch_config_t *config, const cbs_sim_source_t *src,
+                         uint32_t n_sources) {
+    double seconds = sim.end_ps / 1e12;
+
+    for (int port = 0; port < NUM_PORTS; port++) {
+        const cbs_sim_port_t *p = &sim.ports[port];
+
+        if (p->busy_ps == 0) continue;
+        printf("Port %d: %llu Mbps, %.1f%% busy\n", port, (unsigned long long)(p->rate / 1000000),
+               100.0 * p->busy_ps / sim.end_ps);
+        for (int tc = MAX_TRAFFIC_CLASSES - 1; tc >= 0; tc--) {
+            const cbs_sim_tc_t *q = &p->tc[tc];
+
+            if (q->frames == 0 && q->drops == 0) continue;
+            if (q->shaped) {
+                printf("  TC%d  CBS idle %7llu kbps  hi %5u B  lo %5u B  credit %+.0f..%+.0f B",
+                       tc, (unsigned long long)(q->idle_slope / 1000),
+                       config->ports[port].tc_config[tc].hi_credit,
+                       config->ports[port].tc_config[tc].lo_credit,
+                       q->min_credit / 8e12, q->max_credit / 8e12);
+            } else {
+                printf("  TC%d  strict priority %-48s", tc, "");
+            }
+            printf("  queue max %7u B  %10llu frames  %8llu drops\n", q->max_queued_bytes,
+                   (unsigned long long)q->frames, (unsigned long long)q->drops);
+        }
+    }
+
+    printf("\n%-22s %4s %2s %8s %10s %8s %7s %9s %9s %9s %9s %9s\n", "stream", "port", "tc",
+           "Mbps", "frames", "drops", "loss %", "p50 us", "p99 us", "p99.9 us", "max us", "bound us");
+    for (uint32_t s = 0; s < CBS_SIM_MAX_STREAMS; s++) {
+        cbs_sim_stream_t *st = &sim.streams[s];
+        cbs_hist_summary_t sum;
+        uint64_t bound = 0;
+
+        if (st->frames == 0) continue;
+        for (uint32_t i = 0; i < n_sources; i++) {
+            if (src[i].stream == s) {
+                bound = stream_bound_ns(config, src, n_sources, &src[i]);
+            }
+        }
+        cbs_hist_summarize(&st->delay_ns, &sum, 0);
+        printf("%-22s %4d %2d %8.2f %10llu %8llu %7.3f %9.1f %9.1f %9.1f %9.1f ",
+               labels[s], st->port, st->tc, seconds > 0 ? st->bytes * 8 / seconds / 1e6 : 0.0,
+               (unsigned long long)st->frames, (unsigned long long)st->drops,
+               100.0 * st->drops / st->frames, sum.p50 / 1e3, sum.p99 / 1e3, sum.p999 / 1e3,
+               sum.max / 1e3);
+        if (bound) {
+            printf("%9.1f%s\n", bound / 1e3, sum.max > bound ? "  EXCEEDED" : "");
+        } else {
+            printf("%9s\n", "-");
+        }
+    }
+}
+
+/*
+ * Classification tables of a scenario: run the driver's init on the
+ * simulated register file and read back what it programmed
+ */
+static int load_tc_tables(const switch_config_t *scenario, uint8_t *pcp_tc, uint8_t *vlan_tc) {
+    switch_config_t config = *scenario;
+    int ret;
+
+    config.reg_backend = "sim";
+    config.quiet = true;                    /* init reports every step it programs */
+    ret = lan9692_cbs_init(&config);
+    if (ret == 0) {
+        ret = lan9692_get_tc_tables(pcp_tc, vlan_tc);
+    }
+    lan9692_cbs_shutdown();
+    return ret;
+}
+
+/*
+ * Wireshark capture: every Ethernet frame goes to the TC the switch
+ * would pick (VLAN table entry if the VID is mapped, else the PCP table,
+ * best effort if untagged), on its scenario sink port or on port if >= 0;
+ * one stream per VID and PCP, the last stream id collects the VID/PCP
+ * pairs seen after all others are taken
+ */
+static int64_t replay_pcap(const char *path, int port, const switch_config_t *config) {
+    static uint8_t vlan_tc[LAN9692_NUM_VLANS];
+    static uint16_t stream_of[LAN9692_NUM_VLANS + 1][8];    /* id + 1, last row untagged */
+    uint8_t pcp_tc[8];
+    uint16_t n_streams = 0, n_other = 0;
+    uint64_t first_ns = 0, skipped = 0, other_frames = 0;
+    cbs_pcap_t pc;
+    cbs_pcap_frame_t f;
+    int64_t frames = 0;
+    int ret;
+
+    ret = load_tc_tables(config, pcp_tc, vlan_tc);
+    if (ret < 0) {
+        fprintf(stderr, "Cannot build the classification tables: %s\n", strerror(-ret));
+        return ret;
+    }
+    ret = cbs_pcap_open(&pc, path);
+    if (ret < 0) {
+        return ret;
+    }
+
+    while ((ret = cbs_pcap_next(&pc, &f)) > 0) {
+        uint8_t pcp = 0, tc = TC_BEST_EFFORT;
+        uint16_t vid = LAN9692_NUM_VLANS, *id;
+        cbs_sim_frame_t frame;
+
+        if (f.linktype != CBS_PCAP_LINKTYPE_ETHERNET) {
+            skipped++;
+            continue;
+        }
+        if (cbs_pcap_vlan(&f, &pcp, &vid)) {
+            tc = vlan_tc[vid] != LAN9692_TC_UNMAPPED ? vlan_tc[vid] : pcp_tc[pcp];
+        }
+        if (frames == 0) {
+            first_ns = f.t_ns;
+        }
+
+        id = &stream_of[vid][pcp];
+        if (*id == 0) {
+            if (n_streams < CBS_SIM_MAX_STREAMS - 1) {
+                *id = ++n_streams;
+            } else {
+                *id = CBS_SIM_MAX_STREAMS;
+                n_other++;
+            }
+        }
+        other_frames += (*id == CBS_SIM_MAX_STREAMS);
+        frame = (cbs_sim_frame_t){
+            .t_ps = (f.t_ns > first_ns ? f.t_ns - first_ns : 0) * 1000,
+            .bytes = f.len + ETH_FCS_LEN, .stream = *id - 1, .tc = tc,
+            .port = port >= 0 ? port : (tc == TC_VIDEO_STREAM_2 ? 2 : 1),
+        };
+        cbs_sim_frame(&sim, &frame);
+        if (labels[frame.stream][0] == '\0') {
+            if (*id == CBS_SIM_MAX_STREAMS) {
+                snprintf(labels[frame.stream], sizeof(labels[frame.stream]), "other");
+            } else if (vid == LAN9692_NUM_VLANS) {
+                snprintf(labels[frame.stream], sizeof(labels[frame.stream]), "untagged");
+            } else {
+                snprintf(labels[frame.stream], sizeof(labels[frame.stream]), "VID %u PCP %u", vid, pcp);
+            }
+        }
+        frames++;
+    }
+    cbs_pcap_close(&pc);
+    if (ret < 0) {
+        /* A capture cut short (killed dumpcap, full disk) is still worth replaying */
+        fprintf(stderr, "%s: truncated or malformed record after %lld frames, replaying those\n",
+                path, (long long)frames);
+    }
+    if (skipped) {
+        fprintf(stderr, "%s: %llu non-Ethernet frames skipped\n", path, (unsigned long long)skipped);
+    }
+    if (n_other) {
+        fprintf(stderr, "%s: %u VID/PCP streams past the first %d merged into \"other\" (%llu frames)\n",
+                path, n_other, CBS_SIM_MAX_STREAMS - 1, (unsigned long long)other_frames);
+    }
+    cbs_sim_finish(&sim);
+    return frames;
+}
+
+int main(int argc, char *argv[]) {
+    static cbs_sim_source_t sources[MAX_SOURCES];
+    switch_config_t config;
+    const char *replay = NULL, *capture = NULL;
+    uint32_t n_sources = 0, be_mbps = DEFAULT_BE_MBPS, queue_bytes = 0;
+    uint32_t overhead = CBS_SIM_WIRE_OVERHEAD;
+    uint64_t seed = 1, start;
+    double duration = 1.0;
+    int scenario = 2, capture_port = -1, opt, ret;
+    int64_t frames;
+
+    while ((opt = getopt(argc, argv, "s:d:t:b:r:c:p:q:o:S:h")) != -1) {
+        switch (opt) {
+        case 's': scenario = atoi(optarg); break;
+        case 'd': duration = atof(optarg); break;
+        case 'b': be_mbps = (uint32_t)atoi(optarg); break;
+        case 'r': replay = optarg; break;
+        case 'c': capture = optarg; break;
+        case 'p': capture_port = atoi(optarg); break;
+        case 'q': queue_bytes = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'o': overhead = (uint32_t)atoi(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 0); break;
+        case 't':
+            if (n_sources >= MAX_SOURCES || parse_source(optarg, &sources[n_sources], n_sources) < 0) {
+                fprintf(stderr, "Bad stream '%s' (port:tc:mbps:bytes[:burst[:p]])\n", optarg);
+                return 1;
+            }
+            n_sources++;
+            break;
+        default:
+            printf("Usage: %s [-s scenario] [-d seconds] [-t stream]... [-b mbps] [-r arrivals.csv]\n"
+                   "          [-c capture.pcap [-p port]] [-q queue_bytes] [-o overhead] [-S seed]\n", argv[0]);
+            printf("  -s  main.c scenario: 1 CBS off, 2 20 Mbps, 3 30 Mbps reservations (default 2)\n");
+            printf("  -d  Simulated time (default 1 s)\n");
+            printf("  -t  Stream port:tc:mbps:bytes[:burst[:p]], p = Poisson bursts; replaces the\n"
+                   "      default 15 Mbps video streams and best-effort load\n");
+            printf("  -b  Best-effort load per sink port in the default traffic (default %u Mbps)\n",
+                   DEFAULT_BE_MBPS);
+            printf("  -r  Replay captured arrivals, lines t_ns,port,tc,bytes[,stream]\n");
+            printf("  -c  Replay a pcap/pcapng capture, classified by the scenario's PCP/VLAN tables\n");
+            printf("  -p  Egress port of every captured frame (default: TC6 port 2, others port 1)\n");
+            printf("  -q  Tail-drop limit per traffic class (default %u B)\n", CBS_SIM_DEFAULT_QUEUE_BYTES);
+            printf("  -o  Wire overhead per frame (default %u B)\n", CBS_SIM_WIRE_OVERHEAD);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (capture_port >= NUM_PORTS) {
+        fprintf(stderr, "Port must be 0-%d\n", NUM_PORTS - 1);
+        return 1;
+    }
+    if (build_scenario_config(scenario, &config) < 0) {
+        fprintf(stderr, "Unknown scenario %d\n", scenario);
+        return 1;
+    }
+    ret = cbs_sim_init(&sim, &config, queue_bytes, overhead);
+    if (ret < 0) {
+        fprintf(stderr, "Failed to set up the simulation: %s\n", strerror(-ret));
+        return 1;
+    }
+
+    start = now_ns();
+    if (capture) {
+        frames = replay_pcap(capture, capture_port, &config);
+        n_sources = 0;
+    } else if (replay) {
+        frames = replay_csv(replay);
+        n_sources = 0;          /* no offered profile, so no bound */
+    } else {
+        if (n_sources == 0) {
+            n_sources = default_sources(sources, be_mbps);
+        }
+        frames = cbs_sim_run(&sim, sources, n_sources, (uint64_t)(duration * 1e12), seed);
+    }
+    if (frames < 0) {
+        fprintf(stderr, "Simulation failed: %s\n", strerror((int)-frames));
+        cbs_sim_destroy(&sim);
+        return 1;
+    }
+    start = now_ns() - start;
+
+    printf("=== CBS simulation: scenario %d, %.3f s simulated, %lld frames ===\n",
+           scenario, sim.end_ps / 1e12, (long long)frames);
+    printf("Simulated in %.1f ms (%.2f M frames/s)", start / 1e6,
+           start ? frames * 1e3 / start : 0.0);
+    if (sim.late) {
+        printf(", %llu arrivals out of order", (unsigned long long)sim.late);
+    }
+    printf("\n\n");
+    print_report(&config, sources, n_sources);
+
+    cbs_sim_destroy(&sim);
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * Shared-memory statistics reader
+ * Prints the per-port/per-TC counters published by the monitoring
+ * process (cbs_shm) without touching the device
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include "cbs_shm.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void print_port(uint32_t port, const cbs_shm_port_t *p, int all) {
+    if (!all && p->tx_frames == 0 && p->rx_frames == 0 && p->status == 0) {
+        return;
+    }
+
+    printf("Port %2u  TX %8.2f Mbps %12llu fr  RX %8.2f Mbps %12llu fr  drops %llu  status 0x%02x\n",
+           port, p->tx_bps / 1e6, (unsigned long long)p->tx_frames,
+           p->rx_bps / 1e6, (unsigned long long)p->rx_frames,
+           (unsigned long long)p->drops, p->status);
+
+    for (int q = CBS_SHM_NUM_TCS - 1; q >= 0; q--) {
+        const cbs_shm_tc_t *tc = &p->tc[q];
+        if (!all && tc->tx_frames == 0 && tc->drops == 0 && !(tc->status & CBS_SHM_TC_SHAPED)) {
+            continue;
+        }
+        printf("  TC%d  %8.2f Mbps %12llu fr  drops %-8llu idle %7u kbps  depth max %6u%s\n",
+               q, tc->tx_bps / 1e6, (unsigned long long)tc->tx_frames,
+               (unsigned long long)tc->drops, tc->idle_slope_kbps, tc->depth_max,
+               (tc->status & CBS_SHM_TC_SHAPED) ? "  [CBS]" : "");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = NULL;
+    int port = -1, all = 0, opt, ret;
+    uint64_t interval_ms = 0, count = 0;
+    static cbs_shm_data_t snap;
+    cbs_shm_t shm;
+
+    while ((opt = getopt(argc, argv, "n:p:i:c:ah")) != -1) {
+        switch (opt) {
+        case 'n': name = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'i': interval_ms = strtoull(optarg, NULL, 0); break;
+        case 'c': count = strtoull(optarg, NULL, 0); break;
+        case 'a': all = 1; break;
+        default:
+            printf("Usage: %s [-n name] [-p port] [-i interval_ms [-c count]] [-a]\n", argv[0]);
+            printf("  -n  Shared-memory object (default %s)\n", CBS_SHM_NAME);
+            printf("  -p  Only this port\n");
+            printf("  -i  Repeat every interval_ms until SIGINT or -c snapshots\n");
+            printf("  -a  Also print idle ports and queues\n");
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    ret = cbs_shm_open(&shm, name);
+    if (ret < 0) {
+        fprintf(stderr, "%s: %s\n", name ? name : CBS_SHM_NAME,
+                ret == -EPROTO ? "layout mismatch" : strerror(-ret));
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    for (uint64_t n = 0; running; n++) {
+        if (port >= 0) {
+            ret = cbs_shm_read_port(&shm, port, &snap.ports[port], &snap.update_ns);
+            snap.n_ports = port + 1;
+        } else {
+            ret = cbs_shm_snapshot(&shm, &snap);
+        }
+        if (ret < 0) {
+            fprintf(stderr, "snapshot failed: %s\n", strerror(-ret));
+            break;
+        }
+
+        printf("\n=== %s: writer pid %u, updated %.3f s ago, %llu publishes ===\n",
+               shm.name, shm.seg->writer_pid, (mono_ns() - snap.update_ns) / 1e9,
+               (unsigned long long)shm.seg->data.publishes);
+        for (uint32_t p = (port >= 0) ? (uint32_t)port : 0; p < snap.n_ports; p++) {
+            print_port(p, &snap.ports[p], all || port >= 0);
+        }
+
+        if (interval_ms == 0 || (count && n + 1 >= count)) {
+            break;
+        }
+        usleep(interval_ms * 1000);
+    }
+
+    cbs_shm_close(&shm);
+    return ret < 0 ? 1 : 0;
+}
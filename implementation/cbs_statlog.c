@@ -0,0 +1,120 @@
+/**
+ * Columnar binary statistics log
+ * The whole file is allocated up front and mapped once; appends are
+ * plain stores into the page cache, the kernel writes them back
+ */
+
+#include "cbs_statlog.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+_Static_assert(sizeof(cbs_statlog_header_t) <= CBS_STATLOG_HEADER_SIZE, "statlog header too large");
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t align_up(uint64_t v) {
+    return (v + CBS_STATLOG_ALIGN - 1) & ~(uint64_t)(CBS_STATLOG_ALIGN - 1);
+}
+
+static uint64_t add_column(cbs_statlog_header_t *hdr, const char *name,
+                           uint32_t elem_size, uint64_t offset) {
+    cbs_statlog_column_t *col = &hdr->columns[hdr->n_columns++];
+
+    snprintf(col->name, sizeof(col->name), "%s", name);
+    col->elem_size = elem_size;
+    col->offset = offset;
+    return align_up(offset + hdr->capacity * elem_size);
+}
+
+int cbs_statlog_create(cbs_statlog_t *log, const char *path, uint64_t capacity,
+                       uint64_t interval_ns, const char *const *ports, uint32_t n_ports,
+                       const char *const *counters, uint32_t n_counters) {
+    cbs_statlog_header_t hdr;
+    uint64_t offset = CBS_STATLOG_HEADER_SIZE;
+    int ret;
+
+    if (capacity == 0 || n_ports == 0 || n_ports > CBS_STATLOG_MAX_PORTS ||
+        n_counters > CBS_STATLOG_MAX_COLUMNS - CBS_STATLOG_COL_COUNTERS) {
+        return -EINVAL;
+    }
+
+    memset(log, 0, sizeof(*log));
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CBS_STATLOG_MAGIC, sizeof(hdr.magic));
+    hdr.version = CBS_STATLOG_VERSION;
+    hdr.capacity = capacity;
+    hdr.interval_ns = interval_ns;
+    hdr.start_mono_ns = clock_ns(CLOCK_MONOTONIC);
+    hdr.start_real_ns = clock_ns(CLOCK_REALTIME);
+    hdr.n_ports = n_ports;
+    for (uint32_t p = 0; p < n_ports; p++) {
+        snprintf(hdr.ports[p], sizeof(hdr.ports[p]), "%s", ports[p]);
+    }
+
+    offset = add_column(&hdr, "t_ns", sizeof(uint64_t), offset);
+    offset = add_column(&hdr, "port", sizeof(uint32_t), offset);
+    for (uint32_t c = 0; c < n_counters; c++) {
+        offset = add_column(&hdr, counters[c], sizeof(uint64_t), offset);
+    }
+
+    log->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (log->fd < 0) {
+        return -errno;
+    }
+
+    /* Reserve the blocks now so a full disk shows up here, not as SIGBUS later */
+    ret = posix_fallocate(log->fd, 0, offset);
+    if (ret != 0) {
+        close(log->fd);
+        return -ret;
+    }
+
+    log->map = mmap(NULL, offset, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+    if (log->map == MAP_FAILED) {
+        ret = -errno;
+        close(log->fd);
+        return ret;
+    }
+
+    log->size = offset;
+    log->hdr = (cbs_statlog_header_t *)log->map;
+    memcpy(log->hdr, &hdr, sizeof(hdr));
+    log->time = (uint64_t *)(log->map + hdr.columns[CBS_STATLOG_COL_TIME].offset);
+    log->port = (uint32_t *)(log->map + hdr.columns[CBS_STATLOG_COL_PORT].offset);
+    for (uint32_t c = 0; c < n_counters; c++) {
+        log->counter[c] = (uint64_t *)(log->map + hdr.columns[CBS_STATLOG_COL_COUNTERS + c].offset);
+    }
+    log->n_counters = n_counters;
+    return 0;
+}
+
+void cbs_statlog_commit(cbs_statlog_t *log) {
+    /* Column stores before the count, for readers mapping the live file */
+    __atomic_store_n(&log->hdr->count, log->count, __ATOMIC_RELEASE);
+}
+
+int cbs_statlog_close(cbs_statlog_t *log) {
+    int ret = 0;
+
+    if (log->map == NULL) {
+        return 0;
+    }
+
+    cbs_statlog_commit(log);
+    if (msync(log->map, log->size, MS_SYNC) < 0) {
+        ret = -errno;
+    }
+    munmap(log->map, log->size);
+    close(log->fd);
+    log->map = NULL;
+    log->hdr = NULL;
+    return ret;
+}
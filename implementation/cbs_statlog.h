@@ -0,0 +1,124 @@
+/**
+ * Columnar binary statistics log
+ * Preallocated, memory-mapped file of fixed-size records (timestamp,
+ * port, counters), one contiguous array per field so a reader can map
+ * each column straight into an array without parsing or copying
+ *
+ * File layout (little endian):
+ *   [0, 4096)          cbs_statlog_header_t
+ *   column i           capacity * elem_size bytes at columns[i].offset,
+ *                      each column starting on a 4096 byte boundary
+ * Records [0, count) are valid; count is published after every poll.
+ */
+
+#ifndef CBS_STATLOG_H
+#define CBS_STATLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+
+#define CBS_STATLOG_MAGIC           "CBSSTAT1"
+#define CBS_STATLOG_VERSION         1
+#define CBS_STATLOG_HEADER_SIZE     4096
+#define CBS_STATLOG_ALIGN           4096
+#define CBS_STATLOG_MAX_PORTS       16
+#define CBS_STATLOG_MAX_COLUMNS     32
+#define CBS_STATLOG_NAME_LEN        24
+
+/* Fixed columns ahead of the counters */
+#define CBS_STATLOG_COL_TIME        0           /* uint64 CLOCK_MONOTONIC ns */
+#define CBS_STATLOG_COL_PORT        1           /* uint32 index into ports[] */
+#define CBS_STATLOG_COL_COUNTERS    2           /* uint64 counters follow */
+
+/* Column Descriptor */
+typedef struct {
+    char name[CBS_STATLOG_NAME_LEN];
+    uint32_t elem_size;         /* bytes per record */
+    uint32_t reserved;
+    uint64_t offset;            /* file offset of element 0 */
+} cbs_statlog_column_t;
+
+/* File Header */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_columns;
+    uint64_t capacity;          /* records each column can hold */
+    uint64_t count;             /* records written */
+    uint64_t interval_ns;       /* nominal poll interval */
+    uint64_t start_mono_ns;     /* CLOCK_MONOTONIC at creation */
+    uint64_t start_real_ns;     /* CLOCK_REALTIME at creation */
+    uint32_t n_ports;
+    uint32_t reserved;
+    char ports[CBS_STATLOG_MAX_PORTS][16];
+    cbs_statlog_column_t columns[CBS_STATLOG_MAX_COLUMNS];
+} cbs_statlog_header_t;
+
+/* Open Log (writer side) */
+typedef struct {
+    int fd;
+    uint8_t *map;
+    size_t size;
+    cbs_statlog_header_t *hdr;
+    uint64_t *time;
+    uint32_t *port;
+    uint64_t *counter[CBS_STATLOG_MAX_COLUMNS - CBS_STATLOG_COL_COUNTERS];
+    uint32_t n_counters;
+    uint64_t count;             /* records appended, published by commit */
+} cbs_statlog_t;
+
+/**
+ * Create and preallocate a log file
+ * @param log: Log to initialize
+ * @param path: File path (truncated if it exists)
+ * @param capacity: Number of records to preallocate
+ * @param interval_ns: Nominal poll interval, recorded in the header
+ * @param ports: Port names
+ * @param n_ports: Number of ports (max CBS_STATLOG_MAX_PORTS)
+ * @param counters: Counter column names
+ * @param n_counters: Number of counter columns
+ * @return: 0 on success, negative on error
+ */
+int cbs_statlog_create(cbs_statlog_t *log, const char *path, uint64_t capacity,
+                       uint64_t interval_ns, const char *const *ports, uint32_t n_ports,
+                       const char *const *counters, uint32_t n_counters);
+
+/**
+ * Append one record; it becomes visible to readers at the next commit
+ * @param log: Log
+ * @param t_ns: Timestamp (CLOCK_MONOTONIC ns)
+ * @param port: Port index
+ * @param values: n_counters counter values
+ * @return: 0 on success, -ENOSPC when the log is full
+ */
+static inline int cbs_statlog_append(cbs_statlog_t *log, uint64_t t_ns, uint32_t port,
+                                     const uint64_t *values) {
+    uint64_t i = log->count;
+
+    if (i >= log->hdr->capacity) {
+        return -ENOSPC;
+    }
+    log->time[i] = t_ns;
+    log->port[i] = port;
+    for (uint32_t c = 0; c < log->n_counters; c++) {
+        log->counter[c][i] = values[c];
+    }
+    log->count = i + 1;
+    return 0;
+}
+
+/**
+ * Publish the appended records in the header
+ * @param log: Log
+ */
+void cbs_statlog_commit(cbs_statlog_t *log);
+
+/**
+ * Commit, flush and unmap the log
+ * @param log: Log
+ * @return: 0 on success, negative on error
+ */
+int cbs_statlog_close(cbs_statlog_t *log);
+
+#endif /* CBS_STATLOG_H */
@@ -0,0 +1,411 @@
+/**
+ * Reservation sweep over the CBS model
+ * Runs the 802.1Qav simulator (cbs_sim) for every point of a grid of
+ * per-stream reservations x best-effort loads x video frame sizes x
+ * stream counts, spread over all cores by the work-stealing pool, and
+ * writes one CSV row per point. The egress port is that of the lab test
+ * (run_tests.sh): 1 Gbps, video streams alternating between TC7 and TC6,
+ * Poisson best effort on TC0. A reservation of 0 is the CBS-off baseline.
+ * For every load/frame/stream combination the smallest reservation that
+ * meets the SLA (video loss and maximum delay) is reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include "lan9692_cbs.h"
+#include "cbs_calc.h"
+#include "cbs_sim.h"
+#include "cbs_pool.h"
+
+#define SWEEP_PORT                  1
+#define VIDEO_STREAM_MBPS           15      /* ffmpeg -b:v 15M */
+#define VIDEO_BURST_FRAMES          4
+#define BE_FRAME_BYTES              CBS_MAX_FRAME_SIZE
+#define MAX_AXIS                    64
+#define MAX_VIDEO_STREAMS           64
+
+/* Grid axis: values in ascending order */
+typedef struct {
+    uint32_t v[MAX_AXIS];
+    uint32_t n;
+} axis_t;
+
+/* One Grid Point's Outcome */
+typedef struct {
+    uint64_t video_frames;
+    uint64_t video_drops;
+    uint64_t video_bytes;
+    uint64_t be_frames;
+    uint64_t be_drops;
+    uint64_t be_bytes;
+    uint32_t p99_ns;
+    uint32_t max_ns;
+    uint64_t bound_ns;          /* cbs_calc worst case of the slower class, 0 = none */
+    double seconds;
+    int status;                 /* 0, -ERANGE reservation above port rate, -EINVAL */
+} point_t;
+
+typedef struct {
+    axis_t idle, be, frame, streams;
+    double duration;
+    uint64_t seed;
+    point_t *points;
+    cbs_sim_t *sims;            /* one per worker */
+} sweep_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* "a,b,c" or "first:last:step" */
+static int parse_axis(const char *arg, axis_t *axis) {
+    unsigned first, last, step;
+
+    axis->n = 0;
+    if (sscanf(arg, "%u:%u:%u", &first, &last, &step) == 3) {
+        if (step == 0 || last < first) {
+            return -EINVAL;
+        }
+        for (uint64_t v = first; v <= last; v += step) {
+            if (axis->n == MAX_AXIS) return -E2BIG;
+            axis->v[axis->n++] = (uint32_t)v;
+        }
+        return 0;
+    }
+    for (const char *p = arg; *p; ) {
+        char *end;
+        unsigned long v = strtoul(p, &end, 10);
+
+        if (end == p || (*end != ',' && *end != '\0') || axis->n == MAX_AXIS) {
+            return -EINVAL;
+        }
+        axis->v[axis->n++] = (uint32_t)v;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    /* Ascending, so the first passing reservation is the cheapest */
+    for (uint32_t i = 1; i < axis->n; i++) {
+        for (uint32_t j = i; j > 0 && axis->v[j - 1] > axis->v[j]; j--) {
+            uint32_t t = axis->v[j];
+            axis->v[j] = axis->v[j - 1];
+            axis->v[j - 1] = t;
+        }
+    }
+    return axis->n ? 0 : -EINVAL;
+}
+
+/* Point index -> axis values, reservation fastest */
+static void point_params(const sweep_t *sw, uint32_t index, uint32_t *idle, uint32_t *be,
+                         uint32_t *frame, uint32_t *streams) {
+    *idle = sw->idle.v[index % sw->idle.n];
+    index /= sw->idle.n;
+    *be = sw->be.v[index % sw->be.n];
+    index /= sw->be.n;
+    *frame = sw->frame.v[index % sw->frame.n];
+    index /= sw->frame.n;
+    *streams = sw->streams.v[index];
+}
+
+/*
+ * TC7 and TC6 each reserve idle_mbps per stream they carry, TC6 below
+ * TC7 as in lan9692_cbs_calculate() but with TC7's slope and frames as
+ * higher-class interference
+ */
+static int build_config(switch_config_t *config, uint32_t idle_mbps, uint32_t frame,
+                        const uint32_t per_tc[2], uint64_t *bound_ns) {
+    uint32_t wire = frame + CBS_SIM_WIRE_OVERHEAD;
+    uint64_t higher = 0;
+
+    memset(config, 0, sizeof(*config));
+    for (int port = 0; port < NUM_PORTS; port++) {
+        config->ports[port].port_id = port;
+        config->ports[port].port_speed = PORT_SPEED_1GBPS;
+    }
+    *bound_ns = 0;
+    if (idle_mbps == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        int tc = i == 0 ? TC_VIDEO_STREAM_1 : TC_VIDEO_STREAM_2;
+        cbs_config_t *cfg = &config->ports[SWEEP_PORT].tc_config[tc];
+        cbs_calc_class_t cls = {
+            .port_rate = PORT_SPEED_1GBPS,
+            .idle_slope = (uint64_t)idle_mbps * per_tc[i] * 1000000ULL,
+            .max_frame = wire,
+            .max_interference = BE_FRAME_BYTES + CBS_SIM_WIRE_OVERHEAD,
+            .higher_idle_slope = higher,
+            .higher_max_frame = higher ? wire : 0,
+            .burst = VIDEO_BURST_FRAMES * per_tc[i] * wire,
+        };
+        cbs_calc_result_t r;
+        int ret;
+
+        if (per_tc[i] == 0) {
+            continue;
+        }
+        if (cls.idle_slope + higher >= PORT_SPEED_1GBPS) {
+            return -ERANGE;
+        }
+        ret = cbs_calc(&cls, &r);
+        if (ret < 0) {
+            return ret;
+        }
+        cfg->idle_slope = (uint32_t)r.idle_slope;
+        cfg->send_slope = (uint32_t)r.send_slope;
+        cfg->hi_credit = r.hi_credit;
+        cfg->lo_credit = r.lo_credit;
+        cfg->enabled = true;
+        if (r.max_delay_ns > *bound_ns) {
+            *bound_ns = r.max_delay_ns;
+        }
+        higher += cls.idle_slope;
+    }
+    return 0;
+}
+
+static void run_point(void *arg, uint32_t index, unsigned worker) {
+    sweep_t *sw = arg;
+    cbs_sim_t *sim = &sw->sims[worker];
+    point_t *pt = &sw->points[index];
+    cbs_sim_source_t src[MAX_VIDEO_STREAMS + 1];
+    uint32_t idle, be, frame, streams, per_tc[2] = { 0, 0 }, n = 0;
+    switch_config_t config;
+    cbs_hist_summary_t sum;
+    cbs_hist_t delay;
+
+    point_params(sw, index, &idle, &be, &frame, &streams);
+    memset(pt, 0, sizeof(*pt));
+    for (uint32_t s = 0; s < streams; s++) {
+        per_tc[s & 1]++;
+    }
+    pt->status = build_config(&config, idle, frame, per_tc, &pt->bound_ns);
+    if (pt->status < 0) {
+        return;
+    }
+    pt->status = cbs_sim_init(sim, &config, 0, CBS_SIM_WIRE_OVERHEAD);
+    if (pt->status < 0) {
+        return;
+    }
+
+    /* Staggered video starts so the streams do not burst in lockstep */
+    for (uint32_t s = 0; s < streams; s++) {
+        src[n] = (cbs_sim_source_t){
+            .port = SWEEP_PORT, .tc = (s & 1) ? TC_VIDEO_STREAM_2 : TC_VIDEO_STREAM_1,
+            .stream = n, .rate = VIDEO_STREAM_MBPS * 1000000ULL, .frame_bytes = frame,
+            .burst = VIDEO_BURST_FRAMES, .start_ps = (uint64_t)s * 97 * 1000000ULL,
+        };
+        n++;
+    }
+    if (be > 0) {
+        src[n] = (cbs_sim_source_t){
+            .port = SWEEP_PORT, .tc = TC_BEST_EFFORT, .stream = n,
+            .rate = (uint64_t)be * 1000000ULL, .frame_bytes = BE_FRAME_BYTES,
+            .burst = 1, .poisson = true,
+        };
+        n++;
+    }
+
+    if (cbs_sim_run(sim, src, n, (uint64_t)(sw->duration * CBS_SIM_PS_PER_SEC),
+                    sw->seed + index) < 0) {
+        pt->status = -EINVAL;
+        cbs_sim_destroy(sim);
+        return;
+    }
+
+    cbs_hist_reset(&delay);
+    for (uint32_t s = 0; s < n; s++) {
+        const cbs_sim_stream_t *st = &sim->streams[s];
+
+        if (s < streams) {
+            pt->video_frames += st->frames;
+            pt->video_drops += st->drops;
+            pt->video_bytes += st->bytes;
+            cbs_hist_merge(&delay, &st->delay_ns);
+        } else {
+            pt->be_frames += st->frames;
+            pt->be_drops += st->drops;
+            pt->be_bytes += st->bytes;
+        }
+    }
+    cbs_hist_summarize(&delay, &sum, 0);
+    pt->p99_ns = sum.p99;
+    pt->max_ns = sum.max;
+    pt->seconds = sim->end_ps / 1e12;
+    cbs_sim_destroy(sim);
+}
+
+static double delivered_mbps(uint64_t bytes, uint64_t frames, uint64_t drops, double seconds) {
+    /* stream bytes count offered frames; scale by what was not dropped */
+    if (frames == 0 || seconds <= 0) {
+        return 0.0;
+    }
+    return bytes * 8.0 * (frames - drops) / frames / seconds / 1e6;
+}
+
+static void write_table(FILE *fp, const sweep_t *sw, uint32_t n_points) {
+    fprintf(fp, "idle_mbps,be_mbps,frame,streams,status,video_frames,video_drops,video_loss_pct,"
+                "p99_us,max_us,bound_us,video_mbps,be_out_mbps,be_loss_pct\n");
+    for (uint32_t i = 0; i < n_points; i++) {
+        const point_t *pt = &sw->points[i];
+        uint32_t idle, be, frame, streams;
+
+        point_params(sw, i, &idle, &be, &frame, &streams);
+        fprintf(fp, "%u,%u,%u,%u,", idle, be, frame, streams);
+        if (pt->status < 0) {
+            fprintf(fp, "%s,,,,,,,,,\n", pt->status == -ERANGE ? "overbooked" : "invalid");
+            continue;
+        }
+        fprintf(fp, "ok,%llu,%llu,%.4f,%.1f,%.1f,%.1f,%.2f,%.2f,%.4f\n",
+                (unsigned long long)pt->video_frames, (unsigned long long)pt->video_drops,
+                pt->video_frames ? 100.0 * pt->video_drops / pt->video_frames : 0.0,
+                pt->p99_ns / 1e3, pt->max_ns / 1e3, pt->bound_ns / 1e3,
+                delivered_mbps(pt->video_bytes, pt->video_frames, pt->video_drops, pt->seconds),
+                delivered_mbps(pt->be_bytes, pt->be_frames, pt->be_drops, pt->seconds),
+                pt->be_frames ? 100.0 * pt->be_drops / pt->be_frames : 0.0);
+    }
+}
+
+/* Smallest shaped reservation meeting the SLA for every BE load, frame size and stream count */
+static void print_cheapest(const sweep_t *sw, double max_loss_pct, double max_delay_us) {
+    printf("\nCheapest reservation per stream meeting loss <= %g%%", max_loss_pct);
+    if (max_delay_us > 0) {
+        printf(" and max delay <= %g us", max_delay_us);
+    }
+    printf("\n%8s %6s %8s %12s %10s %10s\n", "BE Mbps", "frame", "streams", "reserve Mbps",
+           "max us", "loss %");
+    for (uint32_t rest = 0; rest < sw->be.n * sw->frame.n * sw->streams.n; rest++) {
+        uint32_t idle, be, frame, streams, found = UINT32_MAX;
+
+        for (uint32_t k = 0; k < sw->idle.n && found == UINT32_MAX; k++) {
+            const point_t *pt = &sw->points[rest * sw->idle.n + k];
+
+            if (sw->idle.v[k] == 0 || pt->status < 0) continue;
+            if (100.0 * pt->video_drops > max_loss_pct * pt->video_frames) continue;
+            if (max_delay_us > 0 && pt->max_ns / 1e3 > max_delay_us) continue;
+            found = rest * sw->idle.n + k;
+        }
+        point_params(sw, rest * sw->idle.n, &idle, &be, &frame, &streams);
+        printf("%8u %6u %8u ", be, frame, streams);
+        if (found == UINT32_MAX) {
+            printf("%12s\n", "none");
+            continue;
+        }
+        point_params(sw, found, &idle, &be, &frame, &streams);
+        printf("%12u %10.1f %10.4f\n", idle, sw->points[found].max_ns / 1e3,
+               sw->points[found].video_frames ?
+               100.0 * sw->points[found].video_drops / sw->points[found].video_frames : 0.0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    sweep_t sw = { .duration = 1.0, .seed = 1 };
+    const char *output = NULL;
+    double max_loss_pct = 0.0, max_delay_us = 0.0;
+    unsigned workers = 0;
+    uint32_t n_points;
+    cbs_pool_stats_t stats;
+    uint64_t start, elapsed;
+    int opt, ret;
+
+    parse_axis("0,10,15,20,25,30,40", &sw.idle);
+    parse_axis("0:1000:100", &sw.be);
+    parse_axis("1366,1522", &sw.frame);        /* mpegts pkt_size=1316 + UDP/IP/Ethernet/VLAN */
+    parse_axis("1,2,4,8", &sw.streams);
+
+    while ((opt = getopt(argc, argv, "i:b:f:n:d:j:o:L:D:S:h")) != -1) {
+        switch (opt) {
+        case 'i': ret = parse_axis(optarg, &sw.idle); break;
+        case 'b': ret = parse_axis(optarg, &sw.be); break;
+        case 'f': ret = parse_axis(optarg, &sw.frame); break;
+        case 'n': ret = parse_axis(optarg, &sw.streams); break;
+        case 'd': sw.duration = atof(optarg); ret = sw.duration > 0 ? 0 : -EINVAL; break;
+        case 'j': workers = (unsigned)atoi(optarg); ret = 0; break;
+        case 'o': output = optarg; ret = 0; break;
+        case 'L': max_loss_pct = atof(optarg); ret = 0; break;
+        case 'D': max_delay_us = atof(optarg); ret = 0; break;
+        case 'S': sw.seed = strtoull(optarg, NULL, 0); ret = 0; break;
+        default:
+            printf("Usage: %s [-i mbps] [-b mbps] [-f bytes] [-n streams] [-d sec] [-j threads]\n"
+                   "          [-o table.csv] [-L loss_pct] [-D max_delay_us] [-S seed]\n", argv[0]);
+            printf("  Axes are lists (a,b,c) or ranges (first:last:step)\n");
+            printf("  -i  Reservation per video stream, 0 = CBS off (default 0,10,15,20,25,30,40)\n");
+            printf("  -b  Best-effort load on the port (default 0:1000:100)\n");
+            printf("  -f  Video frame size (default 1366,1522)\n");
+            printf("  -n  Video streams of %d Mbps, alternating TC7/TC6 (default 1,2,4,8)\n",
+                   VIDEO_STREAM_MBPS);
+            printf("  -d  Simulated seconds per point (default 1)\n");
+            printf("  -j  Worker threads (default one per CPU)\n");
+            printf("  -o  Results table (CSV, one row per point); default stdout\n");
+            printf("  -L  SLA: maximum video loss in percent (default 0)\n");
+            printf("  -D  SLA: maximum video delay in us (default not checked)\n");
+            return opt == 'h' ? 0 : 1;
+        }
+        if (ret < 0) {
+            fprintf(stderr, "Bad value for -%c: %s\n", opt, optarg);
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < sw.frame.n; i++) {
+        if (sw.frame.v[i] < CBS_SIM_MIN_FRAME || sw.frame.v[i] > CBS_CALC_MAX_FRAME) {
+            fprintf(stderr, "Frame sizes must be %d-%d bytes\n", CBS_SIM_MIN_FRAME, CBS_CALC_MAX_FRAME);
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < sw.streams.n; i++) {
+        if (sw.streams.v[i] == 0 || sw.streams.v[i] > MAX_VIDEO_STREAMS) {
+            fprintf(stderr, "Stream counts must be 1-%d\n", MAX_VIDEO_STREAMS);
+            return 1;
+        }
+    }
+
+    n_points = sw.idle.n * sw.be.n * sw.frame.n * sw.streams.n;
+    if (workers == 0) {
+        workers = cbs_pool_cpus();
+    }
+    if (workers > CBS_POOL_MAX_WORKERS) {
+        workers = CBS_POOL_MAX_WORKERS;
+    }
+    sw.points = calloc(n_points, sizeof(point_t));
+    sw.sims = calloc(workers, sizeof(cbs_sim_t));
+    if (sw.points == NULL || sw.sims == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    start = now_ns();
+    ret = cbs_pool_run(workers, n_points, run_point, &sw, &stats);
+    elapsed = now_ns() - start;
+    if (ret < 0) {
+        fprintf(stderr, "Only %u of %u workers started: %s\n", stats.workers, workers, strerror(-ret));
+    }
+
+    if (output) {
+        FILE *fp = fopen(output, "w");
+        if (fp == NULL) {
+            perror(output);
+            return 1;
+        }
+        write_table(fp, &sw, n_points);
+        fclose(fp);
+    } else {
+        write_table(stdout, &sw, n_points);
+    }
+
+    fprintf(output ? stdout : stderr,
+            "%u points x %.2f s simulated in %.2f s on %u workers (%llu steals, %u-%u points each)\n",
+            n_points, sw.duration, elapsed / 1e9, stats.workers, (unsigned long long)stats.steals,
+            stats.min_tasks, stats.max_tasks);
+    if (output) {
+        print_cheapest(&sw, max_loss_pct, max_delay_us);
+    }
+
+    free(sw.points);
+    free(sw.sims);
+    return 0;
+}
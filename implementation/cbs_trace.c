@@ -0,0 +1,228 @@
+/**
+ * Binary event tracer for the CBS drivers
+ * Ring management, binary save and Chrome-trace JSON export
+ */
+
+#include "cbs_trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define TRACE_SWITCH_PID            0           /* device-wide events */
+#define TRACE_PORT_PID(p)           ((p) + 1)
+#define TRACE_TC_TID(tc)            ((tc) + 1)  /* tid 0 = port shaper */
+
+cbs_trace_t cbs_trace;
+
+static const char *const counter_names[CBS_TRACE_CTR_KINDS] = {
+    "tx_octets", "rx_octets", "tx_frames", "rx_frames", "drops",
+};
+
+uint64_t cbs_trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int cbs_trace_start(uint64_t capacity) {
+    uint64_t size = 1;
+
+    if (capacity == 0) {
+        capacity = CBS_TRACE_DEFAULT_EVENTS;
+    }
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    cbs_trace_stop();
+    cbs_trace.events = calloc(size, sizeof(cbs_trace_event_t));
+    if (cbs_trace.events == NULL) {
+        return -ENOMEM;
+    }
+    cbs_trace.mask = size - 1;
+    cbs_trace.head = 0;
+    return 0;
+}
+
+void cbs_trace_stop(void) {
+    free(cbs_trace.events);
+    cbs_trace.events = NULL;
+}
+
+int64_t cbs_trace_save(const char *path, const char *source) {
+    cbs_trace_file_header_t hdr;
+    uint64_t head = __atomic_load_n(&cbs_trace.head, __ATOMIC_ACQUIRE);
+    uint64_t capacity = cbs_trace.mask + 1;
+    uint64_t first, split;
+    FILE *fp;
+    int ret = 0;
+
+    if (cbs_trace.events == NULL) {
+        return -EINVAL;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CBS_TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = CBS_TRACE_VERSION;
+    hdr.event_size = sizeof(cbs_trace_event_t);
+    hdr.count = head < capacity ? head : capacity;
+    hdr.lost = head - hdr.count;
+    snprintf(hdr.source, sizeof(hdr.source), "%s", source ? source : "");
+
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return -errno;
+    }
+
+    /* The oldest surviving event sits at head once the ring has wrapped */
+    first = (head - hdr.count) & cbs_trace.mask;
+    split = capacity - first < hdr.count ? capacity - first : hdr.count;
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+        fwrite(&cbs_trace.events[first], sizeof(cbs_trace_event_t), split, fp) != split ||
+        fwrite(cbs_trace.events, sizeof(cbs_trace_event_t), hdr.count - split, fp) != hdr.count - split) {
+        ret = -EIO;
+    }
+    if (fclose(fp) != 0 && ret == 0) {
+        ret = -errno;
+    }
+    return ret < 0 ? ret : (int64_t)hdr.count;
+}
+
+/* Quoted JSON string: quote, backslash and control characters escaped */
+static void json_string(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+
+        if (c == '"' || c == '\\') {
+            fputc('\\', fp);
+            fputc(c, fp);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+/* Common fields of one JSON event; ts in microseconds from the first event */
+static void json_event(FILE *fp, const char *name, char ph, int pid, int tid,
+                       uint64_t t_ns, uint64_t t0) {
+    uint64_t rel = t_ns > t0 ? t_ns - t0 : 0;
+
+    fprintf(fp, ",\n{\"name\":");
+    json_string(fp, name);
+    fprintf(fp, ",\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%llu.%03u",
+            ph, pid, tid, (unsigned long long)(rel / 1000), (unsigned)(rel % 1000));
+}
+
+static void json_metadata(FILE *fp, const char *what, int pid, int tid, const char *name) {
+    fprintf(fp, ",\n{\"name\":");
+    json_string(fp, what);
+    fprintf(fp, ",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", pid, tid);
+    json_string(fp, name);
+    fprintf(fp, "}}");
+}
+
+int cbs_trace_export_json(const cbs_trace_event_t *events, uint64_t count,
+                          const char *source, FILE *fp) {
+    uint8_t tcs_seen[256] = { 0 };      /* bit tc+1, bit 0 = port shaper track */
+    uint64_t t0 = UINT64_MAX;
+    char name[64];
+
+    /* Name the port processes and TC threads that actually occur */
+    for (uint64_t i = 0; i < count; i++) {
+        const cbs_trace_event_t *ev = &events[i];
+        if (ev->port != CBS_TRACE_NO_PORT) {
+            tcs_seen[ev->port] |= 1u << (ev->tc == CBS_TRACE_NO_TC ? 0 : (ev->tc & 7));
+        }
+        if (ev->t_ns < t0) {
+            t0 = ev->t_ns;
+        }
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"source\":");
+    json_string(fp, source ? source : "");
+    fprintf(fp, ",\"clock\":\"CLOCK_MONOTONIC_RAW\",\"t0_ns\":%llu},\n\"traceEvents\":[\n",
+            (unsigned long long)(count ? t0 : 0));
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+            "\"args\":{\"name\":\"Switch\"}}", TRACE_SWITCH_PID);
+    for (int port = 0; port < CBS_TRACE_NO_PORT; port++) {
+        if (tcs_seen[port] == 0) continue;
+        snprintf(name, sizeof(name), "Port %d", port);
+        json_metadata(fp, "process_name", TRACE_PORT_PID(port), 0, name);
+        json_metadata(fp, "thread_name", TRACE_PORT_PID(port), 0, "Shaper");
+        for (int tc = 0; tc < 8; tc++) {
+            if (tcs_seen[port] & (1u << (tc + 1))) {
+                snprintf(name, sizeof(name), "TC%d", tc);
+                json_metadata(fp, "thread_name", TRACE_PORT_PID(port), TRACE_TC_TID(tc), name);
+            }
+        }
+    }
+
+    for (uint64_t i = 0; i < count; i++) {
+        const cbs_trace_event_t *ev = &events[i];
+        int pid = ev->port == CBS_TRACE_NO_PORT ? TRACE_SWITCH_PID : TRACE_PORT_PID(ev->port);
+        int tid = ev->tc == CBS_TRACE_NO_TC ? 0 : TRACE_TC_TID(ev->tc & 7);
+
+        switch (ev->type) {
+        case CBS_TRACE_SHAPER_ENABLE:
+        case CBS_TRACE_SHAPER_DISABLE:
+            json_event(fp, "CBS enabled", 'C', pid, 0, ev->t_ns, t0);
+            fprintf(fp, ",\"args\":{\"on\":%d}}", ev->type == CBS_TRACE_SHAPER_ENABLE);
+            json_event(fp, ev->type == CBS_TRACE_SHAPER_ENABLE ? "CBS enable" : "CBS disable",
+                       'i', pid, 0, ev->t_ns, t0);
+            fprintf(fp, ",\"s\":\"p\"}");
+            break;
+        case CBS_TRACE_CREDIT_RESET:
+            json_event(fp, "credit reset", 'B', pid, 0, ev->t_ns, t0);
+            fprintf(fp, "}");
+            break;
+        case CBS_TRACE_CREDIT_RESET_DONE:
+            json_event(fp, "credit reset", 'E', pid, 0, ev->t_ns, t0);
+            fprintf(fp, ",\"args\":{\"timeout\":%u,\"wait_us\":%llu}}", ev->a,
+                    (unsigned long long)ev->b);
+            break;
+        case CBS_TRACE_RECONFIG_BEGIN:
+            json_event(fp, "reconfig", 'B', TRACE_SWITCH_PID, 0, ev->t_ns, t0);
+            fprintf(fp, ",\"args\":{\"ports\":\"0x%X\"}}", ev->a);
+            break;
+        case CBS_TRACE_RECONFIG_END:
+            json_event(fp, "reconfig", 'E', TRACE_SWITCH_PID, 0, ev->t_ns, t0);
+            fprintf(fp, ",\"args\":{\"writes\":%llu}}", (unsigned long long)ev->b);
+            break;
+        case CBS_TRACE_REG_WRITE:
+            json_event(fp, "write", 'i', pid, tid, ev->t_ns, t0);
+            fprintf(fp, ",\"s\":\"t\",\"args\":{\"reg\":\"0x%08X\",\"value\":\"0x%08llX\"}}",
+                    ev->a, (unsigned long long)ev->b);
+            break;
+        case CBS_TRACE_STATUS:
+            json_event(fp, "status", 'C', pid, 0, ev->t_ns, t0);
+            fprintf(fp, ",\"args\":{\"status\":%u}}", ev->a);
+            break;
+        case CBS_TRACE_QUEUE_DEPTH:
+            snprintf(name, sizeof(name), "depth TC%d", ev->tc & 7);
+            json_event(fp, name, 'C', pid, tid, ev->t_ns, t0);
+            fprintf(fp, ",\"args\":{\"bytes\":%u}}", ev->a);
+            break;
+        case CBS_TRACE_COUNTER_DELTA:
+            if (ev->tc == CBS_TRACE_NO_TC) {
+                snprintf(name, sizeof(name), "%s",
+                         ev->a < CBS_TRACE_CTR_KINDS ? counter_names[ev->a] : "counter");
+            } else {
+                snprintf(name, sizeof(name), "%s TC%d",
+                         ev->a < CBS_TRACE_CTR_KINDS ? counter_names[ev->a] : "counter", ev->tc & 7);
+            }
+            json_event(fp, name, 'C', pid, tid, ev->t_ns, t0);
+            fprintf(fp, ",\"args\":{\"delta\":%llu}}", (unsigned long long)ev->b);
+            break;
+        default:
+            break;
+        }
+    }
+
+    fprintf(fp, "\n]}\n");
+    return ferror(fp) ? -EIO : 0;
+}
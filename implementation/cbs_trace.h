@@ -0,0 +1,153 @@
+/**
+ * Binary event tracer for the CBS drivers
+ * Timestamped shaper, credit, register and sample events go into a
+ * preallocated flight-recorder ring (oldest events are overwritten); the
+ * ring is saved as a binary file and converted to Chrome-trace/Perfetto
+ * JSON by cbs_trace_export
+ *
+ * Events are stamped with CLOCK_MONOTONIC_RAW, the clock of cbs_sampler,
+ * so sampled status and depth line up with driver events. With tracing
+ * off an emit point costs one predictable branch.
+ */
+
+#ifndef CBS_TRACE_H
+#define CBS_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define CBS_TRACE_MAGIC             "CBSTRC01"
+#define CBS_TRACE_VERSION           1
+#define CBS_TRACE_DEFAULT_EVENTS    (1u << 20)  /* 24 MB */
+#define CBS_TRACE_NO_PORT           0xFF
+#define CBS_TRACE_NO_TC             0xFF
+
+/* Event Types */
+typedef enum {
+    CBS_TRACE_SHAPER_ENABLE = 1,    /* port */
+    CBS_TRACE_SHAPER_DISABLE,       /* port */
+    CBS_TRACE_CREDIT_RESET,         /* port, reset asserted */
+    CBS_TRACE_CREDIT_RESET_DONE,    /* port, a = 1 on timeout, b = wait us */
+    CBS_TRACE_RECONFIG_BEGIN,       /* a = ports changing (mask) */
+    CBS_TRACE_RECONFIG_END,         /* b = register writes */
+    CBS_TRACE_REG_WRITE,            /* a = offset, b = value */
+    CBS_TRACE_STATUS,               /* port, a = sampled status word */
+    CBS_TRACE_QUEUE_DEPTH,          /* port, tc, a = sampled depth */
+    CBS_TRACE_COUNTER_DELTA,        /* port, tc, a = cbs_trace_counter_t, b = delta */
+    CBS_TRACE_EVENT_TYPES
+} cbs_trace_type_t;
+
+/* Counter kinds of CBS_TRACE_COUNTER_DELTA */
+typedef enum {
+    CBS_TRACE_CTR_TX_OCTETS,
+    CBS_TRACE_CTR_RX_OCTETS,
+    CBS_TRACE_CTR_TX_FRAMES,
+    CBS_TRACE_CTR_RX_FRAMES,
+    CBS_TRACE_CTR_DROPS,
+    CBS_TRACE_CTR_KINDS
+} cbs_trace_counter_t;
+
+/* One Event (24 bytes) */
+typedef struct {
+    uint64_t t_ns;              /* CLOCK_MONOTONIC_RAW */
+    uint16_t type;              /* cbs_trace_type_t */
+    uint8_t port;               /* CBS_TRACE_NO_PORT if device wide */
+    uint8_t tc;                 /* CBS_TRACE_NO_TC if per port */
+    uint32_t a;
+    uint64_t b;
+} cbs_trace_event_t;
+
+/* Trace File Header, followed by count events in emission order */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t event_size;
+    uint64_t count;
+    uint64_t lost;              /* overwritten before the save */
+    char source[32];            /* emitting tool */
+} cbs_trace_file_header_t;
+
+/* Trace Ring */
+typedef struct {
+    cbs_trace_event_t *events;  /* NULL while tracing is off */
+    uint64_t mask;              /* capacity - 1, capacity a power of two */
+    uint64_t head;              /* events emitted so far */
+} cbs_trace_t;
+
+/* Process-wide trace ring used by the drivers' emit points */
+extern cbs_trace_t cbs_trace;
+
+/**
+ * Allocate the ring and start tracing
+ * @param capacity: Events kept, rounded up to a power of two, 0 for the default
+ * @return: 0 on success, negative on error
+ */
+int cbs_trace_start(uint64_t capacity);
+
+/**
+ * Stop tracing and free the ring
+ */
+void cbs_trace_stop(void);
+
+/**
+ * Current CLOCK_MONOTONIC_RAW time, the trace clock
+ * @return: Nanoseconds
+ */
+uint64_t cbs_trace_now_ns(void);
+
+/**
+ * Record an event with an explicit timestamp (e.g. a sampler reading)
+ * Safe from several threads; a slot is claimed with one atomic add
+ */
+static inline void cbs_trace_emit_at(uint64_t t_ns, cbs_trace_type_t type, uint8_t port,
+                                     uint8_t tc, uint32_t a, uint64_t b) {
+    cbs_trace_event_t *ev;
+
+    if (__builtin_expect(cbs_trace.events == NULL, 1)) {
+        return;
+    }
+    ev = &cbs_trace.events[__atomic_fetch_add(&cbs_trace.head, 1, __ATOMIC_RELAXED) & cbs_trace.mask];
+    ev->t_ns = t_ns;
+    ev->type = type;
+    ev->port = port;
+    ev->tc = tc;
+    ev->a = a;
+    ev->b = b;
+}
+
+/**
+ * Record an event stamped now
+ */
+static inline void cbs_trace_emit(cbs_trace_type_t type, uint8_t port, uint8_t tc,
+                                  uint32_t a, uint64_t b) {
+    if (__builtin_expect(cbs_trace.events == NULL, 1)) {
+        return;
+    }
+    cbs_trace_emit_at(cbs_trace_now_ns(), type, port, tc, a, b);
+}
+
+/**
+ * Write the ring to a binary trace file, oldest event first (emission
+ * order; events stamped by another thread may be slightly out of time order)
+ * Tracing must be quiescent (no concurrent emitters)
+ * @param path: Output file
+ * @param source: Emitting tool name, stored in the header
+ * @return: Events written, negative on error
+ */
+int64_t cbs_trace_save(const char *path, const char *source);
+
+/**
+ * Convert events to Chrome-trace JSON (chrome://tracing, ui.perfetto.dev)
+ * Ports become processes, traffic classes threads; reconfigurations and
+ * credit resets are slices, samples and counter deltas counter tracks
+ * @param events: Events in emission order
+ * @param count: Number of events
+ * @param source: Trace source name for the metadata
+ * @param fp: Output stream
+ * @return: 0 on success, negative on error
+ */
+int cbs_trace_export_json(const cbs_trace_event_t *events, uint64_t count,
+                          const char *source, FILE *fp);
+
+#endif /* CBS_TRACE_H */
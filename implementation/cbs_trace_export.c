@@ -0,0 +1,80 @@
+/**
+ * Trace exporter
+ * Converts a binary CBS trace (CBS_TRACE=file) to Chrome-trace JSON for
+ * chrome://tracing or ui.perfetto.dev
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cbs_trace.h"
+
+int main(int argc, char *argv[]) {
+    const cbs_trace_file_header_t *hdr;
+    char source[sizeof(hdr->source) + 1];
+    const char *out = NULL;
+    FILE *fp = stdout;
+    struct stat st;
+    void *map;
+    int fd, opt, ret;
+
+    while ((opt = getopt(argc, argv, "o:h")) != -1) {
+        switch (opt) {
+        case 'o': out = optarg; break;
+        default:
+            printf("Usage: %s [-o trace.json] trace.bin\n", argv[0]);
+            printf("  -o  Output file (default stdout)\n");
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Need a trace file\n");
+        return 1;
+    }
+
+    fd = open(argv[optind], O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+    if ((size_t)st.st_size < sizeof(*hdr)) {
+        fprintf(stderr, "%s: not a CBS trace\n", argv[optind]);
+        return 1;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+
+    hdr = map;
+    if (memcmp(hdr->magic, CBS_TRACE_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->version != CBS_TRACE_VERSION || hdr->event_size != sizeof(cbs_trace_event_t) ||
+        hdr->count > (st.st_size - sizeof(*hdr)) / sizeof(cbs_trace_event_t)) {
+        fprintf(stderr, "%s: not a CBS trace or truncated\n", argv[optind]);
+        return 1;
+    }
+
+    if (out != NULL && (fp = fopen(out, "w")) == NULL) {
+        fprintf(stderr, "%s: %s\n", out, strerror(errno));
+        return 1;
+    }
+
+    /* The header field need not be terminated in a damaged file */
+    snprintf(source, sizeof(source), "%.*s", (int)sizeof(hdr->source), hdr->source);
+    ret = cbs_trace_export_json((const cbs_trace_event_t *)(hdr + 1), hdr->count, source, fp);
+    fprintf(stderr, "%s: %llu events from %s (%llu lost to ring wrap)\n", argv[optind],
+            (unsigned long long)hdr->count, source, (unsigned long long)hdr->lost);
+
+    if (fp != stdout && fclose(fp) != 0) {
+        ret = -errno;
+    }
+    munmap(map, st.st_size);
+    return ret < 0 ? 1 : 0;
+}
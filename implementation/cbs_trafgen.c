@@ -0,0 +1,552 @@
+/**
+ * Multi-threaded precision traffic generator
+ * Replaces the ffmpeg encoders and the iperf3 flood of run_tests.sh.
+ * Streams are the LAN9662 streaming profiles (cbs_profiles), ad-hoc
+ * constant-rate streams and best-effort floods. All streams of one
+ * traffic class share a thread pinned to its own CPU.
+ *
+ * A stream sends a burst (the profile's burst_size, or one GSO message
+ * for a flood) every burst * 8 / bitrate seconds, with the period kept
+ * exact in picoseconds. A burst leaves as UDP GSO super-datagrams, and
+ * every burst due at the same time goes out in one sendmmsg(). Every
+ * datagram starts with the cbs_pkt header (stream, seq, CLOCK_REALTIME
+ * transmit time) for the receive analyzer.
+ *
+ * The traffic class becomes the socket priority, so the VLAN
+ * egress-qos-map of vlc_cbs_test.sh maps it to the PCP without the tc
+ * skbedit filters.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include "cbs_profiles.h"
+#include "cbs_hist.h"
+#include "cbs_pkt.h"
+
+#ifndef SOL_UDP
+#define SOL_UDP                     17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT                 103
+#endif
+
+#define NS_PER_SEC                  1000000000ULL
+#define PS_PER_SEC                  1000000000000ULL
+#define NUM_CLASSES                 8
+#define MAX_STREAMS                 256
+#define MAX_MSGS                    64              /* messages per sendmmsg */
+#define GSO_MAX_SEGS                64
+#define UDP_MAX_PAYLOAD             65507
+#define DEFAULT_PAYLOAD             1316            /* mpegts pkt_size of the ffmpeg streams */
+#define BE_PAYLOAD                  1472            /* iperf3 -u on a 1500 byte MTU */
+#define DEFAULT_DST                 "10.0.100.2"
+#define PROFILE_PORT                5005            /* 4K 5005, FHD 5006, VOD 5007, ... */
+#define STREAM_PORT_STEP            100             /* -n: next stream of a profile */
+#define SPIN_NS                     100000          /* busy-poll the last 100 us of a wait */
+#define START_LEAD_NS               10000000        /* threads start 10 ms after setup */
+#define SNDBUF_BYTES                (4 << 20)
+
+/* One UDP Stream */
+typedef struct {
+    char name[24];
+    uint16_t id;
+    uint8_t tc;
+    struct sockaddr_in dst;
+    uint64_t rate;              /* payload bps, 0 = as fast as the thread can send */
+    uint32_t payload;           /* bytes per datagram */
+    uint32_t burst;             /* datagrams per burst */
+    uint8_t *buf;               /* burst; datagram i at i * payload */
+    uint64_t period_ps;
+    uint64_t next_ps;           /* next burst, from the common start */
+    uint64_t seq;
+    /* Statistics */
+    uint64_t datagrams;
+    uint64_t drops;             /* rejected by the socket (ENOBUFS) */
+} gen_stream_t;
+
+/* One Thread per Traffic Class */
+typedef struct {
+    uint8_t tc;
+    int cpu;
+    gen_stream_t *streams[MAX_STREAMS];
+    uint32_t n_streams;
+    pthread_t thread;
+    bool gso;
+    /* Statistics */
+    uint64_t calls;             /* sendmmsg */
+    uint64_t messages;
+    uint64_t cpu_ns;
+    cbs_hist_t error_ns;        /* burst sent minus burst due */
+} gen_class_t;
+
+/* Messages of One sendmmsg */
+typedef struct {
+    struct mmsghdr msgs[MAX_MSGS];
+    struct iovec iov[MAX_MSGS];
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } ctrl[MAX_MSGS];
+    gen_stream_t *stream[MAX_MSGS];
+    uint32_t datagrams[MAX_MSGS];
+    uint32_t n;
+} gen_batch_t;
+
+static gen_stream_t streams[MAX_STREAMS];
+static uint32_t n_streams;
+static gen_class_t classes[NUM_CLASSES];
+static const char *bind_ifname;
+static bool busy_poll, no_gso;
+static uint64_t start_ns, end_ns, rt_offset;
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* ===== Streams ===== */
+
+static gen_stream_t *add_stream(const char *name, uint8_t tc, const char *dst, uint16_t port,
+                                uint64_t rate, uint32_t payload, uint32_t burst) {
+    gen_stream_t *s;
+
+    if (n_streams == MAX_STREAMS || tc >= NUM_CLASSES || payload < sizeof(cbs_pkt_hdr_t) ||
+        payload > UDP_MAX_PAYLOAD || burst == 0) {
+        return NULL;
+    }
+    s = &streams[n_streams];
+    memset(s, 0, sizeof(*s));
+    if (inet_pton(AF_INET, dst, &s->dst.sin_addr) != 1) {
+        return NULL;
+    }
+    s->dst.sin_family = AF_INET;
+    s->dst.sin_port = htons(port);
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    s->id = (uint16_t)n_streams;
+    s->tc = tc;
+    s->rate = rate;
+    s->payload = payload;
+    s->burst = burst;
+    s->buf = calloc(burst, payload);
+    if (s->buf == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < burst; i++) {
+        cbs_pkt_hdr_init(s->buf + (size_t)i * payload, s->id, tc);
+    }
+    if (rate > 0) {
+        s->period_ps = (uint64_t)((unsigned __int128)burst * payload * 8 * PS_PER_SEC / rate);
+    }
+    n_streams++;
+    return s;
+}
+
+/* Profile bursts as whole datagrams; -n streams per profile on ports 100 apart */
+static int add_profile(size_t index, const char *dst, uint32_t payload, uint32_t count) {
+    const streaming_profile_t *p = &cbs_profiles[index];
+    uint32_t burst = (p->burst_size + payload - 1) / payload;
+
+    for (uint32_t k = 0; k < count; k++) {
+        if (add_stream(p->name, p->tc, dst, PROFILE_PORT + index + k * STREAM_PORT_STEP,
+                       p->bitrate, payload, burst) == NULL) {
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+/* -p all | index,index,... */
+static int parse_profiles(const char *arg, bool *selected) {
+    char buf[64], *tok, *save;
+
+    if (strcmp(arg, "all") == 0) {
+        for (size_t i = 0; i < cbs_num_profiles; i++) {
+            selected[i] = true;
+        }
+        return 0;
+    }
+    snprintf(buf, sizeof(buf), "%s", arg);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *end;
+        unsigned long i = strtoul(tok, &end, 10);
+
+        if (*end || i >= cbs_num_profiles) {
+            return -EINVAL;
+        }
+        selected[i] = true;
+    }
+    return 0;
+}
+
+/* -s dst:port:mbps[:tc[:payload]] and -b dst:port:mbps */
+static int parse_flow(const char *arg, bool flood) {
+    char dst[64], name[24];
+    unsigned port, tc = TC_BEST_EFFORT, payload = flood ? BE_PAYLOAD : DEFAULT_PAYLOAD, burst = 1;
+    double mbps;
+    int n = sscanf(arg, "%63[^:]:%u:%lf:%u:%u", dst, &port, &mbps, &tc, &payload);
+
+    if (n < 3 || (flood && n > 3) || port == 0 || port > 65535 || mbps < 0 || tc >= NUM_CLASSES) {
+        return -EINVAL;
+    }
+    if (flood) {
+        burst = UDP_MAX_PAYLOAD / payload < GSO_MAX_SEGS ? UDP_MAX_PAYLOAD / payload : GSO_MAX_SEGS;
+    } else if (mbps == 0) {
+        return -EINVAL;
+    }
+    snprintf(name, sizeof(name), "%s %u", flood ? "BE" : "UDP", port);
+    return add_stream(name, (uint8_t)tc, dst, (uint16_t)port, (uint64_t)(mbps * 1e6), payload, burst)
+           ? 0 : -EINVAL;
+}
+
+/* ===== Class Threads ===== */
+
+static int open_socket(gen_class_t *c) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int prio = c->tc, tos = c->tc << 5, sndbuf = SNDBUF_BYTES, seg = 1000, off = 0;
+
+    if (fd < 0) {
+        return -errno;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &prio, sizeof(prio));
+    setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    if (bind_ifname &&
+        setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, bind_ifname, strlen(bind_ifname) + 1) < 0) {
+        int err = errno;
+        close(fd);
+        return -err;
+    }
+    /* Kernel without UDP GSO: one message per datagram */
+    c->gso = !no_gso && setsockopt(fd, SOL_UDP, UDP_SEGMENT, &seg, sizeof(seg)) == 0;
+    if (c->gso) {
+        setsockopt(fd, SOL_UDP, UDP_SEGMENT, &off, sizeof(off));
+    }
+    return fd;
+}
+
+static void flush(gen_class_t *c, int fd, gen_batch_t *b) {
+    uint32_t done = 0;
+
+    while (done < b->n) {
+        int ret = sendmmsg(fd, b->msgs + done, b->n - done, 0);
+
+        c->calls++;
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            b->stream[done]->drops += b->datagrams[done];
+            done++;
+        } else {
+            done += ret;
+        }
+    }
+    c->messages += b->n;
+    b->n = 0;
+}
+
+/* Queue datagrams first..first+count-1 of a burst as one message */
+static void add_message(gen_class_t *c, int fd, gen_batch_t *b, gen_stream_t *s,
+                        uint32_t first, uint32_t count) {
+    struct msghdr *m;
+
+    if (b->n == MAX_MSGS) {
+        flush(c, fd, b);
+    }
+    m = &b->msgs[b->n].msg_hdr;
+    memset(m, 0, sizeof(*m));
+    b->iov[b->n] = (struct iovec){ s->buf + (size_t)first * s->payload, (size_t)count * s->payload };
+    m->msg_name = &s->dst;
+    m->msg_namelen = sizeof(s->dst);
+    m->msg_iov = &b->iov[b->n];
+    m->msg_iovlen = 1;
+    if (count > 1) {
+        struct cmsghdr *cm;
+
+        m->msg_control = b->ctrl[b->n].buf;
+        m->msg_controllen = sizeof(b->ctrl[b->n].buf);
+        cm = CMSG_FIRSTHDR(m);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        *(uint16_t *)CMSG_DATA(cm) = (uint16_t)s->payload;
+    }
+    b->stream[b->n] = s;
+    b->datagrams[b->n] = count;
+    b->n++;
+}
+
+static void wait_until(int tfd, uint64_t target) {
+    if (tfd >= 0 && target > clock_ns(CLOCK_MONOTONIC) + SPIN_NS) {
+        struct itimerspec its = {
+            .it_value = {
+                .tv_sec = (target - SPIN_NS) / NS_PER_SEC,
+                .tv_nsec = (target - SPIN_NS) % NS_PER_SEC,
+            },
+        };
+        uint64_t expirations;
+
+        if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) == 0) {
+            ssize_t ret = read(tfd, &expirations, sizeof(expirations));
+            (void)ret;
+        }
+    }
+    while (clock_ns(CLOCK_MONOTONIC) < target && running) {
+        cpu_relax();
+    }
+}
+
+static void *class_thread(void *arg) {
+    gen_class_t *c = arg;
+    static __thread gen_batch_t batch;
+    uint32_t max_segs;
+    cpu_set_t cpus;
+    int fd, tfd = -1;
+
+    CPU_ZERO(&cpus);
+    CPU_SET(c->cpu, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    prctl(PR_SET_TIMERSLACK, 1UL);             /* per thread; the 50 us default shows up as lateness */
+
+    fd = open_socket(c);
+    if (fd < 0) {
+        fprintf(stderr, "TC%u: socket: %s\n", c->tc, strerror(-fd));
+        return NULL;
+    }
+    if (!busy_poll) {
+        tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    }
+
+    while (running) {
+        uint64_t due = UINT64_MAX, now, rt;
+
+        for (uint32_t i = 0; i < c->n_streams; i++) {
+            uint64_t t = start_ns + c->streams[i]->next_ps / 1000;
+            if (t < due) {
+                due = t;
+            }
+        }
+        if (due >= end_ns) {
+            break;
+        }
+        wait_until(tfd, due);
+        now = clock_ns(CLOCK_MONOTONIC);
+        if (now >= end_ns) {
+            break;                              /* unpaced flood, or a stream that fell behind */
+        }
+        rt = now + rt_offset;
+
+        /* Every burst that is due: stamp it, split it into GSO messages, send all at once */
+        for (uint32_t i = 0; i < c->n_streams; i++) {
+            gen_stream_t *s = c->streams[i];
+            uint64_t t = start_ns + s->next_ps / 1000;
+
+            if (t > now) {
+                continue;
+            }
+            if (s->period_ps) {
+                cbs_hist_record(&c->error_ns, now - t > UINT32_MAX ? UINT32_MAX : (uint32_t)(now - t));
+            }
+            for (uint32_t d = 0; d < s->burst; d++) {
+                cbs_pkt_stamp(s->buf + (size_t)d * s->payload, s->seq++, rt);
+            }
+            max_segs = c->gso ? UDP_MAX_PAYLOAD / s->payload : 1;
+            if (max_segs > GSO_MAX_SEGS) {
+                max_segs = GSO_MAX_SEGS;
+            }
+            for (uint32_t d = 0; d < s->burst; d += max_segs) {
+                add_message(c, fd, &batch, s, d, s->burst - d < max_segs ? s->burst - d : max_segs);
+            }
+            s->datagrams += s->burst;
+            s->next_ps += s->period_ps;
+        }
+        if (batch.n) {
+            flush(c, fd, &batch);
+        }
+    }
+
+    c->cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    if (tfd >= 0) {
+        close(tfd);
+    }
+    close(fd);
+    return NULL;
+}
+
+static void report(double sec) {
+    uint64_t total = 0, total_bytes = 0;
+
+    printf("\n%-16s %3s %22s %10s %10s %12s %10s\n", "stream", "tc", "destination", "Mbps",
+           "sent Mbps", "datagrams", "drops");
+    for (uint32_t i = 0; i < n_streams; i++) {
+        gen_stream_t *s = &streams[i];
+        uint64_t sent = s->datagrams - s->drops;
+        char dst[32], rate[16];
+
+        snprintf(dst, sizeof(dst), "%s:%u", inet_ntoa(s->dst.sin_addr), ntohs(s->dst.sin_port));
+        if (s->rate) {
+            snprintf(rate, sizeof(rate), "%.3f", s->rate / 1e6);
+        } else {
+            snprintf(rate, sizeof(rate), "max");
+        }
+        printf("%-16s %3u %22s %10s %10.3f %12llu %10llu\n", s->name, s->tc, dst, rate,
+               sent * s->payload * 8 / sec / 1e6, (unsigned long long)s->datagrams,
+               (unsigned long long)s->drops);
+        total += sent;
+        total_bytes += sent * s->payload;
+    }
+
+    printf("\n%-6s %4s %8s %10s %12s %8s %6s %9s %9s %9s\n", "thread", "cpu", "streams", "syscalls",
+           "datagrams", "per call", "CPU %", "late p50", "late p99", "late max");
+    for (int tc = NUM_CLASSES - 1; tc >= 0; tc--) {
+        gen_class_t *c = &classes[tc];
+        cbs_hist_summary_t sum;
+        uint64_t datagrams = 0;
+
+        if (c->n_streams == 0) {
+            continue;
+        }
+        for (uint32_t i = 0; i < c->n_streams; i++) {
+            datagrams += c->streams[i]->datagrams;
+        }
+        cbs_hist_summarize(&c->error_ns, &sum, 0);
+        printf("TC%-4d %4d %8u %10llu %12llu %8.1f %6.1f %7.1fus %7.1fus %7.1fus%s\n", tc, c->cpu,
+               c->n_streams, (unsigned long long)c->calls, (unsigned long long)datagrams,
+               c->calls ? (double)datagrams / c->calls : 0.0, c->cpu_ns / 1e7 / sec,
+               sum.p50 / 1e3, sum.p99 / 1e3, sum.max / 1e3, c->gso ? "" : "  (no GSO)");
+    }
+    printf("\n%llu datagrams in %.3f s: %.1f kpps, %.1f Mbps of UDP payload\n",
+           (unsigned long long)total, sec, total / sec / 1e3, total_bytes * 8 / sec / 1e6);
+}
+
+int main(int argc, char *argv[]) {
+    const char *dst = DEFAULT_DST;
+    bool selected[16] = { false }, any_profile = false;
+    uint32_t payload = DEFAULT_PAYLOAD, per_profile = 1;
+    double duration = 10.0;
+    int first_cpu = 0, opt, ret, ncpu, next_cpu;
+    uint64_t stop;
+
+    while ((opt = getopt(argc, argv, "p:n:s:b:D:l:I:d:c:SGh")) != -1) {
+        switch (opt) {
+        case 'p': ret = parse_profiles(optarg, selected); any_profile = true; break;
+        case 'n': per_profile = (uint32_t)atoi(optarg); ret = per_profile > 0 ? 0 : -EINVAL; break;
+        case 's': ret = parse_flow(optarg, false); break;
+        case 'b': ret = parse_flow(optarg, true); break;
+        case 'D': dst = optarg; ret = 0; break;
+        case 'l': payload = (uint32_t)atoi(optarg); ret = 0; break;
+        case 'I': bind_ifname = optarg; ret = 0; break;
+        case 'd': duration = atof(optarg); ret = duration > 0 ? 0 : -EINVAL; break;
+        case 'c': first_cpu = atoi(optarg); ret = first_cpu >= 0 ? 0 : -EINVAL; break;
+        case 'S': busy_poll = true; ret = 0; break;
+        case 'G': no_gso = true; ret = 0; break;
+        default:
+            printf("Usage: %s [-p all|i,j,...] [-n streams] [-D dst] [-l payload]\n"
+                   "          [-s dst:port:mbps[:tc[:payload]]]... [-b dst:port:mbps]...\n"
+                   "          [-I ifname] [-d sec] [-c cpu] [-S] [-G]\n", argv[0]);
+            printf("  -p  Streaming profiles (default all when no -s/-b is given):\n");
+            for (size_t i = 0; i < cbs_num_profiles; i++) {
+                printf("        %zu  %-12s TC%d %8.3f Mbps, %u byte bursts, UDP port %zu\n", i,
+                       cbs_profiles[i].name, cbs_profiles[i].tc, cbs_profiles[i].bitrate / 1e6,
+                       cbs_profiles[i].burst_size, PROFILE_PORT + i);
+            }
+            printf("  -n  Streams per profile, ports %d apart (default 1)\n", STREAM_PORT_STEP);
+            printf("  -D  Destination of the profile streams (default %s)\n", DEFAULT_DST);
+            printf("  -l  Profile datagram payload (default %d)\n", DEFAULT_PAYLOAD);
+            printf("  -s  Constant-rate stream, default TC0 with %d byte datagrams\n", DEFAULT_PAYLOAD);
+            printf("  -b  Best-effort flood on TC0, %d byte datagrams; mbps 0 = unpaced\n", BE_PAYLOAD);
+            printf("  -I  Send through this interface (SO_BINDTODEVICE)\n");
+            printf("  -d  Run time in seconds (default 10)\n");
+            printf("  -c  CPU of the first class thread, the others follow (default 0)\n");
+            printf("  -S  Busy-poll instead of sleeping on a timerfd\n");
+            printf("  -G  Do not use UDP GSO\n");
+            return opt == 'h' ? 0 : 1;
+        }
+        if (ret < 0) {
+            fprintf(stderr, "Bad value for -%c: %s\n", opt, optarg);
+            return 1;
+        }
+    }
+    if (!any_profile && n_streams == 0) {
+        parse_profiles("all", selected);
+    }
+    for (size_t i = 0; i < cbs_num_profiles; i++) {
+        if (selected[i] && add_profile(i, dst, payload, per_profile) < 0) {
+            fprintf(stderr, "Cannot add profile %s (payload %u, at most %d streams)\n",
+                    cbs_profiles[i].name, payload, MAX_STREAMS);
+            return 1;
+        }
+    }
+
+    /* One thread per class in use, on consecutive CPUs */
+    ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1) {
+        ncpu = 1;
+    }
+    next_cpu = first_cpu;
+    for (uint32_t i = 0; i < n_streams; i++) {
+        gen_class_t *c = &classes[streams[i].tc];
+
+        if (c->n_streams == 0) {
+            c->tc = streams[i].tc;
+            c->cpu = next_cpu++ % ncpu;
+        }
+        c->streams[c->n_streams++] = &streams[i];
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    start_ns = clock_ns(CLOCK_MONOTONIC) + START_LEAD_NS;
+    end_ns = start_ns + (uint64_t)(duration * NS_PER_SEC);
+    rt_offset = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+    printf("Generating %u streams for %.1f s\n", n_streams, duration);
+    for (int tc = 0; tc < NUM_CLASSES; tc++) {
+        if (classes[tc].n_streams &&
+            (ret = pthread_create(&classes[tc].thread, NULL, class_thread, &classes[tc])) != 0) {
+            fprintf(stderr, "TC%d: cannot start thread: %s\n", tc, strerror(ret));
+            classes[tc].n_streams = 0;
+        }
+    }
+    for (int tc = 0; tc < NUM_CLASSES; tc++) {
+        if (classes[tc].n_streams) {
+            pthread_join(classes[tc].thread, NULL);
+        }
+    }
+    stop = clock_ns(CLOCK_MONOTONIC);
+
+    report(stop > start_ns ? (stop - start_ns) / 1e9 : duration);
+    for (uint32_t i = 0; i < n_streams; i++) {
+        free(streams[i].buf);
+    }
+    return 0;
+}
@@ -0,0 +1,360 @@
+/**
+ * Raw frame transmit rings
+ * Both backends hand slots out in ring order and get them back in the
+ * same order: the kernel transmits a TX ring front to back and a single
+ * queue completes in order, so a slot index is all the bookkeeping a
+ * frame needs.
+ */
+
+#include "cbs_tx.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/if_xdp.h>
+
+#ifndef AF_XDP
+#define AF_XDP                      44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP                     283
+#endif
+
+#define PACKET_DATA_OFFSET          (TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+#define PACKET_BLOCK_SIZE           (1u << 16)
+#define XDP_KICK_RETRIES            64      /* copy mode sends at most 32 frames per kick */
+
+static uint32_t round_pow2(uint32_t n) {
+    uint32_t p = 1;
+
+    while (p < n && p < (1u << 20)) {
+        p <<= 1;
+    }
+    return p;
+}
+
+static cbs_tx_t *tx_alloc(const char *ifname, uint32_t n_frames) {
+    cbs_tx_t *tx;
+    int ifindex = if_nametoindex(ifname);
+
+    if (ifindex == 0) {
+        return NULL;
+    }
+    tx = calloc(1, sizeof(*tx));
+    if (tx == NULL) {
+        return NULL;
+    }
+    tx->fd = -1;
+    tx->ifindex = ifindex;
+    tx->n_frames = round_pow2(n_frames ? n_frames : CBS_TX_DEFAULT_FRAMES);
+    return tx;
+}
+
+/* ===== AF_PACKET TPACKET_V2 ===== */
+
+static inline struct tpacket2_hdr *packet_slot(cbs_tx_t *tx, uint32_t index) {
+    return (struct tpacket2_hdr *)(tx->ring + (size_t)(index & (tx->n_frames - 1)) * CBS_TX_FRAME_SIZE);
+}
+
+static uint8_t *packet_frame(cbs_tx_t *tx) {
+    struct tpacket2_hdr *hdr = packet_slot(tx, tx->head);
+    uint32_t status = __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE);
+
+    if (status == TP_STATUS_WRONG_FORMAT) {
+        tx->stats.errors++;         /* dropped by the kernel, slot is ours again */
+    } else if (status != TP_STATUS_AVAILABLE) {
+        return NULL;
+    }
+    return (uint8_t *)hdr + PACKET_DATA_OFFSET;
+}
+
+static void packet_commit(cbs_tx_t *tx, uint32_t len) {
+    struct tpacket2_hdr *hdr = packet_slot(tx, tx->head);
+
+    hdr->tp_len = len;
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+    tx->head++;
+}
+
+static int packet_kick(cbs_tx_t *tx) {
+    if (sendto(tx->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0 && errno != EAGAIN && errno != ENOBUFS) {
+        return -errno;
+    }
+    return 0;
+}
+
+static void packet_close(cbs_tx_t *tx) {
+    if (tx->ring) {
+        munmap(tx->ring, tx->ring_size);
+    }
+}
+
+static const cbs_tx_ops_t packet_ops = {
+    .name = "packet",
+    .frame = packet_frame,
+    .commit = packet_commit,
+    .kick = packet_kick,
+    .close = packet_close,
+};
+
+cbs_tx_t *cbs_tx_open_packet(const char *ifname, uint32_t n_frames) {
+    struct tpacket_req req;
+    struct sockaddr_ll addr;
+    int version = TPACKET_V2, one = 1, err;
+    cbs_tx_t *tx = tx_alloc(ifname, n_frames);
+
+    if (tx == NULL) {
+        return NULL;
+    }
+    tx->ops = &packet_ops;
+    tx->max_len = CBS_TX_FRAME_SIZE - PACKET_DATA_OFFSET;
+
+    /* Protocol 0: the socket transmits only and never receives */
+    tx->fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (tx->fd < 0) {
+        goto fail;
+    }
+    if (setsockopt(tx->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0 ||
+        setsockopt(tx->fd, SOL_PACKET, PACKET_LOSS, &one, sizeof(one)) < 0) {
+        goto fail;
+    }
+    /* Frames are shaped here already; a qdisc would only add a second queue */
+    setsockopt(tx->fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    if (tx->n_frames < PACKET_BLOCK_SIZE / CBS_TX_FRAME_SIZE) {
+        tx->n_frames = PACKET_BLOCK_SIZE / CBS_TX_FRAME_SIZE;
+    }
+    req.tp_block_size = PACKET_BLOCK_SIZE;
+    req.tp_frame_size = CBS_TX_FRAME_SIZE;
+    req.tp_frame_nr = tx->n_frames;
+    req.tp_block_nr = tx->n_frames / (PACKET_BLOCK_SIZE / CBS_TX_FRAME_SIZE);
+    if (setsockopt(tx->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+        goto fail;
+    }
+    tx->ring_size = (size_t)req.tp_block_size * req.tp_block_nr;
+    tx->ring = mmap(NULL, tx->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, tx->fd, 0);
+    if (tx->ring == MAP_FAILED) {
+        tx->ring = NULL;
+        goto fail;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_ifindex = tx->ifindex;
+    if (bind(tx->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        goto fail;
+    }
+    return tx;
+
+fail:
+    err = errno;
+    cbs_tx_close(tx);
+    errno = err;
+    return NULL;
+}
+
+/* ===== AF_XDP ===== */
+
+static void xdp_reclaim(cbs_tx_t *tx) {
+    uint32_t prod = __atomic_load_n(tx->cq.producer, __ATOMIC_ACQUIRE);
+    uint32_t cons = *tx->cq.consumer;
+
+    if (prod != cons) {
+        tx->completed += prod - cons;
+        __atomic_store_n(tx->cq.consumer, prod, __ATOMIC_RELEASE);
+    }
+}
+
+static uint8_t *xdp_frame(cbs_tx_t *tx) {
+    if (tx->head - tx->completed >= tx->n_frames) {
+        xdp_reclaim(tx);
+        if (tx->head - tx->completed >= tx->n_frames) {
+            return NULL;
+        }
+    }
+    return tx->ring + (size_t)(tx->head & (tx->n_frames - 1)) * CBS_TX_FRAME_SIZE;
+}
+
+static void xdp_commit(cbs_tx_t *tx, uint32_t len) {
+    struct xdp_desc *desc = &((struct xdp_desc *)tx->txq.desc)[tx->head & (tx->n_frames - 1)];
+
+    desc->addr = (uint64_t)(tx->head & (tx->n_frames - 1)) * CBS_TX_FRAME_SIZE;
+    desc->len = len;
+    desc->options = 0;
+    tx->head++;
+}
+
+static int xdp_kick(cbs_tx_t *tx) {
+    int ret = 0;
+
+    __atomic_store_n(tx->txq.producer, tx->head, __ATOMIC_RELEASE);
+    if (tx->zerocopy && !(__atomic_load_n(tx->txq.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP)) {
+        xdp_reclaim(tx);
+        return 0;
+    }
+    for (int i = 0; i < XDP_KICK_RETRIES; i++) {
+        if (sendto(tx->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0) {
+            if (errno != EAGAIN && errno != EBUSY && errno != ENOBUFS) {
+                ret = -errno;
+            }
+            break;
+        }
+        if (tx->zerocopy || __atomic_load_n(tx->txq.consumer, __ATOMIC_ACQUIRE) == tx->head) {
+            break;
+        }
+    }
+    xdp_reclaim(tx);
+    return ret;
+}
+
+static void xdp_close(cbs_tx_t *tx) {
+    if (tx->txq.map) {
+        munmap(tx->txq.map, tx->txq.map_size);
+    }
+    if (tx->cq.map) {
+        munmap(tx->cq.map, tx->cq.map_size);
+    }
+    if (tx->ring) {
+        munmap(tx->ring, tx->ring_size);
+    }
+}
+
+static const cbs_tx_ops_t xdp_ops = {
+    .name = "xdp",
+    .frame = xdp_frame,
+    .commit = xdp_commit,
+    .kick = xdp_kick,
+    .close = xdp_close,
+};
+
+static int xdp_map_ring(cbs_tx_t *tx, const struct xdp_ring_offset *off, size_t entry_size,
+                        off_t pgoff, cbs_tx_ring_t *ring) {
+    uint8_t *map;
+
+    ring->map_size = off->desc + tx->n_frames * entry_size;
+    map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, tx->fd, pgoff);
+    if (map == MAP_FAILED) {
+        return -errno;
+    }
+    ring->map = map;
+    ring->producer = (uint32_t *)(map + off->producer);
+    ring->consumer = (uint32_t *)(map + off->consumer);
+    ring->flags = (uint32_t *)(map + off->flags);
+    ring->desc = map + off->desc;
+    return 0;
+}
+
+cbs_tx_t *cbs_tx_open_xdp(const char *ifname, uint32_t queue, uint32_t n_frames) {
+    struct xdp_umem_reg umem;
+    struct xdp_mmap_offsets off;
+    struct sockaddr_xdp addr;
+    socklen_t optlen = sizeof(off);
+    uint32_t ring_size;
+    int err;
+    cbs_tx_t *tx = tx_alloc(ifname, n_frames);
+
+    if (tx == NULL) {
+        return NULL;
+    }
+    tx->ops = &xdp_ops;
+    tx->max_len = CBS_TX_FRAME_SIZE;
+    ring_size = tx->n_frames;
+
+    tx->fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (tx->fd < 0) {
+        goto fail;
+    }
+    tx->ring_size = (size_t)tx->n_frames * CBS_TX_FRAME_SIZE;
+    tx->ring = mmap(NULL, tx->ring_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (tx->ring == MAP_FAILED) {
+        tx->ring = NULL;
+        goto fail;
+    }
+
+    memset(&umem, 0, sizeof(umem));
+    umem.addr = (uintptr_t)tx->ring;
+    umem.len = tx->ring_size;
+    umem.chunk_size = CBS_TX_FRAME_SIZE;
+    /* The fill ring is never used for TX but bind() requires one */
+    if (setsockopt(tx->fd, SOL_XDP, XDP_UMEM_REG, &umem, sizeof(umem)) < 0 ||
+        setsockopt(tx->fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(tx->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(tx->fd, SOL_XDP, XDP_TX_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        getsockopt(tx->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0) {
+        goto fail;
+    }
+    if ((err = xdp_map_ring(tx, &off.tx, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING, &tx->txq)) < 0 ||
+        (err = xdp_map_ring(tx, &off.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING, &tx->cq)) < 0) {
+        errno = -err;
+        goto fail;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sxdp_family = AF_XDP;
+    addr.sxdp_ifindex = tx->ifindex;
+    addr.sxdp_queue_id = queue;
+    addr.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+    tx->zerocopy = 1;
+    if (bind(tx->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        addr.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+        tx->zerocopy = 0;
+        if (bind(tx->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            goto fail;
+        }
+    }
+    return tx;
+
+fail:
+    err = errno;
+    cbs_tx_close(tx);
+    errno = err;
+    return NULL;
+}
+
+/* ===== Common ===== */
+
+cbs_tx_t *cbs_tx_open(const char *spec, const char *ifname, uint32_t queue, uint32_t n_frames) {
+    cbs_tx_t *tx;
+
+    if (strcmp(spec, "packet") == 0) {
+        return cbs_tx_open_packet(ifname, n_frames);
+    }
+    if (strcmp(spec, "xdp") == 0) {
+        return cbs_tx_open_xdp(ifname, queue, n_frames);
+    }
+    if (strcmp(spec, "auto") == 0) {
+        tx = cbs_tx_open_xdp(ifname, queue, n_frames);
+        return tx ? tx : cbs_tx_open_packet(ifname, n_frames);
+    }
+    errno = EINVAL;
+    return NULL;
+}
+
+void cbs_tx_close(cbs_tx_t *tx) {
+    if (tx == NULL) {
+        return;
+    }
+    if (tx->ops) {
+        tx->ops->close(tx);
+    }
+    if (tx->fd >= 0) {
+        close(tx->fd);
+    }
+    free(tx);
+}
+
+void cbs_tx_dump_stats(cbs_tx_t *tx, FILE *fp) {
+    const cbs_tx_stats_t *s = &tx->stats;
+
+    fprintf(fp, "TX ring (%s%s, %u slots): %llu frames, %llu bytes, %llu kicks (%.1f frames/kick), "
+            "%llu ring full, %llu errors\n",
+            tx->ops->name, tx->ops == &xdp_ops ? (tx->zerocopy ? " zero-copy" : " copy") : "",
+            tx->n_frames, (unsigned long long)s->frames, (unsigned long long)s->bytes,
+            (unsigned long long)s->kicks, s->kicks ? (double)s->frames / s->kicks : 0.0,
+            (unsigned long long)s->ring_full, (unsigned long long)s->errors);
+}
@@ -0,0 +1,137 @@
+/**
+ * Raw frame transmit rings
+ * Frames are written straight into a kernel-shared ring and handed over
+ * in batches with one syscall ("kick"), so a single core can feed a
+ * link at line rate without a copy or syscall per frame.
+ *
+ * Backends:
+ *   packet  - AF_PACKET TPACKET_V2 TX ring (PACKET_MMAP), qdisc bypassed
+ *   xdp     - AF_XDP socket, TX only (no XDP program needed), zero-copy
+ *             when the driver supports it, copy mode otherwise
+ *   auto    - xdp, falling back to packet
+ */
+
+#ifndef CBS_TX_H
+#define CBS_TX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define CBS_TX_FRAME_SIZE           2048            /* ring slot, largest frame 2048 - headroom */
+#define CBS_TX_DEFAULT_FRAMES       4096
+
+typedef struct cbs_tx cbs_tx_t;
+
+/* AF_XDP Ring Mapping */
+typedef struct {
+    uint32_t *producer;
+    uint32_t *consumer;
+    uint32_t *flags;
+    void *desc;
+    void *map;
+    size_t map_size;
+} cbs_tx_ring_t;
+
+/* Backend Operations */
+typedef struct {
+    const char *name;
+    uint8_t *(*frame)(cbs_tx_t *tx);                /* free slot, NULL if the ring is full */
+    void (*commit)(cbs_tx_t *tx, uint32_t len);     /* queue the slot returned by frame() */
+    int (*kick)(cbs_tx_t *tx);                      /* start transmission of queued frames */
+    void (*close)(cbs_tx_t *tx);
+} cbs_tx_ops_t;
+
+/* Transmit Statistics */
+typedef struct {
+    uint64_t frames;            /* committed */
+    uint64_t bytes;
+    uint64_t kicks;
+    uint64_t ring_full;         /* frame() found no free slot */
+    uint64_t errors;            /* failed kicks, rejected frames */
+} cbs_tx_stats_t;
+
+/* Transmit Ring Handle */
+struct cbs_tx {
+    const cbs_tx_ops_t *ops;
+    int fd;
+    int ifindex;
+    uint8_t *ring;              /* PACKET_MMAP ring or XDP UMEM */
+    size_t ring_size;
+    uint32_t n_frames;          /* power of two */
+    uint32_t max_len;           /* largest frame a slot holds */
+    uint32_t head;              /* next slot */
+    int zerocopy;               /* xdp: bound in zero-copy mode */
+    cbs_tx_ring_t txq;          /* xdp: TX descriptors */
+    cbs_tx_ring_t cq;           /* xdp: completion ring */
+    uint32_t completed;         /* xdp: frames returned through the completion ring */
+    cbs_tx_stats_t stats;
+};
+
+/**
+ * Open a transmit ring on an interface
+ * @param spec: "packet", "xdp" or "auto"
+ * @param ifname: Interface
+ * @param queue: Hardware queue (xdp only)
+ * @param n_frames: Ring slots, rounded up to a power of two, 0 = default
+ * @return: Handle, NULL on error (errno set)
+ */
+cbs_tx_t *cbs_tx_open(const char *spec, const char *ifname, uint32_t queue, uint32_t n_frames);
+
+/**
+ * Open an AF_PACKET TPACKET_V2 transmit ring
+ * @param ifname: Interface
+ * @param n_frames: Ring slots, power of two
+ * @return: Handle, NULL on error (errno set)
+ */
+cbs_tx_t *cbs_tx_open_packet(const char *ifname, uint32_t n_frames);
+
+/**
+ * Open an AF_XDP transmit-only socket
+ * @param ifname: Interface
+ * @param queue: Queue to bind
+ * @param n_frames: UMEM frames and TX ring entries, power of two
+ * @return: Handle, NULL on error (errno set)
+ */
+cbs_tx_t *cbs_tx_open_xdp(const char *ifname, uint32_t queue, uint32_t n_frames);
+
+/**
+ * Release the ring; frames not yet kicked are discarded
+ * @param tx: Handle
+ */
+void cbs_tx_close(cbs_tx_t *tx);
+
+/**
+ * Print statistics
+ * @param tx: Handle
+ * @param fp: Output
+ */
+void cbs_tx_dump_stats(cbs_tx_t *tx, FILE *fp);
+
+static inline uint8_t *cbs_tx_frame(cbs_tx_t *tx) {
+    uint8_t *frame = tx->ops->frame(tx);
+
+    if (frame == NULL) {
+        tx->stats.ring_full++;
+    }
+    return frame;
+}
+
+static inline void cbs_tx_commit(cbs_tx_t *tx, uint32_t len) {
+    tx->ops->commit(tx, len);
+    tx->stats.frames++;
+    tx->stats.bytes += len;
+}
+
+/* Also retries frames an earlier kick left in the ring, so it may be called with none queued */
+static inline int cbs_tx_kick(cbs_tx_t *tx) {
+    int ret = tx->ops->kick(tx);
+
+    tx->stats.kicks++;
+    if (ret < 0) {
+        tx->stats.errors++;
+    }
+    return ret;
+}
+
+#endif /* CBS_TX_H */
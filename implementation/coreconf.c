@@ -0,0 +1,610 @@
+/**
+ * CORECONF (RFC 9254 YANG-CBOR) encoding of EVB-LAN9692 change sets
+ * Minimal CBOR codec plus SID-based instance identifier handling
+ */
+
+#include "coreconf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+/* CBOR Major Types */
+#define CBOR_UINT           0
+#define CBOR_NEGINT         1
+#define CBOR_BYTES          2
+#define CBOR_TEXT           3
+#define CBOR_ARRAY          4
+#define CBOR_MAP            5
+#define CBOR_TAG            6
+#define CBOR_SIMPLE         7
+
+#define CBOR_FALSE          20
+#define CBOR_TRUE           21
+#define CBOR_NULL           22
+
+#define CORECONF_MAX_KEYS   8
+#define CORECONF_PATH_MAX   512
+
+/* CBOR Writer */
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} cbor_out_t;
+
+static void cbor_put(cbor_out_t *o, const void *data, size_t len) {
+    if (o->len + len > o->size) {
+        o->overflow = true;
+        return;
+    }
+    memcpy(o->buf + o->len, data, len);
+    o->len += len;
+}
+
+static void cbor_head(cbor_out_t *o, uint8_t major, uint64_t v) {
+    uint8_t h[9];
+    size_t n;
+
+    major <<= 5;
+    if (v < 24) {
+        h[0] = major | v;
+        n = 1;
+    } else if (v <= 0xFF) {
+        h[0] = major | 24; h[1] = v;
+        n = 2;
+    } else if (v <= 0xFFFF) {
+        h[0] = major | 25; h[1] = v >> 8; h[2] = v;
+        n = 3;
+    } else if (v <= 0xFFFFFFFFULL) {
+        h[0] = major | 26;
+        for (int i = 0; i < 4; i++) h[1 + i] = v >> (24 - 8 * i);
+        n = 5;
+    } else {
+        h[0] = major | 27;
+        for (int i = 0; i < 8; i++) h[1 + i] = v >> (56 - 8 * i);
+        n = 9;
+    }
+    cbor_put(o, h, n);
+}
+
+static void cbor_int(cbor_out_t *o, int64_t v) {
+    if (v >= 0) {
+        cbor_head(o, CBOR_UINT, v);
+    } else {
+        cbor_head(o, CBOR_NEGINT, (uint64_t)(-1 - v));
+    }
+}
+
+static void cbor_text(cbor_out_t *o, const char *s, size_t len) {
+    cbor_head(o, CBOR_TEXT, len);
+    cbor_put(o, s, len);
+}
+
+/* CBOR Reader */
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+} cbor_in_t;
+
+static int cbor_read_head(cbor_in_t *in, uint8_t *major, uint64_t *val) {
+    if (in->pos >= in->len) {
+        return -EPROTO;
+    }
+
+    uint8_t ib = in->buf[in->pos++];
+    uint8_t ai = ib & 0x1F;
+    int extra;
+
+    *major = ib >> 5;
+    if (ai < 24) {
+        *val = ai;
+        return 0;
+    }
+    switch (ai) {
+    case 24: extra = 1; break;
+    case 25: extra = 2; break;
+    case 26: extra = 4; break;
+    case 27: extra = 8; break;
+    default: return -EPROTO;        /* indefinite lengths are not used */
+    }
+    if (in->pos + extra > in->len) {
+        return -EPROTO;
+    }
+    *val = 0;
+    for (int i = 0; i < extra; i++) {
+        *val = (*val << 8) | in->buf[in->pos++];
+    }
+    return 0;
+}
+
+static int cbor_skip(cbor_in_t *in) {
+    uint8_t major;
+    uint64_t val;
+    int ret = cbor_read_head(in, &major, &val);
+
+    if (ret < 0) {
+        return ret;
+    }
+    switch (major) {
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+        if (val > in->len - in->pos) return -EPROTO;
+        in->pos += val;
+        return 0;
+    case CBOR_MAP:
+        val *= 2;
+        /* fall through */
+    case CBOR_ARRAY:
+        for (uint64_t i = 0; i < val; i++) {
+            if ((ret = cbor_skip(in)) < 0) return ret;
+        }
+        return 0;
+    case CBOR_TAG:
+        return cbor_skip(in);
+    default:
+        return 0;
+    }
+}
+
+/* SID Table Lookup */
+static const coreconf_sid_t *sid_by_path(const char *path) {
+    for (size_t i = 0; i < coreconf_num_sids; i++) {
+        if (strcmp(coreconf_sids[i].path, path) == 0) {
+            return &coreconf_sids[i];
+        }
+    }
+    return NULL;
+}
+
+static const coreconf_sid_t *sid_by_value(uint64_t sid) {
+    for (size_t i = 0; i < coreconf_num_sids; i++) {
+        if (coreconf_sids[i].sid == sid) {
+            return &coreconf_sids[i];
+        }
+    }
+    return NULL;
+}
+
+static const coreconf_sid_t *sid_child(const coreconf_sid_t *parent, const char *name) {
+    char path[CORECONF_PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/%s", parent->path, name);
+    return sid_by_path(path);
+}
+
+static const coreconf_enum_t *enum_by_name(uint32_t leaf_sid, const char *name, size_t len) {
+    for (size_t i = 0; i < coreconf_num_enums; i++) {
+        if (coreconf_enums[i].leaf_sid == leaf_sid &&
+            strlen(coreconf_enums[i].name) == len &&
+            strncmp(coreconf_enums[i].name, name, len) == 0) {
+            return &coreconf_enums[i];
+        }
+    }
+    return NULL;
+}
+
+static const coreconf_enum_t *enum_by_value(uint32_t leaf_sid, int64_t value) {
+    for (size_t i = 0; i < coreconf_num_enums; i++) {
+        if (coreconf_enums[i].leaf_sid == leaf_sid && coreconf_enums[i].value == value) {
+            return &coreconf_enums[i];
+        }
+    }
+    return NULL;
+}
+
+static const coreconf_identity_t *identity_by_name(const char *name, size_t len) {
+    for (size_t i = 0; i < coreconf_num_identities; i++) {
+        if (strlen(coreconf_identities[i].name) == len &&
+            strncmp(coreconf_identities[i].name, name, len) == 0) {
+            return &coreconf_identities[i];
+        }
+    }
+    return NULL;
+}
+
+static const coreconf_identity_t *identity_by_sid(uint64_t sid) {
+    for (size_t i = 0; i < coreconf_num_identities; i++) {
+        if (coreconf_identities[i].sid == sid) {
+            return &coreconf_identities[i];
+        }
+    }
+    return NULL;
+}
+
+/* Member name for a schema node: last path segment without module prefix */
+static const char *sid_name(const coreconf_sid_t *row) {
+    const char *name = strrchr(row->path, '/');
+    const char *colon;
+
+    name = name ? name + 1 : row->path;
+    colon = strchr(name, ':');
+    return colon ? colon + 1 : name;
+}
+
+/* Encode a text value of an enumeration / identityref / string leaf */
+static void encode_text_leaf(cbor_out_t *o, const coreconf_sid_t *row, const char *s, size_t len) {
+    if (row->type == CORECONF_ENUM) {
+        const coreconf_enum_t *e = enum_by_name(row->sid, s, len);
+        if (e) {
+            cbor_int(o, e->value);
+            return;
+        }
+    } else if (row->type == CORECONF_IDENTITYREF) {
+        const coreconf_identity_t *id = identity_by_name(s, len);
+        if (id) {
+            cbor_head(o, CBOR_UINT, id->sid);
+            return;
+        }
+    } else if (row->type == CORECONF_UINT) {
+        char tmp[24];
+        if (len < sizeof(tmp)) {
+            memcpy(tmp, s, len);
+            tmp[len] = '\0';
+            cbor_head(o, CBOR_UINT, strtoull(tmp, NULL, 10));
+            return;
+        }
+    } else if (row->type == CORECONF_BOOL) {
+        cbor_head(o, CBOR_SIMPLE, (len == 4 && strncmp(s, "true", 4) == 0) ? CBOR_TRUE : CBOR_FALSE);
+        return;
+    }
+    /* Unknown enum/identity names fall back to their string form */
+    cbor_text(o, s, len);
+}
+
+/*
+ * Encode an instance identifier: SID alone, or [SID, key...] when the
+ * path carries list keys, e.g. interface[name='10']/.../port-type
+ */
+static int encode_iid(cbor_out_t *o, const char *path, const coreconf_sid_t **target) {
+    char schema[CORECONF_PATH_MAX];
+    struct { const char *val; size_t len; const coreconf_sid_t *leaf; } keys[CORECONF_MAX_KEYS];
+    size_t n = 0;
+    int n_keys = 0;
+
+    for (const char *p = path; *p; ) {
+        if (*p != '[') {
+            if (n + 1 >= sizeof(schema)) return -ENAMETOOLONG;
+            schema[n++] = *p++;
+            continue;
+        }
+
+        /* [key='value'] predicate on the list ending at schema[n] */
+        const char *eq = strchr(p, '=');
+        const char *end = eq ? strchr(eq + 2, eq[1]) : NULL;
+        char key_path[CORECONF_PATH_MAX];
+
+        if (eq == NULL || end == NULL || n_keys >= CORECONF_MAX_KEYS ||
+            (eq[1] != '\'' && eq[1] != '"')) {
+            return -EINVAL;
+        }
+        schema[n] = '\0';
+        if (snprintf(key_path, sizeof(key_path), "%s/%.*s", schema,
+                     (int)(eq - p - 1), p + 1) >= (int)sizeof(key_path)) {
+            return -ENAMETOOLONG;
+        }
+        keys[n_keys].leaf = sid_by_path(key_path);
+        if (keys[n_keys].leaf == NULL) {
+            return -ENOENT;
+        }
+        keys[n_keys].val = eq + 2;
+        keys[n_keys].len = end - (eq + 2);
+        n_keys++;
+        p = end + 2;    /* skip quote and ']' */
+    }
+    schema[n] = '\0';
+
+    *target = sid_by_path(schema);
+    if (*target == NULL) {
+        return -ENOENT;
+    }
+
+    if (n_keys == 0) {
+        cbor_head(o, CBOR_UINT, (*target)->sid);
+        return 0;
+    }
+    cbor_head(o, CBOR_ARRAY, 1 + n_keys);
+    cbor_head(o, CBOR_UINT, (*target)->sid);
+    for (int i = 0; i < n_keys; i++) {
+        encode_text_leaf(o, keys[i].leaf, keys[i].val, keys[i].len);
+    }
+    return 0;
+}
+
+static int encode_value(cbor_out_t *o, const evb_changeset_t *cs, int idx,
+                        const coreconf_sid_t *row) {
+    const evb_node_t *node = &cs->nodes[idx];
+    int count = 0, ret;
+
+    switch (node->type) {
+    case EVB_NODE_LIST:
+        for (int c = node->first_child; c != EVB_CS_NONE; c = cs->nodes[c].next) count++;
+        cbor_head(o, CBOR_ARRAY, count);
+        for (int c = node->first_child; c != EVB_CS_NONE; c = cs->nodes[c].next) {
+            if ((ret = encode_value(o, cs, c, row)) < 0) return ret;
+        }
+        return 0;
+
+    case EVB_NODE_MAP:
+        /* Members are keyed by SID delta from the enclosing node */
+        for (int c = node->first_child; c != EVB_CS_NONE; c = cs->nodes[c].next) count++;
+        cbor_head(o, CBOR_MAP, count);
+        for (int c = node->first_child; c != EVB_CS_NONE; c = cs->nodes[c].next) {
+            const coreconf_sid_t *child = sid_child(row, evb_cs_str(cs, cs->nodes[c].key));
+            if (child == NULL) {
+                return -ENOENT;
+            }
+            cbor_int(o, (int64_t)child->sid - (int64_t)row->sid);
+            if ((ret = encode_value(o, cs, c, child)) < 0) return ret;
+        }
+        return 0;
+
+    case EVB_NODE_UINT:
+        cbor_head(o, CBOR_UINT, node->v.uint);
+        return 0;
+
+    case EVB_NODE_BOOL:
+        cbor_head(o, CBOR_SIMPLE, node->v.boolean ? CBOR_TRUE : CBOR_FALSE);
+        return 0;
+
+    case EVB_NODE_STRING:
+    case EVB_NODE_IDENTITY: {
+        const char *s = evb_cs_str(cs, node->v.str);
+        if (node->type == EVB_NODE_STRING && row->type == CORECONF_STRING) {
+            cbor_text(o, s, strlen(s));
+        } else {
+            encode_text_leaf(o, row, s, strlen(s));
+        }
+        return 0;
+    }
+    }
+    return -EINVAL;
+}
+
+int coreconf_encode_patch(const evb_changeset_t *cs, uint8_t *out, size_t size) {
+    cbor_out_t o = { out, size, 0, false };
+
+    if (cs->overflow) {
+        return -E2BIG;
+    }
+    for (int i = 0; i < cs->n_entries; i++) {
+        const coreconf_sid_t *row;
+        int ret;
+
+        if (cs->entries[i].value == EVB_CS_NONE) {
+            continue;
+        }
+        cbor_head(&o, CBOR_MAP, 1);
+        if ((ret = encode_iid(&o, evb_cs_str(cs, cs->entries[i].path), &row)) < 0 ||
+            (ret = encode_value(&o, cs, cs->entries[i].value, row)) < 0) {
+            return ret;
+        }
+    }
+    return o.overflow ? -ENOSPC : (int)o.len;
+}
+
+int coreconf_encode_fetch(const evb_changeset_t *cs, uint8_t *out, size_t size) {
+    cbor_out_t o = { out, size, 0, false };
+
+    if (cs->overflow) {
+        return -E2BIG;
+    }
+    for (int i = 0; i < cs->n_entries; i++) {
+        const coreconf_sid_t *row;
+        int ret = encode_iid(&o, evb_cs_str(cs, cs->entries[i].path), &row);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return o.overflow ? -ENOSPC : (int)o.len;
+}
+
+/* Decode a scalar key or leaf value into text, using the leaf's schema type */
+static int decode_text(cbor_in_t *in, const coreconf_sid_t *leaf, char *out, size_t size) {
+    uint8_t major;
+    uint64_t val;
+    int ret = cbor_read_head(in, &major, &val);
+
+    if (ret < 0) {
+        return ret;
+    }
+    switch (major) {
+    case CBOR_UINT:
+    case CBOR_NEGINT: {
+        int64_t v = (major == CBOR_UINT) ? (int64_t)val : -1 - (int64_t)val;
+        const coreconf_enum_t *e = leaf && leaf->type == CORECONF_ENUM ? enum_by_value(leaf->sid, v) : NULL;
+        const coreconf_identity_t *id = leaf && leaf->type == CORECONF_IDENTITYREF ? identity_by_sid(val) : NULL;
+        if (e) snprintf(out, size, "%s", e->name);
+        else if (id) snprintf(out, size, "%s", id->name);
+        else snprintf(out, size, "%lld", (long long)v);
+        return 0;
+    }
+    case CBOR_TEXT:
+        if (val > in->len - in->pos) return -EPROTO;
+        snprintf(out, size, "%.*s", (int)val, (const char *)in->buf + in->pos);
+        in->pos += val;
+        return 0;
+    case CBOR_SIMPLE:
+        snprintf(out, size, "%s", val == CBOR_TRUE ? "true" : "false");
+        return 0;
+    default:
+        return -EPROTO;
+    }
+}
+
+/* Rebuild the instance path from an instance identifier */
+static int decode_iid(cbor_in_t *in, char *path, size_t size, const coreconf_sid_t **target) {
+    uint8_t major;
+    uint64_t val, n_keys = 0;
+    int ret = cbor_read_head(in, &major, &val);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (major == CBOR_ARRAY) {
+        if (val == 0) return -EPROTO;
+        n_keys = val - 1;
+        if ((ret = cbor_read_head(in, &major, &val)) < 0) return ret;
+    }
+    if (major != CBOR_UINT || (*target = sid_by_value(val)) == NULL) {
+        return -ENOENT;
+    }
+
+    /* Walk the schema path, attaching keys to each list in order */
+    const char *schema = (*target)->path;
+    size_t n = 0;
+    for (const char *p = schema; ; p++) {
+        if (*p == '/' || *p == '\0') {
+            char prefix[CORECONF_PATH_MAX];
+            const coreconf_sid_t *list;
+
+            snprintf(prefix, sizeof(prefix), "%.*s", (int)(p - schema), schema);
+            list = sid_by_path(prefix);
+            if (n_keys > 0 && list && list->type == CORECONF_LIST && list->keys) {
+                for (const char *k = list->keys; *k && n_keys > 0; ) {
+                    const char *comma = strchr(k, ',');
+                    size_t klen = comma ? (size_t)(comma - k) : strlen(k);
+                    char name[64], value[128];
+                    const coreconf_sid_t *leaf;
+
+                    snprintf(name, sizeof(name), "%.*s", (int)klen, k);
+                    leaf = sid_child(list, name);
+                    if ((ret = decode_text(in, leaf, value, sizeof(value))) < 0) return ret;
+                    n += snprintf(path + n, n < size ? size - n : 0, "[%s='%s']", name, value);
+                    n_keys--;
+                    k = comma ? comma + 1 : k + klen;
+                }
+            }
+        }
+        if (*p == '\0') break;
+        if (n + 1 < size) path[n] = *p;
+        n++;
+    }
+    if (n >= size || n_keys > 0) {
+        return -EPROTO;
+    }
+    path[n] = '\0';
+    return 0;
+}
+
+/* Decode one value under parent (or as the entry root when parent is NONE) */
+static int decode_value(cbor_in_t *in, evb_changeset_t *cs, int parent, const char *name,
+                        const char *path, const coreconf_sid_t *row) {
+    size_t start = in->pos;
+    uint8_t major;
+    uint64_t val;
+    int node, ret;
+
+    if ((ret = cbor_read_head(in, &major, &val)) < 0) {
+        return ret;
+    }
+
+    switch (major) {
+    case CBOR_MAP:
+        node = (parent == EVB_CS_NONE) ? evb_cs_set_map(cs, "%s", path) : evb_cs_map(cs, parent, name);
+        for (uint64_t i = 0; i < val; i++) {
+            uint8_t kmajor;
+            uint64_t kval;
+            const coreconf_sid_t *child;
+
+            if ((ret = cbor_read_head(in, &kmajor, &kval)) < 0) return ret;
+            if (kmajor != CBOR_UINT && kmajor != CBOR_NEGINT) return -EPROTO;
+            child = sid_by_value(row->sid + (kmajor == CBOR_UINT ? (int64_t)kval : -1 - (int64_t)kval));
+            if (child == NULL) {
+                /* Unknown member (newer firmware): skip it */
+                if ((ret = cbor_skip(in)) < 0) return ret;
+                continue;
+            }
+            if ((ret = decode_value(in, cs, node, sid_name(child), NULL, child)) < 0) return ret;
+        }
+        return 0;
+
+    case CBOR_ARRAY:
+        node = (parent == EVB_CS_NONE) ? evb_cs_set_list(cs, "%s", path) : evb_cs_list(cs, parent, name);
+        for (uint64_t i = 0; i < val; i++) {
+            if ((ret = decode_value(in, cs, node, NULL, NULL, row)) < 0) return ret;
+        }
+        return 0;
+
+    case CBOR_UINT:
+        if (row->type != CORECONF_ENUM && row->type != CORECONF_IDENTITYREF) {
+            if (parent == EVB_CS_NONE) evb_cs_set_uint(cs, val, "%s", path);
+            else evb_cs_uint(cs, parent, name, val);
+            return 0;
+        }
+        /* fall through */
+    case CBOR_NEGINT:
+    case CBOR_TEXT:
+    case CBOR_SIMPLE: {
+        char text[256];
+
+        in->pos = start;
+        if ((ret = decode_text(in, row, text, sizeof(text))) < 0) {
+            return ret;
+        }
+        if (major == CBOR_SIMPLE) {
+            bool b = (val == CBOR_TRUE);
+            if (parent == EVB_CS_NONE) evb_cs_set_bool(cs, b, "%s", path);
+            else evb_cs_bool(cs, parent, name, b);
+        } else if (row->type == CORECONF_ENUM || row->type == CORECONF_IDENTITYREF) {
+            if (parent == EVB_CS_NONE) evb_cs_set_identity(cs, text, "%s", path);
+            else evb_cs_identity(cs, parent, name, text);
+        } else {
+            if (parent == EVB_CS_NONE) evb_cs_set_string(cs, text, "%s", path);
+            else evb_cs_string(cs, parent, name, text);
+        }
+        return 0;
+    }
+
+    default:
+        in->pos = start;
+        return cbor_skip(in);
+    }
+}
+
+int coreconf_decode(const uint8_t *buf, size_t len, evb_changeset_t *cs) {
+    cbor_in_t in = { buf, len, 0 };
+    int entries = 0;
+
+    while (in.pos < in.len) {
+        uint8_t major;
+        uint64_t pairs;
+        int ret = cbor_read_head(&in, &major, &pairs);
+
+        if (ret < 0) return ret;
+        if (major != CBOR_MAP) return -EPROTO;
+
+        for (uint64_t i = 0; i < pairs; i++) {
+            char path[CORECONF_PATH_MAX];
+            const coreconf_sid_t *row;
+
+            if ((ret = decode_iid(&in, path, sizeof(path), &row)) < 0 ||
+                (ret = decode_value(&in, cs, EVB_CS_NONE, NULL, path, row)) < 0) {
+                return ret;
+            }
+            entries++;
+        }
+    }
+    return cs->overflow ? -E2BIG : entries;
+}
+
+int coreconf_decode_fetch(const uint8_t *buf, size_t len, evb_changeset_t *cs) {
+    cbor_in_t in = { buf, len, 0 };
+    int entries = 0;
+
+    while (in.pos < in.len) {
+        char path[CORECONF_PATH_MAX];
+        const coreconf_sid_t *row;
+        int ret = decode_iid(&in, path, sizeof(path), &row);
+
+        if (ret < 0) {
+            return ret;
+        }
+        evb_cs_fetch(cs, "%s", path);
+        entries++;
+    }
+    return cs->overflow ? -E2BIG : entries;
+}
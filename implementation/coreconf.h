@@ -0,0 +1,86 @@
+/**
+ * CORECONF (RFC 9254 YANG-CBOR) encoding of EVB-LAN9692 change sets
+ * Instance paths become SIDs and map members become delta-SIDs
+ */
+
+#ifndef CORECONF_H
+#define CORECONF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "evb_changeset.h"
+
+/* Schema Node Types (how leaf values are encoded) */
+typedef enum {
+    CORECONF_NODE = 0,          /* container */
+    CORECONF_LIST,
+    CORECONF_UINT,
+    CORECONF_BOOL,
+    CORECONF_STRING,
+    CORECONF_ENUM,              /* encoded as the enum integer */
+    CORECONF_IDENTITYREF,       /* encoded as the identity SID */
+} coreconf_type_t;
+
+/* SID Table Row */
+typedef struct {
+    uint32_t sid;
+    const char *path;           /* schema path, module prefix where the module changes */
+    coreconf_type_t type;
+    const char *keys;           /* lists: comma separated key leaf names */
+} coreconf_sid_t;
+
+/* Enumeration Value */
+typedef struct {
+    uint32_t leaf_sid;
+    const char *name;
+    int32_t value;
+} coreconf_enum_t;
+
+/* Identity */
+typedef struct {
+    uint32_t sid;
+    const char *name;           /* module:identity */
+} coreconf_identity_t;
+
+/* Tables, see coreconf_sid.c */
+extern const coreconf_sid_t coreconf_sids[];
+extern const size_t coreconf_num_sids;
+extern const coreconf_enum_t coreconf_enums[];
+extern const size_t coreconf_num_enums;
+extern const coreconf_identity_t coreconf_identities[];
+extern const size_t coreconf_num_identities;
+
+/**
+ * Encode the valued entries of a change set as an iPATCH body
+ * (application/yang-instances+cbor-seq)
+ * @param cs: Change set
+ * @param out: Output buffer
+ * @param size: Buffer size
+ * @return: Encoded length, -ENOENT if a path has no SID, negative on error
+ */
+int coreconf_encode_patch(const evb_changeset_t *cs, uint8_t *out, size_t size);
+
+/**
+ * Encode the paths of a change set as a FETCH body
+ * (application/yang-identifiers+cbor-seq)
+ * @return: Encoded length, -ENOENT if a path has no SID, negative on error
+ */
+int coreconf_encode_fetch(const evb_changeset_t *cs, uint8_t *out, size_t size);
+
+/**
+ * Decode an instances sequence (iPATCH body or FETCH response)
+ * Entries are appended to cs with instance paths rebuilt from the SIDs
+ * @param buf: CBOR sequence
+ * @param len: Length
+ * @param cs: Change set to fill
+ * @return: Number of entries decoded, negative on error
+ */
+int coreconf_decode(const uint8_t *buf, size_t len, evb_changeset_t *cs);
+
+/**
+ * Decode an identifiers sequence (FETCH body) into fetch-only entries
+ * @return: Number of entries decoded, negative on error
+ */
+int coreconf_decode_fetch(const uint8_t *buf, size_t len, evb_changeset_t *cs);
+
+#endif /* CORECONF_H */
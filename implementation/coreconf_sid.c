@@ -0,0 +1,97 @@
+/**
+ * CORECONF SID assignments for the EVB-LAN9692 YANG models
+ *
+ * PLACEHOLDER values: they must match the .sid files of the firmware's
+ * YANG catalog. Regenerate this table from the catalog (pyang --sid-*)
+ * before talking CBOR to a real board.
+ */
+
+#include "coreconf.h"
+
+#define IF              "/ietf-interfaces:interfaces/interface"
+#define BP              IF "/ieee802-dot1q-bridge:bridge-port"
+#define FDB             "/ieee802-dot1q-bridge:bridges/bridge/component/filtering-database"
+#define QOS             IF "/mchp-velocitysp-port:eth-qos"
+#define PORT            IF "/mchp-velocitysp-port:eth-port"
+
+const coreconf_sid_t coreconf_sids[] = {
+    /* ietf-interfaces */
+    { 1000, "/ietf-interfaces:interfaces",                                  CORECONF_NODE,   NULL },
+    { 1001, IF,                                                             CORECONF_LIST,   "name" },
+    { 1002, IF "/name",                                                     CORECONF_STRING, NULL },
+
+    /* ieee802-dot1q-bridge: bridge port */
+    { 2000, BP,                                                             CORECONF_NODE,   NULL },
+    { 2001, BP "/port-type",                                                CORECONF_IDENTITYREF, NULL },
+    { 2002, BP "/acceptable-frame",                                         CORECONF_ENUM,   NULL },
+    { 2003, BP "/enable-ingress-filtering",                                 CORECONF_BOOL,   NULL },
+    { 2004, BP "/pcp-decoding-table",                                       CORECONF_NODE,   NULL },
+    { 2005, BP "/pcp-decoding-table/pcp-decoding-map",                      CORECONF_LIST,   "pcp" },
+    { 2006, BP "/pcp-decoding-table/pcp-decoding-map/pcp",                  CORECONF_ENUM,   NULL },
+    { 2007, BP "/pcp-decoding-table/pcp-decoding-map/priority-map",         CORECONF_LIST,   "priority-code-point" },
+    { 2008, BP "/pcp-decoding-table/pcp-decoding-map/priority-map/priority-code-point", CORECONF_UINT, NULL },
+    { 2009, BP "/pcp-decoding-table/pcp-decoding-map/priority-map/priority", CORECONF_UINT,  NULL },
+    { 2010, BP "/pcp-decoding-table/pcp-decoding-map/priority-map/drop-eligible", CORECONF_BOOL, NULL },
+    { 2011, BP "/pcp-encoding-table",                                       CORECONF_NODE,   NULL },
+    { 2012, BP "/pcp-encoding-table/pcp-encoding-map",                      CORECONF_LIST,   "pcp" },
+    { 2013, BP "/pcp-encoding-table/pcp-encoding-map/pcp",                  CORECONF_ENUM,   NULL },
+    { 2014, BP "/pcp-encoding-table/pcp-encoding-map/priority-map",         CORECONF_LIST,   "priority,dei" },
+    { 2015, BP "/pcp-encoding-table/pcp-encoding-map/priority-map/priority", CORECONF_UINT,  NULL },
+    { 2016, BP "/pcp-encoding-table/pcp-encoding-map/priority-map/dei",     CORECONF_BOOL,   NULL },
+    { 2017, BP "/pcp-encoding-table/pcp-encoding-map/priority-map/priority-code-point", CORECONF_UINT, NULL },
+
+    /* ieee802-dot1q-bridge: bridges */
+    { 2100, "/ieee802-dot1q-bridge:bridges",                                CORECONF_NODE,   NULL },
+    { 2101, "/ieee802-dot1q-bridge:bridges/bridge",                         CORECONF_LIST,   "name" },
+    { 2102, "/ieee802-dot1q-bridge:bridges/bridge/name",                    CORECONF_STRING, NULL },
+    { 2103, "/ieee802-dot1q-bridge:bridges/bridge/component",               CORECONF_LIST,   "name" },
+    { 2104, "/ieee802-dot1q-bridge:bridges/bridge/component/name",          CORECONF_STRING, NULL },
+    { 2105, FDB,                                                            CORECONF_NODE,   NULL },
+    { 2106, FDB "/vlan-registration-entry",                                 CORECONF_LIST,   "database-id,vids" },
+    { 2107, FDB "/vlan-registration-entry/database-id",                     CORECONF_UINT,   NULL },
+    { 2108, FDB "/vlan-registration-entry/vids",                            CORECONF_STRING, NULL },
+    { 2109, FDB "/vlan-registration-entry/entry-type",                      CORECONF_ENUM,   NULL },
+    { 2110, FDB "/vlan-registration-entry/port-map",                        CORECONF_LIST,   "port-ref" },
+    { 2111, FDB "/vlan-registration-entry/port-map/port-ref",               CORECONF_UINT,   NULL },
+    { 2112, FDB "/vlan-registration-entry/port-map/static-vlan-registration-entries", CORECONF_NODE, NULL },
+    { 2113, FDB "/vlan-registration-entry/port-map/static-vlan-registration-entries/vlan-transmitted", CORECONF_ENUM, NULL },
+
+    /* mchp-velocitysp-port: QoS */
+    { 3000, QOS,                                                            CORECONF_NODE,   NULL },
+    { 3001, QOS "/config",                                                  CORECONF_NODE,   NULL },
+    { 3002, QOS "/config/traffic-class-shapers",                            CORECONF_LIST,   "traffic-class" },
+    { 3003, QOS "/config/traffic-class-shapers/traffic-class",              CORECONF_UINT,   NULL },
+    { 3004, QOS "/config/traffic-class-shapers/credit-based",               CORECONF_NODE,   NULL },
+    { 3005, QOS "/config/traffic-class-shapers/credit-based/idle-slope",    CORECONF_UINT,   NULL },
+
+    /* mchp-velocitysp-port: statistics */
+    { 3010, PORT,                                                           CORECONF_NODE,   NULL },
+    { 3011, PORT "/statistics",                                             CORECONF_NODE,   NULL },
+    { 3012, PORT "/statistics/traffic-class",                               CORECONF_LIST,   "traffic-class" },
+    { 3013, PORT "/statistics/traffic-class/traffic-class",                 CORECONF_UINT,   NULL },
+    { 3014, PORT "/statistics/traffic-class/tx-frames",                     CORECONF_UINT,   NULL },
+    { 3015, PORT "/statistics/traffic-class/tx-octets",                     CORECONF_UINT,   NULL },
+    { 3016, PORT "/statistics/traffic-class/rx-frames",                     CORECONF_UINT,   NULL },
+    { 3017, PORT "/statistics/traffic-class/rx-octets",                     CORECONF_UINT,   NULL },
+    { 3018, PORT "/statistics/traffic-class/drops",                         CORECONF_UINT,   NULL },
+};
+const size_t coreconf_num_sids = sizeof(coreconf_sids) / sizeof(coreconf_sids[0]);
+
+const coreconf_enum_t coreconf_enums[] = {
+    { 2002, "admit-only-VLAN-tagged-frames",                1 },
+    { 2002, "admit-only-untagged-and-priority-tagged",      2 },
+    { 2002, "admit-all-frames",                             3 },
+    { 2006, "8P0D", 1 }, { 2006, "7P1D", 2 }, { 2006, "6P2D", 3 }, { 2006, "5P3D", 4 },
+    { 2013, "8P0D", 1 }, { 2013, "7P1D", 2 }, { 2013, "6P2D", 3 }, { 2013, "5P3D", 4 },
+    { 2109, "static", 1 }, { 2109, "dynamic", 2 },
+    { 2113, "tagged", 1 }, { 2113, "untagged", 2 },
+};
+const size_t coreconf_num_enums = sizeof(coreconf_enums) / sizeof(coreconf_enums[0]);
+
+const coreconf_identity_t coreconf_identities[] = {
+    { 2200, "ieee802-dot1q-bridge:c-vlan-bridge-port" },
+    { 2201, "ieee802-dot1q-bridge:customer-network-port" },
+    { 2202, "ieee802-dot1q-bridge:customer-edge-port" },
+    { 2203, "ieee802-dot1q-bridge:d-bridge-port" },
+};
+const size_t coreconf_num_identities = sizeof(coreconf_identities) / sizeof(coreconf_identities[0]);
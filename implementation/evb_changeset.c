@@ -0,0 +1,849 @@
+/**
+ * In-memory YANG change sets for the EVB-LAN9692
+ * Builder, YAML renderer and the matching YAML reader
+ */
+
+#include "evb_changeset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+
+void evb_cs_init(evb_changeset_t *cs) {
+    cs->n_entries = 0;
+    cs->n_nodes = 0;
+    cs->pool_len = 0;
+    cs->overflow = false;
+}
+
+static int cs_intern(evb_changeset_t *cs, const char *fmt, va_list ap) {
+    size_t room = sizeof(cs->pool) - cs->pool_len;
+    int n = vsnprintf(cs->pool + cs->pool_len, room, fmt, ap);
+
+    if (n < 0 || (size_t)n >= room) {
+        cs->overflow = true;
+        return EVB_CS_NONE;
+    }
+    int offset = (int)cs->pool_len;
+    cs->pool_len += n + 1;
+    return offset;
+}
+
+static int cs_string(evb_changeset_t *cs, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int offset = cs_intern(cs, fmt, ap);
+    va_end(ap);
+    return offset;
+}
+
+static int cs_node(evb_changeset_t *cs, int parent, const char *key, evb_node_type_t type) {
+    if (cs->n_nodes >= EVB_CS_MAX_NODES || (parent == EVB_CS_NONE && key != NULL)) {
+        cs->overflow = true;
+        return EVB_CS_NONE;
+    }
+
+    int idx = cs->n_nodes;
+    evb_node_t *n = &cs->nodes[idx];
+
+    n->type = type;
+    n->key = key ? cs_string(cs, "%s", key) : EVB_CS_NONE;
+    n->first_child = n->last_child = n->next = EVB_CS_NONE;
+    n->v.uint = 0;
+    cs->n_nodes++;
+
+    if (parent != EVB_CS_NONE) {
+        evb_node_t *p = &cs->nodes[parent];
+        if (p->last_child == EVB_CS_NONE) {
+            p->first_child = idx;
+        } else {
+            cs->nodes[p->last_child].next = idx;
+        }
+        p->last_child = idx;
+    }
+    return idx;
+}
+
+static int cs_entry(evb_changeset_t *cs, int value, const char *fmt, va_list ap) {
+    if (cs->n_entries >= EVB_CS_MAX_ENTRIES) {
+        cs->overflow = true;
+        return EVB_CS_NONE;
+    }
+
+    int path = cs_intern(cs, fmt, ap);
+    if (path == EVB_CS_NONE) {
+        return EVB_CS_NONE;
+    }
+    cs->entries[cs->n_entries].path = path;
+    cs->entries[cs->n_entries].value = value;
+    cs->n_entries++;
+    return 0;
+}
+
+/* Root value nodes have no parent and no key */
+static int cs_root(evb_changeset_t *cs, int node, const char *fmt, va_list ap) {
+    if (node == EVB_CS_NONE || cs_entry(cs, node, fmt, ap) < 0) {
+        return EVB_CS_NONE;
+    }
+    return node;
+}
+
+int evb_cs_set_map(evb_changeset_t *cs, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int node = cs_root(cs, cs_node(cs, EVB_CS_NONE, NULL, EVB_NODE_MAP), fmt, ap);
+    va_end(ap);
+    return node;
+}
+
+int evb_cs_set_list(evb_changeset_t *cs, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int node = cs_root(cs, cs_node(cs, EVB_CS_NONE, NULL, EVB_NODE_LIST), fmt, ap);
+    va_end(ap);
+    return node;
+}
+
+int evb_cs_set_identity(evb_changeset_t *cs, const char *value, const char *fmt, ...) {
+    int node = cs_node(cs, EVB_CS_NONE, NULL, EVB_NODE_IDENTITY);
+    va_list ap;
+
+    if (node != EVB_CS_NONE) {
+        cs->nodes[node].v.str = cs_string(cs, "%s", value);
+    }
+    va_start(ap, fmt);
+    node = cs_root(cs, node, fmt, ap);
+    va_end(ap);
+    return node < 0 ? node : 0;
+}
+
+int evb_cs_set_bool(evb_changeset_t *cs, bool value, const char *fmt, ...) {
+    int node = cs_node(cs, EVB_CS_NONE, NULL, EVB_NODE_BOOL);
+    va_list ap;
+
+    if (node != EVB_CS_NONE) {
+        cs->nodes[node].v.boolean = value;
+    }
+    va_start(ap, fmt);
+    node = cs_root(cs, node, fmt, ap);
+    va_end(ap);
+    return node < 0 ? node : 0;
+}
+
+int evb_cs_set_uint(evb_changeset_t *cs, uint64_t value, const char *fmt, ...) {
+    int node = cs_node(cs, EVB_CS_NONE, NULL, EVB_NODE_UINT);
+    va_list ap;
+
+    if (node != EVB_CS_NONE) {
+        cs->nodes[node].v.uint = value;
+    }
+    va_start(ap, fmt);
+    node = cs_root(cs, node, fmt, ap);
+    va_end(ap);
+    return node < 0 ? node : 0;
+}
+
+int evb_cs_set_string(evb_changeset_t *cs, const char *value, const char *fmt, ...) {
+    int node = cs_node(cs, EVB_CS_NONE, NULL, EVB_NODE_STRING);
+    va_list ap;
+
+    if (node != EVB_CS_NONE) {
+        cs->nodes[node].v.str = cs_string(cs, "%s", value);
+    }
+    va_start(ap, fmt);
+    node = cs_root(cs, node, fmt, ap);
+    va_end(ap);
+    return node < 0 ? node : 0;
+}
+
+int evb_cs_fetch(evb_changeset_t *cs, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = cs_entry(cs, EVB_CS_NONE, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+int evb_cs_map(evb_changeset_t *cs, int parent, const char *key) {
+    return parent == EVB_CS_NONE ? EVB_CS_NONE : cs_node(cs, parent, key, EVB_NODE_MAP);
+}
+
+int evb_cs_list(evb_changeset_t *cs, int parent, const char *key) {
+    return parent == EVB_CS_NONE ? EVB_CS_NONE : cs_node(cs, parent, key, EVB_NODE_LIST);
+}
+
+int evb_cs_uint(evb_changeset_t *cs, int parent, const char *key, uint64_t value) {
+    int node = parent == EVB_CS_NONE ? EVB_CS_NONE : cs_node(cs, parent, key, EVB_NODE_UINT);
+    if (node != EVB_CS_NONE) {
+        cs->nodes[node].v.uint = value;
+    }
+    return node;
+}
+
+int evb_cs_bool(evb_changeset_t *cs, int parent, const char *key, bool value) {
+    int node = parent == EVB_CS_NONE ? EVB_CS_NONE : cs_node(cs, parent, key, EVB_NODE_BOOL);
+    if (node != EVB_CS_NONE) {
+        cs->nodes[node].v.boolean = value;
+    }
+    return node;
+}
+
+int evb_cs_string(evb_changeset_t *cs, int parent, const char *key, const char *value) {
+    int node = parent == EVB_CS_NONE ? EVB_CS_NONE : cs_node(cs, parent, key, EVB_NODE_STRING);
+    if (node != EVB_CS_NONE) {
+        cs->nodes[node].v.str = cs_string(cs, "%s", value);
+    }
+    return node;
+}
+
+int evb_cs_identity(evb_changeset_t *cs, int parent, const char *key, const char *value) {
+    int node = evb_cs_string(cs, parent, key, value);
+    if (node != EVB_CS_NONE) {
+        cs->nodes[node].type = EVB_NODE_IDENTITY;
+    }
+    return node;
+}
+
+int evb_cs_find(const evb_changeset_t *cs, const char *path) {
+    for (int i = 0; i < cs->n_entries; i++) {
+        if (strcmp(evb_cs_str(cs, cs->entries[i].path), path) == 0) {
+            return i;
+        }
+    }
+    return EVB_CS_NONE;
+}
+
+static int cs_copy_node(evb_changeset_t *dst, int parent, const evb_changeset_t *src, int idx) {
+    const evb_node_t *n = &src->nodes[idx];
+    int node = cs_node(dst, parent, n->key == EVB_CS_NONE ? NULL : evb_cs_str(src, n->key), n->type);
+
+    if (node == EVB_CS_NONE) {
+        return EVB_CS_NONE;
+    }
+    if (n->type == EVB_NODE_STRING || n->type == EVB_NODE_IDENTITY) {
+        dst->nodes[node].v.str = cs_string(dst, "%s", evb_cs_str(src, n->v.str));
+    } else {
+        dst->nodes[node].v = n->v;
+    }
+    for (int c = n->first_child; c != EVB_CS_NONE; c = src->nodes[c].next) {
+        if (cs_copy_node(dst, node, src, c) == EVB_CS_NONE) {
+            return EVB_CS_NONE;
+        }
+    }
+    return node;
+}
+
+int evb_cs_copy_entry(evb_changeset_t *dst, const evb_changeset_t *src, int entry) {
+    const char *path = evb_cs_str(src, src->entries[entry].path);
+
+    if (src->entries[entry].value == EVB_CS_NONE) {
+        return evb_cs_fetch(dst, "%s", path);
+    }
+
+    int node = cs_copy_node(dst, EVB_CS_NONE, src, src->entries[entry].value);
+    if (node == EVB_CS_NONE) {
+        return EVB_CS_NONE;
+    }
+    if (dst->n_entries >= EVB_CS_MAX_ENTRIES) {
+        dst->overflow = true;
+        return EVB_CS_NONE;
+    }
+    int offset = cs_string(dst, "%s", path);
+    if (offset == EVB_CS_NONE) {
+        return EVB_CS_NONE;
+    }
+    dst->entries[dst->n_entries].path = offset;
+    dst->entries[dst->n_entries].value = node;
+    dst->n_entries++;
+    return 0;
+}
+
+/* YAML Rendering */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} yaml_out_t;
+
+static void yaml_printf(yaml_out_t *out, const char *fmt, ...) {
+    size_t room = out->len < out->size ? out->size - out->len : 0;
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(room ? out->buf + out->len : NULL, room, fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || (size_t)n >= room) {
+        out->overflow = true;
+    }
+    out->len += (n > 0) ? (size_t)n : 0;
+}
+
+static bool yaml_is_scalar(const evb_node_t *n) {
+    return n->type != EVB_NODE_MAP && n->type != EVB_NODE_LIST;
+}
+
+static void yaml_scalar(yaml_out_t *out, const evb_changeset_t *cs, const evb_node_t *n) {
+    switch (n->type) {
+    case EVB_NODE_UINT:     yaml_printf(out, "%llu", (unsigned long long)n->v.uint); break;
+    case EVB_NODE_BOOL:     yaml_printf(out, "%s", n->v.boolean ? "true" : "false"); break;
+    case EVB_NODE_STRING:   yaml_printf(out, "'%s'", evb_cs_str(cs, n->v.str)); break;
+    case EVB_NODE_IDENTITY: yaml_printf(out, "%s", evb_cs_str(cs, n->v.str)); break;
+    }
+}
+
+/* Flow style for list entries made only of leaves: { a: 1, b: 2 } */
+static bool yaml_flow_map(const evb_changeset_t *cs, const evb_node_t *n) {
+    if (n->type != EVB_NODE_MAP || n->first_child == EVB_CS_NONE) {
+        return false;
+    }
+    for (int c = n->first_child; c != EVB_CS_NONE; c = cs->nodes[c].next) {
+        if (!yaml_is_scalar(&cs->nodes[c])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Caller has already written the "key: " / "- " prefix for this value */
+static void yaml_value(yaml_out_t *out, const evb_changeset_t *cs, int idx, int indent) {
+    const evb_node_t *n = &cs->nodes[idx];
+
+    if (yaml_is_scalar(n)) {
+        yaml_scalar(out, cs, n);
+        yaml_printf(out, "\n");
+        return;
+    }
+    if (n->first_child == EVB_CS_NONE) {
+        yaml_printf(out, n->type == EVB_NODE_MAP ? "{}\n" : "[]\n");
+        return;
+    }
+
+    bool first = true;
+    for (int c = n->first_child; c != EVB_CS_NONE; c = cs->nodes[c].next) {
+        const evb_node_t *child = &cs->nodes[c];
+
+        if (!first) {
+            yaml_printf(out, "%*s", indent, "");
+        }
+        first = false;
+
+        if (n->type == EVB_NODE_LIST) {
+            yaml_printf(out, "- ");
+            if (yaml_flow_map(cs, child)) {
+                const char *sep = "{ ";
+                for (int g = child->first_child; g != EVB_CS_NONE; g = cs->nodes[g].next) {
+                    yaml_printf(out, "%s%s: ", sep, evb_cs_str(cs, cs->nodes[g].key));
+                    yaml_scalar(out, cs, &cs->nodes[g]);
+                    sep = ", ";
+                }
+                yaml_printf(out, " }\n");
+            } else {
+                yaml_value(out, cs, c, indent + 2);
+            }
+        } else if (yaml_is_scalar(child)) {
+            yaml_printf(out, "%s: ", evb_cs_str(cs, child->key));
+            yaml_value(out, cs, c, indent);
+        } else {
+            yaml_printf(out, "%s:\n%*s", evb_cs_str(cs, child->key), indent + 2, "");
+            yaml_value(out, cs, c, indent + 2);
+        }
+    }
+}
+
+int evb_cs_render_yaml(const evb_changeset_t *cs, char *buf, size_t size) {
+    yaml_out_t out = { buf, size, 0, false };
+
+    if (cs->overflow) {
+        return -E2BIG;
+    }
+    for (int i = 0; i < cs->n_entries; i++) {
+        const evb_cs_entry_t *e = &cs->entries[i];
+
+        if (e->value == EVB_CS_NONE) {
+            continue;
+        }
+        yaml_printf(&out, "- ? \"%s\"\n  : ", evb_cs_str(cs, e->path));
+        yaml_value(&out, cs, e->value, 4);
+    }
+    return out.overflow ? -ENOSPC : (int)out.len;
+}
+
+int evb_cs_render_fetch_yaml(const evb_changeset_t *cs, char *buf, size_t size) {
+    yaml_out_t out = { buf, size, 0, false };
+
+    if (cs->overflow) {
+        return -E2BIG;
+    }
+    for (int i = 0; i < cs->n_entries; i++) {
+        yaml_printf(&out, "- \"%s\"\n", evb_cs_str(cs, cs->entries[i].path));
+    }
+    return out.overflow ? -ENOSPC : (int)out.len;
+}
+
+/* YAML Reading (the subset evb_cs_render_yaml writes) */
+typedef struct {
+    evb_changeset_t *cs;
+    const char *p;
+    const char *end;
+    const char *line;           /* start of the current line, for the column */
+} yaml_in_t;
+
+typedef enum {
+    YAML_SCALAR = 0,
+    YAML_MAP,
+    YAML_LIST,
+    YAML_EMPTY_MAP,
+    YAML_EMPTY_LIST,
+} yaml_kind_t;
+
+static bool yaml_at(const yaml_in_t *in, const char *s) {
+    size_t n = strlen(s);
+    return (size_t)(in->end - in->p) >= n && memcmp(in->p, s, n) == 0;
+}
+
+static void yaml_next_line(yaml_in_t *in) {
+    const char *eol = memchr(in->p, '\n', in->end - in->p);
+
+    in->p = eol ? eol + 1 : in->end;
+    in->line = in->p;
+}
+
+/* Next line indented to column indent and starting with prefix, else stay put */
+static bool yaml_continues(yaml_in_t *in, int indent, const char *prefix) {
+    const char *p = in->p;
+
+    while (p < in->end && *p == ' ') {
+        p++;
+    }
+    if (p - in->line != indent || p >= in->end || *p == '\n' ||
+        (prefix && ((size_t)(in->end - p) < strlen(prefix) || memcmp(p, prefix, strlen(prefix)) != 0)) ||
+        (!prefix && in->end - p >= 2 && p[0] == '-' && p[1] == ' ')) {
+        return false;
+    }
+    in->p = p;
+    return true;
+}
+
+/* "key:" followed by a space or the end of the line */
+static size_t yaml_key_len(const yaml_in_t *in) {
+    const char *p = in->p;
+
+    while (p < in->end && *p != '\n' && *p != ' ' && *p != '\'' && *p != '{') {
+        if (*p == ':' && (p + 1 == in->end || p[1] == ' ' || p[1] == '\n')) {
+            return (size_t)(p - in->p);
+        }
+        p++;
+    }
+    return 0;
+}
+
+static yaml_kind_t yaml_kind(const yaml_in_t *in) {
+    if (yaml_at(in, "{}")) return YAML_EMPTY_MAP;
+    if (yaml_at(in, "[]")) return YAML_EMPTY_LIST;
+    if (yaml_at(in, "- ")) return YAML_LIST;
+    if (yaml_key_len(in) > 0) return YAML_MAP;
+    return YAML_SCALAR;
+}
+
+/* Leaf up to one of the stop characters (or the end of the line) */
+static int yaml_leaf(yaml_in_t *in, int parent, const char *key, const char *stops) {
+    const char *start = in->p;
+    char text[EVB_CS_POOL_SIZE / 4];
+    bool quoted = (*start == '\'');
+    size_t n;
+
+    if (quoted) {
+        const char *q = memchr(start + 1, '\'', in->end - start - 1);
+        if (q == NULL) {
+            return -EINVAL;
+        }
+        n = (size_t)(q - start - 1);
+        in->p = q + 1;
+        start++;
+    } else {
+        while (in->p < in->end && *in->p != '\n' && (*stops == '\0' || !strchr(stops, *in->p))) {
+            in->p++;
+        }
+        n = (size_t)(in->p - start);
+    }
+    if (n >= sizeof(text)) {
+        return -E2BIG;
+    }
+    memcpy(text, start, n);
+    text[n] = '\0';
+
+    if (quoted) {
+        return evb_cs_string(in->cs, parent, key, text);
+    }
+    if (strcmp(text, "true") == 0 || strcmp(text, "false") == 0) {
+        return evb_cs_bool(in->cs, parent, key, text[0] == 't');
+    }
+    if (n > 0 && strspn(text, "0123456789") == n) {
+        return evb_cs_uint(in->cs, parent, key, strtoull(text, NULL, 10));
+    }
+    return evb_cs_identity(in->cs, parent, key, text);
+}
+
+static int yaml_block(yaml_in_t *in, int node, bool list, int indent);
+
+/* Value at the cursor: the "key: " or "- " in front of it is already consumed */
+static int yaml_child(yaml_in_t *in, int parent, const char *key, int indent) {
+    yaml_kind_t kind = yaml_kind(in);
+    int node;
+
+    if (kind == YAML_SCALAR) {
+        node = yaml_leaf(in, parent, key, "");
+        yaml_next_line(in);
+        return node;
+    }
+    node = (kind == YAML_MAP || kind == YAML_EMPTY_MAP) ? evb_cs_map(in->cs, parent, key)
+                                                         : evb_cs_list(in->cs, parent, key);
+    if (node < 0) {
+        return node;
+    }
+    if (kind == YAML_EMPTY_MAP || kind == YAML_EMPTY_LIST) {
+        yaml_next_line(in);
+        return node;
+    }
+    return yaml_block(in, node, kind == YAML_LIST, indent);
+}
+
+/* { a: 1, b: 2 } list item */
+static int yaml_flow(yaml_in_t *in, int node) {
+    in->p += 2;
+    for (;;) {
+        char key[128];
+        size_t n = yaml_key_len(in);
+        int ret;
+
+        if (n == 0 || n >= sizeof(key)) {
+            return -EINVAL;
+        }
+        memcpy(key, in->p, n);
+        key[n] = '\0';
+        in->p += n + 2;
+        ret = yaml_leaf(in, node, key, ", }");
+        if (ret < 0) {
+            return ret;
+        }
+        if (yaml_at(in, ", ")) {
+            in->p += 2;
+        } else if (yaml_at(in, " }")) {
+            yaml_next_line(in);
+            return node;
+        } else {
+            return -EINVAL;
+        }
+    }
+}
+
+/* Members or items of a block map / list whose first line starts at the cursor */
+static int yaml_block(yaml_in_t *in, int node, bool list, int indent) {
+    do {
+        int ret;
+
+        if (list) {
+            in->p += 2;
+            if (yaml_at(in, "{ ")) {
+                int item = evb_cs_map(in->cs, node, NULL);
+                ret = item < 0 ? item : yaml_flow(in, item);
+            } else {
+                ret = yaml_child(in, node, NULL, indent + 2);
+            }
+        } else {
+            char key[128];
+            size_t n = yaml_key_len(in);
+
+            if (n == 0 || n >= sizeof(key)) {
+                return -EINVAL;
+            }
+            memcpy(key, in->p, n);
+            key[n] = '\0';
+            in->p += n + 1;
+            if (yaml_at(in, " ")) {
+                in->p++;
+                ret = yaml_child(in, node, key, indent);
+            } else {
+                /* Container on the next line, two columns in */
+                yaml_next_line(in);
+                ret = yaml_continues(in, indent + 2, NULL) || yaml_continues(in, indent + 2, "- ")
+                      ? yaml_child(in, node, key, indent + 2) : -EINVAL;
+            }
+        }
+        if (ret < 0) {
+            return ret;
+        }
+    } while (yaml_continues(in, indent, list ? "- " : NULL));
+    return node;
+}
+
+int evb_cs_parse_yaml(evb_changeset_t *cs, const char *text, size_t len) {
+    yaml_in_t in = { cs, text, text + len, text };
+
+    while (in.p < in.end) {
+        const char *q;
+        int path, node, ret;
+
+        if (*in.p == '\n') {
+            yaml_next_line(&in);
+            continue;
+        }
+        /* - ? "path"\n  : value */
+        if (!yaml_at(&in, "- ? \"") ||
+            (q = memchr(in.p + 5, '"', in.end - in.p - 5)) == NULL) {
+            return -EINVAL;
+        }
+        path = (int)(q - in.p - 5);
+        if (evb_cs_fetch(cs, "%.*s", path, in.p + 5) < 0) {
+            return -E2BIG;
+        }
+        yaml_next_line(&in);
+        if (!yaml_at(&in, "  : ")) {
+            return -EINVAL;
+        }
+        in.p += 4;
+
+        /* Parse under a scratch root, then hang the value on the entry */
+        node = cs_node(cs, EVB_CS_NONE, NULL, EVB_NODE_MAP);
+        if (node < 0) {
+            return -E2BIG;
+        }
+        ret = yaml_child(&in, node, NULL, 4);
+        if (ret < 0) {
+            return cs->overflow ? -E2BIG : ret;
+        }
+        cs->entries[cs->n_entries - 1].value = cs->nodes[node].first_child;
+    }
+    return cs->overflow ? -E2BIG : 0;
+}
+
+/* Value comparison state: location of the node being compared, for the report */
+typedef struct {
+    const evb_changeset_t *expect;
+    const evb_changeset_t *actual;
+    char loc[256];
+    size_t loc_len;
+    char *diff;
+    size_t size;
+    bool quiet;                 /* trying list items: a miss is not the answer yet */
+} cs_match_t;
+
+static const char *cs_scalar_text(const evb_changeset_t *cs, const evb_node_t *n, char *buf, size_t size) {
+    switch (n->type) {
+    case EVB_NODE_UINT:
+        snprintf(buf, size, "%llu", (unsigned long long)n->v.uint);
+        return buf;
+    case EVB_NODE_BOOL:
+        return n->v.boolean ? "true" : "false";
+    default:
+        return evb_cs_str(cs, n->v.str);
+    }
+}
+
+static bool cs_mismatch(cs_match_t *m, const char *fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (m->quiet || m->diff == NULL || m->size == 0) {
+        return false;
+    }
+    n = snprintf(m->diff, m->size, "%.*s: ", (int)m->loc_len, m->loc);
+    if (n >= 0 && (size_t)n < m->size) {
+        va_start(ap, fmt);
+        vsnprintf(m->diff + n, m->size - n, fmt, ap);
+        va_end(ap);
+    }
+    return false;
+}
+
+static bool cs_match(cs_match_t *m, int en, int an) {
+    const evb_node_t *e = &m->expect->nodes[en];
+    const evb_node_t *a = &m->actual->nodes[an];
+    size_t loc_len = m->loc_len;
+    bool ok = true;
+
+    if (yaml_is_scalar(e)) {
+        char ebuf[24], abuf[24];
+        const char *et = cs_scalar_text(m->expect, e, ebuf, sizeof(ebuf));
+        const char *at;
+
+        if (!yaml_is_scalar(a)) {
+            return cs_mismatch(m, "expected %s, read back a %s", et, a->type == EVB_NODE_MAP ? "map" : "list");
+        }
+        at = cs_scalar_text(m->actual, a, abuf, sizeof(abuf));
+        return strcmp(et, at) == 0 || cs_mismatch(m, "expected %s, read back %s", et, at);
+    }
+    if (a->type != e->type) {
+        return cs_mismatch(m, "expected a %s", e->type == EVB_NODE_MAP ? "map" : "list");
+    }
+
+    int index = 0;
+    for (int ec = e->first_child; ec != EVB_CS_NONE && ok; ec = m->expect->nodes[ec].next, index++) {
+        int n;
+
+        if (e->type == EVB_NODE_MAP) {
+            const char *key = evb_cs_str(m->expect, m->expect->nodes[ec].key);
+            int ac;
+
+            n = snprintf(m->loc + loc_len, sizeof(m->loc) - loc_len, "/%s", key);
+            m->loc_len = (n > 0 && loc_len + n < sizeof(m->loc)) ? loc_len + n : loc_len;
+            for (ac = a->first_child; ac != EVB_CS_NONE; ac = m->actual->nodes[ac].next) {
+                if (m->actual->nodes[ac].key != EVB_CS_NONE &&
+                    strcmp(evb_cs_str(m->actual, m->actual->nodes[ac].key), key) == 0) {
+                    break;
+                }
+            }
+            ok = (ac != EVB_CS_NONE) ? cs_match(m, ec, ac) : cs_mismatch(m, "not read back");
+        } else {
+            /* List items in any order, the datastore may hold more */
+            bool quiet = m->quiet;
+            int ac;
+
+            n = snprintf(m->loc + loc_len, sizeof(m->loc) - loc_len, "[%d]", index);
+            m->loc_len = (n > 0 && loc_len + n < sizeof(m->loc)) ? loc_len + n : loc_len;
+            m->quiet = true;
+            for (ac = a->first_child; ac != EVB_CS_NONE; ac = m->actual->nodes[ac].next) {
+                if (cs_match(m, ec, ac)) {
+                    break;
+                }
+            }
+            m->quiet = quiet;
+            if (ac == EVB_CS_NONE) {
+                /* Report against the item with the same key (first member), if any */
+                int ek = m->expect->nodes[ec].first_child;
+                bool keyed = false;
+
+                if (ek != EVB_CS_NONE && m->expect->nodes[ek].key != EVB_CS_NONE) {
+                    m->quiet = true;
+                    for (ac = a->first_child; ac != EVB_CS_NONE && !keyed; ac = m->actual->nodes[ac].next) {
+                        int ak = m->actual->nodes[ac].first_child;
+                        if (ak != EVB_CS_NONE && m->actual->nodes[ak].key != EVB_CS_NONE &&
+                            strcmp(evb_cs_str(m->actual, m->actual->nodes[ak].key),
+                                   evb_cs_str(m->expect, m->expect->nodes[ek].key)) == 0 &&
+                            cs_match(m, ek, ak)) {
+                            m->quiet = quiet;
+                            keyed = true;
+                            cs_match(m, ec, ac);
+                        }
+                    }
+                    m->quiet = quiet;
+                }
+                ok = keyed ? false : cs_mismatch(m, "no matching item read back");
+            }
+        }
+        m->loc_len = loc_len;
+    }
+    return ok;
+}
+
+bool evb_cs_match_entry(const evb_changeset_t *expect, int entry,
+                        const evb_changeset_t *actual, char *diff, size_t size) {
+    cs_match_t m = { .expect = expect, .actual = actual, .diff = diff, .size = size };
+    const char *path = evb_cs_str(expect, expect->entries[entry].path);
+    int hit = evb_cs_find(actual, path);
+
+    if (diff && size) {
+        diff[0] = '\0';
+    }
+    if (hit == EVB_CS_NONE) {
+        return cs_mismatch(&m, "not read back");
+    }
+    if (expect->entries[entry].value == EVB_CS_NONE) {
+        return true;
+    }
+    if (actual->entries[hit].value == EVB_CS_NONE) {
+        return cs_mismatch(&m, "read back without a value");
+    }
+    return cs_match(&m, expect->entries[entry].value, actual->entries[hit].value);
+}
+
+/* A leaf found at [hit, hit + len) starts its own item and is not a prefix of a longer value */
+static bool yaml_leaf_at(const char *text, const char *end, const char *hit, size_t len) {
+    const char *p = hit;
+    const char *q = hit + len;
+
+    /* Flow map member, "{ key: v, key: v }" */
+    if (p - text >= 2 && (p[-2] == '{' || p[-2] == ',') && p[-1] == ' ') {
+        return q == end || *q == ',' || (q + 1 < end && q[0] == ' ' && q[1] == '}');
+    }
+    if (!(q == end || *q == '\n')) {
+        return false;
+    }
+    /* Otherwise only indentation, "- " list markers or the "  : " value marker before it */
+    while (p > text && p[-1] != '\n') {
+        if (p - text >= 2 && (p[-2] == '-' || p[-2] == ':') && p[-1] == ' ') {
+            p -= 2;
+        } else if (p[-1] == ' ') {
+            p--;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Every leaf of the value tree, rendered as in evb_cs_render_yaml, within [text, end) */
+static bool cs_match_yaml(const evb_changeset_t *cs, int idx, const char *text, const char *end,
+                          char *diff, size_t size) {
+    const evb_node_t *n = &cs->nodes[idx];
+
+    if (yaml_is_scalar(n)) {
+        char want[320];
+        yaml_out_t out = { want, sizeof(want), 0, false };
+
+        if (n->key != EVB_CS_NONE) {
+            yaml_printf(&out, "%s: ", evb_cs_str(cs, n->key));
+        }
+        yaml_scalar(&out, cs, n);
+        for (const char *hit = text; !out.overflow && (hit = strstr(hit, want)) != NULL &&
+                                     hit + out.len <= end; hit++) {
+            if (yaml_leaf_at(text, end, hit, out.len)) {
+                return true;
+            }
+        }
+        if (diff && size) {
+            snprintf(diff, size, ": %s not read back", want);
+        }
+        return false;
+    }
+    for (int c = n->first_child; c != EVB_CS_NONE; c = cs->nodes[c].next) {
+        if (!cs_match_yaml(cs, c, text, end, diff, size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool evb_cs_match_entry_yaml(const evb_changeset_t *expect, int entry, const char *text,
+                             char *diff, size_t size) {
+    const char *path = evb_cs_str(expect, expect->entries[entry].path);
+    size_t path_len = strlen(path);
+    const char *start = text;
+
+    if (diff && size) {
+        diff[0] = '\0';
+    }
+    /* The path as a quoted key, not as the prefix of a longer one */
+    while (start && (start = strstr(start, path)) != NULL &&
+           (start == text || start[-1] != '"' || start[path_len] != '"')) {
+        start += path_len;
+    }
+    if (start == NULL) {
+        if (diff && size) {
+            snprintf(diff, size, ": not read back");
+        }
+        return false;
+    }
+    if (expect->entries[entry].value == EVB_CS_NONE) {
+        return true;
+    }
+    /* The entry's section runs up to the next top-level "- " */
+    const char *end = strstr(start, "\n- ");
+    if (end == NULL) {
+        end = start + strlen(start);
+    }
+    return cs_match_yaml(expect, expect->entries[entry].value, start, end, diff, size);
+}
@@ -0,0 +1,201 @@
+/**
+ * In-memory YANG change sets for the EVB-LAN9692
+ * Instance paths with structured values, rendered into a single request
+ */
+
+#ifndef EVB_CHANGESET_H
+#define EVB_CHANGESET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Change Set Limits */
+#define EVB_CS_MAX_ENTRIES          64
+#define EVB_CS_MAX_NODES            1024
+#define EVB_CS_POOL_SIZE            16384
+#define EVB_CS_NONE                 (-1)
+
+/* Value Node Types */
+typedef enum {
+    EVB_NODE_MAP = 0,           /* container or list entry */
+    EVB_NODE_LIST,              /* YANG list or leaf-list */
+    EVB_NODE_UINT,
+    EVB_NODE_BOOL,
+    EVB_NODE_STRING,
+    EVB_NODE_IDENTITY,          /* identityref / enumeration, e.g. "tagged" */
+} evb_node_type_t;
+
+/* Value Node (tree linked through node indices) */
+typedef struct {
+    uint8_t type;
+    int key;                    /* member name (pool offset), EVB_CS_NONE in lists */
+    int first_child;
+    int last_child;
+    int next;
+    union {
+        uint64_t uint;
+        bool boolean;
+        int str;                /* pool offset */
+    } v;
+} evb_node_t;
+
+/* Change Set Entry */
+typedef struct {
+    int path;                   /* instance identifier (pool offset) */
+    int value;                  /* root node, EVB_CS_NONE for fetch-only entries */
+} evb_cs_entry_t;
+
+/* Change Set */
+typedef struct {
+    evb_cs_entry_t entries[EVB_CS_MAX_ENTRIES];
+    int n_entries;
+    evb_node_t nodes[EVB_CS_MAX_NODES];
+    int n_nodes;
+    char pool[EVB_CS_POOL_SIZE];
+    size_t pool_len;
+    bool overflow;              /* set when any limit was exceeded */
+} evb_changeset_t;
+
+/**
+ * Initialize an empty change set
+ * @param cs: Change set
+ */
+void evb_cs_init(evb_changeset_t *cs);
+
+/**
+ * Add an entry whose value is a container / list entry
+ * @param cs: Change set
+ * @param fmt: printf-style instance path
+ * @return: Node index for child values, negative on overflow
+ */
+int evb_cs_set_map(evb_changeset_t *cs, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * Add an entry whose value is a list
+ * @return: Node index for list items, negative on overflow
+ */
+int evb_cs_set_list(evb_changeset_t *cs, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * Add an entry whose value is an identity / enumeration leaf
+ * @return: 0 on success, negative on overflow
+ */
+int evb_cs_set_identity(evb_changeset_t *cs, const char *value, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Add an entry whose value is a boolean leaf
+ * @return: 0 on success, negative on overflow
+ */
+int evb_cs_set_bool(evb_changeset_t *cs, bool value, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Add an entry whose value is an unsigned integer leaf
+ * @return: 0 on success, negative on overflow
+ */
+int evb_cs_set_uint(evb_changeset_t *cs, uint64_t value, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Add an entry whose value is a string leaf
+ * @return: 0 on success, negative on overflow
+ */
+int evb_cs_set_string(evb_changeset_t *cs, const char *value, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Add a fetch-only entry (path without value)
+ * @return: 0 on success, negative on overflow
+ */
+int evb_cs_fetch(evb_changeset_t *cs, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/*
+ * Child values. parent is a node returned by a map/list call, key is the
+ * member name inside maps and NULL for list items.
+ */
+int evb_cs_map(evb_changeset_t *cs, int parent, const char *key);
+int evb_cs_list(evb_changeset_t *cs, int parent, const char *key);
+int evb_cs_uint(evb_changeset_t *cs, int parent, const char *key, uint64_t value);
+int evb_cs_bool(evb_changeset_t *cs, int parent, const char *key, bool value);
+int evb_cs_string(evb_changeset_t *cs, int parent, const char *key, const char *value);
+int evb_cs_identity(evb_changeset_t *cs, int parent, const char *key, const char *value);
+
+/**
+ * Get a string stored in the change set pool
+ * @param cs: Change set
+ * @param offset: Pool offset (path, key or string value)
+ * @return: String
+ */
+static inline const char *evb_cs_str(const evb_changeset_t *cs, int offset) {
+    return cs->pool + offset;
+}
+
+/**
+ * Find an entry by instance path
+ * @param cs: Change set
+ * @param path: Instance path
+ * @return: Entry index, EVB_CS_NONE if absent
+ */
+int evb_cs_find(const evb_changeset_t *cs, const char *path);
+
+/**
+ * Copy one entry (path and value tree) from another change set
+ * @param dst: Destination change set
+ * @param src: Source change set
+ * @param entry: Entry index in src
+ * @return: 0 on success, negative on overflow
+ */
+int evb_cs_copy_entry(evb_changeset_t *dst, const evb_changeset_t *src, int entry);
+
+/**
+ * Check that a decoded reply holds the value of one entry: maps member by
+ * member (extra members are fine), list items in any order, leaves by text
+ * @param expect: Change set with the expected values
+ * @param entry: Entry index in expect
+ * @param actual: Decoded reply
+ * @param diff: Output, where the first difference is, e.g. "/credit-based/idle-slope: ..."
+ * @param size: diff buffer size
+ * @return: true if the reply matches
+ */
+bool evb_cs_match_entry(const evb_changeset_t *expect, int entry,
+                        const evb_changeset_t *actual, char *diff, size_t size);
+
+/**
+ * Same check against a YAML reply: every leaf of the entry, as rendered by
+ * evb_cs_render_yaml, must appear in the reply section of its path
+ * @return: true if the reply matches
+ */
+bool evb_cs_match_entry_yaml(const evb_changeset_t *expect, int entry, const char *text,
+                             char *diff, size_t size);
+
+/**
+ * Render the change set as a YAML iPATCH body (dr mup1cc input format)
+ * @param cs: Change set
+ * @param buf: Output buffer
+ * @param size: Buffer size
+ * @return: Length written, negative on error
+ */
+int evb_cs_render_yaml(const evb_changeset_t *cs, char *buf, size_t size);
+
+/**
+ * Render the change set paths as a YAML FETCH body
+ * @return: Length written, negative on error
+ */
+int evb_cs_render_fetch_yaml(const evb_changeset_t *cs, char *buf, size_t size);
+
+/**
+ * Read a YAML iPATCH body in the layout evb_cs_render_yaml writes back
+ * into entries (the change set is appended to, not reset)
+ * @param cs: Change set
+ * @param text: YAML text
+ * @param len: Text length
+ * @return: 0 on success, -EINVAL on anything else, -E2BIG on overflow
+ */
+int evb_cs_parse_yaml(evb_changeset_t *cs, const char *text, size_t len);
+
+#endif /* EVB_CHANGESET_H */
@@ -0,0 +1,29 @@
+/**
+ * EVB-LAN9692 lab setup
+ */
+
+#include "evb_lab.h"
+#include "cbs_profiles.h"
+
+/* Reservations above the profile rates, kbps */
+const evb_shaper_t evb_shapers[] = {
+    /* Port 10 - PC1 (4K + FHD streams) */
+    {10, TC_LIVE_4K_VIDEO,  30000},
+    {10, TC_LIVE_FHD_VIDEO, 10000},
+    {10, TC_VOD_STREAMING,   5000},
+    /* Port 11 - PC2 (FHD + VOD streams) */
+    {11, TC_LIVE_4K_VIDEO,  30000},
+    {11, TC_LIVE_FHD_VIDEO, 10000},
+    {11, TC_VOD_STREAMING,   5000},
+};
+
+const size_t evb_num_shapers = sizeof(evb_shapers) / sizeof(evb_shapers[0]);
+
+const evb_route_t evb_routes[] = {
+    {TC_LIVE_4K_VIDEO,  10},
+    {TC_LIVE_FHD_VIDEO, 10},
+    {TC_LIVE_FHD_VIDEO, 11},
+    {TC_VOD_STREAMING,  11},
+};
+
+const size_t evb_num_routes = sizeof(evb_routes) / sizeof(evb_routes[0]);
@@ -0,0 +1,34 @@
+/**
+ * EVB-LAN9692 lab setup
+ * Port 8 is the ingress from the video sources, ports 10 (PC1) and 11
+ * (PC2) the shaped egress ports towards the receivers. One table of
+ * egress shapers for everything that needs it: evb_lan9692_cbs programs
+ * it on the board and cbs_bound analyzes it.
+ */
+
+#ifndef EVB_LAB_H
+#define EVB_LAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Egress CBS Shaper */
+typedef struct {
+    uint8_t port;
+    uint8_t tc;
+    uint32_t idle_slope;        /* kbps */
+} evb_shaper_t;
+
+/* Lab Stream: the profile of its traffic class (cbs_profiles) and where it leaves */
+typedef struct {
+    uint8_t tc;
+    uint8_t egress;             /* 10 or 11 */
+} evb_route_t;
+
+extern const evb_shaper_t evb_shapers[];
+extern const size_t evb_num_shapers;
+
+extern const evb_route_t evb_routes[];
+extern const size_t evb_num_routes;
+
+#endif /* EVB_LAB_H */
@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -13,6 +14,12 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
+#include "mup1.h"
+#include "evb_changeset.h"
+#include "coreconf.h"
+#include "cbs_prof.h"
+#include "evb_lab.h"
 
 /* EVB-LAN9692 보드 구성 */
 #define LAN9692_PORTS           12      /* LAN9692는 12포트 스위치 */
@@ -21,334 +28,362 @@
 #define VLAN_BASE_ID           100
 #define TTY_DEVICE             "/dev/ttyACM0"
 
-/* 트래픽 클래스 정의 (실제 테스트 기준) */
-typedef enum {
-    TC_4K_VIDEO = 7,       /* 4K 실시간 영상 - 최고 우선순위 */
-    TC_FHD_VIDEO = 6,      /* FHD 실시간 영상 */
-    TC_HD_VOD = 5,         /* HD VOD 스트리밍 */
-    TC_AUDIO = 4,          /* 오디오 스트림 */
-    TC_CONTROL = 3,        /* 제어 데이터 */
-    TC_DIAG = 2,           /* 진단 데이터 */
-    TC_BULK = 1,           /* 벌크 데이터 */
-    TC_BE = 0              /* 베스트 에포트 */
-} traffic_class_t;
-
-/* CBS 구성 파라미터 */
-typedef struct {
-    uint8_t port;
-    uint8_t tc;
-    uint32_t idle_slope;   /* kbps */
-    uint32_t send_slope;   /* kbps */
-    uint16_t vlan_id;
-    uint8_t pcp;
-} cbs_config_t;
-
-/* 테스트 시나리오별 CBS 설정 */
-static cbs_config_t test_configs[] = {
-    /* Port 8 인그레스 - 비디오 스트림 수신 */
-    {8, TC_4K_VIDEO,  25000, 975000, 100, 7},   /* 4K: 25Mbps */
-    {8, TC_FHD_VIDEO,  8000, 992000, 110, 6},   /* FHD: 8Mbps */
-    {8, TC_HD_VOD,     4000, 996000, 120, 5},   /* VOD: 4Mbps */
-    
-    /* Port 10/11 이그레스 - PC로 전송 */
-    {10, TC_4K_VIDEO, 30000, 970000, 100, 7},   /* 4K 여유있게 30Mbps */
-    {10, TC_FHD_VIDEO, 10000, 990000, 110, 6},  /* FHD 여유있게 10Mbps */
-    {11, TC_HD_VOD,    5000, 995000, 120, 5},   /* VOD 여유있게 5Mbps */
-};
-
-/* YAML 파일 생성 함수 */
-int generate_yaml_file(const char *filename, const char *content) {
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        perror("Failed to create YAML file");
-        return -1;
+/* 이그레스 포트 CBS 셰이퍼 설정 (kbps) 은 evb_lab.c 의 evb_shapers, cbs_bound 와 공유 */
+
+/* Port 8: 인그레스 (비디오 소스), Port 10, 11: 이그레스 (PC 수신) */
+static const uint8_t ingress_ports[] = { 8 };
+static const uint8_t egress_ports[] = { 10, 11 };
+static const uint8_t bridge_ports[] = { 8, 10, 11 };
+#define ARRAY_SIZE(a)          (sizeof(a) / sizeof((a)[0]))
+
+/* YANG 인스턴스 경로 */
+#define IF_PATH                "/ietf-interfaces:interfaces/interface[name='%u']"
+#define BRIDGE_PORT_PATH       IF_PATH "/ieee802-dot1q-bridge:bridge-port"
+#define SHAPERS_PATH           IF_PATH "/mchp-velocitysp-port:eth-qos/config/traffic-class-shapers"
+#define TC_STATS_PATH          IF_PATH "/mchp-velocitysp-port:eth-port/statistics/traffic-class"
+#define FDB_PATH               "/ieee802-dot1q-bridge:bridges/bridge[name='b0']/component[name='c0']/filtering-database"
+
+/* VLAN 설정 변경 항목 */
+void add_vlan_changes(evb_changeset_t *cs) {
+    /* C-VLAN 포트, VLAN 태그 프레임만 수신, 인그레스 필터링 */
+    for (size_t i = 0; i < ARRAY_SIZE(bridge_ports); i++) {
+        unsigned port = bridge_ports[i];
+        evb_cs_set_identity(cs, "ieee802-dot1q-bridge:c-vlan-bridge-port", BRIDGE_PORT_PATH "/port-type", port);
+        evb_cs_set_identity(cs, "admit-only-VLAN-tagged-frames", BRIDGE_PORT_PATH "/acceptable-frame", port);
+        evb_cs_set_bool(cs, true, BRIDGE_PORT_PATH "/enable-ingress-filtering", port);
+    }
+
+    /* VLAN 100 (4K Video) 멤버십 */
+    int entry = evb_cs_set_map(cs, FDB_PATH "/vlan-registration-entry");
+    evb_cs_uint(cs, entry, "database-id", 0);
+    evb_cs_string(cs, entry, "vids", "100");
+    evb_cs_identity(cs, entry, "entry-type", "static");
+    int port_map = evb_cs_list(cs, entry, "port-map");
+    for (size_t i = 0; i < ARRAY_SIZE(bridge_ports); i++) {
+        int member = evb_cs_map(cs, port_map, NULL);
+        evb_cs_uint(cs, member, "port-ref", bridge_ports[i]);
+        int reg = evb_cs_map(cs, member, "static-vlan-registration-entries");
+        evb_cs_identity(cs, reg, "vlan-transmitted", "tagged");
     }
-    
-    fprintf(fp, "%s", content);
-    fclose(fp);
-    
-    printf("Generated: %s\n", filename);
-    return 0;
 }
 
-/* VLAN 설정 YAML 생성 */
-int setup_vlan_configuration(void) {
-    char yaml_content[4096];
-    
-    /* VLAN 100/110/120 설정 - 포트 8, 10, 11 */
-    snprintf(yaml_content, sizeof(yaml_content),
-        "# VLAN Configuration for EVB-LAN9692\n"
-        "# Port 8: Ingress (Video Source)\n"
-        "# Port 10, 11: Egress (PC Receivers)\n\n"
-        
-        "# Set ports to C-VLAN aware\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='8']/ieee802-dot1q-bridge:bridge-port/port-type\"\n"
-        "  : ieee802-dot1q-bridge:c-vlan-bridge-port\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='10']/ieee802-dot1q-bridge:bridge-port/port-type\"\n"
-        "  : ieee802-dot1q-bridge:c-vlan-bridge-port\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='11']/ieee802-dot1q-bridge:bridge-port/port-type\"\n"
-        "  : ieee802-dot1q-bridge:c-vlan-bridge-port\n\n"
-        
-        "# Accept only VLAN tagged frames\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='8']/ieee802-dot1q-bridge:bridge-port/acceptable-frame\"\n"
-        "  : admit-only-VLAN-tagged-frames\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='10']/ieee802-dot1q-bridge:bridge-port/acceptable-frame\"\n"
-        "  : admit-only-VLAN-tagged-frames\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='11']/ieee802-dot1q-bridge:bridge-port/acceptable-frame\"\n"
-        "  : admit-only-VLAN-tagged-frames\n\n"
-        
-        "# Enable ingress filtering\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='8']/ieee802-dot1q-bridge:bridge-port/enable-ingress-filtering\"\n"
-        "  : true\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='10']/ieee802-dot1q-bridge:bridge-port/enable-ingress-filtering\"\n"
-        "  : true\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='11']/ieee802-dot1q-bridge:bridge-port/enable-ingress-filtering\"\n"
-        "  : true\n\n"
-        
-        "# VLAN 100 (4K Video) membership\n"
-        "- ? \"/ieee802-dot1q-bridge:bridges/bridge[name='b0']/component[name='c0']/filtering-database/vlan-registration-entry\"\n"
-        "  : database-id: 0\n"
-        "    vids: '100'\n"
-        "    entry-type: static\n"
-        "    port-map:\n"
-        "    - port-ref: 8\n"
-        "      static-vlan-registration-entries:\n"
-        "        vlan-transmitted: tagged\n"
-        "    - port-ref: 10\n"
-        "      static-vlan-registration-entries:\n"
-        "        vlan-transmitted: tagged\n"
-        "    - port-ref: 11\n"
-        "      static-vlan-registration-entries:\n"
-        "        vlan-transmitted: tagged\n"
-    );
-    
-    return generate_yaml_file("vlan_setup.yaml", yaml_content);
+/* PCP 디코딩/인코딩 변경 항목 (PCP <-> TC 1:1) */
+void add_pcp_changes(evb_changeset_t *cs) {
+    for (size_t i = 0; i < ARRAY_SIZE(ingress_ports); i++) {
+        unsigned port = ingress_ports[i];
+        int map = evb_cs_set_map(cs, BRIDGE_PORT_PATH "/pcp-decoding-table/pcp-decoding-map", port);
+        evb_cs_identity(cs, map, "pcp", "8P0D");
+
+        int prio = evb_cs_set_list(cs, BRIDGE_PORT_PATH
+                                   "/pcp-decoding-table/pcp-decoding-map[pcp='8P0D']/priority-map", port);
+        for (int pcp = 0; pcp < NUM_TRAFFIC_CLASSES; pcp++) {
+            int item = evb_cs_map(cs, prio, NULL);
+            evb_cs_uint(cs, item, "priority-code-point", pcp);
+            evb_cs_uint(cs, item, "priority", pcp);
+            evb_cs_bool(cs, item, "drop-eligible", false);
+        }
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(egress_ports); i++) {
+        unsigned port = egress_ports[i];
+        int map = evb_cs_set_map(cs, BRIDGE_PORT_PATH "/pcp-encoding-table/pcp-encoding-map", port);
+        evb_cs_identity(cs, map, "pcp", "8P0D");
+
+        int prio = evb_cs_set_list(cs, BRIDGE_PORT_PATH
+                                   "/pcp-encoding-table/pcp-encoding-map[pcp='8P0D']/priority-map", port);
+        for (int tc = 0; tc < NUM_TRAFFIC_CLASSES; tc++) {
+            int item = evb_cs_map(cs, prio, NULL);
+            evb_cs_uint(cs, item, "priority", tc);
+            evb_cs_bool(cs, item, "dei", false);
+            evb_cs_uint(cs, item, "priority-code-point", tc);
+        }
+    }
 }
 
-/* PCP 디코딩/인코딩 설정 YAML 생성 */
-int setup_pcp_mapping(void) {
-    char yaml_content[4096];
-    
-    /* 포트 8: PCP → TC 디코딩 (1:1 매핑) */
-    snprintf(yaml_content, sizeof(yaml_content),
-        "# PCP Decoding for Port 8 (Ingress)\n"
-        "# Maps PCP values to Traffic Classes (1:1)\n\n"
-        
-        "- ? \"/ietf-interfaces:interfaces/interface[name='8']/ieee802-dot1q-bridge:bridge-port/pcp-decoding-table/pcp-decoding-map\"\n"
-        "  : pcp: 8P0D\n\n"
-        
-        "- \"/ietf-interfaces:interfaces/interface[name='8']/ieee802-dot1q-bridge:bridge-port/pcp-decoding-table/pcp-decoding-map[pcp='8P0D']/priority-map\":\n"
-        "  - { priority-code-point: 0, priority: 0, drop-eligible: false }\n"
-        "  - { priority-code-point: 1, priority: 1, drop-eligible: false }\n"
-        "  - { priority-code-point: 2, priority: 2, drop-eligible: false }\n"
-        "  - { priority-code-point: 3, priority: 3, drop-eligible: false }\n"
-        "  - { priority-code-point: 4, priority: 4, drop-eligible: false }\n"
-        "  - { priority-code-point: 5, priority: 5, drop-eligible: false }\n"
-        "  - { priority-code-point: 6, priority: 6, drop-eligible: false }\n"
-        "  - { priority-code-point: 7, priority: 7, drop-eligible: false }\n"
-    );
-    
-    generate_yaml_file("pcp_decoding_p8.yaml", yaml_content);
-    
-    /* 포트 10, 11: TC → PCP 인코딩 */
-    snprintf(yaml_content, sizeof(yaml_content),
-        "# PCP Encoding for Port 10, 11 (Egress)\n"
-        "# Maps Traffic Classes to PCP values (1:1)\n\n"
-        
-        "- ? \"/ietf-interfaces:interfaces/interface[name='10']/ieee802-dot1q-bridge:bridge-port/pcp-encoding-table/pcp-encoding-map\"\n"
-        "  : pcp: 8P0D\n\n"
-        
-        "- \"/ietf-interfaces:interfaces/interface[name='10']/ieee802-dot1q-bridge:bridge-port/pcp-encoding-table/pcp-encoding-map[pcp='8P0D']/priority-map\":\n"
-        "  - { priority: 0, dei: false, priority-code-point: 0 }\n"
-        "  - { priority: 1, dei: false, priority-code-point: 1 }\n"
-        "  - { priority: 2, dei: false, priority-code-point: 2 }\n"
-        "  - { priority: 3, dei: false, priority-code-point: 3 }\n"
-        "  - { priority: 4, dei: false, priority-code-point: 4 }\n"
-        "  - { priority: 5, dei: false, priority-code-point: 5 }\n"
-        "  - { priority: 6, dei: false, priority-code-point: 6 }\n"
-        "  - { priority: 7, dei: false, priority-code-point: 7 }\n\n"
-        
-        "# Same for Port 11\n"
-        "- ? \"/ietf-interfaces:interfaces/interface[name='11']/ieee802-dot1q-bridge:bridge-port/pcp-encoding-table/pcp-encoding-map\"\n"
-        "  : pcp: 8P0D\n\n"
-        
-        "- \"/ietf-interfaces:interfaces/interface[name='11']/ieee802-dot1q-bridge:bridge-port/pcp-encoding-table/pcp-encoding-map[pcp='8P0D']/priority-map\":\n"
-        "  - { priority: 0, dei: false, priority-code-point: 0 }\n"
-        "  - { priority: 1, dei: false, priority-code-point: 1 }\n"
-        "  - { priority: 2, dei: false, priority-code-point: 2 }\n"
-        "  - { priority: 3, dei: false, priority-code-point: 3 }\n"
-        "  - { priority: 4, dei: false, priority-code-point: 4 }\n"
-        "  - { priority: 5, dei: false, priority-code-point: 5 }\n"
-        "  - { priority: 6, dei: false, priority-code-point: 6 }\n"
-        "  - { priority: 7, dei: false, priority-code-point: 7 }\n"
-    );
-    
-    return generate_yaml_file("pcp_encoding_p10_p11.yaml", yaml_content);
+/* CBS 셰이퍼 변경 항목 (disable 시 idle-slope 0) */
+void add_shaper_changes(evb_changeset_t *cs, bool enable) {
+    for (size_t i = 0; i < ARRAY_SIZE(egress_ports); i++) {
+        int shapers = evb_cs_set_list(cs, SHAPERS_PATH, (unsigned)egress_ports[i]);
+
+        for (size_t j = 0; j < evb_num_shapers; j++) {
+            if (evb_shapers[j].port != egress_ports[i]) {
+                continue;
+            }
+            int item = evb_cs_map(cs, shapers, NULL);
+            evb_cs_uint(cs, item, "traffic-class", evb_shapers[j].tc);
+            int cbs = evb_cs_map(cs, item, "credit-based");
+            evb_cs_uint(cs, cbs, "idle-slope", enable ? evb_shapers[j].idle_slope : 0);
+        }
+    }
 }
 
-/* CBS 설정 YAML 생성 */
-int setup_cbs_configuration(void) {
-    char yaml_content[8192];
-    
-    /* 포트 10, 11 CBS 셰이퍼 설정 */
-    snprintf(yaml_content, sizeof(yaml_content),
-        "# CBS Configuration for EVB-LAN9692\n"
-        "# Credit-Based Shaper settings for egress ports\n\n"
-        
-        "# Port 10 CBS - PC1 (4K + FHD streams)\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='10']/mchp-velocitysp-port:eth-qos/config/traffic-class-shapers\":\n"
-        "  - traffic-class: 7\n"
-        "    credit-based:\n"
-        "      idle-slope: 30000    # 30 Mbps for 4K\n"
-        "  - traffic-class: 6\n"
-        "    credit-based:\n"
-        "      idle-slope: 10000    # 10 Mbps for FHD\n"
-        "  - traffic-class: 5\n"
-        "    credit-based:\n"
-        "      idle-slope: 5000     # 5 Mbps for VOD\n\n"
-        
-        "# Port 11 CBS - PC2 (FHD + VOD streams)\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='11']/mchp-velocitysp-port:eth-qos/config/traffic-class-shapers\":\n"
-        "  - traffic-class: 7\n"
-        "    credit-based:\n"
-        "      idle-slope: 30000    # 30 Mbps for 4K\n"
-        "  - traffic-class: 6\n"
-        "    credit-based:\n"
-        "      idle-slope: 10000    # 10 Mbps for FHD\n"
-        "  - traffic-class: 5\n"
-        "    credit-based:\n"
-        "      idle-slope: 5000     # 5 Mbps for VOD\n"
-    );
-    
-    return generate_yaml_file("cbs_setup.yaml", yaml_content);
+/* 구성 조회 항목: 포트 타입, VLAN 멤버십, PCP 매핑, CBS 셰이퍼 */
+void add_config_paths(evb_changeset_t *cs) {
+    for (size_t i = 0; i < ARRAY_SIZE(bridge_ports); i++) {
+        evb_cs_fetch(cs, BRIDGE_PORT_PATH "/port-type", (unsigned)bridge_ports[i]);
+    }
+    for (unsigned vid = VLAN_BASE_ID; vid <= VLAN_BASE_ID + 20; vid += 10) {
+        evb_cs_fetch(cs, FDB_PATH "/vlan-registration-entry[database-id='0'][vids='%u']", vid);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(ingress_ports); i++) {
+        evb_cs_fetch(cs, BRIDGE_PORT_PATH "/pcp-decoding-table/pcp-decoding-map", (unsigned)ingress_ports[i]);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(egress_ports); i++) {
+        evb_cs_fetch(cs, BRIDGE_PORT_PATH "/pcp-encoding-table/pcp-encoding-map", (unsigned)egress_ports[i]);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(egress_ports); i++) {
+        evb_cs_fetch(cs, SHAPERS_PATH, (unsigned)egress_ports[i]);
+    }
 }
 
-/* 통계 확인용 YAML 생성 */
-int generate_stats_fetch_yaml(void) {
-    char yaml_content[4096];
-    
-    snprintf(yaml_content, sizeof(yaml_content),
-        "# Fetch statistics and configuration\n\n"
-        
-        "# Port types\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='8']/ieee802-dot1q-bridge:bridge-port/port-type\"\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='10']/ieee802-dot1q-bridge:bridge-port/port-type\"\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='11']/ieee802-dot1q-bridge:bridge-port/port-type\"\n\n"
-        
-        "# VLAN membership\n"
-        "- \"/ieee802-dot1q-bridge:bridges/bridge[name='b0']/component[name='c0']/filtering-database/vlan-registration-entry[database-id='0'][vids='100']\"\n"
-        "- \"/ieee802-dot1q-bridge:bridges/bridge[name='b0']/component[name='c0']/filtering-database/vlan-registration-entry[database-id='0'][vids='110']\"\n"
-        "- \"/ieee802-dot1q-bridge:bridges/bridge[name='b0']/component[name='c0']/filtering-database/vlan-registration-entry[database-id='0'][vids='120']\"\n\n"
-        
-        "# PCP mappings\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='8']/ieee802-dot1q-bridge:bridge-port/pcp-decoding-table/pcp-decoding-map\"\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='10']/ieee802-dot1q-bridge:bridge-port/pcp-encoding-table/pcp-encoding-map\"\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='11']/ieee802-dot1q-bridge:bridge-port/pcp-encoding-table/pcp-encoding-map\"\n\n"
-        
-        "# CBS configuration\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='10']/mchp-velocitysp-port:eth-qos/config/traffic-class-shapers\"\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='11']/mchp-velocitysp-port:eth-qos/config/traffic-class-shapers\"\n\n"
-        
-        "# Traffic statistics\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='8']/mchp-velocitysp-port:eth-port/statistics/traffic-class\"\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='10']/mchp-velocitysp-port:eth-port/statistics/traffic-class\"\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='11']/mchp-velocitysp-port:eth-port/statistics/traffic-class\"\n"
-    );
-    
-    return generate_yaml_file("fetch_stats.yaml", yaml_content);
+/* 트래픽 클래스별 통계 조회 항목 */
+void add_stats_paths(evb_changeset_t *cs) {
+    for (size_t i = 0; i < ARRAY_SIZE(bridge_ports); i++) {
+        evb_cs_fetch(cs, TC_STATS_PATH, (unsigned)bridge_ports[i]);
+    }
 }
 
-/* VelocityDriveSP 명령 실행 */
-int execute_velocitydrivesp_command(const char *yaml_file, const char *operation) {
-    char cmd[512];
-    
-    /* dr mup1cc 명령 실행 */
-    snprintf(cmd, sizeof(cmd), 
-        "sudo dr mup1cc -d %s -m %s -i %s",
-        TTY_DEVICE, operation, yaml_file);
-    
-    printf("Executing: %s\n", cmd);
-    
-    int ret = system(cmd);
-    if (ret != 0) {
-        fprintf(stderr, "Command failed with code %d\n", ret);
+/* MUP1 세션 - 한 번 열고 모든 요청에 재사용 */
+static mup1_session_t *session;
+
+/*
+ * CORECONF(CBOR) 인코딩 사용 여부 (EVB_ENCODING=cbor 일 때만)
+ * coreconf_sid.c 의 SID 는 임시 값이므로 펌웨어 .sid 파일로 재생성하기 전까지 기본은 YAML
+ */
+static bool use_cbor = false;
+
+static uint64_t evb_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* 보드 연결 (EVB_TTY 환경 변수로 장치 변경 가능, 예: mup1_sim pty) */
+int evb_connect(void) {
+    CBS_PROF_FUNC();
+    const char *device = getenv("EVB_TTY");
+
+    if (device == NULL || device[0] == '\0') {
+        device = TTY_DEVICE;
+    }
+
+    const char *encoding = getenv("EVB_ENCODING");
+    if (encoding && strcmp(encoding, "cbor") == 0) {
+        use_cbor = true;
+    }
+
+    session = mup1_open(device);
+    if (session == NULL) {
+        fprintf(stderr, "Failed to open MUP1 session on %s\n", device);
         return -1;
     }
-    
+
+    printf("Connected to %s (MUP1, %s)\n", device, use_cbor ? "CBOR" : "YAML");
     return 0;
 }
 
+void evb_disconnect(void) {
+    if (session) {
+        const mup1_stats_t *st = mup1_get_stats(session);
+        printf("MUP1: %llu requests, %llu responses, %llu bytes tx, %llu bytes rx\n",
+               (unsigned long long)st->requests, (unsigned long long)st->responses,
+               (unsigned long long)st->tx_bytes, (unsigned long long)st->rx_bytes);
+        mup1_close(session);
+        session = NULL;
+    }
+}
+
+/* 변경 세트 전송 (ipatch: 값 포함, fetch: 경로만) - 응답은 기다리지 않음 */
+static int submit_changeset(const evb_changeset_t *cs, uint8_t method) {
+    CBS_PROF_FUNC();
+    static uint8_t payload[MUP1_MAX_FRAME];
+    uint16_t format = COAP_CF_YAML, accept = COAP_CF_YAML;
+    int len = -ENOENT;
+
+    if (use_cbor) {
+        if (method == COAP_IPATCH) {
+            len = coreconf_encode_patch(cs, payload, sizeof(payload));
+            format = COAP_CF_YANG_INST_CBOR;
+        } else {
+            len = coreconf_encode_fetch(cs, payload, sizeof(payload));
+            format = COAP_CF_YANG_IDS_CBOR;
+        }
+        accept = COAP_CF_YANG_INST_CBOR;
+        if (len == -ENOENT) {
+            printf("No SID for some paths, sending YAML\n");
+        }
+    }
+    if (len == -ENOENT) {
+        /* YAML 텍스트 (SID 테이블에 없는 경로 포함 시) */
+        format = accept = COAP_CF_YAML;
+        if (method == COAP_IPATCH) {
+            len = evb_cs_render_yaml(cs, (char *)payload, sizeof(payload));
+        } else {
+            len = evb_cs_render_fetch_yaml(cs, (char *)payload, sizeof(payload));
+        }
+    }
+    if (len < 0) {
+        fprintf(stderr, "Failed to render change set: %s\n", strerror(-len));
+        return -1;
+    }
+
+    printf("Sending: %s, %d entries (%d bytes %s)\n",
+           method == COAP_IPATCH ? "ipatch" : "fetch", cs->n_entries, len,
+           format == COAP_CF_YAML ? "YAML" : "CBOR");
+
+    int id = mup1_submit(session, method, format, accept, payload, len);
+    if (id < 0) {
+        fprintf(stderr, "Request failed: %s\n", strerror(-id));
+        return -1;
+    }
+    return id;
+}
+
+/*
+ * 전송한 요청의 응답 대기
+ * expect가 주어지면 조회 결과의 각 항목 값이 expect의 값과 같은지 확인
+ */
+static int wait_changeset(int id, const evb_changeset_t *expect) {
+    CBS_PROF_FUNC();
+    static evb_changeset_t reply;
+    static char text[MUP1_MAX_FRAME * 2];
+    mup1_response_t resp;
+    bool cbor;
+
+    if (id < 0) {
+        return -1;
+    }
+
+    int ret = mup1_wait(session, id, &resp, MUP1_DEFAULT_TIMEOUT_MS);
+    if (ret < 0) {
+        fprintf(stderr, "No response: %s\n", strerror(-ret));
+        return -1;
+    }
+
+    if (COAP_CODE_CLASS(resp.code) != 2) {
+        fprintf(stderr, "Command failed with code %d.%02d\n",
+                COAP_CODE_CLASS(resp.code), resp.code & 0x1F);
+        if (resp.payload_len > 0 && resp.content_format == COAP_CF_YAML) {
+            fprintf(stderr, "%s\n", (char *)resp.payload);
+        }
+        mup1_response_free(&resp);
+        return -1;
+    }
+
+    /* CBOR 응답은 변경 세트로 디코딩해서 경로 비교 / YAML로 출력 */
+    cbor = (resp.content_format == COAP_CF_YANG_INST_CBOR);
+    if (cbor) {
+        evb_cs_init(&reply);
+        ret = coreconf_decode(resp.payload, resp.payload_len, &reply);
+        if (ret < 0) {
+            fprintf(stderr, "Malformed CBOR response: %s\n", strerror(-ret));
+            mup1_response_free(&resp);
+            return -1;
+        }
+        ret = 0;
+    }
+
+    if (expect) {
+        int mismatched = 0;
+        for (int i = 0; i < expect->n_entries; i++) {
+            char diff[256];
+            bool match = cbor ? evb_cs_match_entry(expect, i, &reply, diff, sizeof(diff))
+                              : evb_cs_match_entry_yaml(expect, i, (const char *)resp.payload,
+                                                        diff, sizeof(diff));
+            if (!match) {
+                fprintf(stderr, "Mismatch: %s%s\n", evb_cs_str(expect, expect->entries[i].path), diff);
+                mismatched++;
+            }
+        }
+        printf("Verified %d/%d entries\n", expect->n_entries - mismatched, expect->n_entries);
+        ret = mismatched ? -1 : 0;
+    } else if (resp.code == COAP_CONTENT && resp.payload_len > 0) {
+        if (cbor && evb_cs_render_yaml(&reply, text, sizeof(text)) >= 0) {
+            printf("%s\n", text);
+        } else if (!cbor) {
+            printf("%s\n", (char *)resp.payload);
+        }
+    }
+
+    mup1_response_free(&resp);
+    return ret;
+}
+
+/*
+ * 변경 세트를 하나의 ipatch로 적용하고, 같은 경로를 fetch해서 값까지 확인
+ * 보드가 요청을 순서대로 처리하므로 두 요청을 연달아 보내고 응답을 기다림
+ */
+int commit_changeset(const evb_changeset_t *changes) {
+    CBS_PROF_FUNC();
+    static evb_changeset_t verify;
+    uint64_t start = evb_now_us();
+
+    evb_cs_init(&verify);
+    for (int i = 0; i < changes->n_entries; i++) {
+        evb_cs_fetch(&verify, "%s", evb_cs_str(changes, changes->entries[i].path));
+    }
+
+    int patch_id = submit_changeset(changes, COAP_IPATCH);
+    int fetch_id = (patch_id < 0) ? -1 : submit_changeset(&verify, COAP_FETCH);
+
+    int ret = wait_changeset(patch_id, NULL);
+    if (wait_changeset(fetch_id, changes) < 0) {
+        ret = -1;
+    }
+
+    printf("Committed in %.1f ms\n", (evb_now_us() - start) / 1000.0);
+    return ret;
+}
+
 /* CBS 활성화 */
 int enable_cbs(void) {
+    static evb_changeset_t cs;
+
     printf("\n=== Enabling CBS on EVB-LAN9692 ===\n\n");
-    
-    /* 1. VLAN 설정 */
-    printf("Step 1: Configuring VLANs...\n");
-    setup_vlan_configuration();
-    execute_velocitydrivesp_command("vlan_setup.yaml", "ipatch");
-    sleep(1);
-    
-    /* 2. PCP 매핑 설정 */
-    printf("\nStep 2: Configuring PCP mappings...\n");
-    setup_pcp_mapping();
-    execute_velocitydrivesp_command("pcp_decoding_p8.yaml", "ipatch");
-    execute_velocitydrivesp_command("pcp_encoding_p10_p11.yaml", "ipatch");
-    sleep(1);
-    
-    /* 3. CBS 설정 */
-    printf("\nStep 3: Configuring CBS shapers...\n");
-    setup_cbs_configuration();
-    execute_velocitydrivesp_command("cbs_setup.yaml", "ipatch");
-    sleep(1);
-    
-    /* 4. 통계 확인 */
-    printf("\nStep 4: Fetching statistics...\n");
-    generate_stats_fetch_yaml();
-    execute_velocitydrivesp_command("fetch_stats.yaml", "get");
-    
+
+    /* VLAN + PCP 매핑 + CBS 셰이퍼를 하나의 트랜잭션으로 */
+    evb_cs_init(&cs);
+    add_vlan_changes(&cs);
+    add_pcp_changes(&cs);
+    add_shaper_changes(&cs, true);
+
+    if (commit_changeset(&cs) < 0) {
+        fprintf(stderr, "CBS configuration failed\n");
+        return -1;
+    }
+
     printf("\n=== CBS Configuration Complete ===\n");
     return 0;
 }
 
 /* CBS 비활성화 */
 int disable_cbs(void) {
-    char yaml_content[2048];
-    
+    static evb_changeset_t cs;
+
     printf("\n=== Disabling CBS on EVB-LAN9692 ===\n\n");
-    
-    /* CBS 비활성화 YAML */
-    snprintf(yaml_content, sizeof(yaml_content),
-        "# Disable CBS on all ports\n"
-        "- \"/ietf-interfaces:interfaces/interface[name='10']/mchp-velocitysp-port:eth-qos/config/traffic-class-shapers\":\n"
-        "  - traffic-class: 7\n"
-        "    credit-based:\n"
-        "      idle-slope: 0\n"
-        "  - traffic-class: 6\n"
-        "    credit-based:\n"
-        "      idle-slope: 0\n"
-        "  - traffic-class: 5\n"
-        "    credit-based:\n"
-        "      idle-slope: 0\n\n"
-        
-        "- \"/ietf-interfaces:interfaces/interface[name='11']/mchp-velocitysp-port:eth-qos/config/traffic-class-shapers\":\n"
-        "  - traffic-class: 7\n"
-        "    credit-based:\n"
-        "      idle-slope: 0\n"
-        "  - traffic-class: 6\n"
-        "    credit-based:\n"
-        "      idle-slope: 0\n"
-        "  - traffic-class: 5\n"
-        "    credit-based:\n"
-        "      idle-slope: 0\n"
-    );
-    
-    generate_yaml_file("cbs_disable.yaml", yaml_content);
-    execute_velocitydrivesp_command("cbs_disable.yaml", "ipatch");
-    
+
+    evb_cs_init(&cs);
+    add_shaper_changes(&cs, false);
+
+    if (commit_changeset(&cs) < 0) {
+        return -1;
+    }
+
     printf("CBS disabled successfully\n");
     return 0;
 }
 
+/* 구성 + 통계 1회 조회 */
+int fetch_statistics(void) {
+    CBS_PROF_FUNC();
+    static evb_changeset_t stats;
+
+    evb_cs_init(&stats);
+    add_config_paths(&stats);
+    add_stats_paths(&stats);
+    return wait_changeset(submit_changeset(&stats, COAP_FETCH), NULL);
+}
+
 /* 실시간 모니터링 */
 void monitor_statistics(void) {
     printf("\n=== Real-time Statistics Monitoring ===\n");
@@ -361,7 +396,7 @@ void monitor_statistics(void) {
         printf("Time: %s\n", __TIME__);
         
         /* 통계 가져오기 */
-        execute_velocitydrivesp_command("fetch_stats.yaml", "get");
+        fetch_statistics();
         
         sleep(5);
     }
@@ -374,23 +409,35 @@ int main(int argc, char *argv[]) {
     printf("=====================================\n\n");
     
     if (argc < 2) {
-        printf("Usage: %s [enable|disable|monitor]\n", argv[0]);
+        printf("Usage: %s [enable|disable|stats|monitor]\n", argv[0]);
         printf("  enable  - Enable CBS with test configuration\n");
         printf("  disable - Disable CBS\n");
+        printf("  stats   - Fetch traffic class statistics once\n");
         printf("  monitor - Monitor real-time statistics\n");
+        printf("Set EVB_TTY to use another device (default %s)\n", TTY_DEVICE);
+        printf("Set EVB_ENCODING=cbor to send CORECONF CBOR instead of YAML\n");
+        printf("  (SIDs in coreconf_sid.c are placeholders until generated from the firmware .sid files)\n");
+        return 1;
+    }
+    
+    if (evb_connect() < 0) {
         return 1;
     }
     
+    int ret = 0;
     if (strcmp(argv[1], "enable") == 0) {
-        enable_cbs();
+        ret = enable_cbs();
     } else if (strcmp(argv[1], "disable") == 0) {
-        disable_cbs();
+        ret = disable_cbs();
+    } else if (strcmp(argv[1], "stats") == 0) {
+        ret = fetch_statistics();
     } else if (strcmp(argv[1], "monitor") == 0) {
         monitor_statistics();
     } else {
         fprintf(stderr, "Unknown command: %s\n", argv[1]);
-        return 1;
+        ret = -1;
     }
     
-    return 0;
+    evb_disconnect();
+    return ret < 0 ? 1 : 0;
 }
\ No newline at end of file
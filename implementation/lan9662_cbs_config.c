@@ -8,127 +8,174 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/mman.h>
 #include <arpa/inet.h>
 #include <linux/if.h>
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <signal.h>
+#include "cbs_regio.h"
+#include "cbs_regcache.h"
+#include "cbs_calc.h"
+#include "cbs_sampler.h"
+#include "cbs_counters.h"
+#include "cbs_hist.h"
+#include "cbs_shm.h"
+#include "cbs_trace.h"
+#include "lan9662_regs.h"
+#include "cbs_prof.h"
+#include "cbs_profiles.h"
 
-/* LAN9662 Register Map */
-#define LAN9662_BASE_ADDR           0x70000000
-#define LAN9662_REG_SIZE            0x10000000
-
-/* CBS Registers - Per Port Configuration */
-#define QSYS_CBS_PORT(p)            (0x0C000 + ((p) * 0x100))
-#define QSYS_CBS_CIR(p,q)           (QSYS_CBS_PORT(p) + 0x00 + ((q) * 0x10))
-#define QSYS_CBS_EIR(p,q)           (QSYS_CBS_PORT(p) + 0x04 + ((q) * 0x10))
-#define QSYS_CBS_CBS(p,q)           (QSYS_CBS_PORT(p) + 0x08 + ((q) * 0x10))
-#define QSYS_CBS_EBS(p,q)           (QSYS_CBS_PORT(p) + 0x0C + ((q) * 0x10))
-
-/* Port Configuration */
-#define DEVCPU_GCB_CHIP_MODE        0x71070000
-#define DEVCPU_GCB_PORT_MODE(p)     (0x71070100 + ((p) * 0x4))
-
-/* Queue System */
-#define QSYS_QMAP                   0x0C110000
-#define QSYS_QMAP_SE_BASE(se)       (QSYS_QMAP + ((se) * 0x4))
+/* 포트 x 큐 CBS 할당 매트릭스 (NULL = CBS 미사용, 레지스터 0) */
+typedef struct {
+    const streaming_profile_t *assign[LAN9662_NUM_PORTS][LAN9662_NUM_QUEUES];
+} lan9662_cbs_matrix_t;
 
-/* LAN9662 특성 */
-#define LAN9662_NUM_PORTS           64
-#define LAN9662_NUM_QUEUES          8
-#define LAN9662_PORT_SPEED_1G       1000000000
-#define LAN9662_PORT_SPEED_100M     100000000
-#define LAN9662_PORT_SPEED_10M      10000000
-#define LAN9662_MAX_FRAME_SIZE      9600  /* Jumbo Frame Support */
+/* 일괄 프로비저닝 결과 및 단계별 소요 시간 */
+typedef struct {
+    uint64_t compute_ns;       /* 파라미터 계산 */
+    uint64_t write_ns;         /* 섀도 기록 + flush */
+    uint64_t verify_ns;        /* 하드웨어 readback 검증 */
+    uint32_t queues;           /* CBS 할당된 큐 수 */
+    uint32_t registers;        /* 백엔드에 실제로 기록된 레지스터 수 */
+    uint32_t mismatches;       /* readback 불일치 레지스터 수 */
+    uint32_t invalid;          /* 계산할 수 없어 0 으로 둔 예약 수 */
+} lan9662_provision_report_t;
 
-/* VOD/Live Streaming Traffic Classes */
-typedef enum {
-    TC_LIVE_4K_VIDEO = 7,      /* 실시간 4K 영상 */
-    TC_LIVE_FHD_VIDEO = 6,     /* 실시간 FHD 영상 */
-    TC_VOD_STREAMING = 5,      /* VOD 스트리밍 */
-    TC_AUDIO_STREAM = 4,       /* 오디오 스트림 */
-    TC_CONTROL_DATA = 3,       /* 제어 데이터 */
-    TC_DIAGNOSTIC = 2,         /* 진단 데이터 */
-    TC_BEST_EFFORT = 0        /* 일반 트래픽 */
-} traffic_class_t;
+/* 큐 깊이 고주파 샘플링 대상 포트 수 (포트 0-7) */
+#define LAN9662_MONITOR_PORTS       8
+#define LAN9662_SAMPLE_HZ           1000
+#define LAN9662_DRAIN_INTERVAL_US   100000  /* 100ms 마다 링 비우기 */
 
-/* Streaming Profile */
-typedef struct {
-    const char *name;
-    uint32_t bitrate;          /* bps */
-    uint32_t burst_size;       /* bytes */
-    traffic_class_t tc;
-    uint8_t vlan_id_start;
-    uint8_t vlan_count;
-} streaming_profile_t;
+/* 카운터 폴링 주기 - 1G 옥텟 카운터 랩(약 34초)보다 충분히 짧게 */
+#define LAN9662_COUNTER_POLL_US     1000000
 
-/* 실제 스트리밍 프로파일 */
-static streaming_profile_t profiles[] = {
-    {"4K HDR Live", 25000000, 65536, TC_LIVE_4K_VIDEO, 100, 4},      /* 25Mbps */
-    {"FHD Live", 8000000, 32768, TC_LIVE_FHD_VIDEO, 110, 8},         /* 8Mbps */
-    {"HD VOD", 4000000, 16384, TC_VOD_STREAMING, 120, 16},           /* 4Mbps */
-    {"Audio HQ", 320000, 4096, TC_AUDIO_STREAM, 130, 8},             /* 320kbps */
-    {"Control", 100000, 1522, TC_CONTROL_DATA, 140, 4}               /* 100kbps */
-};
+/* 포트별 64비트 카운터 배치: MAC 카운터 다음에 큐 x 큐 카운터 */
+enum { MAC_TX_OCTETS, MAC_RX_OCTETS, MAC_TX_FRAMES, MAC_RX_FRAMES, MAC_DROPS, MAC_COUNTERS };
+enum { QUEUE_TX_FRAMES, QUEUE_TX_OCTETS, QUEUE_DROPS, QUEUE_COUNTERS };
+#define LAN9662_PORT_COUNTERS       (MAC_COUNTERS + LAN9662_NUM_QUEUES * QUEUE_COUNTERS)
+#define MAC_COUNTER(p,c)            ((p) * LAN9662_PORT_COUNTERS + (c))
+#define QUEUE_COUNTER(p,q,c)        ((p) * LAN9662_PORT_COUNTERS + MAC_COUNTERS + (q) * QUEUE_COUNTERS + (c))
 
 /* Global Variables */
-static void *reg_base = NULL;
-static int mem_fd = -1;
+static cbs_regio_t *regio = NULL;
+static cbs_regcache_t regcache;     /* QSYS 설정 레지스터 섀도 */
+static cbs_sampler_t sampler;       /* QSYS_QUEUE_DEPTH 샘플러, ring == NULL 이면 미사용 */
+static cbs_hist_t depth_hist[LAN9662_MONITOR_PORTS][LAN9662_NUM_QUEUES];     /* 보고 구간, 읽으면 초기화 */
+static cbs_hist_t depth_hist_run[LAN9662_MONITOR_PORTS][LAN9662_NUM_QUEUES]; /* 실행 전체 누적 */
+static cbs_counters_t counters;     /* 전 포트 MAC/큐 카운터, offsets == NULL 이면 미사용 */
+static cbs_shm_t shm;               /* 공유 메모리 통계 게시, seg == NULL 이면 미사용 */
+static uint32_t depth_last[LAN9662_MONITOR_PORTS][LAN9662_NUM_QUEUES]; /* 트레이스: 변화 시에만 기록 */
+static volatile sig_atomic_t running = 1;
 
 /* Register Access Functions */
+/* 통계/큐 깊이 등 하드웨어가 갱신하는 레지스터는 캐시를 거치지 않음 */
 static inline uint32_t lan9662_read(uint32_t offset) {
-    if (!reg_base) return 0;
-    return *((volatile uint32_t*)((uint8_t*)reg_base + offset));
+    if (!regio) return 0;
+    return cbs_regio_read(regio, offset);
 }
 
+/* 설정 쓰기는 섀도에 모았다가 flush 시 한 번의 barrier/readback 으로 반영 */
 static inline void lan9662_write(uint32_t offset, uint32_t value) {
-    if (!reg_base) return;
-    *((volatile uint32_t*)((uint8_t*)reg_base + offset)) = value;
-    usleep(1); /* 안정화 대기 */
+    if (!regio) return;
+    if (offset >= QSYS_CBS_PORT(0) && offset < QSYS_CBS_PORT(LAN9662_NUM_PORTS)) {
+        cbs_trace_emit(CBS_TRACE_REG_WRITE, (offset - QSYS_CBS_PORT(0)) >> 8,
+                       (offset & 0xFF) >> 4, offset, value);
+    } else {
+        cbs_trace_emit(CBS_TRACE_REG_WRITE, CBS_TRACE_NO_PORT, CBS_TRACE_NO_TC, offset, value);
+    }
+    cbs_regcache_write(&regcache, offset, value);
 }
 
-/* CBS 파라미터 계산 - 실제 하드웨어 특성 반영 */
-static void calculate_cbs_params(uint32_t bitrate, uint32_t port_speed,
-                                 uint32_t *cir, uint32_t *eir, 
-                                 uint32_t *cbs, uint32_t *ebs) {
-    /* Committed Information Rate (보장 대역폭) */
-    *cir = bitrate;
+/* 802.1Qav 클래스 기술 - 표준 프레임 스트림, 점보 BE 프레임이 간섭 */
+static cbs_calc_class_t lan9662_cbs_class(uint32_t bitrate, uint32_t burst_size) {
+    cbs_calc_class_t cls = {
+        .port_rate = LAN9662_PORT_SPEED_1G,
+        .idle_slope = bitrate,
+        .max_frame = CBS_CALC_DEFAULT_FRAME,
+        .max_interference = LAN9662_MAX_FRAME_SIZE,
+        .burst = burst_size > CBS_CALC_DEFAULT_FRAME ? burst_size : 0,
+    };
+    return cls;
+}
+
+/*
+ * CBS 파라미터 계산 - 공용 계산기(cbs_calc) 결과를 QSYS 셰이퍼에 매핑
+ * CIR = idleSlope, CBS 버킷 = hiCredit (최소 한 프레임),
+ * 802.1Qav 에는 초과 대역폭이 없으므로 EIR/EBS = 0
+ */
+static int calculate_cbs_params(const streaming_profile_t *profile,
+                                uint32_t *cir, uint32_t *eir,
+                                uint32_t *cbs, uint32_t *ebs,
+                                uint64_t *max_delay_ns) {
+    cbs_calc_class_t cls = lan9662_cbs_class(profile->bitrate, profile->burst_size);
+    cbs_calc_result_t result;
+    
+    if (cbs_calc(&cls, &result) < 0) {
+        return -1;
+    }
     
-    /* Excess Information Rate (초과 대역폭) - 버스트 허용 */
-    *eir = bitrate / 4; /* 25% 추가 버스트 허용 */
+    *cir = (uint32_t)result.idle_slope;
+    *eir = 0;
+    *cbs = result.hi_credit < cls.max_frame ? cls.max_frame : result.hi_credit;
+    *ebs = 0;
+    *max_delay_ns = result.max_delay_ns;
+    return 0;
+}
+
+/*
+ * 큐 배열의 CBS 파라미터 계산 - 큐마다 calculate_cbs_params 를 호출하는 스칼라 루프
+ * (프로파일의 burst 포함 동일한 매핑), 결과는 레지스터별 배열로 모음
+ * NULL(미사용 큐) 및 계산할 수 없는 예약은 0, 후자의 개수를 반환
+ */
+static uint32_t calculate_cbs_params_array(const streaming_profile_t *const *profiles, uint32_t n,
+                                           uint32_t *cir, uint32_t *eir,
+                                           uint32_t *cbs, uint32_t *ebs) {
+    uint32_t invalid = 0;
     
-    /* Committed Burst Size (보장 버스트 크기) */
-    *cbs = (bitrate * 20) / 1000; /* 20ms 버스트 */
-    if (*cbs < LAN9662_MAX_FRAME_SIZE) {
-        *cbs = LAN9662_MAX_FRAME_SIZE;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t max_delay_ns;
+        
+        cir[i] = eir[i] = cbs[i] = ebs[i] = 0;
+        if (profiles[i] == NULL) {
+            continue;
+        }
+        if (calculate_cbs_params(profiles[i], &cir[i], &eir[i], &cbs[i], &ebs[i], &max_delay_ns) < 0) {
+            cir[i] = eir[i] = cbs[i] = ebs[i] = 0;
+            invalid++;
+        }
     }
-    
-    /* Excess Burst Size (초과 버스트 크기) */
-    *ebs = *cbs / 2;
+    return invalid;
+}
+
+static inline uint64_t lan9662_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
 /* LAN9662 초기화 */
-int lan9662_init(void) {
-    /* /dev/mem 열기 */
-    mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if (mem_fd < 0) {
-        perror("Failed to open /dev/mem");
+int lan9662_init(const char *backend) {
+    CBS_PROF_FUNC();
+    /* 레지스터 백엔드 열기 (NULL = /dev/mem 매핑) */
+    regio = cbs_regio_open_spec(backend, LAN9662_BASE_ADDR, LAN9662_REG_SIZE);
+    if (regio == NULL) {
         return -1;
     }
     
-    /* 레지스터 메모리 매핑 */
-    reg_base = mmap(NULL, LAN9662_REG_SIZE, PROT_READ | PROT_WRITE,
-                    MAP_SHARED, mem_fd, LAN9662_BASE_ADDR);
-    if (reg_base == MAP_FAILED) {
-        perror("Failed to mmap registers");
-        close(mem_fd);
+    /* 64 포트 x 8 큐 x 4 QSYS_CBS_* 레지스터 + QMAP */
+    if (cbs_regcache_init(&regcache, regio,
+                          LAN9662_NUM_PORTS * LAN9662_NUM_QUEUES * 4 + 256) < 0) {
+        cbs_regio_close(regio);
+        regio = NULL;
         return -1;
     }
     
-    printf("LAN9662 초기화 완료 (Base: 0x%lx)\n", LAN9662_BASE_ADDR);
+    printf("LAN9662 초기화 완료 (Base: 0x%x, Backend: %s)\n",
+           LAN9662_BASE_ADDR, regio->ops->name);
     
     /* Chip Mode 확인 */
     uint32_t chip_mode = lan9662_read(DEVCPU_GCB_CHIP_MODE - LAN9662_BASE_ADDR);
@@ -138,8 +185,10 @@ int lan9662_init(void) {
 }
 
 /* 포트별 CBS 구성 */
-int lan9662_configure_port_cbs(uint8_t port, streaming_profile_t *profile) {
+int lan9662_configure_port_cbs(uint8_t port, const streaming_profile_t *profile) {
+    CBS_PROF_FUNC();
     uint32_t cir, eir, cbs, ebs;
+    uint64_t max_delay_ns;
     
     if (port >= LAN9662_NUM_PORTS) {
         fprintf(stderr, "Invalid port number: %d\n", port);
@@ -154,15 +203,19 @@ int lan9662_configure_port_cbs(uint8_t port, streaming_profile_t *profile) {
            profile->vlan_id_start + profile->vlan_count - 1);
     
     /* CBS 파라미터 계산 */
-    calculate_cbs_params(profile->bitrate, LAN9662_PORT_SPEED_1G,
-                        &cir, &eir, &cbs, &ebs);
+    if (calculate_cbs_params(profile, &cir, &eir, &cbs, &ebs, &max_delay_ns) < 0) {
+        fprintf(stderr, "Invalid CBS reservation: %u bps\n", profile->bitrate);
+        return -1;
+    }
     
     printf("  - CIR: %u bps, EIR: %u bps\n", cir, eir);
     printf("  - CBS: %u bytes, EBS: %u bytes\n", cbs, ebs);
+    printf("  - 최악 큐잉 지연: %.1f us\n", max_delay_ns / 1000.0);
     
     /* 레지스터 설정 */
+    cbs_regcache_begin(&regcache);
     for (int queue = 0; queue < LAN9662_NUM_QUEUES; queue++) {
-        if (queue == profile->tc) {
+        if (queue == (int)profile->tc) {
             /* 해당 TC에 CBS 설정 */
             lan9662_write(QSYS_CBS_CIR(port, queue), cir / 100); /* 100bps 단위 */
             lan9662_write(QSYS_CBS_EIR(port, queue), eir / 100);
@@ -178,53 +231,369 @@ int lan9662_configure_port_cbs(uint8_t port, streaming_profile_t *profile) {
             lan9662_write(QSYS_CBS_EBS(port, queue), 0);
         }
     }
+    cbs_regcache_end(&regcache);
     
     return 0;
 }
 
-/* VLAN to TC 매핑 설정 */
-int lan9662_configure_vlan_mapping(streaming_profile_t *profile) {
+/* 전체 포트 x 큐 CBS 일괄 구성 - 계산, 기록, 검증을 각각 한 번의 패스로 수행 */
+int lan9662_provision_cbs(const lan9662_cbs_matrix_t *matrix,
+                          lan9662_provision_report_t *report) {
+    CBS_PROF_FUNC();
+    enum { N = LAN9662_NUM_PORTS * LAN9662_NUM_QUEUES };
+    static uint32_t cir[N], eir[N], cbs[N], ebs[N];
+    const streaming_profile_t *const *profiles = &matrix->assign[0][0];
+    uint32_t regs[N][4];
+    uint64_t t0, t1, t2, t3;
+    int flushed;
+    
+    memset(report, 0, sizeof(*report));
+    
+    /* 1. 계산: 포트 x 큐 순서로 레지스터별 배열에 모음, 미할당 큐는 0 */
+    t0 = lan9662_now_ns();
+    for (uint32_t i = 0; i < N; i++) {
+        report->queues += (profiles[i] != NULL);
+    }
+    report->invalid = calculate_cbs_params_array(profiles, N, cir, eir, cbs, ebs);
+    for (uint32_t i = 0; i < N; i++) {
+        regs[i][0] = cir[i] / 100;  /* 100bps 단위 */
+        regs[i][1] = eir[i] / 100;
+        regs[i][2] = cbs[i];
+        regs[i][3] = ebs[i];
+    }
+    
+    /* 2. 기록: 하나의 트랜잭션으로 flush */
+    t1 = lan9662_now_ns();
+    cbs_regcache_begin(&regcache);
+    for (uint32_t i = 0; i < N; i++) {
+        uint8_t port = i / LAN9662_NUM_QUEUES, queue = i % LAN9662_NUM_QUEUES;
+        lan9662_write(QSYS_CBS_CIR(port, queue), regs[i][0]);
+        lan9662_write(QSYS_CBS_EIR(port, queue), regs[i][1]);
+        lan9662_write(QSYS_CBS_CBS(port, queue), regs[i][2]);
+        lan9662_write(QSYS_CBS_EBS(port, queue), regs[i][3]);
+    }
+    flushed = cbs_regcache_end(&regcache);
+    
+    /* 3. 검증: 섀도를 거치지 않고 하드웨어 값 확인 */
+    t2 = lan9662_now_ns();
+    for (uint32_t i = 0; i < N; i++) {
+        uint8_t port = i / LAN9662_NUM_QUEUES, queue = i % LAN9662_NUM_QUEUES;
+        report->mismatches += lan9662_read(QSYS_CBS_CIR(port, queue)) != regs[i][0];
+        report->mismatches += lan9662_read(QSYS_CBS_EIR(port, queue)) != regs[i][1];
+        report->mismatches += lan9662_read(QSYS_CBS_CBS(port, queue)) != regs[i][2];
+        report->mismatches += lan9662_read(QSYS_CBS_EBS(port, queue)) != regs[i][3];
+    }
+    t3 = lan9662_now_ns();
+    
+    report->compute_ns = t1 - t0;
+    report->write_ns = t2 - t1;
+    report->verify_ns = t3 - t2;
+    report->registers = flushed > 0 ? flushed : 0;
+    
+    return (report->mismatches || report->invalid) ? -1 : 0;
+}
+
+/* 일괄 프로비저닝 결과 출력 */
+void lan9662_print_provision_report(const lan9662_provision_report_t *report) {
+    printf("\n=== CBS 일괄 프로비저닝 ===\n");
+    printf("  CBS 큐: %u / %d, 기록 레지스터: %u, 불일치: %u, 계산 불가: %u\n",
+           report->queues, LAN9662_NUM_PORTS * LAN9662_NUM_QUEUES,
+           report->registers, report->mismatches, report->invalid);
+    printf("  계산: %.1f us, 기록: %.1f us, 검증: %.1f us\n",
+           report->compute_ns / 1000.0, report->write_ns / 1000.0,
+           report->verify_ns / 1000.0);
+}
+
+/* 프로파일별 예약 대역폭과 그에 따른 최악 큐잉 지연 출력 */
+void lan9662_print_latency_budget(void) {
+    printf("\n=== CBS 지연 예산 (1G 포트, 점보 프레임 간섭) ===\n");
+    printf("  %-14s %10s %8s %8s %8s %12s\n",
+           "프로파일", "CIR kbps", "hiCred", "loCred", "burst", "최악 지연 us");
+    for (size_t i = 0; i < cbs_num_profiles; i++) {
+        cbs_calc_class_t cls = lan9662_cbs_class(cbs_profiles[i].bitrate, cbs_profiles[i].burst_size);
+        cbs_calc_result_t result;
+        
+        if (cbs_calc(&cls, &result) < 0) {
+            continue;
+        }
+        printf("  %-14s %10u %8u %8u %8u %12.1f\n", cbs_profiles[i].name,
+               cbs_profiles[i].bitrate / 1000, result.hi_credit, result.lo_credit,
+               cbs_profiles[i].burst_size, result.max_delay_ns / 1000.0);
+    }
+}
+
+/* VLAN to TC 매핑 설정 - 범위 이미지를 만든 뒤 변경된 엔트리만 연속 기록 */
+int lan9662_configure_vlan_mapping(const streaming_profile_t *profile) {
+    CBS_PROF_FUNC();
+    uint32_t qmap_val = (profile->tc << 0) |  /* Queue number */
+                        (1 << 3);              /* Enable */
+    int changed = 0;
+    
     printf("\nVLAN → TC 매핑 설정\n");
     
+    cbs_regcache_begin(&regcache);
     for (int i = 0; i < profile->vlan_count; i++) {
         uint16_t vlan_id = profile->vlan_id_start + i;
         uint32_t se_idx = vlan_id; /* Service Entry Index */
-        uint32_t qmap_val = (profile->tc << 0) |  /* Queue number */
-                           (1 << 3);               /* Enable */
         
-        lan9662_write(QSYS_QMAP_SE_BASE(se_idx), qmap_val);
-        printf("  VLAN %d → TC%d\n", vlan_id, profile->tc);
+        if (cbs_regcache_read(&regcache, QSYS_QMAP_SE_BASE(se_idx)) != qmap_val) {
+            lan9662_write(QSYS_QMAP_SE_BASE(se_idx), qmap_val);
+            changed++;
+        }
     }
+    cbs_regcache_end(&regcache);
+    
+    printf("  VLAN %d-%d → TC%d (%d 엔트리 변경)\n",
+           profile->vlan_id_start, profile->vlan_id_start + profile->vlan_count - 1,
+           profile->tc, changed);
     
     return 0;
 }
 
+/* 큐 배출 속도 - CBS 큐는 CIR(idle slope), 아니면 포트 선로 속도 */
+static uint64_t lan9662_queue_drain_rate(int port, int q) {
+    uint64_t cir = (uint64_t)lan9662_read(QSYS_CBS_CIR(port, q)) * 100;  /* 100bps 단위 */
+    return cir ? cir : LAN9662_PORT_SPEED_1G;
+}
+
 /* 실시간 통계 모니터링 */
 void lan9662_monitor_statistics(uint8_t port) {
+    CBS_PROF_FUNC();
     printf("\n=== Port %d 실시간 통계 ===\n", port);
     
-    /* 포트 통계 레지스터 읽기 */
-    uint32_t tx_octets = lan9662_read(0x04000000 + (port * 0x100));
-    uint32_t rx_octets = lan9662_read(0x04000004 + (port * 0x100));
-    uint32_t tx_frames = lan9662_read(0x04000008 + (port * 0x100));
-    uint32_t rx_frames = lan9662_read(0x0400000C + (port * 0x100));
-    uint32_t drops = lan9662_read(0x04000010 + (port * 0x100));
-    
-    printf("TX: %u bytes (%u frames)\n", tx_octets, tx_frames);
-    printf("RX: %u bytes (%u frames)\n", rx_octets, rx_frames);
-    printf("Drops: %u frames\n", drops);
+    /* 포트 통계 - 64비트 누적값과 EWMA 속도 */
+    if (counters.offsets != NULL) {
+        const cbs_counter_t *mac = &counters.counters[MAC_COUNTER(port, 0)];
+        
+        printf("TX: %llu bytes (%llu frames), %.2f Mbps, %.0f fps\n",
+               (unsigned long long)mac[MAC_TX_OCTETS].total,
+               (unsigned long long)mac[MAC_TX_FRAMES].total,
+               mac[MAC_TX_OCTETS].rate * 8 / 1e6, mac[MAC_TX_FRAMES].rate);
+        printf("RX: %llu bytes (%llu frames), %.2f Mbps, %.0f fps\n",
+               (unsigned long long)mac[MAC_RX_OCTETS].total,
+               (unsigned long long)mac[MAC_RX_FRAMES].total,
+               mac[MAC_RX_OCTETS].rate * 8 / 1e6, mac[MAC_RX_FRAMES].rate);
+        printf("Drops: %llu frames (%.1f/s)\n",
+               (unsigned long long)mac[MAC_DROPS].total, mac[MAC_DROPS].rate);
+        
+        for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
+            const cbs_counter_t *qc = &counters.counters[QUEUE_COUNTER(port, q, 0)];
+            if (qc[QUEUE_TX_FRAMES].total > 0 || qc[QUEUE_DROPS].total > 0) {
+                printf("Queue %d: %.2f Mbps, %llu frames, %llu drops\n", q,
+                       qc[QUEUE_TX_OCTETS].rate * 8 / 1e6,
+                       (unsigned long long)qc[QUEUE_TX_FRAMES].total,
+                       (unsigned long long)qc[QUEUE_DROPS].total);
+            }
+        }
+    } else {
+        printf("TX: %u bytes (%u frames)\n", lan9662_read(DEV_STAT_TX_OCTETS(port)),
+               lan9662_read(DEV_STAT_TX_FRAMES(port)));
+        printf("RX: %u bytes (%u frames)\n", lan9662_read(DEV_STAT_RX_OCTETS(port)),
+               lan9662_read(DEV_STAT_RX_FRAMES(port)));
+        printf("Drops: %u frames\n", lan9662_read(DEV_STAT_DROPS(port)));
+    }
     
-    /* Queue별 통계 */
+    /* Queue별 깊이 - 샘플러가 있으면 구간 백분위수와 지연, 없으면 현재 값 */
     for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
-        uint32_t queue_depth = lan9662_read(0x0C200000 + (port * 0x40) + (q * 0x4));
+        if (sampler.ring != NULL && port < LAN9662_MONITOR_PORTS) {
+            cbs_hist_t *h = &depth_hist[port][q];
+            cbs_hist_summary_t sum;
+            uint64_t rate = lan9662_queue_drain_rate(port, q);
+            
+            cbs_hist_merge(&depth_hist_run[port][q], h);
+            cbs_hist_summarize(h, &sum, 1);
+            if (sum.max > 0) {
+                printf("Queue %d depth p50/p99/p99.9/max: %u/%u/%u/%u B, "
+                       "delay %.1f/%.1f/%.1f/%.1f us (%llu samples)\n", q,
+                       sum.p50, sum.p99, sum.p999, sum.max,
+                       cbs_hist_delay_ns(sum.p50, rate) / 1e3, cbs_hist_delay_ns(sum.p99, rate) / 1e3,
+                       cbs_hist_delay_ns(sum.p999, rate) / 1e3, cbs_hist_delay_ns(sum.max, rate) / 1e3,
+                       (unsigned long long)sum.count);
+            }
+            continue;
+        }
+        uint32_t queue_depth = lan9662_read(QSYS_QUEUE_DEPTH(port, q));
         if (queue_depth > 0) {
             printf("Queue %d depth: %u\n", q, queue_depth);
         }
     }
 }
 
+/* 실시간 영상 큐(TC7/TC6)의 실행 누적 꼬리 지연 - SLA 판단 기준 */
+void lan9662_print_tail_latency(void) {
+    static const int tcs[] = { TC_LIVE_4K_VIDEO, TC_LIVE_FHD_VIDEO };
+    
+    if (sampler.ring == NULL) return;
+    
+    printf("\n=== 누적 꼬리 지연 (TC7/TC6) ===\n");
+    for (int port = 0; port < LAN9662_MONITOR_PORTS; port++) {
+        for (size_t i = 0; i < sizeof(tcs)/sizeof(tcs[0]); i++) {
+            cbs_hist_summary_t sum;
+            uint64_t rate = lan9662_queue_drain_rate(port, tcs[i]);
+            
+            cbs_hist_summarize(&depth_hist_run[port][tcs[i]], &sum, 0);
+            if (sum.count == 0) continue;
+            printf("Port %d TC%d: p99 %.1f us, p99.9 %.1f us, max %.1f us (%llu samples)\n",
+                   port, tcs[i], cbs_hist_delay_ns(sum.p99, rate) / 1e3,
+                   cbs_hist_delay_ns(sum.p999, rate) / 1e3, cbs_hist_delay_ns(sum.max, rate) / 1e3,
+                   (unsigned long long)sum.count);
+        }
+    }
+}
+
+/* 전 포트 MAC/큐 카운터 등록 - 랩 검출 기준은 1G 선로 속도 */
+int lan9662_init_counters(void) {
+    CBS_PROF_FUNC();
+    uint32_t octets = cbs_counters_octets_per_sec(LAN9662_PORT_SPEED_1G);
+    uint32_t frames = cbs_counters_frames_per_sec(LAN9662_PORT_SPEED_1G);
+    int ret;
+    
+    ret = cbs_counters_init(&counters, regio, LAN9662_NUM_PORTS * LAN9662_PORT_COUNTERS, 0);
+    if (ret < 0) {
+        return ret;
+    }
+    
+    for (int port = 0; port < LAN9662_NUM_PORTS; port++) {
+        cbs_counters_add(&counters, DEV_STAT_TX_OCTETS(port), octets);
+        cbs_counters_add(&counters, DEV_STAT_RX_OCTETS(port), octets);
+        cbs_counters_add(&counters, DEV_STAT_TX_FRAMES(port), frames);
+        cbs_counters_add(&counters, DEV_STAT_RX_FRAMES(port), frames);
+        cbs_counters_add(&counters, DEV_STAT_DROPS(port), frames);
+        for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
+            cbs_counters_add(&counters, QSYS_QSTAT_TX_FRAMES(port, q), frames);
+            cbs_counters_add(&counters, QSYS_QSTAT_TX_OCTETS(port, q), octets);
+            cbs_counters_add(&counters, QSYS_QSTAT_DROPS(port, q), frames);
+        }
+    }
+    
+    /* 기준값 읽기 */
+    cbs_counters_poll(&counters);
+    return 0;
+}
+
+/* 카운터 폴링 결과 중 0 이 아닌 증가분을 트레이스에 기록 */
+static void lan9662_trace_counter_deltas(void) {
+    static const uint8_t mac_kind[MAC_COUNTERS] = {
+        [MAC_TX_OCTETS] = CBS_TRACE_CTR_TX_OCTETS, [MAC_RX_OCTETS] = CBS_TRACE_CTR_RX_OCTETS,
+        [MAC_TX_FRAMES] = CBS_TRACE_CTR_TX_FRAMES, [MAC_RX_FRAMES] = CBS_TRACE_CTR_RX_FRAMES,
+        [MAC_DROPS] = CBS_TRACE_CTR_DROPS,
+    };
+    static const uint8_t queue_kind[QUEUE_COUNTERS] = {
+        [QUEUE_TX_FRAMES] = CBS_TRACE_CTR_TX_FRAMES, [QUEUE_TX_OCTETS] = CBS_TRACE_CTR_TX_OCTETS,
+        [QUEUE_DROPS] = CBS_TRACE_CTR_DROPS,
+    };
+    uint64_t t = cbs_trace_now_ns();
+    
+    if (cbs_trace.events == NULL || counters.offsets == NULL) return;
+    
+    for (int port = 0; port < LAN9662_NUM_PORTS; port++) {
+        for (int c = 0; c < MAC_COUNTERS; c++) {
+            uint64_t delta = counters.counters[MAC_COUNTER(port, c)].delta;
+            if (delta) {
+                cbs_trace_emit_at(t, CBS_TRACE_COUNTER_DELTA, port, CBS_TRACE_NO_TC, mac_kind[c], delta);
+            }
+        }
+        for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
+            for (int c = 0; c < QUEUE_COUNTERS; c++) {
+                uint64_t delta = counters.counters[QUEUE_COUNTER(port, q, c)].delta;
+                if (delta) {
+                    cbs_trace_emit_at(t, CBS_TRACE_COUNTER_DELTA, port, q, queue_kind[c], delta);
+                }
+            }
+        }
+    }
+}
+
+/* 카운터 폴링 직후 최신 값을 공유 메모리에 게시 - 읽는 쪽은 시스템 콜 없이 스냅샷 */
+void lan9662_publish_stats(void) {
+    CBS_PROF_FUNC();
+    cbs_shm_data_t *data;
+    
+    if (shm.seg == NULL || counters.offsets == NULL) return;
+    
+    data = cbs_shm_begin(&shm);
+    for (int port = 0; port < LAN9662_NUM_PORTS; port++) {
+        const cbs_counter_t *mc = &counters.counters[MAC_COUNTER(port, 0)];
+        cbs_shm_port_t *sp = &data->ports[port];
+        
+        sp->tx_octets = mc[MAC_TX_OCTETS].total;
+        sp->rx_octets = mc[MAC_RX_OCTETS].total;
+        sp->tx_frames = mc[MAC_TX_FRAMES].total;
+        sp->rx_frames = mc[MAC_RX_FRAMES].total;
+        sp->drops = mc[MAC_DROPS].total;
+        sp->tx_bps = mc[MAC_TX_OCTETS].rate * 8;
+        sp->rx_bps = mc[MAC_RX_OCTETS].rate * 8;
+        sp->status = 0;
+        
+        for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
+            const cbs_counter_t *qc = &counters.counters[QUEUE_COUNTER(port, q, 0)];
+            cbs_shm_tc_t *st = &sp->tc[q];
+            /* 설정값은 섀도에서 - 장치 접근 없음 */
+            uint32_t cir = cbs_regcache_read(&regcache, QSYS_CBS_CIR(port, q));
+            
+            st->tx_frames = qc[QUEUE_TX_FRAMES].total;
+            st->tx_octets = qc[QUEUE_TX_OCTETS].total;
+            st->drops = qc[QUEUE_DROPS].total;
+            st->tx_bps = qc[QUEUE_TX_OCTETS].rate * 8;
+            st->idle_slope_kbps = cir / 10;     /* 100bps 단위 */
+            st->depth_max = port < LAN9662_MONITOR_PORTS ? depth_hist[port][q].max : 0;
+            st->status = cir ? CBS_SHM_TC_SHAPED : 0;
+            sp->status |= cir ? 1u << q : 0;
+        }
+    }
+    cbs_shm_end(&shm, lan9662_now_ns());
+}
+
+/* 큐 깊이 샘플러 시작 - 모니터링 포트의 모든 큐를 rate_hz 로 읽음 */
+int lan9662_start_depth_sampler(uint32_t rate_hz) {
+    int ret = cbs_sampler_init(&sampler, regio, rate_hz);
+    if (ret < 0) {
+        return ret;
+    }
+    
+    for (int port = 0; port < LAN9662_MONITOR_PORTS; port++) {
+        for (int q = 0; q < LAN9662_NUM_QUEUES; q++) {
+            cbs_hist_reset(&depth_hist[port][q]);
+            cbs_hist_reset(&depth_hist_run[port][q]);
+            cbs_sampler_add(&sampler, QSYS_QUEUE_DEPTH(port, q), port, q);
+        }
+    }
+    
+    ret = cbs_sampler_start(&sampler);
+    if (ret < 0) {
+        cbs_sampler_destroy(&sampler);
+    }
+    return ret;
+}
+
+/* 링에 쌓인 샘플을 꺼내 큐별 깊이 히스토그램에 기록 - 샘플러는 막지 않음 */
+void lan9662_collect_depth_samples(void) {
+    CBS_PROF_FUNC();
+    static cbs_sample_t batch[4096];
+    size_t n;
+    
+    if (sampler.ring == NULL) return;
+    
+    while ((n = cbs_sampler_drain(&sampler, batch, sizeof(batch)/sizeof(batch[0]))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const cbs_sampler_channel_t *ch = &sampler.channels[batch[i].channel];
+            cbs_hist_record(&depth_hist[ch->port][ch->queue], batch[i].value);
+            if (batch[i].value != depth_last[ch->port][ch->queue]) {
+                cbs_trace_emit_at(batch[i].t_ns, CBS_TRACE_QUEUE_DEPTH, ch->port, ch->queue,
+                                  batch[i].value, 0);
+                depth_last[ch->port][ch->queue] = batch[i].value;
+            }
+        }
+    }
+}
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
 /* VLC 스트리밍 설정 스크립트 생성 */
-void generate_vlc_config(streaming_profile_t *profile, const char *source_file) {
+void generate_vlc_config(const streaming_profile_t *profile, const char *source_file) {
     char filename[256];
     snprintf(filename, sizeof(filename), "vlc_stream_%s.sh", profile->name);
     
@@ -269,8 +638,8 @@ void setup_vod_server(void) {
     fprintf(fp, "        listen 1935;\n");
     fprintf(fp, "        chunk_size 4096;\n\n");
     
-    for (int i = 0; i < sizeof(profiles)/sizeof(profiles[0]); i++) {
-        fprintf(fp, "        application %s {\n", profiles[i].name);
+    for (size_t i = 0; i < cbs_num_profiles; i++) {
+        fprintf(fp, "        application %s {\n", cbs_profiles[i].name);
         fprintf(fp, "            live on;\n");
         fprintf(fp, "            record off;\n");
         fprintf(fp, "            allow publish all;\n");
@@ -278,13 +647,13 @@ void setup_vod_server(void) {
         
         /* HLS 설정 */
         fprintf(fp, "            hls on;\n");
-        fprintf(fp, "            hls_path /var/www/hls/%s;\n", profiles[i].name);
+        fprintf(fp, "            hls_path /var/www/hls/%s;\n", cbs_profiles[i].name);
         fprintf(fp, "            hls_fragment 3;\n");
         fprintf(fp, "            hls_playlist_length 60;\n");
         
         /* DASH 설정 */
         fprintf(fp, "            dash on;\n");
-        fprintf(fp, "            dash_path /var/www/dash/%s;\n", profiles[i].name);
+        fprintf(fp, "            dash_path /var/www/dash/%s;\n", cbs_profiles[i].name);
         fprintf(fp, "            dash_fragment 3;\n");
         fprintf(fp, "            dash_playlist_length 60;\n");
         fprintf(fp, "        }\n\n");
@@ -298,45 +667,111 @@ void setup_vod_server(void) {
 }
 
 /* 메인 테스트 프로그램 */
-int main(int argc, char *argv[]) {
+int main(void) {
     printf("===========================================\n");
     printf("   LAN9662 TSN CBS 구성 및 테스트 도구\n");
     printf("   Microchip 64-Port Gigabit Switch\n");
     printf("===========================================\n\n");
     
-    /* LAN9662 초기화 */
-    if (lan9662_init() < 0) {
+    /* CBS_TRACE=file 이면 프로비저닝 쓰기, 큐 깊이 변화, 카운터 증가분을 기록 */
+    if (getenv("CBS_TRACE") && cbs_trace_start(0) < 0) {
+        fprintf(stderr, "트레이스 버퍼 할당 실패\n");
+    }
+    
+    /* LAN9662 초기화 - LAN9662_REGIO=sim 으로 하드웨어 없이 실행 */
+    if (lan9662_init(getenv("LAN9662_REGIO")) < 0) {
         fprintf(stderr, "LAN9662 초기화 실패\n");
         return -1;
     }
     
-    /* 각 스트리밍 프로파일에 대해 CBS 구성 */
-    for (int i = 0; i < sizeof(profiles)/sizeof(profiles[0]); i++) {
-        /* 포트 그룹 할당: 4K는 포트 1-4, FHD는 5-12, VOD는 13-28 등 */
+    /* 포트 그룹 할당: 4K는 포트 0-3, FHD는 16-19, VOD는 32-35 등 */
+    static lan9662_cbs_matrix_t matrix;
+    lan9662_provision_report_t report;
+    
+    for (size_t i = 0; i < cbs_num_profiles; i++) {
         int start_port = i * 16;
         int end_port = start_port + 4;
         
-        for (int port = start_port; port < end_port && port < 64; port++) {
-            lan9662_configure_port_cbs(port, &profiles[i]);
+        for (int port = start_port; port < end_port && port < LAN9662_NUM_PORTS; port++) {
+            matrix.assign[port][cbs_profiles[i].tc] = &cbs_profiles[i];
         }
-        
+    }
+    
+    /* 전체 스위치 CBS 를 하나의 트랜잭션으로 구성 */
+    if (lan9662_provision_cbs(&matrix, &report) < 0) {
+        fprintf(stderr, "CBS 레지스터 검증 실패\n");
+    }
+    lan9662_print_provision_report(&report);
+    lan9662_print_latency_budget();
+    
+    /* 각 스트리밍 프로파일에 대해 VLAN 매핑 - 전체를 한 번에 flush */
+    cbs_regcache_begin(&regcache);
+    for (size_t i = 0; i < cbs_num_profiles; i++) {
         /* VLAN 매핑 설정 */
-        lan9662_configure_vlan_mapping(&profiles[i]);
+        lan9662_configure_vlan_mapping(&cbs_profiles[i]);
         
         /* VLC 설정 생성 */
-        generate_vlc_config(&profiles[i], "/media/video/sample.mp4");
+        generate_vlc_config(&cbs_profiles[i], "/media/video/sample.mp4");
     }
+    cbs_regcache_end(&regcache);
+    cbs_regcache_dump_stats(&regcache, stdout);
     
     /* VOD 서버 설정 */
     setup_vod_server();
     
-    /* 모니터링 루프 */
+    /* 큐 깊이 샘플러 - LAN9662_SAMPLE_HZ 로 1-10kHz 설정 */
+    const char *rate = getenv("LAN9662_SAMPLE_HZ");
+    uint32_t rate_hz = rate ? (uint32_t)atoi(rate) : LAN9662_SAMPLE_HZ;
+    if (lan9662_start_depth_sampler(rate_hz) < 0) {
+        fprintf(stderr, "큐 깊이 샘플러 시작 실패 (%u Hz), 5초 주기 읽기로 대체\n", rate_hz);
+    }
+    
+    /* 64비트 카운터 - 랩 시간 안에 폴링 */
+    if (lan9662_init_counters() < 0) {
+        fprintf(stderr, "카운터 초기화 실패, 32비트 원시값 출력\n");
+    }
+    
+    /* 공유 메모리 통계 - cbs_stat 등 로컬 리더용 */
+    int ret = cbs_shm_create(&shm, getenv("LAN9662_SHM"), LAN9662_NUM_PORTS);
+    if (ret < 0) {
+        fprintf(stderr, "공유 메모리 통계 생성 실패: %s\n", strerror(-ret));
+    }
+    
+    /* 모니터링 루프 - Ctrl+C 시 트레이스 저장 후 종료 */
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
     printf("\n실시간 모니터링 시작 (Ctrl+C로 종료)\n");
-    while (1) {
-        sleep(5);
-        for (int port = 0; port < 8; port++) {
+    while (running) {
+        for (int i = 1; i <= 5000000 / LAN9662_DRAIN_INTERVAL_US && running; i++) {
+            usleep(LAN9662_DRAIN_INTERVAL_US);
+            lan9662_collect_depth_samples();
+            if (counters.offsets != NULL &&
+                i % (LAN9662_COUNTER_POLL_US / LAN9662_DRAIN_INTERVAL_US) == 0) {
+                cbs_counters_poll(&counters);
+                lan9662_trace_counter_deltas();
+                lan9662_publish_stats();
+            }
+        }
+        for (int port = 0; port < LAN9662_MONITOR_PORTS; port++) {
             lan9662_monitor_statistics(port);
         }
+        lan9662_print_tail_latency();
+    }
+    
+    if (sampler.ring != NULL) {
+        cbs_sampler_stop(&sampler);
+        lan9662_collect_depth_samples();
+        cbs_sampler_destroy(&sampler);
+    }
+    cbs_shm_close(&shm);
+    if (cbs_trace.events != NULL) {
+        int64_t saved = cbs_trace_save(getenv("CBS_TRACE"), "lan9662_cbs_config");
+        if (saved < 0) {
+            fprintf(stderr, "트레이스 저장 실패: %s\n", strerror((int)-saved));
+        } else {
+            printf("트레이스: %lld 이벤트 → %s\n", (long long)saved, getenv("CBS_TRACE"));
+        }
+        cbs_trace_stop();
     }
     
     return 0;
@@ -0,0 +1,51 @@
+/**
+ * LAN9662 Register Map
+ * Register offsets and device limits shared by the LAN9662 tools
+ */
+
+#ifndef LAN9662_REGS_H
+#define LAN9662_REGS_H
+
+/* LAN9662 Register Map */
+#define LAN9662_BASE_ADDR           0x70000000
+#define LAN9662_REG_SIZE            0x10000000
+
+/* CBS Registers - Per Port Configuration */
+#define QSYS_CBS_PORT(p)            (0x0C000 + ((p) * 0x100))
+#define QSYS_CBS_CIR(p,q)           (QSYS_CBS_PORT(p) + 0x00 + ((q) * 0x10))
+#define QSYS_CBS_EIR(p,q)           (QSYS_CBS_PORT(p) + 0x04 + ((q) * 0x10))
+#define QSYS_CBS_CBS(p,q)           (QSYS_CBS_PORT(p) + 0x08 + ((q) * 0x10))
+#define QSYS_CBS_EBS(p,q)           (QSYS_CBS_PORT(p) + 0x0C + ((q) * 0x10))
+
+/* Port Configuration */
+#define DEVCPU_GCB_CHIP_MODE        0x71070000
+#define DEVCPU_GCB_PORT_MODE(p)     (0x71070100 + ((p) * 0x4))
+
+/* Queue System */
+#define QSYS_QMAP                   0x0C110000
+#define QSYS_QMAP_SE_BASE(se)       (QSYS_QMAP + ((se) * 0x4))
+#define QSYS_QUEUE_DEPTH(p,q)       (0x0C200000 + ((p) * 0x40) + ((q) * 0x4))
+
+/* Port Statistics (32-bit counters) */
+#define DEV_STAT_PORT(p)            (0x04000000 + ((p) * 0x100))
+#define DEV_STAT_TX_OCTETS(p)       (DEV_STAT_PORT(p) + 0x00)
+#define DEV_STAT_RX_OCTETS(p)       (DEV_STAT_PORT(p) + 0x04)
+#define DEV_STAT_TX_FRAMES(p)       (DEV_STAT_PORT(p) + 0x08)
+#define DEV_STAT_RX_FRAMES(p)       (DEV_STAT_PORT(p) + 0x0C)
+#define DEV_STAT_DROPS(p)           (DEV_STAT_PORT(p) + 0x10)
+
+/* Queue Statistics (32-bit counters) */
+#define QSYS_QUEUE_STAT(p,q)        (0x0C300000 + ((p) * 0x100) + ((q) * 0x10))
+#define QSYS_QSTAT_TX_FRAMES(p,q)   (QSYS_QUEUE_STAT(p,q) + 0x00)
+#define QSYS_QSTAT_TX_OCTETS(p,q)   (QSYS_QUEUE_STAT(p,q) + 0x04)
+#define QSYS_QSTAT_DROPS(p,q)       (QSYS_QUEUE_STAT(p,q) + 0x08)
+
+/* LAN9662 특성 */
+#define LAN9662_NUM_PORTS           64
+#define LAN9662_NUM_QUEUES          8
+#define LAN9662_PORT_SPEED_1G       1000000000
+#define LAN9662_PORT_SPEED_100M     100000000
+#define LAN9662_PORT_SPEED_10M      10000000
+#define LAN9662_MAX_FRAME_SIZE      9600  /* Jumbo Frame Support */
+
+#endif /* LAN9662_REGS_H */
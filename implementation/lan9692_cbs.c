@@ -4,102 +4,189 @@
  */
 
 #include "lan9692_cbs.h"
+#include "cbs_regio.h"
+#include "cbs_regcache.h"
+#include "cbs_calc.h"
+#include "cbs_trace.h"
+#include "cbs_prof.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/mman.h>
+#include <time.h>
 #include <errno.h>
 
-/* MDIO Interface */
-static int mdio_fd = -1;
-static void *reg_base = NULL;
+/* Register Backend and Shadow Cache */
+static cbs_regio_t *regio = NULL;
+static cbs_regcache_t regcache;
 
-/* Register Access Functions */
+/* Ports with a credit reset asserted and not yet completed */
+static uint32_t reset_pending = 0;
+
+/* VIDs given a TC through this driver; table entries have no valid bit */
+static uint64_t vlan_mapped[LAN9692_NUM_VLANS / 64];
+
+/* Progress messages off (switch_config_t.quiet); errors always print */
+static bool quiet = false;
+#define LAN9692_INFO(...)   do { if (!quiet) printf(__VA_ARGS__); } while (0)
+
+/* Register Access Functions (through the shadow cache) */
 static uint32_t lan9692_read_reg(uint32_t offset) {
-    if (reg_base == NULL) return 0;
-    return *((volatile uint32_t*)((uint8_t*)reg_base + offset));
+    if (regio == NULL) return 0;
+    return cbs_regcache_read(&regcache, offset);
 }
 
 static void lan9692_write_reg(uint32_t offset, uint32_t value) {
-    if (reg_base == NULL) return;
-    *((volatile uint32_t*)((uint8_t*)reg_base + offset)) = value;
+    if (regio == NULL) return;
+    cbs_trace_emit(CBS_TRACE_REG_WRITE,
+                   (offset >= LAN9692_PORT_BASE(0) && offset < LAN9692_PORT_BASE(NUM_PORTS)) ?
+                   (offset - LAN9692_PORT_BASE(0)) / 0x1000 : CBS_TRACE_NO_PORT,
+                   CBS_TRACE_NO_TC, offset, value);
+    cbs_regcache_write(&regcache, offset, value);
 }
 
-/* Initialize memory mapping for register access */
-static int lan9692_init_mdio(void) {
-    mdio_fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if (mdio_fd < 0) {
-        perror("Failed to open /dev/mem");
+/* Uncached read for status and hardware-updated registers */
+static uint32_t lan9692_read_volatile(uint32_t offset) {
+    if (regio == NULL) return 0;
+    return cbs_regio_read(regio, offset);
+}
+
+/* Open the register backend selected by the configuration */
+static int lan9692_init_regio(const char *backend) {
+    if (regio != NULL) {
+        cbs_regcache_destroy(&regcache);
+        cbs_regio_close(regio);
+    }
+    
+    memset(vlan_mapped, 0, sizeof(vlan_mapped));
+    regio = cbs_regio_open_spec(backend, LAN9692_BASE_ADDR, LAN9692_REG_SIZE);
+    if (regio == NULL) {
         return -1;
     }
     
-    reg_base = mmap(NULL, 0x10000, PROT_READ | PROT_WRITE, 
-                    MAP_SHARED, mdio_fd, LAN9692_BASE_ADDR);
-    if (reg_base == MAP_FAILED) {
-        perror("Failed to mmap registers");
-        close(mdio_fd);
+    if (cbs_regcache_init(&regcache, regio, 256) < 0) {
+        cbs_regio_close(regio);
+        regio = NULL;
         return -1;
     }
     
     return 0;
 }
 
-/* Calculate Send Slope from Idle Slope */
-static uint32_t calculate_send_slope(uint32_t idle_slope, uint32_t port_speed) {
-    return port_speed - idle_slope;
+/* Shaper register set programmed for one CBS class (A or B) */
+typedef struct {
+    bool used;
+    uint32_t idle_slope;
+    uint32_t send_slope;
+    uint32_t hi_credit;
+    uint32_t lo_credit;
+} cbs_class_regs_t;
+
+/* Register offsets per class: idle, send, hi, lo */
+static const uint32_t cbs_class_reg[2][4] = {
+    { CBS_IDLE_SLOPE_A_REG, CBS_SEND_SLOPE_A_REG, CBS_HI_CREDIT_A_REG, CBS_LO_CREDIT_A_REG },
+    { CBS_IDLE_SLOPE_B_REG, CBS_SEND_SLOPE_B_REG, CBS_HI_CREDIT_B_REG, CBS_LO_CREDIT_B_REG },
+};
+
+/* Resolve what lan9692_cbs_init programs for a class: the highest enabled TC wins */
+static void lan9692_class_regs(const port_cbs_config_t *port_config, int cls,
+                               cbs_class_regs_t *regs) {
+    int tc_hi = (cls == 0) ? 7 : 5;
+    
+    memset(regs, 0, sizeof(*regs));
+    for (int tc = tc_hi; tc >= tc_hi - 1; tc--) {
+        const cbs_config_t *cfg = &port_config->tc_config[tc];
+        if (cfg->enabled) {
+            regs->used = true;
+            regs->idle_slope = cfg->idle_slope;
+            regs->send_slope = cfg->send_slope;
+            regs->hi_credit = cfg->hi_credit;
+            regs->lo_credit = cfg->lo_credit;
+            return;
+        }
+    }
 }
 
-/* Calculate Hi/Lo Credit limits */
-static void calculate_credit_limits(cbs_config_t *config, uint32_t port_speed) {
-    /* Hi Credit = Maximum frame size * idle_slope / port_speed */
-    uint32_t max_frame_size = 1522; /* Ethernet MTU + headers */
-    config->hi_credit = (max_frame_size * config->idle_slope) / port_speed;
-    
-    /* Lo Credit = -max_frame_size * send_slope / port_speed */
-    config->lo_credit = (max_frame_size * config->send_slope) / port_speed;
+static bool lan9692_port_uses_cbs(const port_cbs_config_t *port_config) {
+    for (int tc = 0; tc < MAX_TRAFFIC_CLASSES; tc++) {
+        if (port_config->tc_config[tc].enabled) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Write one class, reservation first when growing and last when shrinking */
+static int lan9692_apply_class(uint32_t cbs_base, int cls, const cbs_class_regs_t *from,
+                               const cbs_class_regs_t *to, bool grow) {
+    const uint32_t old_val[4] = { from->idle_slope, from->send_slope, from->hi_credit, from->lo_credit };
+    const uint32_t new_val[4] = { to->idle_slope, to->send_slope, to->hi_credit, to->lo_credit };
+    static const int grow_order[4] = { 0, 1, 2, 3 };
+    static const int shrink_order[4] = { 2, 3, 1, 0 };
+    const int *order = grow ? grow_order : shrink_order;
+    int writes = 0;
+    
+    for (int i = 0; i < 4; i++) {
+        int r = order[i];
+        if (old_val[r] != new_val[r]) {
+            lan9692_write_reg(cbs_base + cbs_class_reg[cls][r], new_val[r]);
+            writes++;
+        }
+    }
+    return writes;
+}
+
+/* Enable bits of the classes in use, as lan9692_cbs_apply keeps them on a running port */
+static uint32_t lan9692_class_enables(const cbs_class_regs_t regs[2]) {
+    return (regs[0].used ? CBS_ENABLE_A : 0) | (regs[1].used ? CBS_ENABLE_B : 0);
+}
+
+/* Read-modify-write of a port's shaper control register */
+static int lan9692_update_ctrl(int port, uint32_t clear, uint32_t set) {
+    uint32_t ctrl_reg = LAN9692_CBS_BASE(port) + CBS_CTRL_REG;
+    uint32_t ctrl_val = lan9692_read_reg(ctrl_reg);
+    uint32_t new_val = (ctrl_val & ~clear) | set;
+    
+    if (new_val == ctrl_val) {
+        return 0;
+    }
+    lan9692_write_reg(ctrl_reg, new_val);
+    return 1;
 }
 
 /* Initialize CBS for LAN9692 switch */
 int lan9692_cbs_init(switch_config_t *config) {
+    CBS_PROF_FUNC();
     int ret;
     
-    /* Initialize MDIO interface */
-    ret = lan9692_init_mdio();
+    /* Initialize register backend */
+    quiet = config->quiet;
+    ret = lan9692_init_regio(config->reg_backend);
     if (ret < 0) {
         return ret;
     }
     
+    /* Hold all register writes until the configuration is complete */
+    cbs_regcache_begin(&regcache);
+    
+    /* Reset credits on all ports; the reset runs while the TCs are configured */
+    lan9692_cbs_reset_credits_start(CBS_ALL_PORTS_MASK);
+    
     /* Configure each port */
     for (int port = 0; port < NUM_PORTS; port++) {
         port_cbs_config_t *port_config = &config->ports[port];
         
-        /* Reset CBS for this port */
-        lan9692_cbs_reset_credits(port);
-        
         /* Configure each traffic class */
         for (int tc = 0; tc < MAX_TRAFFIC_CLASSES; tc++) {
             if (port_config->tc_config[tc].enabled) {
                 ret = lan9692_cbs_configure_tc(port, tc, &port_config->tc_config[tc]);
                 if (ret < 0) {
                     printf("Failed to configure CBS for port %d, TC %d\n", port, tc);
+                    lan9692_cbs_reset_credits_wait(CBS_ALL_PORTS_MASK, CBS_RESET_TIMEOUT_US);
+                    cbs_regcache_end(&regcache);
                     return ret;
                 }
             }
         }
-        
-        /* Enable CBS for the port if any TC is configured */
-        bool enable = false;
-        for (int tc = 0; tc < MAX_TRAFFIC_CLASSES; tc++) {
-            if (port_config->tc_config[tc].enabled) {
-                enable = true;
-                break;
-            }
-        }
-        
-        if (enable) {
-            lan9692_cbs_enable_port(port, true);
-        }
     }
     
     /* Configure VLAN if enabled */
@@ -116,12 +203,75 @@ int lan9692_cbs_init(switch_config_t *config) {
     lan9692_set_pcp_tc_mapping(6, TC_VIDEO_STREAM_2);
     lan9692_set_pcp_tc_mapping(0, TC_BEST_EFFORT);
     
-    printf("CBS initialization completed successfully\n");
+    /* Shapers must not be enabled before their credits are reset */
+    ret = lan9692_cbs_reset_credits_wait(CBS_ALL_PORTS_MASK, CBS_RESET_TIMEOUT_US);
+    if (ret < 0) {
+        printf("CBS credit reset did not complete\n");
+        cbs_regcache_end(&regcache);
+        return ret;
+    }
+    
+    /* Enable CBS on every port with a TC configured, only for the classes in use */
+    for (int port = 0; port < NUM_PORTS; port++) {
+        port_cbs_config_t *port_config = &config->ports[port];
+        cbs_class_regs_t regs[2];
+        
+        if (!lan9692_port_uses_cbs(port_config)) {
+            continue;
+        }
+        for (int cls = 0; cls < 2; cls++) {
+            lan9692_class_regs(port_config, cls, &regs[cls]);
+        }
+        lan9692_update_ctrl(port, CBS_ENABLE_A | CBS_ENABLE_B,
+                            lan9692_class_enables(regs) | CBS_MODE_CREDIT_BASED);
+        cbs_trace_emit(CBS_TRACE_SHAPER_ENABLE, port, CBS_TRACE_NO_TC, 0, 0);
+        LAN9692_INFO("Port %d: CBS enabled\n", port);
+    }
+    
+    /* Flush the whole configuration in one ordered pass */
+    cbs_regcache_end(&regcache);
+    
+    LAN9692_INFO("CBS initialization completed successfully\n");
+    return 0;
+}
+
+/* Release the register backend */
+void lan9692_cbs_shutdown(void) {
+    if (regio == NULL) return;
+    
+    cbs_regcache_flush(&regcache);
+    if (regio->lower && !quiet) {
+        cbs_regcache_dump_stats(&regcache, stdout);
+        cbs_regio_dump_stats(regio, stdout);
+    }
+    cbs_regcache_destroy(&regcache);
+    cbs_regio_close(regio);
+    regio = NULL;
+    quiet = false;
+}
+
+/* Sample the per-port CBS status registers */
+int lan9692_cbs_sampler_init(cbs_sampler_t *sampler, uint32_t rate_hz) {
+    int ret;
+    
+    if (regio == NULL) {
+        return -ENODEV;
+    }
+    
+    ret = cbs_sampler_init(sampler, regio, rate_hz);
+    if (ret < 0) {
+        return ret;
+    }
+    
+    for (int port = 0; port < NUM_PORTS; port++) {
+        cbs_sampler_add(sampler, LAN9692_CBS_BASE(port) + CBS_STATUS_REG, port, 0);
+    }
     return 0;
 }
 
 /* Configure CBS for a specific port and traffic class */
 int lan9692_cbs_configure_tc(uint8_t port, uint8_t tc, cbs_config_t *config) {
+    CBS_PROF_FUNC();
     uint32_t cbs_base;
     uint32_t reg_offset;
     
@@ -132,6 +282,8 @@ int lan9692_cbs_configure_tc(uint8_t port, uint8_t tc, cbs_config_t *config) {
     /* Calculate register base for this port */
     cbs_base = LAN9692_CBS_BASE(port);
     
+    cbs_regcache_begin(&regcache);
+    
     /* Select register set based on traffic class */
     /* TC7-TC6 use register set A, TC5-TC4 use register set B */
     if (tc >= 6) {
@@ -163,14 +315,127 @@ int lan9692_cbs_configure_tc(uint8_t port, uint8_t tc, cbs_config_t *config) {
         lan9692_write_reg(cbs_base + reg_offset, config->lo_credit);
     }
     
-    printf("Port %d TC %d: Configured CBS (idle=%u, send=%u)\n", 
+    cbs_regcache_end(&regcache);
+    
+    LAN9692_INFO("Port %d TC %d: Configured CBS (idle=%u, send=%u)\n", 
            port, tc, config->idle_slope, config->send_slope);
     
     return 0;
 }
 
+/* Apply the register delta between two configurations to a running switch */
+int lan9692_cbs_apply(const switch_config_t *old_config, const switch_config_t *new_config) {
+    CBS_PROF_FUNC();
+    cbs_class_regs_t from[NUM_PORTS][2], to[NUM_PORTS][2];
+    uint32_t changing = 0;
+    int writes = 0;
+    
+    if (old_config == NULL || new_config == NULL) {
+        return -EINVAL;
+    }
+    
+    for (int port = 0; port < NUM_PORTS; port++) {
+        for (int cls = 0; cls < 2; cls++) {
+            lan9692_class_regs(&old_config->ports[port], cls, &from[port][cls]);
+            lan9692_class_regs(&new_config->ports[port], cls, &to[port][cls]);
+        }
+        if (memcmp(from[port], to[port], sizeof(from[port])) != 0 ||
+            lan9692_port_uses_cbs(&old_config->ports[port]) !=
+            lan9692_port_uses_cbs(&new_config->ports[port])) {
+            changing |= 1u << port;
+        }
+    }
+    
+    cbs_trace_emit(CBS_TRACE_RECONFIG_BEGIN, CBS_TRACE_NO_PORT, CBS_TRACE_NO_TC, changing, 0);
+    cbs_regcache_begin(&regcache);
+    
+    /*
+     * Pass 0: enables off first, for ports turning off and for classes that
+     * are not in use on a port that stays on, so no live shaper ever runs
+     * on the zero idle slope written below. Unchanged registers are not
+     * written again.
+     */
+    for (int port = 0; port < NUM_PORTS; port++) {
+        bool was_on = lan9692_port_uses_cbs(&old_config->ports[port]);
+        bool is_on = lan9692_port_uses_cbs(&new_config->ports[port]);
+        uint32_t off = 0;
+        
+        if (!(changing & (1u << port))) {
+            continue;
+        }
+        if (was_on && !is_on) {
+            off = CBS_ENABLE_A | CBS_ENABLE_B;
+        } else if (was_on && is_on) {
+            off = (CBS_ENABLE_A | CBS_ENABLE_B) & ~lan9692_class_enables(to[port]);
+        }
+        if (off) {
+            writes += lan9692_update_ctrl(port, off, 0);
+            if (!is_on) {
+                cbs_trace_emit(CBS_TRACE_SHAPER_DISABLE, port, CBS_TRACE_NO_TC, 0, 0);
+                LAN9692_INFO("Port %d: CBS disabled\n", port);
+            }
+        }
+    }
+    
+    /*
+     * Pass 1 raises reservations (idle slope before credit limits), pass 2
+     * lowers them (credit limits before idle slope). Every class therefore
+     * holds at least min(old, new) idle slope at every intermediate step.
+     */
+    for (int pass = 0; pass < 2; pass++) {
+        bool grow = (pass == 0);
+        
+        for (int port = 0; port < NUM_PORTS; port++) {
+            for (int cls = 0; cls < 2; cls++) {
+                const cbs_class_regs_t *a = &from[port][cls];
+                const cbs_class_regs_t *b = &to[port][cls];
+                
+                if ((b->idle_slope >= a->idle_slope) != grow) {
+                    continue;
+                }
+                
+                int n = lan9692_apply_class(LAN9692_CBS_BASE(port), cls, a, b, grow);
+                if (n > 0) {
+                    LAN9692_INFO("Port %d Class %c: idle %u -> %u (%d writes)\n",
+                           port, cls ? 'B' : 'A', a->idle_slope, b->idle_slope, n);
+                }
+                writes += n;
+            }
+        }
+    }
+    
+    /* Pass 3: enables on last, after the parameters they depend on */
+    for (int port = 0; port < NUM_PORTS; port++) {
+        bool was_on = lan9692_port_uses_cbs(&old_config->ports[port]);
+        bool is_on = lan9692_port_uses_cbs(&new_config->ports[port]);
+        uint32_t on = 0;
+        
+        if (!(changing & (1u << port))) {
+            continue;
+        }
+        if (!was_on && is_on) {
+            on = lan9692_class_enables(to[port]) | CBS_MODE_CREDIT_BASED;
+        } else if (was_on && is_on) {
+            on = lan9692_class_enables(to[port]);
+        }
+        if (on) {
+            writes += lan9692_update_ctrl(port, 0, on);
+            if (!was_on) {
+                cbs_trace_emit(CBS_TRACE_SHAPER_ENABLE, port, CBS_TRACE_NO_TC, 0, 0);
+                LAN9692_INFO("Port %d: CBS enabled\n", port);
+            }
+        }
+    }
+    
+    cbs_regcache_end(&regcache);
+    cbs_trace_emit(CBS_TRACE_RECONFIG_END, CBS_TRACE_NO_PORT, CBS_TRACE_NO_TC, 0, writes);
+    
+    return writes;
+}
+
 /* Enable/Disable CBS for a port */
 int lan9692_cbs_enable_port(uint8_t port, bool enable) {
+    CBS_PROF_FUNC();
     uint32_t cbs_base;
     uint32_t ctrl_val;
     
@@ -179,17 +444,27 @@ int lan9692_cbs_enable_port(uint8_t port, bool enable) {
     }
     
     cbs_base = LAN9692_CBS_BASE(port);
+    cbs_regcache_begin(&regcache);
     ctrl_val = lan9692_read_reg(cbs_base + CBS_CTRL_REG);
     
     if (enable) {
-        ctrl_val |= (CBS_ENABLE_A | CBS_ENABLE_B | CBS_MODE_CREDIT_BASED);
+        /* Classes with a reservation programmed, as lan9692_cbs_init enables them */
+        cbs_class_regs_t regs[2];
+        for (int cls = 0; cls < 2; cls++) {
+            regs[cls].used = lan9692_read_reg(cbs_base + cbs_class_reg[cls][0]) != 0;
+        }
+        ctrl_val &= ~(CBS_ENABLE_A | CBS_ENABLE_B);
+        ctrl_val |= lan9692_class_enables(regs) | CBS_MODE_CREDIT_BASED;
     } else {
         ctrl_val &= ~(CBS_ENABLE_A | CBS_ENABLE_B);
     }
     
     lan9692_write_reg(cbs_base + CBS_CTRL_REG, ctrl_val);
+    cbs_regcache_end(&regcache);
+    cbs_trace_emit(enable ? CBS_TRACE_SHAPER_ENABLE : CBS_TRACE_SHAPER_DISABLE,
+                   port, CBS_TRACE_NO_TC, 0, 0);
     
-    printf("Port %d: CBS %s\n", port, enable ? "enabled" : "disabled");
+    LAN9692_INFO("Port %d: CBS %s\n", port, enable ? "enabled" : "disabled");
     return 0;
 }
 
@@ -206,8 +481,44 @@ uint32_t lan9692_cbs_calculate_idle_slope(uint32_t bandwidth_mbps, uint32_t port
     return (uint32_t)bandwidth_bps;
 }
 
+/* Derive the full shaper parameter set for one class A reservation */
+int lan9692_cbs_calculate(uint32_t bandwidth_mbps, uint32_t port_speed,
+                          uint32_t max_frame_size, cbs_config_t *config,
+                          uint64_t *max_delay_ns) {
+    CBS_PROF_FUNC();
+    cbs_calc_class_t cls = {
+        .port_rate = port_speed,
+        .idle_slope = lan9692_cbs_calculate_idle_slope(bandwidth_mbps, port_speed),
+        .max_frame = max_frame_size,
+        .max_interference = max_frame_size,
+    };
+    cbs_calc_result_t result;
+    int ret;
+    
+    if (config == NULL) {
+        return -EINVAL;
+    }
+    
+    ret = cbs_calc(&cls, &result);
+    if (ret < 0) {
+        return ret;
+    }
+    
+    config->idle_slope = (uint32_t)result.idle_slope;
+    config->send_slope = (uint32_t)result.send_slope;
+    config->hi_credit = result.hi_credit;
+    config->lo_credit = result.lo_credit;
+    config->enabled = true;
+    
+    if (max_delay_ns != NULL) {
+        *max_delay_ns = result.max_delay_ns;
+    }
+    return 0;
+}
+
 /* Get CBS status for a port */
 int lan9692_cbs_get_status(uint8_t port, uint32_t *status) {
+    CBS_PROF_FUNC();
     uint32_t cbs_base;
     
     if (port >= NUM_PORTS || status == NULL) {
@@ -215,37 +526,130 @@ int lan9692_cbs_get_status(uint8_t port, uint32_t *status) {
     }
     
     cbs_base = LAN9692_CBS_BASE(port);
-    *status = lan9692_read_reg(cbs_base + CBS_STATUS_REG);
+    *status = lan9692_read_volatile(cbs_base + CBS_STATUS_REG);
     
     return 0;
 }
 
 /* Set VLAN to Traffic Class mapping */
 int lan9692_set_vlan_tc_mapping(uint16_t vlan_id, uint8_t tc) {
-    uint32_t vlan_reg_offset = 0x2000 + (vlan_id * 4);
+    CBS_PROF_FUNC();
+    uint32_t vlan_reg_offset = LAN9692_VLAN_TC_REG(vlan_id);
     uint32_t vlan_config;
     
-    if (vlan_id > 4095 || tc >= MAX_TRAFFIC_CLASSES) {
+    if (vlan_id >= LAN9692_NUM_VLANS || tc >= MAX_TRAFFIC_CLASSES) {
         return -EINVAL;
     }
     
     /* Read current VLAN configuration */
+    cbs_regcache_begin(&regcache);
     vlan_config = lan9692_read_reg(vlan_reg_offset);
     
     /* Update traffic class bits (bits 13-15) */
-    vlan_config &= ~(0x7 << 13);
-    vlan_config |= ((tc & 0x7) << 13);
+    vlan_config &= ~VLAN_TC_MASK;
+    vlan_config |= ((tc & 0x7) << VLAN_TC_SHIFT);
     
     /* Write back configuration */
     lan9692_write_reg(vlan_reg_offset, vlan_config);
+    cbs_regcache_end(&regcache);
+    vlan_mapped[vlan_id / 64] |= 1ULL << (vlan_id % 64);
     
-    printf("VLAN %d mapped to TC %d\n", vlan_id, tc);
+    LAN9692_INFO("VLAN %d mapped to TC %d\n", vlan_id, tc);
     return 0;
 }
 
+/* Write a VLAN table image in ascending VID order, changed entries only */
+static int lan9692_write_vlan_image(const uint32_t *image, const uint64_t *vid_mask) {
+    int changed = 0;
+    
+    cbs_regcache_begin(&regcache);
+    for (uint32_t word = 0; word < LAN9692_NUM_VLANS / 64; word++) {
+        uint64_t bits = vid_mask[word];
+        while (bits) {
+            uint16_t vid = word * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            
+            if (lan9692_read_reg(LAN9692_VLAN_TC_REG(vid)) != image[vid]) {
+                lan9692_write_reg(LAN9692_VLAN_TC_REG(vid), image[vid]);
+                changed++;
+            }
+        }
+    }
+    cbs_regcache_end(&regcache);
+    
+    return changed;
+}
+
+/* Set VLAN to Traffic Class mapping for a whole table */
+int lan9692_set_vlan_tc_table(const uint8_t *tc_map, const uint64_t *vid_mask) {
+    CBS_PROF_FUNC();
+    static uint32_t image[LAN9692_NUM_VLANS];
+    uint64_t all[LAN9692_NUM_VLANS / 64];
+    int changed;
+    
+    if (tc_map == NULL) {
+        return -EINVAL;
+    }
+    if (vid_mask == NULL) {
+        memset(all, 0xFF, sizeof(all));
+        vid_mask = all;
+    }
+    
+    /* Build the new table image from the current (shadowed) entries */
+    for (uint32_t word = 0; word < LAN9692_NUM_VLANS / 64; word++) {
+        uint64_t bits = vid_mask[word];
+        while (bits) {
+            uint16_t vid = word * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            
+            if (tc_map[vid] >= MAX_TRAFFIC_CLASSES) {
+                return -EINVAL;
+            }
+            image[vid] = (lan9692_read_reg(LAN9692_VLAN_TC_REG(vid)) & ~VLAN_TC_MASK) |
+                         ((uint32_t)tc_map[vid] << VLAN_TC_SHIFT);
+        }
+    }
+    
+    changed = lan9692_write_vlan_image(image, vid_mask);
+    for (uint32_t word = 0; word < LAN9692_NUM_VLANS / 64; word++) {
+        vlan_mapped[word] |= vid_mask[word];
+    }
+    LAN9692_INFO("VLAN table: %d entries changed\n", changed);
+    return changed;
+}
+
+/* Set VLAN to Traffic Class mapping for a range of VLANs */
+int lan9692_set_vlan_tc_range(uint16_t first_vid, uint16_t count, uint8_t tc) {
+    CBS_PROF_FUNC();
+    static uint32_t image[LAN9692_NUM_VLANS];
+    uint64_t vid_mask[LAN9692_NUM_VLANS / 64];
+    int changed;
+    
+    if (count == 0 || (uint32_t)first_vid + count > LAN9692_NUM_VLANS ||
+        tc >= MAX_TRAFFIC_CLASSES) {
+        return -EINVAL;
+    }
+    
+    memset(vid_mask, 0, sizeof(vid_mask));
+    for (uint32_t vid = first_vid; vid < (uint32_t)first_vid + count; vid++) {
+        vid_mask[vid / 64] |= 1ULL << (vid % 64);
+        image[vid] = (lan9692_read_reg(LAN9692_VLAN_TC_REG(vid)) & ~VLAN_TC_MASK) |
+                     ((uint32_t)tc << VLAN_TC_SHIFT);
+    }
+    
+    changed = lan9692_write_vlan_image(image, vid_mask);
+    for (uint32_t word = 0; word < LAN9692_NUM_VLANS / 64; word++) {
+        vlan_mapped[word] |= vid_mask[word];
+    }
+    LAN9692_INFO("VLAN %d-%d mapped to TC %d (%d entries changed)\n",
+           first_vid, first_vid + count - 1, tc, changed);
+    return changed;
+}
+
 /* Set PCP to Traffic Class mapping */
 int lan9692_set_pcp_tc_mapping(uint8_t pcp, uint8_t tc) {
-    uint32_t pcp_reg_offset = 0x3000;
+    CBS_PROF_FUNC();
+    uint32_t pcp_reg_offset = LAN9692_PCP_TC_REG;
     uint32_t pcp_config;
     
     if (pcp > 7 || tc >= MAX_TRAFFIC_CLASSES) {
@@ -253,6 +657,7 @@ int lan9692_set_pcp_tc_mapping(uint8_t pcp, uint8_t tc) {
     }
     
     /* Read current PCP mapping configuration */
+    cbs_regcache_begin(&regcache);
     pcp_config = lan9692_read_reg(pcp_reg_offset);
     
     /* Update mapping for this PCP (3 bits per PCP) */
@@ -262,40 +667,152 @@ int lan9692_set_pcp_tc_mapping(uint8_t pcp, uint8_t tc) {
     
     /* Write back configuration */
     lan9692_write_reg(pcp_reg_offset, pcp_config);
+    cbs_regcache_end(&regcache);
     
-    printf("PCP %d mapped to TC %d\n", pcp, tc);
+    LAN9692_INFO("PCP %d mapped to TC %d\n", pcp, tc);
+    return 0;
+}
+
+/* Read back the PCP and VLAN classification tables */
+int lan9692_get_tc_tables(uint8_t *pcp_tc, uint8_t *vlan_tc) {
+    uint32_t pcp_config;
+    
+    if (regio == NULL) {
+        return -ENODEV;
+    }
+    if (pcp_tc == NULL || vlan_tc == NULL) {
+        return -EINVAL;
+    }
+    
+    pcp_config = lan9692_read_reg(LAN9692_PCP_TC_REG);
+    for (int pcp = 0; pcp < 8; pcp++) {
+        pcp_tc[pcp] = (pcp_config >> (pcp * 3)) & 0x7;
+    }
+    for (uint32_t vid = 0; vid < LAN9692_NUM_VLANS; vid++) {
+        vlan_tc[vid] = (vlan_mapped[vid / 64] >> (vid % 64)) & 1
+                       ? (lan9692_read_reg(LAN9692_VLAN_TC_REG(vid)) & VLAN_TC_MASK) >> VLAN_TC_SHIFT
+                       : LAN9692_TC_UNMAPPED;
+    }
     return 0;
 }
 
 /* Reset CBS credits for a port */
 int lan9692_cbs_reset_credits(uint8_t port) {
-    uint32_t cbs_base;
-    uint32_t ctrl_val;
-    
     if (port >= NUM_PORTS) {
         return -EINVAL;
     }
     
-    cbs_base = LAN9692_CBS_BASE(port);
-    ctrl_val = lan9692_read_reg(cbs_base + CBS_CTRL_REG);
+    return lan9692_cbs_reset_credits_mask(1u << port, CBS_RESET_TIMEOUT_US);
+}
+
+/* Reset CBS credits on several ports and wait for completion */
+int lan9692_cbs_reset_credits_mask(uint32_t port_mask, uint32_t timeout_us) {
+    CBS_PROF_FUNC();
+    int ret = lan9692_cbs_reset_credits_start(port_mask);
+    if (ret < 0) {
+        return ret;
+    }
     
-    /* Set credit reset bit */
-    ctrl_val |= CBS_CREDIT_RESET;
-    lan9692_write_reg(cbs_base + CBS_CTRL_REG, ctrl_val);
+    return lan9692_cbs_reset_credits_wait(port_mask, timeout_us);
+}
+
+/* Assert the credit reset bit on all requested ports at once */
+int lan9692_cbs_reset_credits_start(uint32_t port_mask) {
+    CBS_PROF_FUNC();
+    if (port_mask & ~CBS_ALL_PORTS_MASK) {
+        return -EINVAL;
+    }
     
-    /* Wait for reset to complete */
-    usleep(1000);
+    for (int port = 0; port < NUM_PORTS; port++) {
+        if (port_mask & (1u << port)) {
+            uint32_t cbs_base = LAN9692_CBS_BASE(port);
+            uint32_t ctrl_val = lan9692_read_reg(cbs_base + CBS_CTRL_REG);
+            
+            lan9692_write_reg(cbs_base + CBS_CTRL_REG, ctrl_val | CBS_CREDIT_RESET);
+        }
+    }
     
-    /* Clear credit reset bit */
-    ctrl_val &= ~CBS_CREDIT_RESET;
-    lan9692_write_reg(cbs_base + CBS_CTRL_REG, ctrl_val);
+    /* The reset bits must reach the device now, even inside a batch */
+    cbs_regcache_flush(&regcache);
+    for (int port = 0; port < NUM_PORTS; port++) {
+        if (port_mask & (1u << port)) {
+            cbs_trace_emit(CBS_TRACE_CREDIT_RESET, port, CBS_TRACE_NO_TC, 0, 0);
+        }
+    }
+    reset_pending |= port_mask;
+    return 0;
+}
+
+static uint64_t lan9692_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* Poll CBS_STATUS_REG until the resets complete, then deassert them */
+int lan9692_cbs_reset_credits_wait(uint32_t port_mask, uint32_t timeout_us) {
+    CBS_PROF_FUNC();
+    uint32_t waiting = port_mask & reset_pending;
+    uint32_t done = 0;
+    uint64_t start = lan9692_now_us();
+    uint64_t elapsed = 0;
+    
+    if (port_mask & ~CBS_ALL_PORTS_MASK) {
+        return -EINVAL;
+    }
+    
+    for (;;) {
+        for (int port = 0; port < NUM_PORTS; port++) {
+            if ((waiting & (1u << port)) &&
+                !(lan9692_read_volatile(LAN9692_CBS_BASE(port) + CBS_STATUS_REG) &
+                  CBS_STATUS_RESET_BUSY)) {
+                done |= 1u << port;
+            }
+        }
+        waiting &= ~done;
+        
+        elapsed = lan9692_now_us() - start;
+        if (waiting == 0 || elapsed >= timeout_us) {
+            break;
+        }
+        
+        /* Spin briefly, then back off so long resets do not burn a core */
+        if (elapsed > 50) {
+            usleep(10);
+        }
+    }
+    
+    /* Deassert the reset bit on every port we waited for, even on timeout */
+    cbs_regcache_begin(&regcache);
+    for (int port = 0; port < NUM_PORTS; port++) {
+        if ((port_mask & reset_pending) & (1u << port)) {
+            uint32_t cbs_base = LAN9692_CBS_BASE(port);
+            uint32_t ctrl_val = lan9692_read_reg(cbs_base + CBS_CTRL_REG);
+            
+            lan9692_write_reg(cbs_base + CBS_CTRL_REG, ctrl_val & ~CBS_CREDIT_RESET);
+            cbs_trace_emit(CBS_TRACE_CREDIT_RESET_DONE, port, CBS_TRACE_NO_TC,
+                           (waiting >> port) & 1, elapsed);
+        }
+    }
+    cbs_regcache_end(&regcache);
+    reset_pending &= ~port_mask;
     
-    printf("Port %d: CBS credits reset\n", port);
+    if (waiting) {
+        printf("Ports 0x%X: CBS credit reset timed out after %llu us\n",
+               waiting, (unsigned long long)elapsed);
+        return -ETIMEDOUT;
+    }
+    
+    if (done) {
+        LAN9692_INFO("Ports 0x%X: CBS credits reset (%llu us)\n",
+               done, (unsigned long long)elapsed);
+    }
     return 0;
 }
 
 /* Dump CBS configuration for debugging */
 void lan9692_cbs_dump_config(uint8_t port) {
+    CBS_PROF_FUNC();
     uint32_t cbs_base;
     uint32_t ctrl, status;
     uint32_t idle_a, idle_b, send_a, send_b;
@@ -307,17 +824,17 @@ void lan9692_cbs_dump_config(uint8_t port) {
     
     cbs_base = LAN9692_CBS_BASE(port);
     
-    /* Read all CBS registers */
-    ctrl = lan9692_read_reg(cbs_base + CBS_CTRL_REG);
-    status = lan9692_read_reg(cbs_base + CBS_STATUS_REG);
-    idle_a = lan9692_read_reg(cbs_base + CBS_IDLE_SLOPE_A_REG);
-    idle_b = lan9692_read_reg(cbs_base + CBS_IDLE_SLOPE_B_REG);
-    send_a = lan9692_read_reg(cbs_base + CBS_SEND_SLOPE_A_REG);
-    send_b = lan9692_read_reg(cbs_base + CBS_SEND_SLOPE_B_REG);
-    hi_a = lan9692_read_reg(cbs_base + CBS_HI_CREDIT_A_REG);
-    hi_b = lan9692_read_reg(cbs_base + CBS_HI_CREDIT_B_REG);
-    lo_a = lan9692_read_reg(cbs_base + CBS_LO_CREDIT_A_REG);
-    lo_b = lan9692_read_reg(cbs_base + CBS_LO_CREDIT_B_REG);
+    /* Read all CBS registers from the device, bypassing the shadow */
+    ctrl = lan9692_read_volatile(cbs_base + CBS_CTRL_REG);
+    status = lan9692_read_volatile(cbs_base + CBS_STATUS_REG);
+    idle_a = lan9692_read_volatile(cbs_base + CBS_IDLE_SLOPE_A_REG);
+    idle_b = lan9692_read_volatile(cbs_base + CBS_IDLE_SLOPE_B_REG);
+    send_a = lan9692_read_volatile(cbs_base + CBS_SEND_SLOPE_A_REG);
+    send_b = lan9692_read_volatile(cbs_base + CBS_SEND_SLOPE_B_REG);
+    hi_a = lan9692_read_volatile(cbs_base + CBS_HI_CREDIT_A_REG);
+    hi_b = lan9692_read_volatile(cbs_base + CBS_HI_CREDIT_B_REG);
+    lo_a = lan9692_read_volatile(cbs_base + CBS_LO_CREDIT_A_REG);
+    lo_b = lan9692_read_volatile(cbs_base + CBS_LO_CREDIT_B_REG);
     
     printf("\n=== Port %d CBS Configuration ===\n", port);
     printf("Control: 0x%08X (Class A: %s, Class B: %s)\n", 
@@ -8,9 +8,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "cbs_sampler.h"
 
 /* LAN9692 Register Definitions */
 #define LAN9692_BASE_ADDR           0x00000000
+#define LAN9692_REG_SIZE            0x10000
 #define LAN9692_PORT_BASE(p)        (0x1000 + ((p) * 0x1000))
 #define LAN9692_CBS_BASE(p)         (LAN9692_PORT_BASE(p) + 0x0800)
 
@@ -26,12 +28,23 @@
 #define CBS_LO_CREDIT_B_REG         0x20
 #define CBS_STATUS_REG               0x24
 
+/* Classification Tables */
+#define LAN9692_NUM_VLANS           4096
+#define LAN9692_VLAN_TC_REG(vid)    (0x2000 + ((vid) * 4))
+#define LAN9692_PCP_TC_REG          0x3000
+#define VLAN_TC_SHIFT               13
+#define VLAN_TC_MASK                (0x7 << VLAN_TC_SHIFT)
+#define LAN9692_TC_UNMAPPED         0xFF        /* lan9692_get_tc_tables: VID never mapped */
+
 /* CBS Control Bits */
 #define CBS_ENABLE_A                (1 << 0)
 #define CBS_ENABLE_B                (1 << 1)
 #define CBS_CREDIT_RESET            (1 << 8)
 #define CBS_MODE_CREDIT_BASED       (1 << 16)
 
+/* CBS Status Bits */
+#define CBS_STATUS_RESET_BUSY       (1 << 8)    /* credit reset in progress */
+
 /* Traffic Class Definitions */
 #define TC_VIDEO_STREAM_1           7
 #define TC_VIDEO_STREAM_2           6
@@ -42,6 +55,11 @@
 #define NUM_PORTS                   4
 #define PORT_SPEED_1GBPS            1000000000
 #define PORT_SPEED_100MBPS          100000000
+#define CBS_MAX_FRAME_SIZE          1522        /* MTU 1500 + header, VLAN tag, FCS */
+#define CBS_ALL_PORTS_MASK          ((1u << NUM_PORTS) - 1)
+
+/* Upper bound for a credit reset to complete */
+#define CBS_RESET_TIMEOUT_US        1000
 
 /* CBS Parameters Structure */
 typedef struct {
@@ -64,17 +82,27 @@ typedef struct {
     port_cbs_config_t ports[NUM_PORTS];
     bool ptp_enabled;
     bool vlan_enabled;
+    const char *reg_backend;    /* register backend spec, NULL = /dev/mem */
+    bool quiet;                 /* no progress messages from the driver, errors still print */
 } switch_config_t;
 
 /* Function Prototypes */
 
 /**
  * Initialize CBS for LAN9692 switch
+ * Opens the register backend named by config->reg_backend
+ * ("mmap", "sim[:file]" or "trace[+log][@ns]:<backend>")
  * @param config: Pointer to switch configuration
  * @return: 0 on success, negative on error
  */
 int lan9692_cbs_init(switch_config_t *config);
 
+/**
+ * Release the register backend opened by lan9692_cbs_init
+ * Prints access statistics when a tracing backend is in use
+ */
+void lan9692_cbs_shutdown(void);
+
 /**
  * Configure CBS for a specific port and traffic class
  * @param port: Port number (0-3)
@@ -84,6 +112,18 @@ int lan9692_cbs_init(switch_config_t *config);
  */
 int lan9692_cbs_configure_tc(uint8_t port, uint8_t tc, cbs_config_t *config);
 
+/**
+ * Reconfigure a running switch by writing only the registers that differ
+ * between two configurations. Reservations are raised before any are
+ * lowered, idle slope is written first when growing and last when
+ * shrinking, and credits are not reset, so streams are not disturbed.
+ * VLAN/PCP classification tables are left as they are.
+ * @param old_config: Configuration currently programmed
+ * @param new_config: Configuration to switch to
+ * @return: Number of register writes on success, negative on error
+ */
+int lan9692_cbs_apply(const switch_config_t *old_config, const switch_config_t *new_config);
+
 /**
  * Enable/Disable CBS for a port
  * @param port: Port number
@@ -100,6 +140,20 @@ int lan9692_cbs_enable_port(uint8_t port, bool enable);
  */
 uint32_t lan9692_cbs_calculate_idle_slope(uint32_t bandwidth_mbps, uint32_t port_speed);
 
+/**
+ * Calculate idle/send slope and hi/lo credits for a reservation on a port
+ * whose highest shaped class it is, in exact 64-bit arithmetic
+ * @param bandwidth_mbps: Required bandwidth in Mbps
+ * @param port_speed: Port speed in bps
+ * @param max_frame_size: Largest frame on the port in bytes (CBS_MAX_FRAME_SIZE)
+ * @param config: Parameters to fill, enabled is set
+ * @param max_delay_ns: Worst-case queuing delay of the class, may be NULL
+ * @return: 0 on success, negative on error
+ */
+int lan9692_cbs_calculate(uint32_t bandwidth_mbps, uint32_t port_speed,
+                          uint32_t max_frame_size, cbs_config_t *config,
+                          uint64_t *max_delay_ns);
+
 /**
  * Get CBS status for a port
  * @param port: Port number
@@ -116,6 +170,26 @@ int lan9692_cbs_get_status(uint8_t port, uint32_t *status);
  */
 int lan9692_set_vlan_tc_mapping(uint16_t vlan_id, uint8_t tc);
 
+/**
+ * Set VLAN to Traffic Class mapping for a contiguous VLAN range
+ * Builds the range image in memory and writes changed entries in one
+ * ascending burst
+ * @param first_vid: First VLAN ID
+ * @param count: Number of VLANs
+ * @param tc: Traffic class
+ * @return: Number of entries written on success, negative on error
+ */
+int lan9692_set_vlan_tc_range(uint16_t first_vid, uint16_t count, uint8_t tc);
+
+/**
+ * Set VLAN to Traffic Class mapping for many VLANs at once
+ * @param tc_map: Traffic class per VLAN ID (LAN9692_NUM_VLANS entries)
+ * @param vid_mask: Bitmap of VLAN IDs to update (LAN9692_NUM_VLANS / 64
+ *                  words, bit n of word w = VID w*64+n), NULL for all
+ * @return: Number of entries written on success, negative on error
+ */
+int lan9692_set_vlan_tc_table(const uint8_t *tc_map, const uint64_t *vid_mask);
+
 /**
  * Set PCP to Traffic Class mapping
  * @param pcp: Priority Code Point (0-7)
@@ -124,6 +198,15 @@ int lan9692_set_vlan_tc_mapping(uint16_t vlan_id, uint8_t tc);
  */
 int lan9692_set_pcp_tc_mapping(uint8_t pcp, uint8_t tc);
 
+/**
+ * Read back the PCP to TC and VLAN to TC tables as programmed
+ * @param pcp_tc: 8 entries, TC of each PCP
+ * @param vlan_tc: LAN9692_NUM_VLANS entries, TC of each VID, LAN9692_TC_UNMAPPED
+ *                 for VIDs this driver has not mapped since lan9692_cbs_init()
+ * @return: 0 on success, -ENODEV before lan9692_cbs_init()
+ */
+int lan9692_get_tc_tables(uint8_t *pcp_tc, uint8_t *vlan_tc);
+
 /**
  * Reset CBS credits for a port
  * @param port: Port number
@@ -131,6 +214,43 @@ int lan9692_set_pcp_tc_mapping(uint8_t pcp, uint8_t tc);
  */
 int lan9692_cbs_reset_credits(uint8_t port);
 
+/**
+ * Reset CBS credits on several ports at once and wait for completion
+ * @param port_mask: Bit mask of ports (bit n = port n)
+ * @param timeout_us: Maximum time to wait for completion
+ * @return: 0 on success, -ETIMEDOUT if a port stays busy, negative on error
+ */
+int lan9692_cbs_reset_credits_mask(uint32_t port_mask, uint32_t timeout_us);
+
+/**
+ * Start a credit reset without waiting for it
+ * Other registers may be configured while the reset runs; call
+ * lan9692_cbs_reset_credits_wait before enabling the shapers
+ * @param port_mask: Bit mask of ports (bit n = port n)
+ * @return: 0 on success, negative on error
+ */
+int lan9692_cbs_reset_credits_start(uint32_t port_mask);
+
+/**
+ * Wait for credit resets started with lan9692_cbs_reset_credits_start
+ * Polls CBS_STATUS_REG until the reset busy bit clears, then deasserts
+ * the reset bit (also on timeout)
+ * @param port_mask: Bit mask of ports (bit n = port n)
+ * @param timeout_us: Maximum time to wait for completion
+ * @return: 0 on success, -ETIMEDOUT if a port stays busy, negative on error
+ */
+int lan9692_cbs_reset_credits_wait(uint32_t port_mask, uint32_t timeout_us);
+
+/**
+ * Prepare a sampler that reads CBS_STATUS_REG of every port directly from
+ * the register backend (channel n = port n). The caller starts, drains and
+ * destroys it, and must stop it before lan9692_cbs_shutdown.
+ * @param sampler: Sampler to initialize
+ * @param rate_hz: Sweep rate (CBS_SAMPLER_MIN_HZ..CBS_SAMPLER_MAX_HZ)
+ * @return: 0 on success, negative on error
+ */
+int lan9692_cbs_sampler_init(cbs_sampler_t *sampler, uint32_t rate_hz);
+
 /**
  * Dump CBS configuration for debugging
  * @param port: Port number
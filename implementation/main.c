@@ -9,16 +9,39 @@
 #include <signal.h>
 #include <unistd.h>
 #include "lan9692_cbs.h"
+#include "cbs_trace.h"
 
 /* Test configuration */
 #define VIDEO_STREAM_1_BW_MBPS    15  /* 15 Mbps for video stream 1 */
 #define VIDEO_STREAM_2_BW_MBPS    15  /* 15 Mbps for video stream 2 */
 #define CBS_RESERVATION_MBPS      20  /* Reserve 20 Mbps per stream */
 
+/* Status sampling */
+#define SAMPLE_RATE_HZ            1000    /* default, override with argv[2] */
+#define DRAIN_INTERVAL_US         100000  /* ring drained every 100 ms */
+#define REPORT_INTERVAL_DRAINS    50      /* summary every 5 s */
+
 static volatile int running = 1;
 
+/* Configuration currently programmed into the switch */
+static switch_config_t active_config;
+
+/* CBS status seen by the sampler since the last report */
+typedef struct {
+    uint64_t samples;
+    uint64_t changes;           /* value differs from the previous sample */
+    uint64_t reset_busy;        /* samples with a credit reset in progress */
+    uint32_t last;
+    bool seen;
+} status_summary_t;
+
+static cbs_sampler_t sampler;
+static status_summary_t summary[NUM_PORTS];
+static FILE *sample_log;        /* CSV of every sample, CBS_SAMPLE_LOG */
+
 /* Signal handler for clean shutdown */
 void signal_handler(int sig) {
+    (void)sig;
     printf("\nShutting down CBS test...\n");
     running = 0;
 }
@@ -26,6 +49,7 @@ void signal_handler(int sig) {
 /* Configure CBS for video streaming scenario */
 int configure_video_streaming_cbs(void) {
     switch_config_t config;
+    uint64_t max_delay_ns[2];
     int ret;
     
     memset(&config, 0, sizeof(config));
@@ -34,6 +58,9 @@ int configure_video_streaming_cbs(void) {
     config.vlan_enabled = true;
     config.ptp_enabled = true;
     
+    /* Register backend: /dev/mem unless overridden (e.g. LAN9692_REGIO=sim) */
+    config.reg_backend = getenv("LAN9692_REGIO");
+    
     /* Configure Port 0 (Source) - No CBS needed */
     config.ports[0].port_id = 0;
     config.ports[0].port_speed = PORT_SPEED_1GBPS;
@@ -43,34 +70,16 @@ int configure_video_streaming_cbs(void) {
     config.ports[1].port_speed = PORT_SPEED_1GBPS;
     
     /* TC7 - Video Stream 1 */
-    config.ports[1].tc_config[TC_VIDEO_STREAM_1].enabled = true;
-    config.ports[1].tc_config[TC_VIDEO_STREAM_1].idle_slope = 
-        lan9692_cbs_calculate_idle_slope(CBS_RESERVATION_MBPS, PORT_SPEED_1GBPS);
-    config.ports[1].tc_config[TC_VIDEO_STREAM_1].send_slope = 
-        PORT_SPEED_1GBPS - config.ports[1].tc_config[TC_VIDEO_STREAM_1].idle_slope;
-    
-    /* Calculate credit limits */
-    config.ports[1].tc_config[TC_VIDEO_STREAM_1].hi_credit = 
-        (1522 * config.ports[1].tc_config[TC_VIDEO_STREAM_1].idle_slope) / PORT_SPEED_1GBPS;
-    config.ports[1].tc_config[TC_VIDEO_STREAM_1].lo_credit = 
-        (1522 * config.ports[1].tc_config[TC_VIDEO_STREAM_1].send_slope) / PORT_SPEED_1GBPS;
+    lan9692_cbs_calculate(CBS_RESERVATION_MBPS, PORT_SPEED_1GBPS, CBS_MAX_FRAME_SIZE,
+                          &config.ports[1].tc_config[TC_VIDEO_STREAM_1], &max_delay_ns[0]);
     
     /* Configure Port 2 (Sink 2) - CBS for egress traffic */
     config.ports[2].port_id = 2;
     config.ports[2].port_speed = PORT_SPEED_1GBPS;
     
     /* TC6 - Video Stream 2 */
-    config.ports[2].tc_config[TC_VIDEO_STREAM_2].enabled = true;
-    config.ports[2].tc_config[TC_VIDEO_STREAM_2].idle_slope = 
-        lan9692_cbs_calculate_idle_slope(CBS_RESERVATION_MBPS, PORT_SPEED_1GBPS);
-    config.ports[2].tc_config[TC_VIDEO_STREAM_2].send_slope = 
-        PORT_SPEED_1GBPS - config.ports[2].tc_config[TC_VIDEO_STREAM_2].idle_slope;
-    
-    /* Calculate credit limits */
-    config.ports[2].tc_config[TC_VIDEO_STREAM_2].hi_credit = 
-        (1522 * config.ports[2].tc_config[TC_VIDEO_STREAM_2].idle_slope) / PORT_SPEED_1GBPS;
-    config.ports[2].tc_config[TC_VIDEO_STREAM_2].lo_credit = 
-        (1522 * config.ports[2].tc_config[TC_VIDEO_STREAM_2].send_slope) / PORT_SPEED_1GBPS;
+    lan9692_cbs_calculate(CBS_RESERVATION_MBPS, PORT_SPEED_1GBPS, CBS_MAX_FRAME_SIZE,
+                          &config.ports[2].tc_config[TC_VIDEO_STREAM_2], &max_delay_ns[1]);
     
     /* Configure Port 3 (BE Traffic Generator) - No CBS */
     config.ports[3].port_id = 3;
@@ -82,30 +91,67 @@ int configure_video_streaming_cbs(void) {
         fprintf(stderr, "Failed to initialize CBS: %d\n", ret);
         return ret;
     }
+    active_config = config;
     
     printf("CBS configuration completed successfully\n");
-    printf("Video Stream 1: Reserved %d Mbps on TC%d\n", 
-           CBS_RESERVATION_MBPS, TC_VIDEO_STREAM_1);
-    printf("Video Stream 2: Reserved %d Mbps on TC%d\n", 
-           CBS_RESERVATION_MBPS, TC_VIDEO_STREAM_2);
+    printf("Video Stream 1: Reserved %d Mbps on TC%d, worst-case delay %.1f us\n", 
+           CBS_RESERVATION_MBPS, TC_VIDEO_STREAM_1, max_delay_ns[0] / 1000.0);
+    printf("Video Stream 2: Reserved %d Mbps on TC%d, worst-case delay %.1f us\n", 
+           CBS_RESERVATION_MBPS, TC_VIDEO_STREAM_2, max_delay_ns[1] / 1000.0);
     
     return 0;
 }
 
-/* Monitor CBS status */
+/* Drain the sampler ring into the per-port summaries (and the CSV log) */
+void collect_cbs_samples(void) {
+    static cbs_sample_t batch[4096];
+    size_t n;
+    
+    while ((n = cbs_sampler_drain(&sampler, batch, sizeof(batch)/sizeof(batch[0]))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            status_summary_t *sum = &summary[sampler.channels[batch[i].channel].port];
+            
+            /* Status changes only - the counter track holds its value in between */
+            if (!sum->seen || batch[i].value != sum->last) {
+                cbs_trace_emit_at(batch[i].t_ns, CBS_TRACE_STATUS,
+                                  sampler.channels[batch[i].channel].port, CBS_TRACE_NO_TC,
+                                  batch[i].value, 0);
+            }
+            sum->changes += sum->seen && batch[i].value != sum->last;
+            sum->reset_busy += (batch[i].value & CBS_STATUS_RESET_BUSY) != 0;
+            sum->last = batch[i].value;
+            sum->seen = true;
+            sum->samples++;
+            
+            if (sample_log) {
+                fprintf(sample_log, "%llu,%u,0x%08X\n",
+                        (unsigned long long)batch[i].t_ns,
+                        sampler.channels[batch[i].channel].port, batch[i].value);
+            }
+        }
+    }
+}
+
+/* Monitor CBS status - summary of the samples since the last report */
 void monitor_cbs_status(void) {
-    uint32_t status;
-    int ret;
+    cbs_sampler_stats_t stats;
     
-    printf("\n=== CBS Status Monitor ===\n");
+    collect_cbs_samples();
+    cbs_sampler_get_stats(&sampler, &stats);
     
+    printf("\n=== CBS Status Monitor (%u Hz) ===\n", sampler.rate_hz);
     for (int port = 0; port < NUM_PORTS; port++) {
-        ret = lan9692_cbs_get_status(port, &status);
-        if (ret == 0) {
-            printf("Port %d Status: 0x%08X\n", port, status);
-            lan9692_cbs_dump_config(port);
-        }
+        status_summary_t *sum = &summary[port];
+        
+        printf("Port %d Status: 0x%08X, %llu samples, %llu changes, reset busy %.1f%%\n",
+               port, sum->last, (unsigned long long)sum->samples,
+               (unsigned long long)sum->changes,
+               sum->samples ? 100.0 * sum->reset_busy / sum->samples : 0.0);
+        sum->samples = sum->changes = sum->reset_busy = 0;
     }
+    printf("Sampler: %llu sweeps, %llu dropped, %llu overruns, max lateness %.1f us\n",
+           (unsigned long long)stats.sweeps, (unsigned long long)stats.dropped,
+           (unsigned long long)stats.overruns, stats.max_lateness_ns / 1000.0);
 }
 
 /* Test CBS with different scenarios */
@@ -113,13 +159,22 @@ void run_cbs_test_scenario(int scenario) {
     printf("\n=== Running Test Scenario %d ===\n", scenario);
     
     switch(scenario) {
-        case 1:
+        case 1: {
             printf("Scenario 1: CBS Disabled - All traffic treated equally\n");
-            /* Disable CBS on all ports */
+            /* Disable CBS on all ports, through the delta so active_config stays in step */
+            switch_config_t new_config = active_config;
             for (int port = 0; port < NUM_PORTS; port++) {
-                lan9692_cbs_enable_port(port, false);
+                for (int tc = 0; tc < MAX_TRAFFIC_CLASSES; tc++) {
+                    new_config.ports[port].tc_config[tc].enabled = false;
+                }
+            }
+            
+            int writes = lan9692_cbs_apply(&active_config, &new_config);
+            if (writes >= 0) {
+                active_config = new_config;
             }
             break;
+        }
             
         case 2:
             printf("Scenario 2: CBS Enabled - Video streams prioritized\n");
@@ -128,19 +183,31 @@ void run_cbs_test_scenario(int scenario) {
             lan9692_cbs_enable_port(2, true);
             break;
             
-        case 3:
+        case 3: {
             printf("Scenario 3: Increased bandwidth reservation\n");
-            /* Reconfigure with higher bandwidth */
+            /* Reconfigure with higher bandwidth, hitless: only changed registers */
+            switch_config_t new_config = active_config;
             cbs_config_t high_bw_config;
-            high_bw_config.enabled = true;
-            high_bw_config.idle_slope = lan9692_cbs_calculate_idle_slope(30, PORT_SPEED_1GBPS);
-            high_bw_config.send_slope = PORT_SPEED_1GBPS - high_bw_config.idle_slope;
-            high_bw_config.hi_credit = (1522 * high_bw_config.idle_slope) / PORT_SPEED_1GBPS;
-            high_bw_config.lo_credit = (1522 * high_bw_config.send_slope) / PORT_SPEED_1GBPS;
+            uint64_t max_delay_ns;
+            int ret;
+            ret = lan9692_cbs_calculate(30, PORT_SPEED_1GBPS, CBS_MAX_FRAME_SIZE,
+                                        &high_bw_config, &max_delay_ns);
+            if (ret < 0) {
+                printf("Failed to calculate CBS parameters: %d\n", ret);
+                break;
+            }
+            printf("Worst-case queuing delay: %.1f us\n", max_delay_ns / 1000.0);
+            
+            new_config.ports[1].tc_config[TC_VIDEO_STREAM_1] = high_bw_config;
+            new_config.ports[2].tc_config[TC_VIDEO_STREAM_2] = high_bw_config;
             
-            lan9692_cbs_configure_tc(1, TC_VIDEO_STREAM_1, &high_bw_config);
-            lan9692_cbs_configure_tc(2, TC_VIDEO_STREAM_2, &high_bw_config);
+            int writes = lan9692_cbs_apply(&active_config, &new_config);
+            if (writes >= 0) {
+                printf("Reservation updated with %d register writes\n", writes);
+                active_config = new_config;
+            }
             break;
+        }
             
         default:
             printf("Unknown scenario\n");
@@ -150,6 +217,7 @@ void run_cbs_test_scenario(int scenario) {
     /* Monitor for 10 seconds */
     for (int i = 0; i < 10 && running; i++) {
         sleep(1);
+        collect_cbs_samples();
         printf(".");
         fflush(stdout);
     }
@@ -159,11 +227,15 @@ void run_cbs_test_scenario(int scenario) {
 int main(int argc, char *argv[]) {
     int ret;
     int scenario = 2;  /* Default to CBS enabled */
+    uint32_t sample_rate = SAMPLE_RATE_HZ;
     
-    /* Parse command line arguments */
+    /* Parse command line arguments: [scenario] [sample rate Hz] */
     if (argc > 1) {
         scenario = atoi(argv[1]);
     }
+    if (argc > 2) {
+        sample_rate = (uint32_t)atoi(argv[2]);
+    }
     
     /* Setup signal handler */
     signal(SIGINT, signal_handler);
@@ -172,6 +244,11 @@ int main(int argc, char *argv[]) {
     printf("LAN9692 CBS Test Application\n");
     printf("============================\n\n");
     
+    /* CBS_TRACE=file records driver events and status changes for cbs_trace_export */
+    if (getenv("CBS_TRACE") && cbs_trace_start(0) < 0) {
+        fprintf(stderr, "Failed to allocate trace buffer\n");
+    }
+    
     /* Configure CBS for video streaming */
     ret = configure_video_streaming_cbs();
     if (ret < 0) {
@@ -179,13 +256,54 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
     
+    /* Sample CBS status in the background, CBS_SAMPLE_LOG=file.csv keeps every sample */
+    ret = lan9692_cbs_sampler_init(&sampler, sample_rate);
+    if (ret == 0 && getenv("CBS_SAMPLE_LOG")) {
+        sample_log = fopen(getenv("CBS_SAMPLE_LOG"), "w");
+        if (sample_log) {
+            fprintf(sample_log, "t_ns,port,status\n");
+        }
+    }
+    if (ret == 0) {
+        ret = cbs_sampler_start(&sampler);
+    }
+    if (ret < 0) {
+        fprintf(stderr, "Failed to start CBS sampler at %u Hz: %d\n", sample_rate, ret);
+        lan9692_cbs_shutdown();
+        return EXIT_FAILURE;
+    }
+    
     /* Run test scenario */
     run_cbs_test_scenario(scenario);
+    for (int port = 0; port < NUM_PORTS; port++) {
+        lan9692_cbs_dump_config(port);
+    }
     
     /* Monitor CBS status */
-    while (running) {
-        monitor_cbs_status();
-        sleep(5);
+    for (int drains = 1; running; drains++) {
+        usleep(DRAIN_INTERVAL_US);
+        collect_cbs_samples();
+        if (drains % REPORT_INTERVAL_DRAINS == 0) {
+            monitor_cbs_status();
+        }
+    }
+    
+    cbs_sampler_stop(&sampler);
+    monitor_cbs_status();
+    cbs_sampler_destroy(&sampler);
+    if (sample_log) {
+        fclose(sample_log);
+    }
+    lan9692_cbs_shutdown();
+    
+    if (cbs_trace.events != NULL) {
+        int64_t saved = cbs_trace_save(getenv("CBS_TRACE"), "lan9692_cbs_test");
+        if (saved < 0) {
+            fprintf(stderr, "Failed to save trace %s: %d\n", getenv("CBS_TRACE"), (int)saved);
+        } else {
+            printf("Trace: %lld events in %s\n", (long long)saved, getenv("CBS_TRACE"));
+        }
+        cbs_trace_stop();
     }
     
     printf("\nTest completed\n");
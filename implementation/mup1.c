@@ -0,0 +1,627 @@
+/**
+ * MUP1 (Microchip UART Protocol #1) client for VelocityDriveSP boards
+ * Frame codec, minimal CoAP codec and the persistent session
+ */
+
+#include "mup1.h"
+#include "cbs_prof.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <termios.h>
+#include <errno.h>
+
+/* Decoder States */
+enum {
+    DEC_WAIT_SOF,
+    DEC_TYPE,
+    DEC_DATA,
+    DEC_ESCAPED,
+    DEC_EOF2,
+    DEC_CHECKSUM,
+};
+
+/* CoAP Option Numbers */
+#define COAP_OPT_URI_PATH           11
+#define COAP_OPT_CONTENT_FORMAT     12
+#define COAP_OPT_ACCEPT             17
+
+#define COAP_TYPE_CON               0
+#define COAP_TYPE_ACK               2
+#define COAP_TOKEN_LEN              2
+
+/* Session */
+struct mup1_session {
+    int fd;
+    bool is_tty;
+    struct termios saved_tio;
+    uint16_t next_message_id;
+    uint16_t next_token;
+    bool ping_seen;
+    mup1_decoder_t dec;
+    struct {
+        bool used;
+        bool done;
+        uint16_t token;
+        mup1_response_t response;
+    } slots[MUP1_MAX_INFLIGHT];
+    mup1_stats_t stats;
+    uint8_t coap_buf[MUP1_MAX_FRAME];
+    uint8_t tx_buf[MUP1_MAX_FRAME * 2 + 8];
+};
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+/* Ones' complement sum over big-endian 16-bit words */
+static void mup1_sum_byte(uint32_t *sum, bool *odd, uint16_t *hi, uint8_t byte) {
+    if (*odd) {
+        *sum += (uint32_t)(*hi << 8) | byte;
+        *sum = (*sum & 0xFFFF) + (*sum >> 16);
+    } else {
+        *hi = byte;
+    }
+    *odd = !*odd;
+}
+
+int mup1_encode_frame(uint8_t type, const uint8_t *data, size_t len,
+                      uint8_t *out, size_t out_size) {
+    uint32_t sum = 0;
+    uint16_t hi = 0;
+    bool odd = false;
+    size_t n = 0;
+
+/* Worst case per byte is 2 (escape), plus EOF padding and checksum */
+#define PUT(b) do { if (n >= out_size) return -ENOSPC; \
+                    out[n++] = (b); mup1_sum_byte(&sum, &odd, &hi, (b)); } while (0)
+
+    PUT(MUP1_SOF);
+    PUT(type);
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+        switch (c) {
+        case 0x00: PUT(MUP1_ESC); PUT('0'); break;
+        case 0xFF: PUT(MUP1_ESC); PUT('F'); break;
+        case MUP1_SOF:
+        case MUP1_EOF:
+        case MUP1_ESC: PUT(MUP1_ESC); PUT(c); break;
+        default: PUT(c); break;
+        }
+    }
+    PUT(MUP1_EOF);
+    if (odd) {
+        /* A second EOF keeps the checksummed length even */
+        PUT(MUP1_EOF);
+    }
+#undef PUT
+
+    if (n + 4 > out_size) {
+        return -ENOSPC;
+    }
+    uint16_t check = (uint16_t)~sum;
+    for (int shift = 12; shift >= 0; shift -= 4) {
+        out[n++] = hex_digits[(check >> shift) & 0xF];
+    }
+    return (int)n;
+}
+
+void mup1_decoder_reset(mup1_decoder_t *dec) {
+    dec->state = DEC_WAIT_SOF;
+    dec->sum = 0;
+    dec->sum_hi = 0;
+    dec->odd = false;
+    dec->len = 0;
+    dec->check_digits = 0;
+    dec->rx_check = 0;
+}
+
+static int hex_value(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static int mup1_decoder_store(mup1_decoder_t *dec, uint8_t c) {
+    if (dec->len >= sizeof(dec->data)) {
+        mup1_decoder_reset(dec);
+        return -EMSGSIZE;
+    }
+    dec->data[dec->len++] = c;
+    return 0;
+}
+
+int mup1_decoder_feed(mup1_decoder_t *dec, uint8_t c) {
+    if (c == MUP1_SOF && dec->state != DEC_ESCAPED && dec->state != DEC_CHECKSUM) {
+        /* Start of frame always resynchronizes */
+        mup1_decoder_reset(dec);
+        dec->state = DEC_TYPE;
+        mup1_sum_byte(&dec->sum, &dec->odd, &dec->sum_hi, c);
+        return 0;
+    }
+
+    switch (dec->state) {
+    case DEC_WAIT_SOF:
+        return 0;
+
+    case DEC_TYPE:
+        dec->type = c;
+        dec->state = DEC_DATA;
+        mup1_sum_byte(&dec->sum, &dec->odd, &dec->sum_hi, c);
+        return 0;
+
+    case DEC_DATA:
+        mup1_sum_byte(&dec->sum, &dec->odd, &dec->sum_hi, c);
+        if (c == MUP1_ESC) {
+            dec->state = DEC_ESCAPED;
+        } else if (c == MUP1_EOF) {
+            dec->state = dec->odd ? DEC_EOF2 : DEC_CHECKSUM;
+        } else {
+            return mup1_decoder_store(dec, c);
+        }
+        return 0;
+
+    case DEC_ESCAPED:
+        mup1_sum_byte(&dec->sum, &dec->odd, &dec->sum_hi, c);
+        dec->state = DEC_DATA;
+        return mup1_decoder_store(dec, c == '0' ? 0x00 : c == 'F' ? 0xFF : c);
+
+    case DEC_EOF2:
+        if (c != MUP1_EOF) {
+            mup1_decoder_reset(dec);
+            return -EPROTO;
+        }
+        mup1_sum_byte(&dec->sum, &dec->odd, &dec->sum_hi, c);
+        dec->state = DEC_CHECKSUM;
+        return 0;
+
+    case DEC_CHECKSUM: {
+        int v = hex_value(c);
+        if (v < 0) {
+            mup1_decoder_reset(dec);
+            return -EPROTO;
+        }
+        dec->rx_check = (dec->rx_check << 4) | v;
+        if (++dec->check_digits < 4) {
+            return 0;
+        }
+        dec->state = DEC_WAIT_SOF;
+        if ((uint16_t)~dec->sum != dec->rx_check) {
+            return -EBADMSG;
+        }
+        return 1;
+    }
+    }
+
+    return 0;
+}
+
+/* Append one CoAP option header and value */
+static int coap_put_option(uint8_t *out, size_t out_size, size_t *n, uint16_t *last,
+                           uint16_t number, const uint8_t *value, size_t len) {
+    uint16_t delta = number - *last;
+    uint8_t ext[4];
+    size_t ext_len = 0;
+    uint8_t d_nib, l_nib;
+
+#define NIBBLE(v, nib) do { \
+        if ((v) < 13) { nib = (v); } \
+        else if ((v) < 269) { nib = 13; ext[ext_len++] = (v) - 13; } \
+        else { nib = 14; ext[ext_len++] = ((v) - 269) >> 8; ext[ext_len++] = ((v) - 269) & 0xFF; } \
+    } while (0)
+    NIBBLE(delta, d_nib);
+    NIBBLE(len, l_nib);
+#undef NIBBLE
+
+    if (*n + 1 + ext_len + len > out_size) {
+        return -ENOSPC;
+    }
+    out[(*n)++] = (d_nib << 4) | l_nib;
+    memcpy(out + *n, ext, ext_len);
+    *n += ext_len;
+    memcpy(out + *n, value, len);
+    *n += len;
+    *last = number;
+    return 0;
+}
+
+static int coap_put_uint_option(uint8_t *out, size_t out_size, size_t *n, uint16_t *last,
+                                uint16_t number, uint16_t value) {
+    uint8_t v[2] = { value >> 8, value & 0xFF };
+
+    if (value == 0) return coap_put_option(out, out_size, n, last, number, v, 0);
+    if (value < 256) return coap_put_option(out, out_size, n, last, number, v + 1, 1);
+    return coap_put_option(out, out_size, n, last, number, v, 2);
+}
+
+int coap_encode(uint8_t *out, size_t out_size, uint8_t type, uint8_t code,
+                uint16_t message_id, uint16_t token, const char *uri_path,
+                uint16_t content_format, uint16_t accept,
+                const void *payload, size_t len) {
+    size_t n = 0;
+    uint16_t last = 0;
+
+    if (out_size < 4 + COAP_TOKEN_LEN) {
+        return -ENOSPC;
+    }
+    out[n++] = 0x40 | (type << 4) | COAP_TOKEN_LEN;   /* version 1 */
+    out[n++] = code;
+    out[n++] = message_id >> 8;
+    out[n++] = message_id & 0xFF;
+    out[n++] = token >> 8;
+    out[n++] = token & 0xFF;
+
+    /* Options in ascending number order */
+    for (const char *seg = uri_path; seg && *seg; ) {
+        const char *end = strchr(seg, '/');
+        size_t seg_len = end ? (size_t)(end - seg) : strlen(seg);
+        if (coap_put_option(out, out_size, &n, &last, COAP_OPT_URI_PATH,
+                            (const uint8_t *)seg, seg_len) < 0) {
+            return -ENOSPC;
+        }
+        seg = end ? end + 1 : NULL;
+    }
+    if (content_format != COAP_CF_NONE &&
+        coap_put_uint_option(out, out_size, &n, &last, COAP_OPT_CONTENT_FORMAT, content_format) < 0) {
+        return -ENOSPC;
+    }
+    if (accept != COAP_CF_NONE &&
+        coap_put_uint_option(out, out_size, &n, &last, COAP_OPT_ACCEPT, accept) < 0) {
+        return -ENOSPC;
+    }
+
+    if (len > 0) {
+        if (n + 1 + len > out_size) {
+            return -ENOSPC;
+        }
+        out[n++] = 0xFF;
+        memcpy(out + n, payload, len);
+        n += len;
+    }
+    return (int)n;
+}
+
+int coap_decode(const uint8_t *buf, size_t len, coap_msg_t *msg) {
+    size_t n = 4;
+    uint16_t number = 0;
+
+    if (len < 4 || (buf[0] >> 6) != 1) {
+        return -EPROTO;
+    }
+
+    uint8_t tkl = buf[0] & 0x0F;
+    if (tkl > 8 || n + tkl > len) {
+        return -EPROTO;
+    }
+
+    memset(msg, 0, sizeof(*msg));
+    msg->type = (buf[0] >> 4) & 0x3;
+    msg->code = buf[1];
+    msg->message_id = (buf[2] << 8) | buf[3];
+    msg->content_format = COAP_CF_NONE;
+    for (uint8_t i = 0; i < tkl; i++) {
+        msg->token = (msg->token << 8) | buf[n++];
+    }
+
+    while (n < len && buf[n] != 0xFF) {
+        uint32_t delta = buf[n] >> 4, opt_len = buf[n] & 0x0F;
+        n++;
+
+        if (delta == 13) { if (n >= len) return -EPROTO; delta = 13 + buf[n++]; }
+        else if (delta == 14) { if (n + 1 >= len) return -EPROTO; delta = 269 + ((buf[n] << 8) | buf[n + 1]); n += 2; }
+        else if (delta == 15) return -EPROTO;
+        if (opt_len == 13) { if (n >= len) return -EPROTO; opt_len = 13 + buf[n++]; }
+        else if (opt_len == 14) { if (n + 1 >= len) return -EPROTO; opt_len = 269 + ((buf[n] << 8) | buf[n + 1]); n += 2; }
+        else if (opt_len == 15) return -EPROTO;
+        if (n + opt_len > len) {
+            return -EPROTO;
+        }
+
+        number += delta;
+        if (number == COAP_OPT_CONTENT_FORMAT) {
+            msg->content_format = 0;
+            for (uint32_t i = 0; i < opt_len; i++) {
+                msg->content_format = (msg->content_format << 8) | buf[n + i];
+            }
+        }
+        n += opt_len;
+    }
+
+    if (n < len) {
+        /* Payload marker */
+        msg->payload = buf + n + 1;
+        msg->payload_len = len - n - 1;
+    }
+    return 0;
+}
+
+/* Session I/O */
+static int64_t mup1_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int mup1_write_all(mup1_session_t *s, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(s->fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) {
+                struct pollfd pfd = { .fd = s->fd, .events = POLLOUT };
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            return -errno;
+        }
+        buf += n;
+        len -= n;
+        s->stats.tx_bytes += n;
+    }
+    return 0;
+}
+
+static int mup1_send_frame(mup1_session_t *s, uint8_t type, const uint8_t *data, size_t len) {
+    int n = mup1_encode_frame(type, data, len, s->tx_buf, sizeof(s->tx_buf));
+    if (n < 0) {
+        return n;
+    }
+    return mup1_write_all(s, s->tx_buf, n);
+}
+
+/* Route one decoded frame to the request waiting for it */
+static void mup1_dispatch(mup1_session_t *s) {
+    mup1_decoder_t *dec = &s->dec;
+    coap_msg_t msg;
+
+    switch (dec->type) {
+    case MUP1_TYPE_PING:
+        s->ping_seen = true;
+        return;
+
+    case MUP1_TYPE_TRACE:
+        fprintf(stderr, "[mup1 trace] %.*s\n", (int)dec->len, (const char *)dec->data);
+        return;
+
+    case MUP1_TYPE_COAP:
+        break;
+
+    default:
+        return;
+    }
+
+    if (coap_decode(dec->data, dec->len, &msg) < 0) {
+        s->stats.bad_frames++;
+        return;
+    }
+
+    for (int i = 0; i < MUP1_MAX_INFLIGHT; i++) {
+        if (s->slots[i].used && !s->slots[i].done && s->slots[i].token == msg.token) {
+            mup1_response_t *r = &s->slots[i].response;
+
+            r->code = msg.code;
+            r->content_format = msg.content_format;
+            r->payload_len = msg.payload_len;
+            r->payload = malloc(msg.payload_len + 1);
+            if (r->payload) {
+                memcpy(r->payload, msg.payload, msg.payload_len);
+                r->payload[msg.payload_len] = '\0';
+            } else {
+                r->payload_len = 0;
+            }
+            s->slots[i].done = true;
+            s->stats.responses++;
+            return;
+        }
+    }
+}
+
+/* Read whatever is available (up to timeout) and dispatch complete frames */
+static int mup1_pump(mup1_session_t *s, int timeout_ms) {
+    struct pollfd pfd = { .fd = s->fd, .events = POLLIN };
+    uint8_t buf[4096];
+    int ret = poll(&pfd, 1, timeout_ms);
+
+    if (ret < 0) {
+        return errno == EINTR ? 0 : -errno;
+    }
+    if (ret == 0) {
+        return 0;
+    }
+    if (pfd.revents & (POLLERR | POLLHUP)) {
+        return -EIO;
+    }
+
+    ssize_t n = read(s->fd, buf, sizeof(buf));
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -errno;
+    }
+    s->stats.rx_bytes += n;
+
+    for (ssize_t i = 0; i < n; i++) {
+        int r = mup1_decoder_feed(&s->dec, buf[i]);
+        if (r == 1) {
+            mup1_dispatch(s);
+        } else if (r < 0) {
+            s->stats.bad_frames++;
+        }
+    }
+    return 0;
+}
+
+mup1_session_t *mup1_open(const char *device) {
+    mup1_session_t *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+
+    s->fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (s->fd < 0) {
+        perror("Failed to open MUP1 device");
+        free(s);
+        return NULL;
+    }
+
+    /* Raw 115200 8N1, configured once for the whole session */
+    if (tcgetattr(s->fd, &s->saved_tio) == 0) {
+        struct termios tio = s->saved_tio;
+        s->is_tty = true;
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tcsetattr(s->fd, TCSANOW, &tio);
+        tcflush(s->fd, TCIOFLUSH);
+    }
+
+    mup1_decoder_reset(&s->dec);
+    s->next_message_id = (uint16_t)getpid();
+    s->next_token = 1;
+
+    if (mup1_ping(s, 1000) < 0) {
+        fprintf(stderr, "No MUP1 ping reply from %s\n", device);
+        mup1_close(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+void mup1_close(mup1_session_t *s) {
+    if (s == NULL) return;
+
+    for (int i = 0; i < MUP1_MAX_INFLIGHT; i++) {
+        if (s->slots[i].done) {
+            mup1_response_free(&s->slots[i].response);
+        }
+    }
+    if (s->is_tty) {
+        tcsetattr(s->fd, TCSANOW, &s->saved_tio);
+    }
+    close(s->fd);
+    free(s);
+}
+
+int mup1_ping(mup1_session_t *s, int timeout_ms) {
+    int64_t deadline = mup1_now_ms() + timeout_ms;
+    int ret;
+
+    s->ping_seen = false;
+    ret = mup1_send_frame(s, MUP1_TYPE_PING, NULL, 0);
+    if (ret < 0) {
+        return ret;
+    }
+
+    while (!s->ping_seen) {
+        int64_t left = deadline - mup1_now_ms();
+        if (left <= 0) {
+            return -ETIMEDOUT;
+        }
+        ret = mup1_pump(s, (int)left);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int mup1_submit(mup1_session_t *s, uint8_t method, uint16_t content_format,
+                uint16_t accept, const void *payload, size_t len) {
+    CBS_PROF_FUNC();
+    int slot = -1;
+    int n, ret;
+
+    for (int i = 0; i < MUP1_MAX_INFLIGHT; i++) {
+        if (!s->slots[i].used) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return -EBUSY;
+    }
+
+    uint16_t token = s->next_token++;
+    if (s->next_token > 0x7FFF) {
+        s->next_token = 1;
+    }
+
+    n = coap_encode(s->coap_buf, sizeof(s->coap_buf), COAP_TYPE_CON, method,
+                    s->next_message_id++, token, "c", content_format, accept,
+                    payload, len);
+    if (n < 0) {
+        return n;
+    }
+
+    ret = mup1_send_frame(s, MUP1_TYPE_COAP, s->coap_buf, n);
+    if (ret < 0) {
+        return ret;
+    }
+
+    s->slots[slot].used = true;
+    s->slots[slot].done = false;
+    s->slots[slot].token = token;
+    s->stats.requests++;
+    return token;
+}
+
+int mup1_wait(mup1_session_t *s, int request_id, mup1_response_t *response, int timeout_ms) {
+    CBS_PROF_FUNC();
+    int64_t deadline = mup1_now_ms() + timeout_ms;
+    int slot = -1;
+
+    for (int i = 0; i < MUP1_MAX_INFLIGHT; i++) {
+        if (s->slots[i].used && s->slots[i].token == request_id) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return -ENOENT;
+    }
+
+    while (!s->slots[slot].done) {
+        int64_t left = deadline - mup1_now_ms();
+        int ret;
+
+        if (left <= 0) {
+            s->slots[slot].used = false;
+            return -ETIMEDOUT;
+        }
+        ret = mup1_pump(s, (int)left);
+        if (ret < 0) {
+            /* The session is broken: this request will not be answered */
+            s->slots[slot].used = false;
+            return ret;
+        }
+    }
+
+    *response = s->slots[slot].response;
+    s->slots[slot].used = false;
+    s->slots[slot].done = false;
+    return 0;
+}
+
+int mup1_request(mup1_session_t *s, uint8_t method, uint16_t content_format,
+                 uint16_t accept, const void *payload, size_t len,
+                 mup1_response_t *response) {
+    CBS_PROF_FUNC();
+    int id = mup1_submit(s, method, content_format, accept, payload, len);
+    if (id < 0) {
+        return id;
+    }
+    return mup1_wait(s, id, response, MUP1_DEFAULT_TIMEOUT_MS);
+}
+
+void mup1_response_free(mup1_response_t *response) {
+    free(response->payload);
+    response->payload = NULL;
+    response->payload_len = 0;
+}
+
+const mup1_stats_t *mup1_get_stats(const mup1_session_t *s) {
+    return &s->stats;
+}
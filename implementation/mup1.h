@@ -0,0 +1,200 @@
+/**
+ * MUP1 (Microchip UART Protocol #1) client for VelocityDriveSP boards
+ * Persistent CoAP-over-MUP1 session with pipelined, token-matched requests
+ */
+
+#ifndef MUP1_H
+#define MUP1_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* MUP1 Framing */
+#define MUP1_SOF                    '>'
+#define MUP1_EOF                    '<'
+#define MUP1_ESC                    '\\'
+#define MUP1_TYPE_ANNOUNCE          'A'
+#define MUP1_TYPE_COAP              'C'
+#define MUP1_TYPE_PING              'P'
+#define MUP1_TYPE_TRACE             'T'
+#define MUP1_MAX_FRAME              8192    /* unescaped payload bytes */
+
+/* CoAP Methods and Response Codes (class << 5 | detail) */
+#define COAP_GET                    0x01
+#define COAP_POST                   0x02
+#define COAP_PUT                    0x03
+#define COAP_DELETE                 0x04
+#define COAP_FETCH                  0x05
+#define COAP_IPATCH                 0x07
+#define COAP_CHANGED                0x44    /* 2.04 */
+#define COAP_CONTENT                0x45    /* 2.05 */
+#define COAP_CODE_CLASS(c)          ((c) >> 5)
+
+/* Content Formats */
+#define COAP_CF_NONE                0xFFFF
+#define COAP_CF_YANG_DATA_CBOR      140     /* application/yang-data+cbor; id=sid */
+#define COAP_CF_YANG_IDS_CBOR       141     /* application/yang-identifiers+cbor-seq */
+#define COAP_CF_YANG_INST_CBOR      142     /* application/yang-instances+cbor-seq */
+#define COAP_CF_YAML                65000   /* experimental range: YAML text */
+
+/* Session Limits */
+#define MUP1_MAX_INFLIGHT           16
+#define MUP1_DEFAULT_TIMEOUT_MS     5000
+
+typedef struct mup1_session mup1_session_t;
+
+/* CoAP Response */
+typedef struct {
+    uint8_t code;               /* COAP_CHANGED, COAP_CONTENT, 4.xx, 5.xx */
+    uint16_t content_format;    /* COAP_CF_NONE if absent */
+    uint8_t *payload;           /* malloc'd, release with mup1_response_free */
+    size_t payload_len;
+} mup1_response_t;
+
+/* Session Statistics */
+typedef struct {
+    uint64_t requests;
+    uint64_t responses;
+    uint64_t tx_bytes;          /* bytes written to the TTY */
+    uint64_t rx_bytes;          /* bytes read from the TTY */
+    uint64_t bad_frames;        /* checksum or framing errors */
+} mup1_stats_t;
+
+/**
+ * Open a session: configure the TTY once and handshake with a ping
+ * @param device: Serial device (e.g. /dev/ttyACM0 or a pty)
+ * @return: Session, NULL on error
+ */
+mup1_session_t *mup1_open(const char *device);
+
+/**
+ * Close a session
+ * @param session: Session (NULL is ignored)
+ */
+void mup1_close(mup1_session_t *session);
+
+/**
+ * Send a ping and wait for the reply
+ * @param session: Session
+ * @param timeout_ms: Maximum wait
+ * @return: 0 on success, negative on error
+ */
+int mup1_ping(mup1_session_t *session, int timeout_ms);
+
+/**
+ * Submit a CoAP request without waiting for its response
+ * Up to MUP1_MAX_INFLIGHT requests may be outstanding
+ * @param session: Session
+ * @param method: COAP_GET, COAP_FETCH, COAP_IPATCH, ...
+ * @param content_format: Payload format, COAP_CF_NONE if no payload
+ * @param accept: Requested response format, COAP_CF_NONE to omit
+ * @param payload: Request payload (may be NULL)
+ * @param len: Payload length
+ * @return: Request ID (>= 0) on success, negative on error
+ */
+int mup1_submit(mup1_session_t *session, uint8_t method, uint16_t content_format,
+                uint16_t accept, const void *payload, size_t len);
+
+/**
+ * Wait for the response to a submitted request
+ * Responses to other requests that arrive first are kept for later
+ * @param session: Session
+ * @param request_id: ID returned by mup1_submit
+ * @param response: Filled on success
+ * @param timeout_ms: Maximum wait
+ * @return: 0 on success, -ETIMEDOUT, negative on error
+ */
+int mup1_wait(mup1_session_t *session, int request_id, mup1_response_t *response,
+              int timeout_ms);
+
+/**
+ * Submit a request and wait for its response
+ * @return: 0 on success, negative on error
+ */
+int mup1_request(mup1_session_t *session, uint8_t method, uint16_t content_format,
+                 uint16_t accept, const void *payload, size_t len,
+                 mup1_response_t *response);
+
+/**
+ * Release a response payload
+ * @param response: Response
+ */
+void mup1_response_free(mup1_response_t *response);
+
+/**
+ * Get session statistics
+ * @param session: Session
+ * @return: Statistics
+ */
+const mup1_stats_t *mup1_get_stats(const mup1_session_t *session);
+
+/* Framing helpers, shared with the pty stand-in device */
+
+/**
+ * Encode one MUP1 frame (SOF, type, escaped data, EOF padding, checksum)
+ * @param type: Frame type
+ * @param data: Unescaped data
+ * @param len: Data length
+ * @param out: Output buffer
+ * @param out_size: Output buffer size
+ * @return: Encoded length, negative if out is too small
+ */
+int mup1_encode_frame(uint8_t type, const uint8_t *data, size_t len,
+                      uint8_t *out, size_t out_size);
+
+/* Incremental frame decoder */
+typedef struct {
+    int state;
+    uint8_t type;
+    uint16_t sum_hi;            /* pending high byte of a checksum word */
+    bool odd;                   /* odd number of raw bytes so far */
+    uint32_t sum;               /* running 16-bit ones' complement sum */
+    uint16_t rx_check;
+    int check_digits;
+    size_t len;
+    uint8_t data[MUP1_MAX_FRAME];
+} mup1_decoder_t;
+
+/**
+ * Reset a frame decoder
+ * @param dec: Decoder
+ */
+void mup1_decoder_reset(mup1_decoder_t *dec);
+
+/**
+ * Feed one received byte to the decoder
+ * @param dec: Decoder
+ * @param byte: Received byte
+ * @return: 1 when a complete, valid frame is in dec->type/data/len,
+ *          0 if more bytes are needed, negative on a framing error
+ */
+int mup1_decoder_feed(mup1_decoder_t *dec, uint8_t byte);
+
+/**
+ * Encode a CoAP confirmable message
+ * @return: Encoded length, negative on error
+ */
+int coap_encode(uint8_t *out, size_t out_size, uint8_t type, uint8_t code,
+                uint16_t message_id, uint16_t token, const char *uri_path,
+                uint16_t content_format, uint16_t accept,
+                const void *payload, size_t len);
+
+/* Decoded CoAP message (payload points into the input buffer) */
+typedef struct {
+    uint8_t type;
+    uint8_t code;
+    uint16_t message_id;
+    uint16_t token;
+    uint16_t content_format;
+    const uint8_t *payload;
+    size_t payload_len;
+} coap_msg_t;
+
+/**
+ * Decode a CoAP message
+ * @return: 0 on success, negative on malformed input
+ */
+int coap_decode(const uint8_t *buf, size_t len, coap_msg_t *msg);
+
+#endif /* MUP1_H */
@@ -0,0 +1,336 @@
+/**
+ * MUP1 stand-in device for testing without an EVB-LAN9692
+ * Creates a pty that answers pings and CoAP requests like VelocityDriveSP
+ * CBOR and YAML patches are kept in a small datastore
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <errno.h>
+#include "mup1.h"
+#include "evb_changeset.h"
+#include "coreconf.h"
+
+#define SIM_VERSION     "mup1_sim VelocitySP-stand-in"
+#define SIM_MAX_HELD    MUP1_MAX_INFLIGHT
+
+static volatile sig_atomic_t running = 1;
+
+static int baud;            /* 0 = unthrottled */
+static int delay_us;        /* per-request processing time */
+static int reorder;         /* answer pipelined requests in reverse order */
+static int verbose;         /* report the requests served on exit */
+
+static struct {
+    uint8_t frame[MUP1_MAX_FRAME * 2 + 8];
+    int len;
+} held[SIM_MAX_HELD];
+static int n_held;
+
+/* Datastore and request scratch sets */
+static evb_changeset_t store, request, response, merged;
+static unsigned long fetches;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+/* Write one encoded frame, paced to the configured line rate */
+static void sim_send(int fd, const uint8_t *buf, int len) {
+    while (len > 0) {
+        int chunk = len;
+        ssize_t n;
+
+        if (baud > 0 && chunk > 64) {
+            chunk = 64;
+        }
+        n = write(fd, buf, chunk);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return;
+        }
+        if (baud > 0) {
+            /* 10 bit times per byte (8N1) */
+            usleep((useconds_t)((uint64_t)n * 10 * 1000000 / baud));
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static void sim_queue(int fd, uint8_t type, const uint8_t *data, size_t len) {
+    uint8_t frame[MUP1_MAX_FRAME * 2 + 8];
+    int n = mup1_encode_frame(type, data, len, frame, sizeof(frame));
+
+    if (n < 0) {
+        return;
+    }
+    if (reorder && n_held < SIM_MAX_HELD) {
+        memcpy(held[n_held].frame, frame, n);
+        held[n_held].len = n;
+        n_held++;
+        return;
+    }
+    sim_send(fd, frame, n);
+}
+
+/* Release held replies newest first */
+static void sim_release(int fd) {
+    while (n_held > 0) {
+        n_held--;
+        sim_send(fd, held[n_held].frame, held[n_held].len);
+    }
+}
+
+/* Replace or add every patched entry in the datastore */
+static void sim_store_patch(const evb_changeset_t *patch) {
+    evb_cs_init(&merged);
+    for (int i = 0; i < store.n_entries; i++) {
+        if (evb_cs_find(patch, evb_cs_str(&store, store.entries[i].path)) == EVB_CS_NONE) {
+            evb_cs_copy_entry(&merged, &store, i);
+        }
+    }
+    for (int i = 0; i < patch->n_entries; i++) {
+        evb_cs_copy_entry(&merged, patch, i);
+    }
+    if (!merged.overflow) {
+        store = merged;
+    }
+}
+
+/* Per traffic class counters that advance with every fetch */
+static void sim_add_stats(evb_changeset_t *cs, const char *path) {
+    int list = evb_cs_set_list(cs, "%s", path);
+
+    for (int tc = 0; tc < 8; tc++) {
+        uint64_t frames = (uint64_t)(fetches + 1) * 1000 * (tc + 1);
+        int item = evb_cs_map(cs, list, NULL);
+
+        evb_cs_uint(cs, item, "traffic-class", tc);
+        evb_cs_uint(cs, item, "tx-frames", frames);
+        evb_cs_uint(cs, item, "tx-octets", frames * 1200);
+        evb_cs_uint(cs, item, "rx-frames", frames + tc);
+        evb_cs_uint(cs, item, "rx-octets", (frames + tc) * 1200);
+        evb_cs_uint(cs, item, "drops", tc == 0 ? fetches : 0);
+    }
+}
+
+/* Collect "- \"path\"" lines of a YAML fetch body */
+static void sim_parse_yaml_fetch(const coap_msg_t *msg, evb_changeset_t *cs) {
+    const char *p = (const char *)msg->payload;
+    const char *end = p + msg->payload_len;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        const char *q1, *q2;
+
+        if (eol == NULL) eol = end;
+        q1 = memchr(p, '"', eol - p);
+        q2 = q1 ? memchr(q1 + 1, '"', eol - q1 - 1) : NULL;
+        if (p[0] == '-' && q1 && q2) {
+            evb_cs_fetch(cs, "%.*s", (int)(q2 - q1 - 1), q1 + 1);
+        }
+        p = eol + 1;
+    }
+}
+
+static void sim_handle_coap(int fd, const mup1_decoder_t *dec) {
+    static uint8_t out[MUP1_MAX_FRAME];
+    static uint8_t body[MUP1_MAX_FRAME];
+    coap_msg_t msg;
+    uint8_t code;
+    const void *payload = NULL;
+    uint16_t format = COAP_CF_NONE;
+    int len = 0;
+    int n;
+
+    if (coap_decode(dec->data, dec->len, &msg) < 0) {
+        return;
+    }
+    if (delay_us > 0) {
+        usleep(delay_us);
+    }
+
+    switch (msg.code) {
+    case COAP_IPATCH:
+    case COAP_PUT:
+    case COAP_POST:
+        code = COAP_CHANGED;
+        if (msg.content_format == COAP_CF_YANG_INST_CBOR) {
+            evb_cs_init(&request);
+            if (coreconf_decode(msg.payload, msg.payload_len, &request) < 0) {
+                code = 0x80;    /* 4.00 Bad Request */
+            } else {
+                sim_store_patch(&request);
+            }
+        } else if (msg.content_format == COAP_CF_YAML) {
+            evb_cs_init(&request);
+            if (evb_cs_parse_yaml(&request, (const char *)msg.payload, msg.payload_len) < 0) {
+                code = 0x80;
+            } else {
+                sim_store_patch(&request);
+            }
+        }
+        break;
+    case COAP_FETCH:
+        /* Answer from the datastore, statistics are synthesized */
+        code = COAP_CONTENT;
+        evb_cs_init(&request);
+        evb_cs_init(&response);
+        if (msg.content_format == COAP_CF_YANG_IDS_CBOR) {
+            if (coreconf_decode_fetch(msg.payload, msg.payload_len, &request) < 0) {
+                code = 0x80;
+                break;
+            }
+        } else {
+            sim_parse_yaml_fetch(&msg, &request);
+        }
+        for (int i = 0; i < request.n_entries; i++) {
+            const char *path = evb_cs_str(&request, request.entries[i].path);
+            int hit = evb_cs_find(&store, path);
+
+            if (strstr(path, "/statistics/traffic-class")) {
+                sim_add_stats(&response, path);
+            } else if (hit != EVB_CS_NONE) {
+                evb_cs_copy_entry(&response, &store, hit);
+            } else {
+                evb_cs_set_map(&response, "%s", path);
+            }
+        }
+        fetches++;
+        if (msg.content_format == COAP_CF_YANG_IDS_CBOR) {
+            len = coreconf_encode_patch(&response, body, sizeof(body));
+            format = COAP_CF_YANG_INST_CBOR;
+        } else {
+            len = evb_cs_render_yaml(&response, (char *)body, sizeof(body));
+            format = COAP_CF_YAML;
+        }
+        if (len < 0) {
+            code = 0xA0;        /* 5.00 Internal Server Error */
+            len = 0;
+        }
+        payload = body;
+        break;
+    case COAP_GET:
+        /* Echo the request back as the "datastore" contents */
+        code = COAP_CONTENT;
+        payload = msg.payload;
+        len = msg.payload_len;
+        format = msg.content_format;
+        break;
+    default:
+        code = 0x85;    /* 4.05 Method Not Allowed */
+        break;
+    }
+
+    n = coap_encode(out, sizeof(out), 2 /* ACK */, code, msg.message_id, msg.token, NULL,
+                    len ? format : COAP_CF_NONE, COAP_CF_NONE, payload, len);
+    if (n > 0) {
+        sim_queue(fd, MUP1_TYPE_COAP, out, n);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    mup1_decoder_t *dec;
+    uint8_t buf[4096];
+    unsigned long requests = 0;
+    int master, slave, opt;
+
+    while ((opt = getopt(argc, argv, "b:d:rvh")) != -1) {
+        switch (opt) {
+        case 'b': baud = atoi(optarg); break;
+        case 'd': delay_us = atoi(optarg); break;
+        case 'r': reorder = 1; break;
+        case 'v': verbose = 1; break;
+        default:
+            printf("Usage: %s [-b baud] [-d delay_us] [-r] [-v]\n", argv[0]);
+            printf("  -b  Throttle traffic to a serial line rate (e.g. 115200)\n");
+            printf("  -d  Per-request processing delay in microseconds\n");
+            printf("  -r  Answer pipelined requests out of order\n");
+            printf("  -v  Print the number of requests served on exit\n");
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        perror("Failed to create pty");
+        return 1;
+    }
+
+    /* Hold the slave open so the master never sees a hangup between clients */
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave >= 0) {
+        struct termios tio;
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+
+    dec = malloc(sizeof(*dec));
+    if (dec == NULL) {
+        return 1;
+    }
+    mup1_decoder_reset(dec);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("%s\n", ptsname(master));
+    fflush(stdout);
+
+    while (running) {
+        struct pollfd pfd = { .fd = master, .events = POLLIN };
+        int ret = poll(&pfd, 1, n_held ? 0 : 200);
+
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (ret == 0) {
+            /* Input drained: flush replies held for reordering */
+            sim_release(master);
+            continue;
+        }
+
+        ssize_t n = read(master, buf, sizeof(buf));
+        if (n <= 0) {
+            continue;
+        }
+        if (baud > 0) {
+            /* The request also crosses the serial line */
+            usleep((useconds_t)((uint64_t)n * 10 * 1000000 / baud));
+        }
+
+        for (ssize_t i = 0; i < n; i++) {
+            if (mup1_decoder_feed(dec, buf[i]) != 1) {
+                continue;
+            }
+            if (dec->type == MUP1_TYPE_PING) {
+                uint8_t frame[64];
+                int len = mup1_encode_frame(MUP1_TYPE_PING, (const uint8_t *)SIM_VERSION,
+                                            strlen(SIM_VERSION), frame, sizeof(frame));
+                sim_send(master, frame, len);
+            } else if (dec->type == MUP1_TYPE_COAP) {
+                sim_handle_coap(master, dec);
+                requests++;
+            }
+        }
+    }
+
+    if (verbose) {
+        fprintf(stderr, "mup1_sim: %lu requests served\n", requests);
+    }
+    free(dec);
+    if (slave >= 0) close(slave);
+    close(master);
+    return 0;
+}